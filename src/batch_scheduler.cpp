@@ -0,0 +1,265 @@
+/*
+ * dsf2flac - http://code.google.com/p/dsf2flac/
+ *
+ * A file conversion tool for translating dsf dsd audio files into
+ * flac pcm audio files.
+ *
+ * Copyright (c) 2013 by respective authors.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *
+ * Acknowledgments
+ *
+ * Many thanks to the following authors and projects whose work has greatly
+ * helped the development of this tool.
+ *
+ *
+ * Sebastian Gesemann - dsd2pcm (http://code.google.com/p/dsd2pcm/)
+ * SACD Ripper (http://code.google.com/p/sacd-ripper/)
+ * Maxim V.Anisiutkin - foo_input_sacd (http://sourceforge.net/projects/sacddecoder/files/)
+ * Vladislav Goncharov - foo_input_sacd_hq (http://vladgsound.wordpress.com)
+ * Jesus R - www.sonore.us
+ *
+ */
+
+#include "batch_scheduler.h"
+#include <boost/filesystem/fstream.hpp>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <thread>
+
+BatchScheduler::BatchScheduler(dsf2flac_uint32 n)
+{
+	nWorkers = n;
+	if (nWorkers == 0)
+		nWorkers = std::thread::hardware_concurrency();
+	if (nWorkers == 0)
+		nWorkers = 1;
+	nStarted = 0;
+	nDone = 0;
+	nFailed = 0;
+	bytesDone = 0;
+}
+
+BatchScheduler::~BatchScheduler()
+{
+	for (dsf2flac_uint32 i = 0; i < queues.size(); i++)
+		delete queues[i];
+}
+
+bool BatchScheduler::isDsdFile(boost::filesystem::path path)
+{
+	std::string ext = path.extension().string();
+	return ext == ".dsf" || ext == ".DSF" || ext == ".dff" || ext == ".DFF";
+}
+
+void BatchScheduler::addJob(boost::filesystem::path path, boost::filesystem::path relPath)
+{
+	BatchJob job;
+	job.path = path;
+	job.relPath = relPath;
+	boost::system::error_code ec;
+	job.size = boost::filesystem::file_size(path, ec);
+	if (ec)
+		job.size = 0;
+	job.track = -1;
+	jobs.push_back(job);
+}
+
+void BatchScheduler::addTrack(boost::filesystem::path path, dsf2flac_int32 track, dsf2flac_uint64 size)
+{
+	BatchJob job;
+	job.path = path;
+	job.relPath = path.filename();
+	job.size = size;
+	job.track = track;
+	jobs.push_back(job);
+}
+
+void BatchScheduler::addDirectory(boost::filesystem::path dir)
+{
+	boost::system::error_code ec;
+	boost::filesystem::recursive_directory_iterator it(dir, ec), end;
+	for (; !ec && it != end; it.increment(ec)) {
+		if (boost::filesystem::is_regular_file(it->path()) && isDsdFile(it->path()))
+			addJob(it->path(), boost::filesystem::relative(it->path(), dir));
+	}
+	if (ec)
+		fprintf(stderr, "WARNING: %s: %s\n", dir.c_str(), ec.message().c_str());
+}
+
+bool BatchScheduler::addPath(boost::filesystem::path path)
+{
+	if (boost::filesystem::is_directory(path)) {
+		addDirectory(path);
+		return true;
+	}
+	if (!boost::filesystem::is_regular_file(path))
+		return false;
+	if (isDsdFile(path)) {
+		addJob(path, path.filename());
+		return true;
+	}
+	// a list of files and directories, relative entries are relative to the list itself
+	boost::filesystem::ifstream list(path);
+	if (!list)
+		return false;
+	std::string line;
+	while (std::getline(list, line)) {
+		if (!line.empty() && line[line.size() - 1] == '\r')
+			line.erase(line.size() - 1);
+		if (line.empty() || line[0] == '#')
+			continue;
+		boost::filesystem::path entry(line);
+		if (entry.is_relative())
+			entry = path.parent_path() / entry;
+		if (boost::filesystem::is_directory(entry))
+			addDirectory(entry);
+		else if (boost::filesystem::is_regular_file(entry) && isDsdFile(entry))
+			addJob(entry, entry.filename());
+		else
+			fprintf(stderr, "WARNING: skipping %s, not a DSF or DFF file or directory\n", entry.c_str());
+	}
+	return true;
+}
+
+static bool largerJob(const BatchJob& a, const BatchJob& b)
+{
+	return a.size > b.size;
+}
+
+bool BatchScheduler::takeJob(dsf2flac_uint32 worker, BatchJob& out)
+{
+	{
+		std::lock_guard<std::mutex> l(queues[worker]->lock);
+		if (!queues[worker]->jobs.empty()) {
+			out = queues[worker]->jobs.front();
+			queues[worker]->jobs.pop_front();
+			return true;
+		}
+	}
+	// steal the largest job left in the other queues, each is sorted so only the fronts need checking.
+	while (true) {
+		dsf2flac_int32 victim = -1;
+		dsf2flac_uint64 victimSize = 0;
+		for (dsf2flac_uint32 i = 0; i < queues.size(); i++) {
+			if (i == worker)
+				continue;
+			std::lock_guard<std::mutex> l(queues[i]->lock);
+			if (!queues[i]->jobs.empty() && (victim < 0 || queues[i]->jobs.front().size > victimSize)) {
+				victim = i;
+				victimSize = queues[i]->jobs.front().size;
+			}
+		}
+		if (victim < 0)
+			return false;
+		std::lock_guard<std::mutex> l(queues[victim]->lock);
+		// the owner (or another thief) may have got there first, in which case look again.
+		if (!queues[victim]->jobs.empty()) {
+			out = queues[victim]->jobs.front();
+			queues[victim]->jobs.pop_front();
+			return true;
+		}
+	}
+}
+
+void BatchScheduler::workerLoop(dsf2flac_uint32 worker, JobFunction job)
+{
+	BatchJob j;
+	while (takeJob(worker, j)) {
+		{
+			std::lock_guard<std::mutex> l(statsLock);
+			nStarted++;
+		}
+		bool ok = job(j);
+		std::lock_guard<std::mutex> l(statsLock);
+		nDone++;
+		if (!ok)
+			nFailed++;
+		bytesDone += j.size;
+	}
+}
+
+void BatchScheduler::run(JobFunction job, ProgressFunction progress, dsf2flac_uint32 intervalMs)
+{
+	// deal the jobs out largest first
+	std::stable_sort(jobs.begin(), jobs.end(), largerJob);
+	dsf2flac_uint32 nThreads = std::min<dsf2flac_uint32>(nWorkers, jobs.size());
+	for (dsf2flac_uint32 i = queues.size(); i < nThreads; i++)
+		queues.push_back(new JobQueue);
+	for (dsf2flac_uint32 i = 0; i < jobs.size(); i++)
+		queues[i % nThreads]->jobs.push_back(jobs[i]);
+
+	std::mutex doneLock;
+	std::condition_variable doneCond;
+	dsf2flac_uint32 nRunning = nThreads;
+	std::vector<std::thread> threads;
+	for (dsf2flac_uint32 i = 0; i < nThreads; i++) {
+		threads.push_back(std::thread([this, i, job, &doneLock, &doneCond, &nRunning]() {
+			workerLoop(i, job);
+			std::lock_guard<std::mutex> l(doneLock);
+			nRunning--;
+			doneCond.notify_all();
+		}));
+	}
+
+	// report progress until the workers finish
+	{
+		std::unique_lock<std::mutex> l(doneLock);
+		while (nRunning > 0) {
+			if (!doneCond.wait_for(l, std::chrono::milliseconds(intervalMs), [&nRunning]() { return nRunning == 0; }) && progress) {
+				l.unlock();
+				progress();
+				l.lock();
+			}
+		}
+	}
+	for (dsf2flac_uint32 i = 0; i < threads.size(); i++)
+		threads[i].join();
+}
+
+dsf2flac_uint64 BatchScheduler::getTotalBytes()
+{
+	dsf2flac_uint64 total = 0;
+	for (dsf2flac_uint32 i = 0; i < jobs.size(); i++)
+		total += jobs[i].size;
+	return total;
+}
+
+dsf2flac_uint32 BatchScheduler::getNumDone()
+{
+	std::lock_guard<std::mutex> l(statsLock);
+	return nDone;
+}
+
+dsf2flac_uint32 BatchScheduler::getNumRunning()
+{
+	std::lock_guard<std::mutex> l(statsLock);
+	return nStarted - nDone;
+}
+
+dsf2flac_uint32 BatchScheduler::getNumFailed()
+{
+	std::lock_guard<std::mutex> l(statsLock);
+	return nFailed;
+}
+
+dsf2flac_uint64 BatchScheduler::getBytesDone()
+{
+	std::lock_guard<std::mutex> l(statsLock);
+	return bytesDone;
+}
@@ -0,0 +1,131 @@
+/*
+ * dsf2flac - http://code.google.com/p/dsf2flac/
+ *
+ * A file conversion tool for translating dsf dsd audio files into
+ * flac pcm audio files.
+ *
+ * Copyright (c) 2013 by respective authors.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *
+ * Acknowledgments
+ *
+ * Many thanks to the following authors and projects whose work has greatly
+ * helped the development of this tool.
+ *
+ *
+ * Sebastian Gesemann - dsd2pcm (http://code.google.com/p/dsd2pcm/)
+ * SACD Ripper (http://code.google.com/p/sacd-ripper/)
+ * Maxim V.Anisiutkin - foo_input_sacd (http://sourceforge.net/projects/sacddecoder/files/)
+ * Vladislav Goncharov - foo_input_sacd_hq (http://vladgsound.wordpress.com)
+ * Jesus R - www.sonore.us
+ *
+ */
+
+#ifndef BATCHSCHEDULER_H
+#define BATCHSCHEDULER_H
+
+#include "dsf2flac_types.h"
+#include <boost/filesystem.hpp>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+/// One input file (or one track of it) for the BatchScheduler.
+typedef struct {
+	boost::filesystem::path path;		// the input file
+	boost::filesystem::path relPath;	// path relative to the batch root it was found under
+	dsf2flac_uint64 size;				// file size in bytes, used to order the work
+	dsf2flac_int32 track;				// the track to convert, -1 for the whole file
+} BatchJob;
+
+/**
+ * Converts a list of files on a fixed pool of worker threads.
+ *
+ * The jobs are sorted largest first and dealt round robin into one queue per worker, so every
+ * worker starts on a big file and the small ones are left to fill the gaps at the end.
+ * A worker takes jobs from its own queue and, once that is empty, steals the largest job left
+ * in the other queues. Each queue has its own lock, so workers rarely wait on each other.
+ */
+class BatchScheduler
+{
+public:
+	/// The work to do for each job, returns false if the job failed. Called from the worker threads.
+	typedef std::function<bool (const BatchJob& job)> JobFunction;
+	/// Called periodically from the thread which called run() while the workers are busy.
+	typedef std::function<void ()> ProgressFunction;
+
+	/// Class constructor. nWorkers = 0 uses one worker per cpu core.
+	BatchScheduler(dsf2flac_uint32 nWorkers);
+	/// Class destructor.
+	virtual ~BatchScheduler();
+
+	/// Add one file to the batch.
+	void addJob(boost::filesystem::path path, boost::filesystem::path relPath);
+	/// Add one track of a file to the batch, size is anything proportional to the work (e.g. the track length).
+	void addTrack(boost::filesystem::path path, dsf2flac_int32 track, dsf2flac_uint64 size);
+	/**
+	 * Add every .dsf and .dff file found in path. A directory is searched recursively,
+	 * a single DSD file is added as it is and any other file is read as a list of files
+	 * and directories, one per line. Returns false if path can't be read.
+	 */
+	bool addPath(boost::filesystem::path path);
+
+	/// Run every job and wait for them to finish. progress (if set) is called every intervalMs.
+	void run(JobFunction job, ProgressFunction progress = ProgressFunction(), dsf2flac_uint32 intervalMs = 1000);
+
+	/// The number of worker threads.
+	dsf2flac_uint32 getNumWorkers() { return nWorkers; };
+	/// The number of jobs in the batch.
+	dsf2flac_uint32 getNumJobs() { return jobs.size(); };
+	/// The total size of the batch in bytes.
+	dsf2flac_uint64 getTotalBytes();
+	/// The number of jobs finished so far (including failures).
+	dsf2flac_uint32 getNumDone();
+	/// The number of jobs being worked on now.
+	dsf2flac_uint32 getNumRunning();
+	/// The number of jobs which failed so far.
+	dsf2flac_uint32 getNumFailed();
+	/// The size in bytes of the jobs finished so far.
+	dsf2flac_uint64 getBytesDone();
+private:
+	/// The loop run by each worker thread.
+	void workerLoop(dsf2flac_uint32 worker, JobFunction job);
+	/// Take the next job for worker, stealing one if its own queue is empty. Returns false when there are none left.
+	bool takeJob(dsf2flac_uint32 worker, BatchJob& out);
+	/// Add the files under a directory.
+	void addDirectory(boost::filesystem::path dir);
+	/// True if the path looks like a DSD file.
+	static bool isDsdFile(boost::filesystem::path path);
+private:
+	/// One worker's queue of jobs, largest at the front.
+	typedef struct {
+		std::mutex lock;
+		std::deque<BatchJob> jobs;
+	} JobQueue;
+
+	dsf2flac_uint32 nWorkers;
+	std::vector<BatchJob> jobs;
+	std::vector<JobQueue*> queues;
+	std::mutex statsLock;
+	dsf2flac_uint32 nStarted;
+	dsf2flac_uint32 nDone;
+	dsf2flac_uint32 nFailed;
+	dsf2flac_uint64 bytesDone;
+};
+
+#endif // BATCHSCHEDULER_H
@@ -36,14 +36,35 @@ const char *gengetopt_args_info_description = "";
 const char *gengetopt_args_info_help[] = {
   "  -h, --help              Print help and exit",
   "  -V, --version           Print version and exit",
-  "  -r, --samplerate=Hz     Output sample rate  (possible values=\"88200\",\n                            \"176400\", \"352800\" default=`88200')",
+  "  -r, --samplerate=Hz     Output sample rate  (possible values=\"44100\",\n                            \"88200\", \"176400\", \"352800\", \"48000\",\n                            \"96000\", \"192000\", \"384000\"\n                            default=`88200')",
   "  -b, --bits=bits         Output bitdepth  (possible values=\"16\", \"20\",\n                            \"24\" default=`24')",
   "  -n, --nodither          Don't add dither before quantization  (default=off)",
   "  -s, --scale=dB          Scale adjustment. Raw DSD has a modulation depth of\n                            approximately 0.5 so with no scaling the PCM peak\n                            level is approximately -6dB below 0dBFs\n                            (default=`4')",
-  "  -i, --infile=filepath   Input DSF or DFF file",
+  "  -i, --infile=filepath   Input DSF or DFF file, - for stdin",
   "  -o, --outfile=filepath  Output FLAC file, if not specified the output file be\n                            the same as the input file with the extension\n                            changed",
   "  -d, --dop               Encode DSD data directly into FLAC file without\n                            conversion to PCM using DoP format (DSD over PCM)\n                            (default=off)",
   "  -w, --wav               Use wave file  (default=off)",
+  "      --outputs=SPECS     Write several outputs in a single pass over the input.\n                            A comma separated list of flac[:RATE[:BITS]][=FILE],\n                            dop[=FILE], dopwav[=FILE], dsf[=FILE] or dff[=FILE]",
+  "  -p, --passthrough=FORMAT\n                            Write the DSD samples unchanged into DSF or DFF\n                            files (one per track) without converting them.\n                            Uncompressed data is copied directly  (possible\n                            values=\"dsf\", \"dff\")",
+  "      --batch=PATH        Convert every DSF and DFF file found in PATH. PATH is\n                            a directory (searched recursively) or a text file\n                            listing one file or directory per line",
+  "  -j, --jobs=N            Number of files (or tracks of a multi-track input)\n                            converted at once, 0 uses one per cpu core\n                            (default=`0')",
+  "      --outdir=DIR        Write the batch mode outputs under DIR, mirroring the\n                            layout of the inputs. By default each output is\n                            written next to its input",
+  "      --cache=FILE        Keep a manifest of the conversions done in FILE and\n                            skip inputs which are unchanged since they were last\n                            converted with the same settings",
+  "      --hash              With --cache, also compare a crc32 of each input so\n                            that files which were only touched are still skipped\n                            (default=off)",
+  "      --force             With --cache, convert every input even if it is up to\n                            date  (default=off)",
+  "      --serve=SOCKET      Run as a server taking conversion requests on the unix\n                            domain socket SOCKET until interrupted. The other\n                            options given become the defaults for every request",
+  "      --realtime          Stream raw PCM (or DoP with --dop) with low latency,\n                            for playing through a pipe. The decoding runs on a\n                            real time thread and the output is written a period at\n                            a time  (default=off)",
+  "      --period=FRAMES     With --realtime, the number of frames written at a\n                            time  (default=`256')",
+  "      --periods=N         With --realtime, the number of periods decoded ahead\n                            of the output  (default=`4')",
+  "      --stats             Print how long each stage of the conversion took\n                            (read, DST decode, decimate, quantize, encode and\n                            write) as a line of JSON on stderr after each file.\n                            Sending the process SIGUSR1 prints the totals so far.\n                            (default=off)",
+  "      --metrics-fd=FD     Write the progress of the run as a line of JSON to\n                            file descriptor FD every --metrics-interval: audio\n                            converted, realtime factor, jobs queued, running and\n                            finished, bytes in and out and errors.",
+  "      --metrics-file=FILE Keep FILE up to date with the same metrics in the\n                            Prometheus text format, for node_exporter's textfile\n                            collector.",
+  "      --metrics-interval=MS\n                            How often the metrics are written, in milliseconds.\n                            (default=`1000')",
+  "      --input-format=FORMAT\n                            The format of the input when it can't be told from\n                            the extension, such as - for stdin or a named pipe\n                            (possible values=\"dsf\", \"dff\")",
+  "      --filter=FILE       Decimate with the filter in FILE instead of the built-\n                            in one for its ratio, several files can be given\n                            separated by commas. See fir_filter.h for the file\n                            format.",
+  "      --filter-cache=DIR  The folder the lookup tables of --filter filters are\n                            saved in, by default $XDG_CACHE_HOME/dsf2flac or\n                            ~/.cache/dsf2flac. An empty DIR does not save them.",
+  "      --quality=PRESET    The filter set for 352800, 176400 and 88200 from DSD64\n                            (and the other rates with the same ratio): reference,\n                            fast (half the taps, 120dB down) or minphase (minimum\n                            phase, a third of the delay).  (possible\n                            values=\"reference\", \"fast\", \"minphase\"\n                            default=`reference')",
+  "      --fixed-point       Compute integer PCM in fixed point, with the scale\n                            folded into int32 filter tables, so the output is bit\n                            exact on every platform. Used for the single filter\n                            rates, the others are computed in floating point as\n                            usual.  (default=off)",
     0
 };
 
@@ -66,8 +87,11 @@ cmdline_parser_internal (int argc, char **argv, struct gengetopt_args_info *args
 static int
 cmdline_parser_required2 (struct gengetopt_args_info *args_info, const char *prog_name, const char *additional_error);
 
-const char *cmdline_parser_samplerate_values[] = {"88200", "176400", "352800", 0}; /*< Possible values for samplerate. */
+const char *cmdline_parser_samplerate_values[] = {"44100", "88200", "176400", "352800", "48000", "96000", "192000", "384000", 0}; /*< Possible values for samplerate. */
 const char *cmdline_parser_bits_values[] = {"16", "20", "24", 0}; /*< Possible values for bits. */
+const char *cmdline_parser_quality_values[] = {"reference", "fast", "minphase", 0}; /*< Possible values for quality. */
+const char *cmdline_parser_input_format_values[] = {"dsf", "dff", 0}; /*< Possible values for input-format. */
+const char *cmdline_parser_passthrough_values[] = {"dsf", "dff", 0}; /*< Possible values for passthrough. */
 
 static char *
 gengetopt_strdup (const char *s);
@@ -85,6 +109,27 @@ void clear_given (struct gengetopt_args_info *args_info)
   args_info->outfile_given = 0 ;
   args_info->dop_given = 0 ;
   args_info->wav_given = 0 ;
+  args_info->outputs_given = 0 ;
+  args_info->passthrough_given = 0 ;
+  args_info->batch_given = 0 ;
+  args_info->jobs_given = 0 ;
+  args_info->outdir_given = 0 ;
+  args_info->cache_given = 0 ;
+  args_info->hash_given = 0 ;
+  args_info->force_given = 0 ;
+  args_info->serve_given = 0 ;
+  args_info->realtime_given = 0 ;
+  args_info->period_given = 0 ;
+  args_info->periods_given = 0 ;
+  args_info->stats_given = 0 ;
+  args_info->metrics_fd_given = 0 ;
+  args_info->metrics_file_given = 0 ;
+  args_info->metrics_interval_given = 0 ;
+  args_info->input_format_given = 0 ;
+  args_info->filter_given = 0 ;
+  args_info->filter_cache_given = 0 ;
+  args_info->quality_given = 0 ;
+  args_info->fixed_point_given = 0 ;
 }
 
 static
@@ -104,6 +149,43 @@ void clear_args (struct gengetopt_args_info *args_info)
   args_info->outfile_orig = NULL;
   args_info->dop_flag = 0;
   args_info->wav_flag = 0;
+  args_info->outputs_arg = NULL;
+  args_info->outputs_orig = NULL;
+  args_info->passthrough_arg = NULL;
+  args_info->passthrough_orig = NULL;
+  args_info->batch_arg = NULL;
+  args_info->batch_orig = NULL;
+  args_info->jobs_arg = 0;
+  args_info->jobs_orig = NULL;
+  args_info->outdir_arg = NULL;
+  args_info->outdir_orig = NULL;
+  args_info->cache_arg = NULL;
+  args_info->cache_orig = NULL;
+  args_info->hash_flag = 0;
+  args_info->force_flag = 0;
+  args_info->serve_arg = NULL;
+  args_info->serve_orig = NULL;
+  args_info->realtime_flag = 0;
+  args_info->period_arg = 256;
+  args_info->period_orig = NULL;
+  args_info->periods_arg = 4;
+  args_info->periods_orig = NULL;
+  args_info->stats_flag = 0;
+  args_info->metrics_fd_arg = 0;
+  args_info->metrics_fd_orig = NULL;
+  args_info->metrics_file_arg = NULL;
+  args_info->metrics_file_orig = NULL;
+  args_info->metrics_interval_arg = 1000;
+  args_info->metrics_interval_orig = NULL;
+  args_info->input_format_arg = NULL;
+  args_info->input_format_orig = NULL;
+  args_info->filter_arg = NULL;
+  args_info->filter_orig = NULL;
+  args_info->filter_cache_arg = NULL;
+  args_info->filter_cache_orig = NULL;
+  args_info->quality_arg = gengetopt_strdup ("reference");
+  args_info->quality_orig = NULL;
+  args_info->fixed_point_flag = 0;
   
 }
 
@@ -122,6 +204,27 @@ void init_args_info(struct gengetopt_args_info *args_info)
   args_info->outfile_help = gengetopt_args_info_help[7] ;
   args_info->dop_help = gengetopt_args_info_help[8] ;
   args_info->wav_help = gengetopt_args_info_help[9] ;
+  args_info->outputs_help = gengetopt_args_info_help[10] ;
+  args_info->passthrough_help = gengetopt_args_info_help[11] ;
+  args_info->batch_help = gengetopt_args_info_help[12] ;
+  args_info->jobs_help = gengetopt_args_info_help[13] ;
+  args_info->outdir_help = gengetopt_args_info_help[14] ;
+  args_info->cache_help = gengetopt_args_info_help[15] ;
+  args_info->hash_help = gengetopt_args_info_help[16] ;
+  args_info->force_help = gengetopt_args_info_help[17] ;
+  args_info->serve_help = gengetopt_args_info_help[18] ;
+  args_info->realtime_help = gengetopt_args_info_help[19] ;
+  args_info->period_help = gengetopt_args_info_help[20] ;
+  args_info->periods_help = gengetopt_args_info_help[21] ;
+  args_info->stats_help = gengetopt_args_info_help[22] ;
+  args_info->metrics_fd_help = gengetopt_args_info_help[23] ;
+  args_info->metrics_file_help = gengetopt_args_info_help[24] ;
+  args_info->metrics_interval_help = gengetopt_args_info_help[25] ;
+  args_info->input_format_help = gengetopt_args_info_help[26] ;
+  args_info->filter_help = gengetopt_args_info_help[27] ;
+  args_info->filter_cache_help = gengetopt_args_info_help[28] ;
+  args_info->quality_help = gengetopt_args_info_help[29] ;
+  args_info->fixed_point_help = gengetopt_args_info_help[30] ;
   
 }
 
@@ -212,6 +315,33 @@ cmdline_parser_release (struct gengetopt_args_info *args_info)
   free_string_field (&(args_info->infile_orig));
   free_string_field (&(args_info->outfile_arg));
   free_string_field (&(args_info->outfile_orig));
+  free_string_field (&(args_info->outputs_arg));
+  free_string_field (&(args_info->outputs_orig));
+  free_string_field (&(args_info->passthrough_arg));
+  free_string_field (&(args_info->passthrough_orig));
+  free_string_field (&(args_info->batch_arg));
+  free_string_field (&(args_info->batch_orig));
+  free_string_field (&(args_info->jobs_orig));
+  free_string_field (&(args_info->outdir_arg));
+  free_string_field (&(args_info->outdir_orig));
+  free_string_field (&(args_info->cache_arg));
+  free_string_field (&(args_info->cache_orig));
+  free_string_field (&(args_info->serve_arg));
+  free_string_field (&(args_info->serve_orig));
+  free_string_field (&(args_info->period_orig));
+  free_string_field (&(args_info->periods_orig));
+  free_string_field (&(args_info->metrics_fd_orig));
+  free_string_field (&(args_info->metrics_file_arg));
+  free_string_field (&(args_info->metrics_file_orig));
+  free_string_field (&(args_info->metrics_interval_orig));
+  free_string_field (&(args_info->input_format_arg));
+  free_string_field (&(args_info->input_format_orig));
+  free_string_field (&(args_info->filter_arg));
+  free_string_field (&(args_info->filter_orig));
+  free_string_field (&(args_info->filter_cache_arg));
+  free_string_field (&(args_info->filter_cache_orig));
+  free_string_field (&(args_info->quality_arg));
+  free_string_field (&(args_info->quality_orig));
   
   
 
@@ -303,6 +433,48 @@ cmdline_parser_dump(FILE *outfile, struct gengetopt_args_info *args_info)
     write_into_file(outfile, "dop", 0, 0 );
   if (args_info->wav_given)
     write_into_file(outfile, "wav", 0, 0 );
+  if (args_info->outputs_given)
+    write_into_file(outfile, "outputs", args_info->outputs_orig, 0);
+  if (args_info->passthrough_given)
+    write_into_file(outfile, "passthrough", args_info->passthrough_orig, cmdline_parser_passthrough_values);
+  if (args_info->batch_given)
+    write_into_file(outfile, "batch", args_info->batch_orig, 0);
+  if (args_info->jobs_given)
+    write_into_file(outfile, "jobs", args_info->jobs_orig, 0);
+  if (args_info->outdir_given)
+    write_into_file(outfile, "outdir", args_info->outdir_orig, 0);
+  if (args_info->cache_given)
+    write_into_file(outfile, "cache", args_info->cache_orig, 0);
+  if (args_info->hash_given)
+    write_into_file(outfile, "hash", 0, 0 );
+  if (args_info->force_given)
+    write_into_file(outfile, "force", 0, 0 );
+  if (args_info->serve_given)
+    write_into_file(outfile, "serve", args_info->serve_orig, 0);
+  if (args_info->realtime_given)
+    write_into_file(outfile, "realtime", 0, 0 );
+  if (args_info->period_given)
+    write_into_file(outfile, "period", args_info->period_orig, 0);
+  if (args_info->periods_given)
+    write_into_file(outfile, "periods", args_info->periods_orig, 0);
+  if (args_info->stats_given)
+    write_into_file(outfile, "stats", 0, 0 );
+  if (args_info->metrics_fd_given)
+    write_into_file(outfile, "metrics-fd", args_info->metrics_fd_orig, 0);
+  if (args_info->metrics_file_given)
+    write_into_file(outfile, "metrics-file", args_info->metrics_file_orig, 0);
+  if (args_info->metrics_interval_given)
+    write_into_file(outfile, "metrics-interval", args_info->metrics_interval_orig, 0);
+  if (args_info->input_format_given)
+    write_into_file(outfile, "input-format", args_info->input_format_orig, cmdline_parser_input_format_values);
+  if (args_info->filter_given)
+    write_into_file(outfile, "filter", args_info->filter_orig, 0);
+  if (args_info->filter_cache_given)
+    write_into_file(outfile, "filter-cache", args_info->filter_cache_orig, 0);
+  if (args_info->quality_given)
+    write_into_file(outfile, "quality", args_info->quality_orig, cmdline_parser_quality_values);
+  if (args_info->fixed_point_given)
+    write_into_file(outfile, "fixed-point", 0, 0 );
   
 
   i = EXIT_SUCCESS;
@@ -418,14 +590,9 @@ cmdline_parser_required2 (struct gengetopt_args_info *args_info, const char *pro
   int error_occurred = 0;
   FIX_UNUSED (additional_error);
 
-  /* checks for required options */
-  if (! args_info->infile_given)
-    {
-      fprintf (stderr, "%s: '--infile' ('-i') option required%s\n", prog_name, (additional_error ? additional_error : ""));
-      error_occurred = 1;
-    }
-  
-  
+  FIX_UNUSED (args_info);
+  FIX_UNUSED (prog_name);
+
   /* checks for dependences among options */
 
   return error_occurred;
@@ -610,10 +777,31 @@ cmdline_parser_internal (
         { "outfile",	1, NULL, 'o' },
         { "dop",	0, NULL, 'd' },
         { "wav",	0, NULL, 'w' },
+        { "outputs",	1, NULL, 0 },
+        { "passthrough",	1, NULL, 'p' },
+        { "batch",	1, NULL, 0 },
+        { "jobs",	1, NULL, 'j' },
+        { "outdir",	1, NULL, 0 },
+        { "cache",	1, NULL, 0 },
+        { "hash",	0, NULL, 0 },
+        { "force",	0, NULL, 0 },
+        { "serve",	1, NULL, 0 },
+        { "realtime",	0, NULL, 0 },
+        { "period",	1, NULL, 0 },
+        { "periods",	1, NULL, 0 },
+        { "stats",	0, NULL, 0 },
+        { "metrics-fd",	1, NULL, 0 },
+        { "metrics-file",	1, NULL, 0 },
+        { "metrics-interval",	1, NULL, 0 },
+        { "input-format",	1, NULL, 0 },
+        { "filter",	1, NULL, 0 },
+        { "filter-cache",	1, NULL, 0 },
+        { "quality",	1, NULL, 0 },
+        { "fixed-point",	0, NULL, 0 },
         { 0,  0, 0, 0 }
       };
 
-      c = getopt_long (argc, argv, "hVr:b:ns:i:o:dw", long_options, &option_index);
+      c = getopt_long (argc, argv, "hVr:b:ns:i:o:dwp:j:", long_options, &option_index);
 
       if (c == -1) break;	/* Exit from `while (1)' loop.  */
 
@@ -675,7 +863,7 @@ cmdline_parser_internal (
             goto failure;
         
           break;
-        case 'i':	/* Input DSF or DFF file.  */
+        case 'i':	/* Input DSF or DFF file, - for stdin.  */
         
         
           if (update_arg( (void *)&(args_info->infile_arg), 
@@ -718,7 +906,289 @@ cmdline_parser_internal (
         
           break;
 
+        case 'p':	/* Write the DSD samples unchanged into DSF or DFF files (one per track) without converting them. Uncompressed data is copied directly.  */
+        
+        
+          if (update_arg( (void *)&(args_info->passthrough_arg), 
+               &(args_info->passthrough_orig), &(args_info->passthrough_given),
+              &(local_args_info.passthrough_given), optarg, cmdline_parser_passthrough_values, 0, ARG_STRING,
+              check_ambiguity, override, 0, 0,
+              "passthrough", 'p',
+              additional_error))
+            goto failure;
+        
+          break;
+        case 'j':	/* Number of files (or tracks of a multi-track input) converted at once, 0 uses one per cpu core.  */
+        
+        
+          if (update_arg( (void *)&(args_info->jobs_arg), 
+               &(args_info->jobs_orig), &(args_info->jobs_given),
+              &(local_args_info.jobs_given), optarg, 0, "0", ARG_INT,
+              check_ambiguity, override, 0, 0,
+              "jobs", 'j',
+              additional_error))
+            goto failure;
+        
+          break;
         case 0:	/* Long option with no short option */
+          /* Write several outputs in a single pass over the input. A comma separated list of flac[:RATE[:BITS]][=FILE], dop[=FILE], dopwav[=FILE], dsf[=FILE] or dff[=FILE].  */
+          if (strcmp (long_options[option_index].name, "outputs") == 0)
+          {
+          
+          
+            if (update_arg( (void *)&(args_info->outputs_arg), 
+                 &(args_info->outputs_orig), &(args_info->outputs_given),
+                &(local_args_info.outputs_given), optarg, 0, 0, ARG_STRING,
+                check_ambiguity, override, 0, 0,
+                "outputs", '-',
+                additional_error))
+              goto failure;
+          
+          }
+          /* Convert every DSF and DFF file found in PATH. PATH is a directory (searched recursively) or a text file listing one file or directory per line.  */
+          else if (strcmp (long_options[option_index].name, "batch") == 0)
+          {
+          
+          
+            if (update_arg( (void *)&(args_info->batch_arg), 
+                 &(args_info->batch_orig), &(args_info->batch_given),
+                &(local_args_info.batch_given), optarg, 0, 0, ARG_STRING,
+                check_ambiguity, override, 0, 0,
+                "batch", '-',
+                additional_error))
+              goto failure;
+          
+          }
+          /* Write the batch mode outputs under DIR, mirroring the layout of the inputs. By default each output is written next to its input.  */
+          else if (strcmp (long_options[option_index].name, "outdir") == 0)
+          {
+          
+          
+            if (update_arg( (void *)&(args_info->outdir_arg), 
+                 &(args_info->outdir_orig), &(args_info->outdir_given),
+                &(local_args_info.outdir_given), optarg, 0, 0, ARG_STRING,
+                check_ambiguity, override, 0, 0,
+                "outdir", '-',
+                additional_error))
+              goto failure;
+          
+          }
+          /* Keep a manifest of the conversions done in FILE and skip inputs which are unchanged since they were last converted with the same settings.  */
+          else if (strcmp (long_options[option_index].name, "cache") == 0)
+          {
+          
+          
+            if (update_arg( (void *)&(args_info->cache_arg), 
+                 &(args_info->cache_orig), &(args_info->cache_given),
+                &(local_args_info.cache_given), optarg, 0, 0, ARG_STRING,
+                check_ambiguity, override, 0, 0,
+                "cache", '-',
+                additional_error))
+              goto failure;
+          
+          }
+          /* With --cache, also compare a crc32 of each input so that files which were only touched are still skipped.  */
+          else if (strcmp (long_options[option_index].name, "hash") == 0)
+          {
+          
+          
+            if (update_arg((void *)&(args_info->hash_flag), 0, &(args_info->hash_given),
+                &(local_args_info.hash_given), optarg, 0, 0, ARG_FLAG,
+                check_ambiguity, override, 1, 0, "hash", '-',
+                additional_error))
+              goto failure;
+          
+          }
+          /* With --cache, convert every input even if it is up to date.  */
+          else if (strcmp (long_options[option_index].name, "force") == 0)
+          {
+          
+          
+            if (update_arg((void *)&(args_info->force_flag), 0, &(args_info->force_given),
+                &(local_args_info.force_given), optarg, 0, 0, ARG_FLAG,
+                check_ambiguity, override, 1, 0, "force", '-',
+                additional_error))
+              goto failure;
+          
+          }
+          /* Run as a server taking conversion requests on the unix domain socket SOCKET until interrupted. The other options given become the defaults for every request.  */
+          else if (strcmp (long_options[option_index].name, "serve") == 0)
+          {
+          
+          
+            if (update_arg( (void *)&(args_info->serve_arg), 
+                 &(args_info->serve_orig), &(args_info->serve_given),
+                &(local_args_info.serve_given), optarg, 0, 0, ARG_STRING,
+                check_ambiguity, override, 0, 0,
+                "serve", '-',
+                additional_error))
+              goto failure;
+          
+          }
+          /* Stream raw PCM (or DoP with --dop) with low latency, for playing through a pipe. The decoding runs on a real time thread and the output is written a period at a time.  */
+          else if (strcmp (long_options[option_index].name, "realtime") == 0)
+          {
+          
+          
+            if (update_arg((void *)&(args_info->realtime_flag), 0, &(args_info->realtime_given),
+                &(local_args_info.realtime_given), optarg, 0, 0, ARG_FLAG,
+                check_ambiguity, override, 1, 0, "realtime", '-',
+                additional_error))
+              goto failure;
+          
+          }
+          /* With --realtime, the number of frames written at a time.  */
+          else if (strcmp (long_options[option_index].name, "period") == 0)
+          {
+          
+          
+            if (update_arg( (void *)&(args_info->period_arg), 
+                 &(args_info->period_orig), &(args_info->period_given),
+                &(local_args_info.period_given), optarg, 0, "256", ARG_INT,
+                check_ambiguity, override, 0, 0,
+                "period", '-',
+                additional_error))
+              goto failure;
+          
+          }
+          /* With --realtime, the number of periods decoded ahead of the output.  */
+          else if (strcmp (long_options[option_index].name, "periods") == 0)
+          {
+          
+          
+            if (update_arg( (void *)&(args_info->periods_arg), 
+                 &(args_info->periods_orig), &(args_info->periods_given),
+                &(local_args_info.periods_given), optarg, 0, "4", ARG_INT,
+                check_ambiguity, override, 0, 0,
+                "periods", '-',
+                additional_error))
+              goto failure;
+          
+          }
+          /* Print how long each stage of the conversion took (read, DST decode, decimate, quantize, encode and write) as a line of JSON on stderr after each file. Sending the process SIGUSR1 prints the totals so far..  */
+          else if (strcmp (long_options[option_index].name, "stats") == 0)
+          {
+          
+          
+            if (update_arg((void *)&(args_info->stats_flag), 0, &(args_info->stats_given),
+                &(local_args_info.stats_given), optarg, 0, 0, ARG_FLAG,
+                check_ambiguity, override, 1, 0, "stats", '-',
+                additional_error))
+              goto failure;
+          
+          }
+          /* Write the progress of the run as a line of JSON to file descriptor FD every --metrics-interval: audio converted, realtime factor, jobs queued, running and finished, bytes in and out and errors..  */
+          else if (strcmp (long_options[option_index].name, "metrics-fd") == 0)
+          {
+          
+          
+            if (update_arg( (void *)&(args_info->metrics_fd_arg), 
+                 &(args_info->metrics_fd_orig), &(args_info->metrics_fd_given),
+                &(local_args_info.metrics_fd_given), optarg, 0, 0, ARG_INT,
+                check_ambiguity, override, 0, 0,
+                "metrics-fd", '-',
+                additional_error))
+              goto failure;
+          
+          }
+          /* Keep FILE up to date with the same metrics in the Prometheus text format, for node_exporter's textfile collector..  */
+          else if (strcmp (long_options[option_index].name, "metrics-file") == 0)
+          {
+          
+          
+            if (update_arg( (void *)&(args_info->metrics_file_arg), 
+                 &(args_info->metrics_file_orig), &(args_info->metrics_file_given),
+                &(local_args_info.metrics_file_given), optarg, 0, 0, ARG_STRING,
+                check_ambiguity, override, 0, 0,
+                "metrics-file", '-',
+                additional_error))
+              goto failure;
+          
+          }
+          /* How often the metrics are written, in milliseconds..  */
+          else if (strcmp (long_options[option_index].name, "metrics-interval") == 0)
+          {
+          
+          
+            if (update_arg( (void *)&(args_info->metrics_interval_arg), 
+                 &(args_info->metrics_interval_orig), &(args_info->metrics_interval_given),
+                &(local_args_info.metrics_interval_given), optarg, 0, "1000", ARG_INT,
+                check_ambiguity, override, 0, 0,
+                "metrics-interval", '-',
+                additional_error))
+              goto failure;
+          
+          }
+          /* The format of the input when it can't be told from the extension, such as - for stdin or a named pipe.  */
+          else if (strcmp (long_options[option_index].name, "input-format") == 0)
+          {
+          
+          
+            if (update_arg( (void *)&(args_info->input_format_arg), 
+                 &(args_info->input_format_orig), &(args_info->input_format_given),
+                &(local_args_info.input_format_given), optarg, cmdline_parser_input_format_values, 0, ARG_STRING,
+                check_ambiguity, override, 0, 0,
+                "input-format", '-',
+                additional_error))
+              goto failure;
+          
+          }
+          /* Decimate with the filter in FILE instead of the built-in one for its ratio, several files can be given separated by commas. See fir_filter.h for the file format..  */
+          else if (strcmp (long_options[option_index].name, "filter") == 0)
+          {
+          
+          
+            if (update_arg( (void *)&(args_info->filter_arg), 
+                 &(args_info->filter_orig), &(args_info->filter_given),
+                &(local_args_info.filter_given), optarg, 0, 0, ARG_STRING,
+                check_ambiguity, override, 0, 0,
+                "filter", '-',
+                additional_error))
+              goto failure;
+          
+          }
+          /* The folder the lookup tables of --filter filters are saved in, by default $XDG_CACHE_HOME/dsf2flac or ~/.cache/dsf2flac. An empty DIR does not save them..  */
+          else if (strcmp (long_options[option_index].name, "filter-cache") == 0)
+          {
+          
+          
+            if (update_arg( (void *)&(args_info->filter_cache_arg), 
+                 &(args_info->filter_cache_orig), &(args_info->filter_cache_given),
+                &(local_args_info.filter_cache_given), optarg, 0, 0, ARG_STRING,
+                check_ambiguity, override, 0, 0,
+                "filter-cache", '-',
+                additional_error))
+              goto failure;
+          
+          }
+          /* The filter set for 352800, 176400 and 88200 from DSD64 (and the other rates with the same ratio): reference, fast (half the taps, 120dB down) or minphase (minimum phase, a third of the delay)..  */
+          else if (strcmp (long_options[option_index].name, "quality") == 0)
+          {
+          
+          
+            if (update_arg( (void *)&(args_info->quality_arg), 
+                 &(args_info->quality_orig), &(args_info->quality_given),
+                &(local_args_info.quality_given), optarg, cmdline_parser_quality_values, 0, ARG_STRING,
+                check_ambiguity, override, 0, 0,
+                "quality", '-',
+                additional_error))
+              goto failure;
+          
+          }
+          /* Compute integer PCM in fixed point, with the scale folded into int32 filter tables, so the output is bit exact on every platform. Used for the single filter rates, the others are computed in floating point as usual..  */
+          else if (strcmp (long_options[option_index].name, "fixed-point") == 0)
+          {
+          
+          
+            if (update_arg((void *)&(args_info->fixed_point_flag), 0, &(args_info->fixed_point_given),
+                &(local_args_info.fixed_point_given), optarg, 0, 0, ARG_FLAG,
+                check_ambiguity, override, 1, 0, "fixed-point", '-',
+                additional_error))
+              goto failure;
+          
+          }
+          
+          break;
         case '?':	/* Invalid option.  */
           /* `getopt_long' already printed an error message.  */
           goto failure;
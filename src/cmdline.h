@@ -49,9 +49,9 @@ extern "C" {
         float scale_arg; /**< @brief Scale adjustment. Raw DSD has a modulation depth of approximately 0.5 so with no scaling the PCM peak level is approximately -6dB below 0dBFs (default='4').  */
         char * scale_orig; /**< @brief Scale adjustment. Raw DSD has a modulation depth of approximately 0.5 so with no scaling the PCM peak level is approximately -6dB below 0dBFs original value given at command line.  */
         const char *scale_help; /**< @brief Scale adjustment. Raw DSD has a modulation depth of approximately 0.5 so with no scaling the PCM peak level is approximately -6dB below 0dBFs help description.  */
-        char * infile_arg; /**< @brief Input DSF or DFF file.  */
-        char * infile_orig; /**< @brief Input DSF or DFF file original value given at command line.  */
-        const char *infile_help; /**< @brief Input DSF or DFF file help description.  */
+        char * infile_arg; /**< @brief Input DSF or DFF file, - for stdin.  */
+        char * infile_orig; /**< @brief Input DSF or DFF file, - for stdin original value given at command line.  */
+        const char *infile_help; /**< @brief Input DSF or DFF file, - for stdin help description.  */
         char * outfile_arg; /**< @brief Output FLAC file, if not specified the output file be the same as the input file with the extension changed.  */
         char * outfile_orig; /**< @brief Output FLAC file, if not specified the output file be the same as the input file with the extension changed original value given at command line.  */
         const char *outfile_help; /**< @brief Output FLAC file, if not specified the output file be the same as the input file with the extension changed help description.  */
@@ -61,6 +61,85 @@ extern "C" {
         int wav_flag;
         const char *wav_help;
 
+        char * outputs_arg; /**< @brief Write several outputs in a single pass over the input. A comma separated list of flac[:RATE[:BITS]][=FILE], dop[=FILE], dopwav[=FILE], dsf[=FILE] or dff[=FILE].  */
+        char * outputs_orig; /**< @brief Write several outputs in a single pass over the input. A comma separated list of flac[:RATE[:BITS]][=FILE], dop[=FILE], dopwav[=FILE], dsf[=FILE] or dff[=FILE] original value given at command line.  */
+        const char *outputs_help; /**< @brief Write several outputs in a single pass over the input. A comma separated list of flac[:RATE[:BITS]][=FILE], dop[=FILE], dopwav[=FILE], dsf[=FILE] or dff[=FILE] help description.  */
+
+        char * passthrough_arg; /**< @brief Write the DSD samples unchanged into DSF or DFF files (one per track) without converting them. Uncompressed data is copied directly.  */
+        char * passthrough_orig; /**< @brief Write the DSD samples unchanged into DSF or DFF files (one per track) without converting them. Uncompressed data is copied directly original value given at command line.  */
+        const char *passthrough_help; /**< @brief Write the DSD samples unchanged into DSF or DFF files (one per track) without converting them. Uncompressed data is copied directly help description.  */
+
+        char * batch_arg; /**< @brief Convert every DSF and DFF file found in PATH. PATH is a directory (searched recursively) or a text file listing one file or directory per line.  */
+        char * batch_orig; /**< @brief Convert every DSF and DFF file found in PATH. PATH is a directory (searched recursively) or a text file listing one file or directory per line original value given at command line.  */
+        const char *batch_help; /**< @brief Convert every DSF and DFF file found in PATH. PATH is a directory (searched recursively) or a text file listing one file or directory per line help description.  */
+
+        int jobs_arg; /**< @brief Number of files (or tracks of a multi-track input) converted at once, 0 uses one per cpu core (default='0').  */
+        char * jobs_orig; /**< @brief Number of files (or tracks of a multi-track input) converted at once, 0 uses one per cpu core original value given at command line.  */
+        const char *jobs_help; /**< @brief Number of files (or tracks of a multi-track input) converted at once, 0 uses one per cpu core help description.  */
+
+        char * outdir_arg; /**< @brief Write the batch mode outputs under DIR, mirroring the layout of the inputs. By default each output is written next to its input.  */
+        char * outdir_orig; /**< @brief Write the batch mode outputs under DIR, mirroring the layout of the inputs. By default each output is written next to its input original value given at command line.  */
+        const char *outdir_help; /**< @brief Write the batch mode outputs under DIR, mirroring the layout of the inputs. By default each output is written next to its input help description.  */
+
+        char * cache_arg; /**< @brief Keep a manifest of the conversions done in FILE and skip inputs which are unchanged since they were last converted with the same settings.  */
+        char * cache_orig; /**< @brief Keep a manifest of the conversions done in FILE and skip inputs which are unchanged since they were last converted with the same settings original value given at command line.  */
+        const char *cache_help; /**< @brief Keep a manifest of the conversions done in FILE and skip inputs which are unchanged since they were last converted with the same settings help description.  */
+
+        int hash_flag; /**< @brief With --cache, also compare a crc32 of each input so that files which were only touched are still skipped (default=off).  */
+        const char *hash_help; /**< @brief With --cache, also compare a crc32 of each input so that files which were only touched are still skipped help description.  */
+
+        int force_flag; /**< @brief With --cache, convert every input even if it is up to date (default=off).  */
+        const char *force_help; /**< @brief With --cache, convert every input even if it is up to date help description.  */
+
+        char * serve_arg; /**< @brief Run as a server taking conversion requests on the unix domain socket SOCKET until interrupted. The other options given become the defaults for every request.  */
+        char * serve_orig; /**< @brief Run as a server taking conversion requests on the unix domain socket SOCKET until interrupted. The other options given become the defaults for every request original value given at command line.  */
+        const char *serve_help; /**< @brief Run as a server taking conversion requests on the unix domain socket SOCKET until interrupted. The other options given become the defaults for every request help description.  */
+
+        int realtime_flag; /**< @brief Stream raw PCM (or DoP with --dop) with low latency, for playing through a pipe. The decoding runs on a real time thread and the output is written a period at a time (default=off).  */
+        const char *realtime_help; /**< @brief Stream raw PCM (or DoP with --dop) with low latency, for playing through a pipe. The decoding runs on a real time thread and the output is written a period at a time help description.  */
+
+        int period_arg; /**< @brief With --realtime, the number of frames written at a time (default='256').  */
+        char * period_orig; /**< @brief With --realtime, the number of frames written at a time original value given at command line.  */
+        const char *period_help; /**< @brief With --realtime, the number of frames written at a time help description.  */
+
+        int periods_arg; /**< @brief With --realtime, the number of periods decoded ahead of the output (default='4').  */
+        char * periods_orig; /**< @brief With --realtime, the number of periods decoded ahead of the output original value given at command line.  */
+        const char *periods_help; /**< @brief With --realtime, the number of periods decoded ahead of the output help description.  */
+
+        int stats_flag; /**< @brief Print how long each stage of the conversion took (read, DST decode, decimate, quantize, encode and write) as a line of JSON on stderr after each file. Sending the process SIGUSR1 prints the totals so far. (default=off).  */
+        const char *stats_help; /**< @brief Print how long each stage of the conversion took (read, DST decode, decimate, quantize, encode and write) as a line of JSON on stderr after each file. Sending the process SIGUSR1 prints the totals so far. help description.  */
+
+        int metrics_fd_arg; /**< @brief Write the progress of the run as a line of JSON to file descriptor FD every --metrics-interval: audio converted, realtime factor, jobs queued, running and finished, bytes in and out and errors..  */
+        char * metrics_fd_orig; /**< @brief Write the progress of the run as a line of JSON to file descriptor FD every --metrics-interval: audio converted, realtime factor, jobs queued, running and finished, bytes in and out and errors. original value given at command line.  */
+        const char *metrics_fd_help; /**< @brief Write the progress of the run as a line of JSON to file descriptor FD every --metrics-interval: audio converted, realtime factor, jobs queued, running and finished, bytes in and out and errors. help description.  */
+
+        char * metrics_file_arg; /**< @brief Keep FILE up to date with the same metrics in the Prometheus text format, for node_exporter's textfile collector..  */
+        char * metrics_file_orig; /**< @brief Keep FILE up to date with the same metrics in the Prometheus text format, for node_exporter's textfile collector. original value given at command line.  */
+        const char *metrics_file_help; /**< @brief Keep FILE up to date with the same metrics in the Prometheus text format, for node_exporter's textfile collector. help description.  */
+
+        int metrics_interval_arg; /**< @brief How often the metrics are written, in milliseconds. (default='1000').  */
+        char * metrics_interval_orig; /**< @brief How often the metrics are written, in milliseconds. original value given at command line.  */
+        const char *metrics_interval_help; /**< @brief How often the metrics are written, in milliseconds. help description.  */
+
+        char * input_format_arg; /**< @brief The format of the input when it can't be told from the extension, such as - for stdin or a named pipe.  */
+        char * input_format_orig; /**< @brief The format of the input when it can't be told from the extension, such as - for stdin or a named pipe original value given at command line.  */
+        const char *input_format_help; /**< @brief The format of the input when it can't be told from the extension, such as - for stdin or a named pipe help description.  */
+
+        char * filter_arg; /**< @brief Decimate with the filter in FILE instead of the built-in one for its ratio, several files can be given separated by commas. See fir_filter.h for the file format..  */
+        char * filter_orig; /**< @brief Decimate with the filter in FILE instead of the built-in one for its ratio, several files can be given separated by commas. See fir_filter.h for the file format. original value given at command line.  */
+        const char *filter_help; /**< @brief Decimate with the filter in FILE instead of the built-in one for its ratio, several files can be given separated by commas. See fir_filter.h for the file format. help description.  */
+
+        char * filter_cache_arg; /**< @brief The folder the lookup tables of --filter filters are saved in, by default $XDG_CACHE_HOME/dsf2flac or ~/.cache/dsf2flac. An empty DIR does not save them..  */
+        char * filter_cache_orig; /**< @brief The folder the lookup tables of --filter filters are saved in, by default $XDG_CACHE_HOME/dsf2flac or ~/.cache/dsf2flac. An empty DIR does not save them. original value given at command line.  */
+        const char *filter_cache_help; /**< @brief The folder the lookup tables of --filter filters are saved in, by default $XDG_CACHE_HOME/dsf2flac or ~/.cache/dsf2flac. An empty DIR does not save them. help description.  */
+
+        char * quality_arg; /**< @brief The filter set for 352800, 176400 and 88200 from DSD64 (and the other rates with the same ratio): reference, fast (half the taps, 120dB down) or minphase (minimum phase, a third of the delay). (default='reference').  */
+        char * quality_orig; /**< @brief The filter set for 352800, 176400 and 88200 from DSD64 (and the other rates with the same ratio): reference, fast (half the taps, 120dB down) or minphase (minimum phase, a third of the delay). original value given at command line.  */
+        const char *quality_help; /**< @brief The filter set for 352800, 176400 and 88200 from DSD64 (and the other rates with the same ratio): reference, fast (half the taps, 120dB down) or minphase (minimum phase, a third of the delay). help description.  */
+
+        int fixed_point_flag; /**< @brief Compute integer PCM in fixed point, with the scale folded into int32 filter tables, so the output is bit exact on every platform. Used for the single filter rates, the others are computed in floating point as usual. (default=off).  */
+        const char *fixed_point_help; /**< @brief Compute integer PCM in fixed point, with the scale folded into int32 filter tables, so the output is bit exact on every platform. Used for the single filter rates, the others are computed in floating point as usual. help description.  */
+
         unsigned int help_given; /**< @brief Whether help was given.  */
         unsigned int version_given; /**< @brief Whether version was given.  */
         unsigned int samplerate_given; /**< @brief Whether samplerate was given.  */
@@ -72,6 +151,27 @@ extern "C" {
         unsigned int dop_given; /**< @brief Whether dop was given.  */
         unsigned int wav_given;
 
+        unsigned int outputs_given; /**< @brief Whether outputs was given.  */
+        unsigned int passthrough_given; /**< @brief Whether passthrough was given.  */
+        unsigned int batch_given; /**< @brief Whether batch was given.  */
+        unsigned int jobs_given; /**< @brief Whether jobs was given.  */
+        unsigned int outdir_given; /**< @brief Whether outdir was given.  */
+        unsigned int cache_given; /**< @brief Whether cache was given.  */
+        unsigned int hash_given; /**< @brief Whether hash was given.  */
+        unsigned int force_given; /**< @brief Whether force was given.  */
+        unsigned int serve_given; /**< @brief Whether serve was given.  */
+        unsigned int realtime_given; /**< @brief Whether realtime was given.  */
+        unsigned int period_given; /**< @brief Whether period was given.  */
+        unsigned int periods_given; /**< @brief Whether periods was given.  */
+        unsigned int stats_given; /**< @brief Whether stats was given.  */
+        unsigned int metrics_fd_given; /**< @brief Whether metrics-fd was given.  */
+        unsigned int metrics_file_given; /**< @brief Whether metrics-file was given.  */
+        unsigned int metrics_interval_given; /**< @brief Whether metrics-interval was given.  */
+        unsigned int input_format_given; /**< @brief Whether input-format was given.  */
+        unsigned int filter_given; /**< @brief Whether filter was given.  */
+        unsigned int filter_cache_given; /**< @brief Whether filter-cache was given.  */
+        unsigned int quality_given; /**< @brief Whether quality was given.  */
+        unsigned int fixed_point_given; /**< @brief Whether fixed-point was given.  */
     };
 
     /** @brief The additional parameters to pass to parser functions */
@@ -195,7 +295,10 @@ extern "C" {
             const char *prog_name);
 
     extern const char *cmdline_parser_samplerate_values[]; /**< @brief Possible values for samplerate. */
-    extern const char *cmdline_parser_bits_values[]; /**< @brief Possible values for bits. */
+    extern const char *cmdline_parser_bits_values[];
+    extern const char *cmdline_parser_quality_values[]; /**< @brief Possible values for quality. */
+    extern const char *cmdline_parser_input_format_values[]; /**< @brief Possible values for input-format. */
+    extern const char *cmdline_parser_passthrough_values[]; /**< @brief Possible values for passthrough. */ /**< @brief Possible values for bits. */
 
 
 #ifdef __cplusplus
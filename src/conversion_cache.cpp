@@ -0,0 +1,265 @@
+/*
+ * dsf2flac - http://code.google.com/p/dsf2flac/
+ *
+ * A file conversion tool for translating dsf dsd audio files into
+ * flac pcm audio files.
+ *
+ * Copyright (c) 2013 by respective authors.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *
+ * Acknowledgments
+ *
+ * Many thanks to the following authors and projects whose work has greatly
+ * helped the development of this tool.
+ *
+ *
+ * Sebastian Gesemann - dsd2pcm (http://code.google.com/p/dsd2pcm/)
+ * SACD Ripper (http://code.google.com/p/sacd-ripper/)
+ * Maxim V.Anisiutkin - foo_input_sacd (http://sourceforge.net/projects/sacddecoder/files/)
+ * Vladislav Goncharov - foo_input_sacd_hq (http://vladgsound.wordpress.com)
+ * Jesus R - www.sonore.us
+ *
+ */
+
+#include "conversion_cache.h"
+#include <boost/filesystem/fstream.hpp>
+#include <algorithm>
+#include <sstream>
+#include <stdio.h>
+#include <zlib.h>
+
+static const char* manifestHeader = "# dsf2flac conversion cache 1";
+// saveIfDue writes the manifest after this many changes, or once the first unsaved one is this old
+static const dsf2flac_uint32 saveEveryChanges = 64;
+static const std::chrono::seconds saveEveryInterval(5);
+
+ConversionCache::ConversionCache(boost::filesystem::path p, bool h)
+{
+	manifestPath = p;
+	hashInputs = h;
+	errorMsg = "";
+	unsaved = 0;
+}
+
+ConversionCache::~ConversionCache()
+{
+}
+
+bool ConversionCache::fileCrc(boost::filesystem::path path, dsf2flac_uint32* crc)
+{
+	FILE* f = fopen(path.c_str(), "rb");
+	if (!f)
+		return false;
+	std::vector<unsigned char> buf(1 << 20);
+	uLong c = crc32(0L, Z_NULL, 0);
+	size_t n;
+	while ((n = fread(&buf[0], 1, buf.size(), f)) > 0)
+		c = crc32(c, &buf[0], n);
+	bool ok = !ferror(f);
+	fclose(f);
+	*crc = c;
+	return ok;
+}
+
+bool ConversionCache::identify(boost::filesystem::path path, bool withCrc, FileId* id)
+{
+	boost::system::error_code ec;
+	id->path = boost::filesystem::absolute(path).string();
+	id->size = boost::filesystem::file_size(path, ec);
+	if (ec)
+		return false;
+	id->mtime = boost::filesystem::last_write_time(path, ec);
+	if (ec)
+		return false;
+	id->hasCrc = withCrc && fileCrc(path, &id->crc);
+	if (!id->hasCrc)
+		id->crc = 0;
+	return !withCrc || id->hasCrc;
+}
+
+bool ConversionCache::unchanged(const FileId& id)
+{
+	FileId now;
+	if (!identify(id.path, false, &now) || now.size != id.size)
+		return false;
+	if (now.mtime == id.mtime)
+		return true;
+	// touched, but the contents may be the same
+	dsf2flac_uint32 crc;
+	return id.hasCrc && fileCrc(id.path, &crc) && crc == id.crc;
+}
+
+std::string ConversionCache::makeKey(boost::filesystem::path inpath, boost::filesystem::path outpath)
+{
+	return boost::filesystem::absolute(inpath).string() + "\t" + boost::filesystem::absolute(outpath).string();
+}
+
+bool ConversionCache::isUpToDate(boost::filesystem::path inpath, boost::filesystem::path outpath, const std::string& settings)
+{
+	Entry e;
+	{
+		std::lock_guard<std::mutex> l(lock);
+		std::unordered_map<std::string, Entry>::iterator it = entries.find(makeKey(inpath, outpath));
+		if (it == entries.end())
+			return false;
+		e = it->second;
+	}
+	if (e.settings != settings || e.outputs.empty())
+		return false;
+	if (!unchanged(e.input))
+		return false;
+	for (dsf2flac_uint32 i = 0; i < e.outputs.size(); i++)
+		if (!unchanged(e.outputs[i]))
+			return false;
+	return true;
+}
+
+void ConversionCache::record(boost::filesystem::path inpath, boost::filesystem::path outpath, const std::string& settings,
+		const std::vector<boost::filesystem::path>& outputs)
+{
+	Entry e;
+	e.settings = settings;
+	bool ok = identify(inpath, hashInputs, &e.input);
+	for (dsf2flac_uint32 i = 0; ok && i < outputs.size(); i++) {
+		FileId id;
+		ok = identify(outputs[i], true, &id);
+		e.outputs.push_back(id);
+	}
+	// tabs and newlines would break the manifest
+	std::string key = makeKey(inpath, outpath);
+	std::string all = key + "\t" + settings;
+	for (dsf2flac_uint32 i = 0; i < e.outputs.size(); i++)
+		all += e.outputs[i].path;
+	if (all.find('\n') != std::string::npos || std::count(all.begin(), all.end(), '\t') != 2)
+		ok = false;
+
+	std::lock_guard<std::mutex> l(lock);
+	if (ok)
+		entries[key] = e;
+	else
+		entries.erase(key);
+	if (unsaved++ == 0)
+		firstUnsaved = std::chrono::steady_clock::now();
+}
+
+void ConversionCache::forget(boost::filesystem::path inpath, boost::filesystem::path outpath)
+{
+	std::lock_guard<std::mutex> l(lock);
+	entries.erase(makeKey(inpath, outpath));
+	if (unsaved++ == 0)
+		firstUnsaved = std::chrono::steady_clock::now();
+}
+
+static bool parseFileId(std::istringstream& ss, std::string& path, dsf2flac_uint64& size, dsf2flac_int64& mtime, std::string& crc)
+{
+	std::string s, m;
+	if (!std::getline(ss, path, '\t') || !std::getline(ss, s, '\t') || !std::getline(ss, m, '\t') || !std::getline(ss, crc))
+		return false;
+	size = strtoull(s.c_str(), NULL, 10);
+	mtime = strtoll(m.c_str(), NULL, 10);
+	return true;
+}
+
+bool ConversionCache::load()
+{
+	std::lock_guard<std::mutex> l(lock);
+	entries.clear();
+	if (!boost::filesystem::exists(manifestPath))
+		return true;
+	boost::filesystem::ifstream f(manifestPath);
+	std::string line;
+	if (!f || !std::getline(f, line) || line != manifestHeader) {
+		errorMsg = "not a dsf2flac cache manifest: " + manifestPath.string();
+		return false;
+	}
+	Entry* e = NULL;
+	while (std::getline(f, line)) {
+		if (line.size() < 2 || line[1] != '\t')
+			continue;
+		std::istringstream ss(line.substr(2));
+		if (line[0] == 'E') {
+			std::string in, out, settings;
+			if (!std::getline(ss, in, '\t') || !std::getline(ss, out, '\t') || !std::getline(ss, settings))
+				continue;
+			e = &entries[in + "\t" + out];
+			e->settings = settings;
+			e->outputs.clear();
+		} else if (e && (line[0] == 'I' || line[0] == 'O')) {
+			FileId id;
+			std::string crc;
+			if (!parseFileId(ss, id.path, id.size, id.mtime, crc))
+				continue;
+			id.hasCrc = crc != "-";
+			id.crc = id.hasCrc ? strtoul(crc.c_str(), NULL, 16) : 0;
+			if (line[0] == 'I')
+				e->input = id;
+			else
+				e->outputs.push_back(id);
+		}
+	}
+	return true;
+}
+
+bool ConversionCache::save()
+{
+	std::lock_guard<std::mutex> l(lock);
+	boost::filesystem::path tmp = manifestPath;
+	tmp += ".tmp";
+	FILE* f = fopen(tmp.c_str(), "w");
+	if (!f) {
+		errorMsg = "could not write " + tmp.string();
+		return false;
+	}
+	fprintf(f, "%s\n", manifestHeader);
+	std::unordered_map<std::string, Entry>::iterator it;
+	for (it = entries.begin(); it != entries.end(); ++it) {
+		const Entry& e = it->second;
+		fprintf(f, "E\t%s\t%s\n", it->first.c_str(), e.settings.c_str());
+		for (dsf2flac_uint32 i = 0; i <= e.outputs.size(); i++) {
+			const FileId& id = i == 0 ? e.input : e.outputs[i - 1];
+			fprintf(f, "%c\t%s\t%llu\t%lld\t", i == 0 ? 'I' : 'O', id.path.c_str(),
+					(unsigned long long) id.size, (long long) id.mtime);
+			if (id.hasCrc)
+				fprintf(f, "%08x\n", id.crc);
+			else
+				fprintf(f, "-\n");
+		}
+	}
+	bool ok = !ferror(f);
+	ok &= fclose(f) == 0;
+	boost::system::error_code ec;
+	if (ok)
+		boost::filesystem::rename(tmp, manifestPath, ec);
+	if (!ok || ec) {
+		errorMsg = "could not write " + manifestPath.string();
+		return false;
+	}
+	unsaved = 0;
+	return true;
+}
+
+bool ConversionCache::saveIfDue()
+{
+	{
+		std::lock_guard<std::mutex> l(lock);
+		if (unsaved == 0)
+			return true;
+		if (unsaved < saveEveryChanges && std::chrono::steady_clock::now() - firstUnsaved < saveEveryInterval)
+			return true;
+	}
+	return save();
+}
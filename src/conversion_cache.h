@@ -0,0 +1,121 @@
+/*
+ * dsf2flac - http://code.google.com/p/dsf2flac/
+ *
+ * A file conversion tool for translating dsf dsd audio files into
+ * flac pcm audio files.
+ *
+ * Copyright (c) 2013 by respective authors.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *
+ * Acknowledgments
+ *
+ * Many thanks to the following authors and projects whose work has greatly
+ * helped the development of this tool.
+ *
+ *
+ * Sebastian Gesemann - dsd2pcm (http://code.google.com/p/dsd2pcm/)
+ * SACD Ripper (http://code.google.com/p/sacd-ripper/)
+ * Maxim V.Anisiutkin - foo_input_sacd (http://sourceforge.net/projects/sacddecoder/files/)
+ * Vladislav Goncharov - foo_input_sacd_hq (http://vladgsound.wordpress.com)
+ * Jesus R - www.sonore.us
+ *
+ */
+
+#ifndef CONVERSIONCACHE_H
+#define CONVERSIONCACHE_H
+
+#include "dsf2flac_types.h"
+#include <boost/filesystem.hpp>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * An on disk manifest of the conversions already done, so that unchanged files can be skipped.
+ *
+ * Each entry is keyed by the input and output paths and records the input file's size and
+ * modification time (plus, optionally, a crc32 of its contents), a string describing the
+ * conversion settings and the size, modification time and crc32 of every file written.
+ * A conversion is up to date if the settings are the same and neither the input nor any
+ * of the outputs has changed since. A file whose time has changed but whose size and crc32
+ * still match counts as unchanged. Checking an entry only needs a few stat() calls unless
+ * a file has been touched.
+ *
+ * All the methods can be called from several threads.
+ */
+class ConversionCache
+{
+public:
+	/// Class constructor. If hashInputs is set the inputs' contents are hashed too.
+	ConversionCache(boost::filesystem::path manifestPath, bool hashInputs);
+	/// Class destructor.
+	virtual ~ConversionCache();
+
+	/// Read the manifest, a missing manifest is the same as an empty one. Returns false if it can't be read.
+	bool load();
+	/// Write the manifest (to a temporary file which then replaces the old one). Returns false on error.
+	bool save();
+	/// Write the manifest if there are enough changes since it was last written, or some changes a few seconds old.
+	bool saveIfDue();
+	/// Returns a message explaining the last error.
+	std::string getErrorMsg() { return errorMsg; };
+
+	/// True if inpath has already been converted into outpath with these settings and nothing has changed since.
+	bool isUpToDate(boost::filesystem::path inpath, boost::filesystem::path outpath, const std::string& settings);
+	/// Record a successful conversion of inpath into outpath, outputs lists every file that was written.
+	void record(boost::filesystem::path inpath, boost::filesystem::path outpath, const std::string& settings,
+			const std::vector<boost::filesystem::path>& outputs);
+	/// Forget the conversion of inpath into outpath, for instance because it failed.
+	void forget(boost::filesystem::path inpath, boost::filesystem::path outpath);
+
+	/// crc32 of a whole file, returns false if it can't be read.
+	static bool fileCrc(boost::filesystem::path path, dsf2flac_uint32* crc);
+private:
+	/// Identifies the contents of a file.
+	typedef struct {
+		std::string path;
+		dsf2flac_uint64 size;
+		dsf2flac_int64 mtime;
+		bool hasCrc;
+		dsf2flac_uint32 crc;
+	} FileId;
+	/// One conversion.
+	typedef struct {
+		std::string settings;
+		FileId input;
+		std::vector<FileId> outputs;
+	} Entry;
+
+	/// Describe a file as it is now, the crc is only worked out if withCrc is set.
+	static bool identify(boost::filesystem::path path, bool withCrc, FileId* id);
+	/// True if the file still matches id.
+	static bool unchanged(const FileId& id);
+	/// The key used for an input/output pair.
+	static std::string makeKey(boost::filesystem::path inpath, boost::filesystem::path outpath);
+private:
+	boost::filesystem::path manifestPath;
+	bool hashInputs;
+	std::unordered_map<std::string, Entry> entries;
+	dsf2flac_uint32 unsaved;	// records and forgets since the manifest was written
+	std::chrono::steady_clock::time_point firstUnsaved;	// when the oldest of them was made
+	std::mutex lock;
+	std::string errorMsg;
+};
+
+#endif // CONVERSIONCACHE_H
@@ -0,0 +1,223 @@
+/*
+ * dsf2flac - http://code.google.com/p/dsf2flac/
+ *
+ * A file conversion tool for translating dsf dsd audio files into
+ * flac pcm audio files.
+ *
+ * Copyright (c) 2013 by respective authors.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *
+ * Acknowledgments
+ *
+ * Many thanks to the following authors and projects whose work has greatly
+ * helped the development of this tool.
+ *
+ *
+ * Sebastian Gesemann - dsd2pcm (http://code.google.com/p/dsd2pcm/)
+ * SACD Ripper (http://code.google.com/p/sacd-ripper/)
+ * Maxim V.Anisiutkin - foo_input_sacd (http://sourceforge.net/projects/sacddecoder/files/)
+ * Vladislav Goncharov - foo_input_sacd_hq (http://vladgsound.wordpress.com)
+ * Jesus R - www.sonore.us
+ *
+ */
+
+#include <conversion_server.h>
+#include <errno.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+
+/// Requests longer than this are refused, the connection is closed.
+static const size_t maxRequestLength = 1 << 20;
+/// How often (in ms) an idle connection checks whether the server is stopping.
+static const int pollIntervalMs = 250;
+
+ConversionServer::ConversionServer(std::string path, dsf2flac_uint32 n)
+{
+	socketPath = path;
+	nWorkers = n;
+	if (nWorkers == 0)
+		nWorkers = std::thread::hardware_concurrency();
+	if (nWorkers == 0)
+		nWorkers = 1;
+	listenFd = -1;
+	stopping = false;
+}
+
+ConversionServer::~ConversionServer()
+{
+	if (listenFd >= 0) {
+		close(listenFd);
+		unlink(socketPath.c_str());
+	}
+}
+
+bool ConversionServer::listen()
+{
+	struct sockaddr_un addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	if (socketPath.empty() || socketPath.size() >= sizeof(addr.sun_path)) {
+		errorMsg = "the socket path " + socketPath + " is too long";
+		return false;
+	}
+	strcpy(addr.sun_path, socketPath.c_str());
+
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0) {
+		errorMsg = std::string("can't create a socket: ") + strerror(errno);
+		return false;
+	}
+
+	// a socket left behind by a server which has gone is replaced, a live one (or any other file) is not.
+	struct stat st;
+	if (lstat(socketPath.c_str(), &st) == 0) {
+		if (!S_ISSOCK(st.st_mode)) {
+			errorMsg = socketPath + " exists and is not a socket";
+			close(fd);
+			return false;
+		}
+		if (connect(fd, (struct sockaddr*) &addr, sizeof(addr)) == 0) {
+			errorMsg = socketPath + " is already in use by another server";
+			close(fd);
+			return false;
+		}
+		unlink(socketPath.c_str());
+	}
+
+	if (bind(fd, (struct sockaddr*) &addr, sizeof(addr)) != 0 || ::listen(fd, SOMAXCONN) != 0) {
+		errorMsg = "can't listen on " + socketPath + ": " + strerror(errno);
+		close(fd);
+		return false;
+	}
+	listenFd = fd;
+	return true;
+}
+
+void ConversionServer::run(RequestFunction handle)
+{
+	std::vector<std::thread> workers;
+	for (dsf2flac_uint32 i = 0; i < nWorkers; i++)
+		workers.push_back(std::thread(&ConversionServer::workerLoop, this, handle));
+	for (dsf2flac_uint32 i = 0; i < workers.size(); i++)
+		workers[i].join();
+}
+
+void ConversionServer::stop()
+{
+	stopping = true;
+	// wakes up the workers waiting in accept()
+	if (listenFd >= 0)
+		shutdown(listenFd, SHUT_RDWR);
+}
+
+void ConversionServer::workerLoop(RequestFunction handle)
+{
+	while (!stopping) {
+		int fd = accept(listenFd, NULL, NULL);
+		if (fd < 0) {
+			if (stopping)
+				break;
+			// out of file descriptors or the like, wait a little for things to improve
+			if (errno != EINTR && errno != ECONNABORTED)
+				usleep(pollIntervalMs * 1000);
+			continue;
+		}
+		serveConnection(fd, handle);
+		close(fd);
+	}
+}
+
+void ConversionServer::serveConnection(int fd, RequestFunction handle)
+{
+	std::string pending;
+	char buf[4096];
+	while (!stopping) {
+		struct pollfd p;
+		p.fd = fd;
+		p.events = POLLIN;
+		p.revents = 0;
+		int r = poll(&p, 1, pollIntervalMs);
+		if (r < 0 && errno != EINTR)
+			return;
+		if (r <= 0)
+			continue;
+		ssize_t n = recv(fd, buf, sizeof(buf), 0);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return; // the client has finished
+		pending.append(buf, n);
+
+		// answer every complete line
+		size_t eol;
+		while (!stopping && (eol = pending.find('\n')) != std::string::npos) {
+			std::string line = pending.substr(0, eol);
+			pending.erase(0, eol + 1);
+			if (!line.empty() && line[line.size() - 1] == '\r')
+				line.erase(line.size() - 1);
+			if (line.empty())
+				continue;
+
+			std::vector<std::string> fields;
+			size_t start = 0;
+			while (true) {
+				size_t tab = line.find('\t', start);
+				fields.push_back(line.substr(start, tab - start));
+				if (tab == std::string::npos)
+					break;
+				start = tab + 1;
+			}
+
+			// only whole percents are sent, so a client is not flooded with progress lines
+			dsf2flac_int32 lastPercent = -1;
+			ProgressFunction progress = [&](dsf2flac_float64 percent) {
+				dsf2flac_int32 p = (dsf2flac_int32) percent;
+				if (p <= lastPercent)
+					return;
+				lastPercent = p;
+				sendLine(fd, "progress\t" + std::to_string(p));
+			};
+			if (!sendLine(fd, handle(fields, progress)))
+				return;
+		}
+		if (pending.size() > maxRequestLength) {
+			sendLine(fd, "error\trequest too long");
+			return;
+		}
+	}
+}
+
+bool ConversionServer::sendLine(int fd, const std::string& line)
+{
+	std::string data = line + "\n";
+	size_t sent = 0;
+	while (sent < data.size()) {
+		// a client which has gone away must not kill the server with SIGPIPE
+		ssize_t n = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return false;
+		sent += n;
+	}
+	return true;
+}
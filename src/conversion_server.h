@@ -0,0 +1,101 @@
+/*
+ * dsf2flac - http://code.google.com/p/dsf2flac/
+ *
+ * A file conversion tool for translating dsf dsd audio files into
+ * flac pcm audio files.
+ *
+ * Copyright (c) 2013 by respective authors.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *
+ * Acknowledgments
+ *
+ * Many thanks to the following authors and projects whose work has greatly
+ * helped the development of this tool.
+ *
+ *
+ * Sebastian Gesemann - dsd2pcm (http://code.google.com/p/dsd2pcm/)
+ * SACD Ripper (http://code.google.com/p/sacd-ripper/)
+ * Maxim V.Anisiutkin - foo_input_sacd (http://sourceforge.net/projects/sacddecoder/files/)
+ * Vladislav Goncharov - foo_input_sacd_hq (http://vladgsound.wordpress.com)
+ * Jesus R - www.sonore.us
+ *
+ */
+
+#ifndef CONVERSIONSERVER_H
+#define CONVERSIONSERVER_H
+
+#include "dsf2flac_types.h"
+#include <atomic>
+#include <functional>
+#include <string>
+#include <vector>
+
+/**
+ * Serves conversion requests on a unix domain socket, so many short jobs can be run without
+ * starting a new process (and rebuilding the filter tables) for each one.
+ *
+ * The protocol is line based. Each request is one line of tab separated fields, the reply is
+ * any number of "progress\tPERCENT" lines followed by one final line from the request handler.
+ * A connection may send any number of requests, they are answered in order. Every worker
+ * thread accepts connections itself, so a new connection is picked up by the first idle worker
+ * without going through a queue; to run jobs side by side open several connections.
+ */
+class ConversionServer
+{
+public:
+	/// Reports how far the current request has got, in percent.
+	typedef std::function<void (dsf2flac_float64 percent)> ProgressFunction;
+	/// Runs one request and returns the final reply line (without the newline). Called from the worker threads.
+	typedef std::function<std::string (const std::vector<std::string>& fields, const ProgressFunction& progress)> RequestFunction;
+
+	/// Class constructor. nWorkers = 0 uses one worker per cpu core.
+	ConversionServer(std::string socketPath, dsf2flac_uint32 nWorkers);
+	/// Class destructor. Closes the socket and removes it from the file system.
+	virtual ~ConversionServer();
+
+	/// Create the socket and start listening on it. Returns false (see getErrorMsg) if this fails.
+	bool listen();
+	/// Serve requests with handle until stop() is called.
+	void run(RequestFunction handle);
+	/**
+	 * Stop accepting connections. The workers finish the request they are running and run()
+	 * returns once they have all stopped. Safe to call from a signal handler.
+	 */
+	void stop();
+
+	/// The number of worker threads.
+	dsf2flac_uint32 getNumWorkers() { return nWorkers; };
+	/// The path of the socket.
+	std::string getSocketPath() { return socketPath; };
+	/// Describes what went wrong.
+	std::string getErrorMsg() { return errorMsg; };
+private:
+	/// The loop run by each worker thread.
+	void workerLoop(RequestFunction handle);
+	/// Answer the requests on one connection until it is closed (or the server is stopped).
+	void serveConnection(int fd, RequestFunction handle);
+	/// Send a whole line to fd, returns false if the client has gone away.
+	static bool sendLine(int fd, const std::string& line);
+private:
+	std::string socketPath;
+	dsf2flac_uint32 nWorkers;
+	int listenFd;
+	std::atomic<bool> stopping;
+	std::string errorMsg;
+};
+
+#endif // CONVERSIONSERVER_H
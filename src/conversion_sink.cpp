@@ -0,0 +1,491 @@
+/*
+ * dsf2flac - http://code.google.com/p/dsf2flac/
+ *
+ * A file conversion tool for translating dsf dsd audio files into
+ * flac pcm audio files.
+ *
+ * Copyright (c) 2013 by respective authors.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *
+ * Acknowledgments
+ *
+ * Many thanks to the following authors and projects whose work has greatly
+ * helped the development of this tool.
+ *
+ *
+ * Sebastian Gesemann - dsd2pcm (http://code.google.com/p/dsd2pcm/)
+ * SACD Ripper (http://code.google.com/p/sacd-ripper/)
+ * Maxim V.Anisiutkin - foo_input_sacd (http://sourceforge.net/projects/sacddecoder/files/)
+ * Vladislav Goncharov - foo_input_sacd_hq (http://vladgsound.wordpress.com)
+ * Jesus R - www.sonore.us
+ *
+ */
+
+#include "conversion_sink.h"
+#include <stage_timer.h>
+#include <tagConversion.h>
+#include <FLAC++/metadata.h>
+#include <math.h>
+#include <string.h>
+
+#define flacBlockLen 1024
+#define waveBlockLen 16384
+#define dsdBlockLen 65536
+
+ConversionSink::ConversionSink(DsdSampleReader *r)
+{
+	reader = r;
+	valid = true;
+	verbose = true;
+	errorMsg = "";
+}
+
+ConversionSink::~ConversionSink()
+{
+}
+
+/*
+ * FlacSink
+ */
+
+/// A FLAC file encoder which counts the bytes libFLAC writes, as written by the write stage.
+class CountingFlacEncoder : public FLAC::Encoder::File
+{
+public:
+	CountingFlacEncoder() { bytesCounted = 0; };
+protected:
+	void progress_callback(FLAC__uint64 bytes_written, FLAC__uint64 samples_written, unsigned frames_written, unsigned total_frames_estimate) {
+		StageTimer::count(STAGE_WRITE, bytes_written - bytesCounted, 0);
+		bytesCounted = bytes_written;
+	};
+private:
+	FLAC__uint64 bytesCounted;
+};
+
+FlacSink::FlacSink(DsdSampleReader *r) : ConversionSink(r)
+{
+	encoder = NULL;
+	metadata[0] = NULL;
+	metadata[1] = NULL;
+	buffer = NULL;
+}
+
+FlacSink::~FlacSink()
+{
+	freeEncoder();
+}
+
+bool FlacSink::openEncoder(boost::filesystem::path outpath, int bits, int sampleRate, dsf2flac_uint64 totalSamples, ID3_Tag id3tag)
+{
+	freeEncoder();
+
+	// setup the encoder
+	bool ok = true;
+	encoder = new CountingFlacEncoder();
+	if (!*encoder) {
+		errorMsg = "allocating encoder";
+		return false;
+	}
+	ok &= encoder->set_verify(true);
+	ok &= encoder->set_compression_level(5);
+	ok &= encoder->set_channels(reader->getNumChannels());
+	ok &= encoder->set_bits_per_sample(bits);
+	ok &= encoder->set_sample_rate(sampleRate);
+	ok &= encoder->set_total_samples_estimate(totalSamples);
+
+	// add tags and a padding block
+	if (ok) {
+		metadata[0] = id3v2_to_flac(id3tag);
+		metadata[1] = FLAC__metadata_object_new(FLAC__METADATA_TYPE_PADDING);
+		metadata[1]->length = 2048; /* set the padding length */
+		ok = encoder->set_metadata(metadata, 2);
+	}
+	if (!ok) {
+		errorMsg = "setting up encoder";
+		return false;
+	}
+
+	// initialize encoder
+	FLAC__StreamEncoderInitStatus init_status;
+	if (!strcmp(outpath.c_str(), "-"))
+		init_status = encoder->init((FILE *) stdout);
+	else
+		init_status = encoder->init(outpath.c_str());
+	if (init_status != FLAC__STREAM_ENCODER_INIT_STATUS_OK) {
+		errorMsg = std::string("initializing encoder: ") + FLAC__StreamEncoderInitStatusString[init_status];
+		return false;
+	}
+
+	// create a FLAC__int32 buffer to hold the samples as they are converted
+	buffer = new FLAC__int32[reader->getNumChannels() * flacBlockLen];
+	channels.resize(reader->getNumChannels());
+	for (dsf2flac_uint32 c = 0; c < reader->getNumChannels(); c++)
+		channels[c] = buffer + c * flacBlockLen;
+	return true;
+}
+
+bool FlacSink::encode(dsf2flac_uint32 nFrames)
+{
+	StageScope scope(STAGE_ENCODE);
+	StageTimer::count(STAGE_ENCODE, 0, (dsf2flac_uint64) nFrames * reader->getNumChannels());
+	if (encoder->process_interleaved(buffer, nFrames))
+		return true;
+	errorMsg = encoder->get_state().resolved_as_cstring(*encoder);
+	fprintf(stderr, "   state: %s\n", errorMsg.c_str());
+	return false;
+}
+
+bool FlacSink::encodePlanar(dsf2flac_uint32 nFrames)
+{
+	StageScope scope(STAGE_ENCODE);
+	StageTimer::count(STAGE_ENCODE, 0, (dsf2flac_uint64) nFrames * reader->getNumChannels());
+	if (encoder->process(&channels[0], nFrames))
+		return true;
+	errorMsg = encoder->get_state().resolved_as_cstring(*encoder);
+	fprintf(stderr, "   state: %s\n", errorMsg.c_str());
+	return false;
+}
+
+bool FlacSink::closeTrack()
+{
+	if (!encoder)
+		return false;
+	// close the flac file
+	StageScope scope(STAGE_ENCODE); // finish() encodes and writes the last block
+	bool ok = encoder->finish();
+	if (!ok)
+		errorMsg = encoder->get_state().resolved_as_cstring(*encoder);
+	freeEncoder();
+	return ok;
+}
+
+void FlacSink::freeEncoder()
+{
+	if (encoder)
+		delete encoder;
+	encoder = NULL;
+	for (int i=0; i<2; i++) {
+		if (metadata[i])
+			FLAC__metadata_object_delete(metadata[i]);
+		metadata[i] = NULL;
+	}
+	if (buffer)
+		delete[] buffer;
+	buffer = NULL;
+	channels.clear();
+}
+
+/*
+ * PcmFlacSink
+ */
+
+PcmFlacSink::PcmFlacSink(DsdSampleReader *r, int fs, int b, bool d, dsf2flac_float64 s)
+	: FlacSink(r), dec(r, fs)
+{
+	bits = b;
+	dither = d;
+	userScale = s;
+	started = false;
+	remaining = 0;
+	if (!dec.isValid()) {
+		valid = false;
+		errorMsg = dec.getErrorMsg();
+		return;
+	}
+
+	// calc real scale and dither amplitude
+	scale = userScale * pow(2.0, bits - 1); // increase scale by factor of 2^23 (24bit).
+	if (dither)
+		tpdfDitherPeakAmplitude = 1.0;
+	else
+		tpdfDitherPeakAmplitude = 0.0;
+	clipAmplitude = pow(2.0, bits - 1) - 1; // clip at max range.
+}
+
+PcmFlacSink::~PcmFlacSink()
+{
+}
+
+void PcmFlacSink::dispFormatInfo()
+{
+	fprintf(stderr, "Output format\n\tSampleRate: %dHz\n\tDepth: %dbit\n\tDither: %s\n\tScale: %1.1fdB\n",
+			dec.getOutputSampleRate(), bits, (dither) ? "true" : "false", 20 * log10(userScale));
+}
+
+bool PcmFlacSink::openTrack(dsf2flac_uint32 n, boost::filesystem::path outpath)
+{
+	// The first track steps on to its start on the programme's samples, so a track converted on its
+	// own (after the reader was moved to it) gives the same samples and dither as the whole file.
+	if (!started) {
+		dec.startAt(reader->getTrackStart(0), reader->getTrackStart(n));
+		started = true;
+	}
+
+	// Later tracks carry on from the samples already made, so the programme is decimated once
+	// and the tracks join up exactly. Each is cut at the first sample at or after its start
+	// and ends before the first at or after the DSD sample following its last one.
+	dsf2flac_int64 skip = dec.getSamplesBefore(reader->getTrackStart(n));
+	dsf2flac_int64 end = dec.getSamplesBefore(reader->getTrackEnd(n) + 1);
+	dsf2flac_int64 lastSample = dec.getSamplesBefore((dsf2flac_int64) floor(dec.getLastValidSample() * dec.getDecimationRatio()) + 1);
+	if (end > lastSample)
+		end = lastSample;
+	remaining = end > skip ? end - skip : 0;
+
+	if (!openEncoder(outpath, bits, dec.getOutputSampleRate(), remaining, reader->getID3Tag(n)))
+		return false;
+
+	// any gap since the last track is decimated and dropped, which keeps the filters and dither running on.
+	while (skip > 0) {
+		dsf2flac_uint32 m = skip < flacBlockLen ? skip : flacBlockLen;
+		dec.getSamplesPlanar(&channels[0], m, scale, tpdfDitherPeakAmplitude, clipAmplitude);
+		skip -= m;
+	}
+	return true;
+}
+
+bool PcmFlacSink::process()
+{
+	dsf2flac_uint32 m = remaining < flacBlockLen ? remaining : flacBlockLen;
+	dec.getSamplesPlanar(&channels[0], m, scale, tpdfDitherPeakAmplitude, clipAmplitude);
+	remaining -= m;
+	return encodePlanar(m);
+}
+
+bool PcmFlacSink::trackDone()
+{
+	return remaining <= 0;
+}
+
+/*
+ * DopFlacSink
+ */
+
+DopFlacSink::DopFlacSink(DsdSampleReader *r) : FlacSink(r), packer(r)
+{
+	endPos = 0;
+	if (reader->getSamplingFreq() == 2822400) {
+		sampleRate = 176400;
+	} else if (reader->getSamplingFreq() == 5644800) {
+		sampleRate = 352800;
+	} else {
+		sampleRate = 0;
+		valid = false;
+		errorMsg = "DOP sample rate > 352800 not supported by FLAC";
+	}
+}
+
+DopFlacSink::~DopFlacSink()
+{
+}
+
+void DopFlacSink::dispFormatInfo()
+{
+	fprintf(stderr, "Output format\n\tDSD samples packed as DoP\n");
+}
+
+bool DopFlacSink::openTrack(dsf2flac_uint32 n, boost::filesystem::path outpath)
+{
+	// double check the start and end positions!
+	dsf2flac_int64 startPos = reader->getTrackStart(n);
+	endPos = reader->getTrackEnd(n);
+	if (startPos > reader->getLength() - 1)
+		startPos = reader->getLength() - 1;
+	if (endPos > reader->getLength())
+		endPos = reader->getLength();
+
+	if (verbose) {
+		fprintf(stderr, "\tTrack number: %u\n", n);
+		fprintf(stderr, "\tTrack start: %llu\n", reader->getTrackStart(n)*1ULL);
+		fprintf(stderr, "\tTrack end: %llu\n", reader->getTrackEnd(n)*1ULL);
+	}
+
+	if (!openEncoder(outpath, 24, sampleRate, (endPos - startPos) / 16, reader->getID3Tag(n)))
+		return false;
+
+	// creep up to the start point.
+	while (reader->getPosition() < startPos)
+		reader->step();
+	return true;
+}
+
+bool DopFlacSink::process()
+{
+	bool ok = true;
+	if (reader->getPosition() <= endPos - flacBlockLen * 16) {
+		packer.pack_buffer(buffer, reader->getNumChannels() * flacBlockLen);
+		ok &= encode(flacBlockLen);
+	} else {
+		// creep up to the end a frame at a time
+		while (reader->getPosition() <= endPos) {
+			packer.pack_buffer(buffer, reader->getNumChannels());
+			ok &= encode(1);
+		}
+	}
+	return ok;
+}
+
+bool DopFlacSink::trackDone()
+{
+	return reader->getPosition() > endPos;
+}
+
+/*
+ * DopWaveSink
+ */
+
+DopWaveSink::DopWaveSink(DsdSampleReader *r) : ConversionSink(r)
+{
+	writer = NULL;
+	framesLeft = 0;
+}
+
+DopWaveSink::~DopWaveSink()
+{
+	if (writer)
+		delete writer;
+}
+
+void DopWaveSink::dispFormatInfo()
+{
+	fprintf(stderr, "Output format\n\tDSD samples packed as DoP\n");
+}
+
+bool DopWaveSink::openTrack(dsf2flac_uint32 n, boost::filesystem::path outpath)
+{
+	// double check the start and end positions!
+	dsf2flac_int64 startPos = reader->getTrackStart(n);
+	dsf2flac_int64 endPos = reader->getTrackEnd(n);
+	if (startPos > reader->getLength() - 1)
+		startPos = reader->getLength() - 1;
+	if (endPos > reader->getLength())
+		endPos = reader->getLength();
+
+	if (verbose) {
+		fprintf(stderr, "\tTrack number: %u\n", n);
+		fprintf(stderr, "\tTrack start: %llu\n", reader->getTrackStart(n)*1ULL);
+		fprintf(stderr, "\tTrack end: %llu\n", reader->getTrackEnd(n)*1ULL);
+	}
+
+	// creep up to the start point.
+	while (reader->getPosition() < startPos)
+		reader->step();
+
+	// each DoP frame carries 16 DSD samples per channel.
+	framesLeft = 0;
+	if (endPos > reader->getPosition())
+		framesLeft = (endPos - reader->getPosition()) / 16;
+
+	// the writer packs the DoP frames straight into its output buffer.
+	if (writer)
+		delete writer;
+	writer = new DopWaveWriter(reader);
+	if (!writer->open(outpath.c_str(), framesLeft)) {
+		errorMsg = "opening output: " + writer->getErrorMsg();
+		return false;
+	}
+	return true;
+}
+
+bool DopWaveSink::process()
+{
+	dsf2flac_uint32 n = waveBlockLen;
+	if (n > framesLeft)
+		n = framesLeft;
+	framesLeft -= n;
+	if (writer->write(n))
+		return true;
+	errorMsg = writer->getErrorMsg();
+	framesLeft = 0; // no point carrying on
+	return false;
+}
+
+bool DopWaveSink::trackDone()
+{
+	return framesLeft == 0;
+}
+
+bool DopWaveSink::closeTrack()
+{
+	if (!writer)
+		return false;
+	bool ok = writer->close();
+	if (!ok)
+		errorMsg = writer->getErrorMsg();
+	delete writer;
+	writer = NULL;
+	return ok;
+}
+
+/*
+ * DsdFileSink
+ */
+
+DsdFileSink::DsdFileSink(DsdSampleReader *r, DsdFileWriter *w) : ConversionSink(r)
+{
+	writer = w;
+}
+
+DsdFileSink::~DsdFileSink()
+{
+	delete writer;
+}
+
+void DsdFileSink::dispFormatInfo()
+{
+	fprintf(stderr, "Output format\n\tDSD samples written unchanged as %s\n", writer->getFormatName());
+}
+
+bool DsdFileSink::openTrack(dsf2flac_uint32 n, boost::filesystem::path outpath)
+{
+	if (verbose) {
+		fprintf(stderr, "\tTrack number: %u\n", n);
+		fprintf(stderr, "\tTrack start: %llu\n", reader->getTrackStart(n)*1ULL);
+		fprintf(stderr, "\tTrack end: %llu\n", reader->getTrackEnd(n)*1ULL);
+	}
+
+	if (!writer->open(outpath.c_str(), n)) {
+		errorMsg = writer->getErrorMsg();
+		return false;
+	}
+	if (verbose && writer->isCopying())
+		fprintf(stderr, "\tCopying the sample data directly\n");
+	// the samples are still written, just more slowly, so this is only a warning
+	if (!writer->getCopyMsg().empty())
+		fprintf(stderr, "WARNING: not copying the sample data directly, %s\n", writer->getCopyMsg().c_str());
+	return true;
+}
+
+bool DsdFileSink::process()
+{
+	if (writer->write(dsdBlockLen))
+		return true;
+	errorMsg = writer->getErrorMsg();
+	return false;
+}
+
+bool DsdFileSink::trackDone()
+{
+	return writer->done();
+}
+
+bool DsdFileSink::closeTrack()
+{
+	bool ok = writer->close();
+	if (!ok)
+		errorMsg = writer->getErrorMsg();
+	return ok;
+}
@@ -0,0 +1,206 @@
+/*
+ * dsf2flac - http://code.google.com/p/dsf2flac/
+ *
+ * A file conversion tool for translating dsf dsd audio files into
+ * flac pcm audio files.
+ *
+ * Copyright (c) 2013 by respective authors.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *
+ * Acknowledgments
+ *
+ * Many thanks to the following authors and projects whose work has greatly
+ * helped the development of this tool.
+ *
+ *
+ * Sebastian Gesemann - dsd2pcm (http://code.google.com/p/dsd2pcm/)
+ * SACD Ripper (http://code.google.com/p/sacd-ripper/)
+ * Maxim V.Anisiutkin - foo_input_sacd (http://sourceforge.net/projects/sacddecoder/files/)
+ * Vladislav Goncharov - foo_input_sacd_hq (http://vladgsound.wordpress.com)
+ * Jesus R - www.sonore.us
+ *
+ */
+
+#ifndef CONVERSIONSINK_H
+#define CONVERSIONSINK_H
+
+#include <dsf2flac_types.h>
+#include <dsd_sample_reader.h>
+#include <dsd_decimator.h>
+#include <dop_packer.h>
+#include <dop_wave_writer.h>
+#include <dsd_file_writer.h>
+#include <boost/filesystem.hpp>
+#include <FLAC++/encoder.h>
+#include <string>
+#include <vector>
+
+/**
+ * Something that converts the tracks of a DsdSampleReader into an output file, a block at a time.
+ *
+ * A sink is driven by calling openTrack(), then process() until trackDone(), then closeTrack().
+ * Because the work is split into blocks several sinks can share one input (see DsdTeeReader),
+ * the caller just keeps advancing whichever sink is furthest behind.
+ */
+class ConversionSink
+{
+public:
+	/// Class constructor.
+	ConversionSink(DsdSampleReader *reader);
+	/// Class destructor.
+	virtual ~ConversionSink();
+
+	/// Return false if the sink could not be set up.
+	bool isValid() { return valid; };
+	/// Returns a message explaining the last error.
+	std::string getErrorMsg() { return errorMsg; };
+	/// Returns the reader feeding this sink.
+	DsdSampleReader* getReader() { return reader; };
+	/// Returns how far the sink has got through the input, in DSD samples.
+	virtual dsf2flac_int64 getPosition() { return reader->getPosition(); };
+	/// Turn the per track messages on or off (on by default).
+	void setVerbose(bool v) { verbose = v; };
+	/// Return true if the sink decimates the input into PCM.
+	virtual bool makesPcm() { return false; };
+	/// Return true if the PCM comes from the fixed point engine, see DsdDecimator::usesFixedPoint().
+	virtual bool isFixedPoint() { return false; };
+
+	/// Print a description of the output format for the user.
+	virtual void dispFormatInfo() = 0;
+	/// Start converting track n into outpath ("-" for stdout).
+	virtual bool openTrack(dsf2flac_uint32 n, boost::filesystem::path outpath) = 0;
+	/// Convert the next block of the current track.
+	virtual bool process() = 0;
+	/// Returns true once the whole track has been converted.
+	virtual bool trackDone() = 0;
+	/// Finish the current track and close the output.
+	virtual bool closeTrack() = 0;
+protected:
+	DsdSampleReader *reader;
+	bool valid;
+	bool verbose;
+	std::string errorMsg;
+};
+
+/**
+ * Common parts of the sinks which write FLAC.
+ */
+class FlacSink : public ConversionSink
+{
+public:
+	FlacSink(DsdSampleReader *reader);
+	virtual ~FlacSink();
+	bool closeTrack();
+protected:
+	/// Set up and initialise a new encoder for a track.
+	bool openEncoder(boost::filesystem::path outpath, int bits, int sampleRate, dsf2flac_uint64 totalSamples, ID3_Tag id3tag);
+	/// Encode nFrames interleaved frames from buffer.
+	bool encode(dsf2flac_uint32 nFrames);
+	/// Encode nFrames frames from the channel buffers.
+	bool encodePlanar(dsf2flac_uint32 nFrames);
+	/// Free the encoder, its metadata and the sample buffer.
+	void freeEncoder();
+protected:
+	FLAC::Encoder::File *encoder;
+	FLAC__StreamMetadata *metadata[2];
+	FLAC__int32 *buffer;		//!< samples waiting to be encoded.
+	std::vector<FLAC__int32*> channels;	//!< the start of each channel in buffer, flacBlockLen samples apart.
+};
+
+/**
+ * Decimates into PCM and encodes FLAC.
+ */
+class PcmFlacSink : public FlacSink
+{
+public:
+	/// Class constructor, fs is the PCM rate and userScale a linear gain.
+	PcmFlacSink(DsdSampleReader *reader, int fs, int bits, bool dither, dsf2flac_float64 userScale);
+	virtual ~PcmFlacSink();
+	bool makesPcm() { return true; };
+	bool isFixedPoint() { return dec.usesFixedPoint(scale); };
+	void dispFormatInfo();
+	bool openTrack(dsf2flac_uint32 n, boost::filesystem::path outpath);
+	bool process();
+	bool trackDone();
+private:
+	DsdDecimator dec;
+	int bits;
+	bool dither;
+	dsf2flac_float64 userScale;
+	dsf2flac_float64 scale;
+	dsf2flac_float64 tpdfDitherPeakAmplitude;
+	dsf2flac_float64 clipAmplitude;
+	bool started;				//!< true once the first track has been positioned.
+	dsf2flac_int64 remaining;	//!< the PCM samples of the track still to encode.
+};
+
+/**
+ * Packs DoP and encodes FLAC.
+ */
+class DopFlacSink : public FlacSink
+{
+public:
+	DopFlacSink(DsdSampleReader *reader);
+	virtual ~DopFlacSink();
+	void dispFormatInfo();
+	bool openTrack(dsf2flac_uint32 n, boost::filesystem::path outpath);
+	bool process();
+	bool trackDone();
+private:
+	DopPacker packer;
+	int sampleRate;			//!< the DoP frame rate.
+	dsf2flac_int64 endPos;	//!< the last DSD sample of the track.
+};
+
+/**
+ * Packs DoP into a 24bit wave file.
+ */
+class DopWaveSink : public ConversionSink
+{
+public:
+	DopWaveSink(DsdSampleReader *reader);
+	virtual ~DopWaveSink();
+	void dispFormatInfo();
+	bool openTrack(dsf2flac_uint32 n, boost::filesystem::path outpath);
+	bool process();
+	bool trackDone();
+	bool closeTrack();
+private:
+	DopWaveWriter *writer;
+	dsf2flac_uint64 framesLeft;
+};
+
+/**
+ * Writes the DSD samples straight into DSF or DFF files, see DsdFileWriter.
+ */
+class DsdFileSink : public ConversionSink
+{
+public:
+	/// Class constructor, the sink takes ownership of the writer.
+	DsdFileSink(DsdSampleReader *reader, DsdFileWriter *writer);
+	virtual ~DsdFileSink();
+	void dispFormatInfo();
+	dsf2flac_int64 getPosition() { return writer->getPosition(); };
+	bool openTrack(dsf2flac_uint32 n, boost::filesystem::path outpath);
+	bool process();
+	bool trackDone();
+	bool closeTrack();
+private:
+	DsdFileWriter *writer;
+};
+
+#endif // CONVERSIONSINK_H
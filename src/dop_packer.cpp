@@ -37,6 +37,11 @@
 
 #include "dop_packer.h"
 
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <tmmintrin.h>
+#define DOP_SSSE3
+#endif
+
 dsf2flac_int32 odd_marker = 0x00050000;
 dsf2flac_int32 even_marker  = 0xFFFA0000;
 
@@ -97,46 +102,133 @@ unsigned char reverse(unsigned char x)
     return table[x];
 }
 
-void DopPacker::pack_buffer(dsf2flac_int32 *buffer, dsf2flac_uint32 bufferLen) {
-	// check the buffer seems sensible
-	ldiv_t d = div(static_cast<long>(bufferLen),static_cast<long>(reader->getNumChannels()));
-	if (d.rem) {
-		fputs("Buffer length is not a multiple of getNumChannels()",stderr);
-		exit(EXIT_FAILURE);
+#ifdef DOP_SSSE3
+// reverses 16 chars at a time using a nibble lookup table in pshufb.
+__attribute__((target("ssse3")))
+static void reverse_bits_ssse3(dsf2flac_uint8 *data, dsf2flac_uint32 n)
+{
+	const __m128i lut = _mm_setr_epi8(0x0,0x8,0x4,0xc,0x2,0xa,0x6,0xe,0x1,0x9,0x5,0xd,0x3,0xb,0x7,0xf);
+	const __m128i lowNibbles = _mm_set1_epi8(0x0f);
+	dsf2flac_uint32 i = 0;
+	for (; i+16<=n; i+=16) {
+		__m128i v = _mm_loadu_si128(reinterpret_cast<__m128i*>(data+i));
+		__m128i lo = _mm_and_si128(v,lowNibbles);
+		__m128i hi = _mm_and_si128(_mm_srli_epi16(v,4),lowNibbles);
+		// the reversed low nibble becomes the high nibble and vice versa
+		v = _mm_or_si128(_mm_slli_epi16(_mm_shuffle_epi8(lut,lo),4),_mm_shuffle_epi8(lut,hi));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(data+i),v);
 	}
-	// get the sample buffer
-	boost::circular_buffer<dsf2flac_uint8>* buff = reader->getBuffer();
-	for (int i=0; i<d.quot ; i++) {
+	for (; i<n; i++)
+		data[i] = reverse(data[i]);
+}
+#endif
 
-		dsf2flac_int32 packed_sample;
-		dsf2flac_uint8 byte1;
-		dsf2flac_uint8 byte2;
+void DopPacker::reverse_bits(dsf2flac_uint8 *data, dsf2flac_uint32 n)
+{
+#ifdef DOP_SSSE3
+	static const bool haveSsse3 = __builtin_cpu_supports("ssse3");
+	if (haveSsse3) {
+		reverse_bits_ssse3(data,n);
+		return;
+	}
+#endif
+	for (dsf2flac_uint32 i=0; i<n; i++)
+		data[i] = reverse(data[i]);
+}
 
-		// step the buffer right away so that the first sample sits in position 1 in the buffer (second in position 0)
-		reader->step();
+void DopPacker::pack_block(
+		dsf2flac_uint8 **src,
+		dsf2flac_uint32 nChans,
+		dsf2flac_uint32 nFrames,
+		dsf2flac_int64 firstSample,
+		dsf2flac_int32 *buffer)
+{
+	// the marker only depends on the sample position, so work out both phases up front.
+	dsf2flac_int32 marker[2];
+	marker[0] = ( (firstSample % 32) != 0 ) ? even_marker : odd_marker;
+	marker[1] = ( ((firstSample + 16) % 32) != 0 ) ? even_marker : odd_marker;
+
+	for (dsf2flac_uint32 c=0; c<nChans; c++) {
+		const dsf2flac_uint8* s = src[c];
+		dsf2flac_int32* out = buffer + c;
+		for (dsf2flac_uint32 i=0; i<nFrames; i++)
+			out[i*nChans] = marker[i&1] | ((dsf2flac_int32) s[2*i]) << 8 | ((dsf2flac_int32) s[2*i+1]);
+	}
+}
 
-		for (dsf2flac_uint32 c=0; c<reader->getNumChannels(); c++) {
+void DopPacker::pack_block_24(
+		dsf2flac_uint8 **src,
+		dsf2flac_uint32 nChans,
+		dsf2flac_uint32 nFrames,
+		dsf2flac_int64 firstSample,
+		dsf2flac_uint8 *out)
+{
+	dsf2flac_uint8 marker[2];
+	marker[0] = (dsf2flac_uint8) ((( (firstSample % 32) != 0 ) ? even_marker : odd_marker) >> 16);
+	marker[1] = (dsf2flac_uint8) ((( ((firstSample + 16) % 32) != 0 ) ? even_marker : odd_marker) >> 16);
+
+	dsf2flac_uint32 frameBytes = 3*nChans;
+	for (dsf2flac_uint32 c=0; c<nChans; c++) {
+		const dsf2flac_uint8* s = src[c];
+		dsf2flac_uint8* o = out + 3*c;
+		for (dsf2flac_uint32 i=0; i<nFrames; i++) {
+			o[0] = s[2*i+1];
+			o[1] = s[2*i];
+			o[2] = marker[i&1];
+			o += frameBytes;
+		}
+	}
+}
 
-			if (( (reader->getPosition() - 8) % 32) != 0)
-				packed_sample = even_marker;
-			else
-				packed_sample = odd_marker;
+dsf2flac_int64 DopPacker::read_frames(dsf2flac_uint32 nFrames, std::vector<dsf2flac_uint8*>& src)
+{
+	dsf2flac_uint32 nChans = reader->getNumChannels();
+
+	// make room for two chars per frame plus the one already sitting in the circular buffers.
+	blocks.resize(nChans);
+	src.resize(nChans);
+	std::vector<dsf2flac_uint8*> dst(nChans);
+	for (dsf2flac_uint32 c=0; c<nChans; c++) {
+		if (blocks[c].size() < 2*nFrames+1)
+			blocks[c].resize(2*nFrames+1);
+		src[c] = &blocks[c][0];
+		dst[c] = &blocks[c][1];
+	}
 
-			byte1 = buff[c][1];
-			byte2 = buff[c][0];
+	// the first char of the first word was read by the previous step.
+	dsf2flac_int64 firstSample = reader->getPosition();
+	boost::circular_buffer<dsf2flac_uint8>* buff = reader->getBuffer();
+	for (dsf2flac_uint32 c=0; c<nChans; c++)
+		src[c][0] = buff[c][0];
 
-			if (reader->msbIsPlayedFirst()) {
-				byte1 = reverse(byte1);
-				byte2 = reverse(byte2);
-			}
+	// the remaining chars come straight from the reader, the last one is left over for next time.
+	reader->readBlock(&dst[0],2*nFrames);
 
-			packed_sample += ((dsf2flac_int32) byte1) << 8;
-			packed_sample += ((dsf2flac_int32) byte2);
+	if (reader->msbIsPlayedFirst())
+		for (dsf2flac_uint32 c=0; c<nChans; c++)
+			reverse_bits(src[c],2*nFrames);
 
-			buffer[i*reader->getNumChannels()+c] = packed_sample;
-		}
+	return firstSample;
+}
 
-		reader->step();
+void DopPacker::pack_buffer(dsf2flac_int32 *buffer, dsf2flac_uint32 bufferLen) {
+	// check the buffer seems sensible
+	ldiv_t d = div(static_cast<long>(bufferLen),static_cast<long>(reader->getNumChannels()));
+	if (d.rem) {
+		fputs("Buffer length is not a multiple of getNumChannels()",stderr);
+		exit(EXIT_FAILURE);
 	}
+	if (d.quot == 0)
+		return;
+	std::vector<dsf2flac_uint8*> src;
+	dsf2flac_int64 firstSample = read_frames(d.quot,src);
+	pack_block(&src[0],reader->getNumChannels(),d.quot,firstSample,buffer);
 }
 
+void DopPacker::pack_buffer_24(dsf2flac_uint8 *out, dsf2flac_uint32 nFrames) {
+	if (nFrames == 0)
+		return;
+	std::vector<dsf2flac_uint8*> src;
+	dsf2flac_int64 firstSample = read_frames(nFrames,src);
+	pack_block_24(&src[0],reader->getNumChannels(),nFrames,firstSample,out);
+}
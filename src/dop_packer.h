@@ -40,6 +40,7 @@
 
 #include "dsf2flac_types.h"
 #include "dsd_sample_reader.h"
+#include <vector>
 
 
 /**
@@ -67,10 +68,48 @@ public:
 	 */
 	void pack_buffer(dsf2flac_int32 *buffer, dsf2flac_uint32 bufferLen);
 
-private:
+	/**
+	 * Read nFrames DoP frames from the reader and write them as packed 24bit little endian PCM.
+	 * "out" must be at least nFrames*getNumChannels()*3 bytes long.
+	 * Frames are interleaved by channel exactly as in a 24bit wave file, no intermediate int32 buffer is used.
+	 */
+	void pack_buffer_24(dsf2flac_uint8 *out, dsf2flac_uint32 nFrames);
 
+	/**
+	 * Pack blocks of contiguous per channel DSD chars into DoP words.
+	 * src[c] must hold 2*nFrames chars for channel c, in the order they are played and already in DoP bit order (msb first).
+	 * firstSample is the DSD sample position of src[c][0], this sets the phase of the alternating 0x05/0xFA markers.
+	 * The output is interleaved by channel into buffer, which must be at least nFrames*nChans long.
+	 */
+	static void pack_block(
+			dsf2flac_uint8 **src,
+			dsf2flac_uint32 nChans,
+			dsf2flac_uint32 nFrames,
+			dsf2flac_int64 firstSample,
+			dsf2flac_int32 *buffer);
+
+	/**
+	 * Same as pack_block but writes packed 24bit little endian words into out (nFrames*nChans*3 bytes).
+	 */
+	static void pack_block_24(
+			dsf2flac_uint8 **src,
+			dsf2flac_uint32 nChans,
+			dsf2flac_uint32 nFrames,
+			dsf2flac_int64 firstSample,
+			dsf2flac_uint8 *out);
+
+	/**
+	 * Reverse the bit order of every char in data, in place.
+	 * Uses SSSE3 shuffles where the cpu has them.
+	 */
+	static void reverse_bits(dsf2flac_uint8 *data, dsf2flac_uint32 n);
+
+private:
+	/// Reads the chars for nFrames DoP frames into blocks, in DoP bit order. Returns the sample position of the first char.
+	dsf2flac_int64 read_frames(dsf2flac_uint32 nFrames, std::vector<dsf2flac_uint8*>& src);
 
 	DsdSampleReader *reader;	//!< A pointer to the DsdSampleReader.
+	std::vector< std::vector<dsf2flac_uint8> > blocks;	//!< Per channel DSD chars waiting to be packed.
 };
 
 #endif /* DOPPACKER_H_ */
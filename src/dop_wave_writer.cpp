@@ -0,0 +1,201 @@
+/*
+ * dsf2flac - http://code.google.com/p/dsf2flac/
+ *
+ * A file conversion tool for translating dsf dsd audio files into
+ * flac pcm audio files.
+ *
+ * Copyright (c) 2013 by respective authors.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *
+ * Acknowledgments
+ *
+ * Many thanks to the following authors and projects whose work has greatly
+ * helped the development of this tool.
+ *
+ *
+ * Sebastian Gesemann - dsd2pcm (http://code.google.com/p/dsd2pcm/)
+ * SACD Ripper (http://code.google.com/p/sacd-ripper/)
+ * Maxim V.Anisiutkin - foo_input_sacd (http://sourceforge.net/projects/sacddecoder/files/)
+ * Vladislav Goncharov - foo_input_sacd_hq (http://vladgsound.wordpress.com)
+ * Jesus R - www.sonore.us
+ *
+ */
+
+#include "dop_wave_writer.h"
+#include "stage_timer.h"
+#include <AudioFile.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+typedef struct {
+	dsf2flac_uint8 Bits1;
+	dsf2flac_uint8 Bits2;
+	dsf2flac_uint8 Marker;
+} DopSample;
+
+template class AudioFile<DopSample>;
+typedef AudioFile<DopSample>::HeaderFormat HeaderFormat;
+
+static const size_t outBufferSize = 1 << 20; //!< The size of the output buffer in bytes.
+
+DopWaveWriter::DopWaveWriter(DsdSampleReader *r) : packer(r) {
+	reader = r;
+	fd = -1;
+	ownFd = false;
+	seekable = false;
+	headerFormat = (int) HeaderFormat::Riff;
+	framesWritten = 0;
+	outLen = 0;
+}
+
+DopWaveWriter::~DopWaveWriter() {
+	if (fd >= 0)
+		close();
+}
+
+bool DopWaveWriter::open(const char *path, dsf2flac_uint64 nFrames) {
+	if (!strcmp(path,"-")) {
+		fd = STDOUT_FILENO;
+		ownFd = false;
+	} else {
+		fd = ::open(path, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+		if (fd < 0) {
+			errorMsg = std::string("DopWaveWriter::open:") + strerror(errno);
+			return false;
+		}
+		ownFd = true;
+	}
+
+	// only regular files can have their header patched afterwards
+	struct stat st;
+	seekable = !fstat(fd,&st) && S_ISREG(st.st_mode) && lseek(fd,0,SEEK_CUR) == 0;
+
+	// pick the header layout from the expected size.
+	AudioFile<DopSample> file;
+	file.setBitDepth(24);
+	file.setNumChannels(reader->getNumChannels());
+	file.setNumSamples(nFrames);
+	file.setSampleRate(reader->getSamplingFreq() / 16);
+	file.printSummary();
+	if (file.needsRF64() || nFrames == 0)
+		headerFormat = (int) (seekable ? HeaderFormat::Rf64 : HeaderFormat::RiffSizeUnknown);
+	else
+		headerFormat = (int) HeaderFormat::Riff;
+	framesWritten = 0;
+
+	outBuffer.resize(outBufferSize);
+	std::vector<dsf2flac_uint8> headerData;
+	makeHeader(nFrames,headerData);
+	memcpy(&outBuffer[0],headerData.data(),headerData.size());
+	outLen = headerData.size();
+	return true;
+}
+
+void DopWaveWriter::makeHeader(dsf2flac_uint64 nFrames, std::vector<dsf2flac_uint8>& header) {
+	AudioFile<DopSample> file;
+	file.setSampleRate(reader->getSamplingFreq() / 16);
+	file.setBitDepth(24);
+	file.setNumChannels(reader->getNumChannels());
+	file.setNumSamples(nFrames);
+	file.getHeaderData(header,(HeaderFormat) headerFormat);
+}
+
+bool DopWaveWriter::write(dsf2flac_uint32 nFrames) {
+	size_t frameBytes = 3 * reader->getNumChannels();
+	while (nFrames > 0) {
+		// pack as many frames as fit in the space left, flushing when full.
+		dsf2flac_uint32 n = (outBuffer.size() - outLen) / frameBytes;
+		if (n == 0) {
+			if (!flush())
+				return false;
+			continue;
+		}
+		if (n > nFrames)
+			n = nFrames;
+		{
+			StageScope scope(STAGE_ENCODE);
+			StageTimer::count(STAGE_ENCODE, 0, (dsf2flac_uint64) n * reader->getNumChannels());
+			packer.pack_buffer_24(&outBuffer[outLen],n);
+		}
+		outLen += n * frameBytes;
+		framesWritten += n;
+		nFrames -= n;
+	}
+	return true;
+}
+
+bool DopWaveWriter::close() {
+	if (fd < 0)
+		return false;
+	bool ok = flush();
+	// patch the sizes now that we know how much was written.
+	if (ok && seekable)
+		ok = patchHeader();
+	if (ownFd && ::close(fd)) {
+		errorMsg = std::string("DopWaveWriter::close:") + strerror(errno);
+		ok = false;
+	}
+	fd = -1;
+	return ok;
+}
+
+bool DopWaveWriter::patchHeader() {
+	HeaderFormat format = (HeaderFormat) headerFormat;
+	AudioFile<DopSample> file;
+	file.setBitDepth(24);
+	file.setNumChannels(reader->getNumChannels());
+	file.setNumSamples(framesWritten);
+	if (format == HeaderFormat::Riff && file.needsRF64()) {
+		// more was written than announced and there is no room for a ds64 chunk.
+		fprintf(stderr,"WARNING: wave data exceeds 4GiB, writing size unknown header\n");
+		format = HeaderFormat::RiffSizeUnknown;
+	}
+	headerFormat = (int) format;
+	std::vector<dsf2flac_uint8> headerData;
+	makeHeader(framesWritten,headerData);
+	if (pwrite(fd,headerData.data(),headerData.size(),0) != (ssize_t) headerData.size()) {
+		errorMsg = std::string("DopWaveWriter::patchHeader:") + strerror(errno);
+		return false;
+	}
+	return true;
+}
+
+bool DopWaveWriter::flush() {
+	bool ok = writeAll(&outBuffer[0],outLen);
+	outLen = 0;
+	return ok;
+}
+
+bool DopWaveWriter::writeAll(const dsf2flac_uint8 *data, size_t len) {
+	StageScope scope(STAGE_WRITE);
+	StageTimer::count(STAGE_WRITE, len, 0);
+	while (len > 0) {
+		ssize_t n = ::write(fd,data,len);
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			errorMsg = std::string("DopWaveWriter::write:") + strerror(errno);
+			return false;
+		}
+		data += n;
+		len -= n;
+	}
+	return true;
+}
@@ -0,0 +1,113 @@
+/*
+ * dsf2flac - http://code.google.com/p/dsf2flac/
+ *
+ * A file conversion tool for translating dsf dsd audio files into
+ * flac pcm audio files.
+ *
+ * Copyright (c) 2013 by respective authors.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *
+ * Acknowledgments
+ *
+ * Many thanks to the following authors and projects whose work has greatly
+ * helped the development of this tool.
+ *
+ *
+ * Sebastian Gesemann - dsd2pcm (http://code.google.com/p/dsd2pcm/)
+ * SACD Ripper (http://code.google.com/p/sacd-ripper/)
+ * Maxim V.Anisiutkin - foo_input_sacd (http://sourceforge.net/projects/sacddecoder/files/)
+ * Vladislav Goncharov - foo_input_sacd_hq (http://vladgsound.wordpress.com)
+ * Jesus R - www.sonore.us
+ *
+ */
+
+#ifndef DOPWAVEWRITER_H_
+#define DOPWAVEWRITER_H_
+
+#include "dsf2flac_types.h"
+#include "dsd_sample_reader.h"
+#include "dop_packer.h"
+#include <string>
+#include <vector>
+
+/**
+ * Writes DoP encoded DSD into a 24bit wave file (or stdout).
+ *
+ * The DoP words are packed by the DopPacker straight into a large output buffer as 24bit
+ * little endian frames, which is handed to the OS in big writes. No intermediate int32
+ * samples are produced and nothing is written one sample at a time.
+ *
+ * Outputs that would not fit in a RIFF file (4 GiB) are written as RF64 with a ds64 chunk.
+ * If the output is seekable the sizes in the header are patched on close() to match what
+ * was actually written. Pipes get an exact header when the size fits RIFF, otherwise a
+ * "size unknown" header that players read until the end of the stream.
+ */
+class DopWaveWriter {
+public:
+	/**
+	 * Class constructor. reader can be any type of DSD sample reader.
+	 */
+	DopWaveWriter(DsdSampleReader *reader);
+
+	/**
+	 * Class destructor, closes the output if still open.
+	 */
+	virtual ~DopWaveWriter();
+
+	/**
+	 * Open the output file and write the wave header for nFrames DoP frames per channel.
+	 * A path of "-" writes to stdout. nFrames may be 0 if the length is not known.
+	 * Returns false on error, see getErrorMsg().
+	 */
+	bool open(const char *path, dsf2flac_uint64 nFrames);
+
+	/**
+	 * Pack the next nFrames DoP frames from the reader into the output.
+	 */
+	bool write(dsf2flac_uint32 nFrames);
+
+	/**
+	 * Flush anything left in the output buffer and close the output.
+	 */
+	bool close();
+
+	/// Returns a message explaining the last error.
+	std::string getErrorMsg() { return errorMsg; };
+
+private:
+	/// Hand the output buffer to the OS.
+	bool flush();
+	/// Rewrite the header of a seekable output with the number of frames actually written.
+	bool patchHeader();
+	/// Build the wave header for nFrames frames in the chosen format.
+	void makeHeader(dsf2flac_uint64 nFrames, std::vector<dsf2flac_uint8>& header);
+	/// write(2) all of data, retrying on short writes.
+	bool writeAll(const dsf2flac_uint8 *data, size_t len);
+
+	DsdSampleReader *reader;	//!< A pointer to the DsdSampleReader.
+	DopPacker packer;			//!< Packs the DoP words.
+	int fd;						//!< The output file descriptor.
+	bool ownFd;					//!< False when writing to stdout.
+	bool seekable;				//!< True if the header can be patched on close.
+	int headerFormat;			//!< The AudioFile::HeaderFormat in use.
+	dsf2flac_uint64 framesWritten;	//!< Frames packed so far.
+	std::vector<dsf2flac_uint8> outBuffer;	//!< Packed frames waiting to be written.
+	size_t outLen;				//!< Number of bytes used in outBuffer.
+	std::string errorMsg;
+};
+
+#endif /* DOPWAVEWRITER_H_ */
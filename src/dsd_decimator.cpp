@@ -36,68 +36,201 @@
  */
  
 #include "dsd_decimator.h"
+#include "stage_timer.h"
 #include <math.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <tuple>
+#include <type_traits>
+#include <vector>
 #include "filters.cpp"
 
-static bool lookupTableAllocated = false;
+struct DsdDecimator::LookupTable {
+	std::vector<calc_type> data; // all rows in one contiguous block, unless mapped from a file
+	std::vector<const calc_type*> rows;
+	void* map = NULL; // the mapped table file
+	size_t mapLength = 0;
+	~LookupTable() { if (map) munmap(map,mapLength); }
+};
 
-DsdDecimator::DsdDecimator(DsdSampleReader *r, dsf2flac_uint32 rate)
+/// The start of a saved lookup table file, the table rows follow it.
+struct LookupTableHeader {
+	char magic[8]; // "dsf2lut1"
+	dsf2flac_uint32 nCoefs;
+	dsf2flac_uint32 nLookupTable;
+	dsf2flac_uint32 crc; // crc32 of the coefficients
+	dsf2flac_uint32 valueSize; // sizeof(calc_type)
+	dsf2flac_uint32 msbFirst;
+	dsf2flac_uint32 reserved;
+};
+
+/// The built-in single stage filters of each quality, for the ratios without a --filter file.
+struct BuiltinFilter {
+	DsdFilterQuality quality;
+	dsf2flac_uint32 ratio;
+	dsf2flac_int32 nCoefs;
+	const dsf2flac_float64* coefs;
+	dsf2flac_int32 tzero;
+};
+static const BuiltinFilter builtinFilters[] = {
+	{ DSD_FILTER_REFERENCE, 8, nCoefs_352, coefs_352, tzero_352 },
+	{ DSD_FILTER_REFERENCE, 16, nCoefs_176, coefs_176, tzero_176 },
+	{ DSD_FILTER_REFERENCE, 32, nCoefs_88, coefs_88, tzero_88 },
+	{ DSD_FILTER_FAST, 8, nCoefs_fast_352, coefs_fast_352, tzero_fast_352 },
+	{ DSD_FILTER_FAST, 16, nCoefs_fast_176, coefs_fast_176, tzero_fast_176 },
+	{ DSD_FILTER_FAST, 32, nCoefs_fast_88, coefs_fast_88, tzero_fast_88 },
+	{ DSD_FILTER_MINIMUM_PHASE, 8, nCoefs_minphase_352, coefs_minphase_352, tzero_minphase_352 },
+	{ DSD_FILTER_MINIMUM_PHASE, 16, nCoefs_minphase_176, coefs_minphase_176, tzero_minphase_176 },
+	{ DSD_FILTER_MINIMUM_PHASE, 32, nCoefs_minphase_88, coefs_minphase_88, tzero_minphase_88 },
+};
+
+DsdFilterQuality DsdDecimator::defaultQuality = DSD_FILTER_REFERENCE;
+bool DsdDecimator::defaultFixedPoint = false;
+
+DsdDecimator::DsdDecimator(DsdSampleReader *r, dsf2flac_uint32 rate, DsdFilterQuality quality)
 {
 	reader = r;
 	outputSampleRate = rate;
 	valid = true;;
 	errorMsg = "";
+	lookupTable = NULL;
+	cascadePos = -1;
+	cascadeSpan = 0;
+	resamplePos = -1;
+	nextOutput = 0;
+	decimatedTzero = 0;
+	fixedPoint = defaultFixedPoint;
+	fixedScale = -1;
+	fixedShift = 0;
 	
+	// the 48kHz family is resampled from the 44.1kHz family rate below it
+	dsf2flac_uint32 decimatedRate = outputSampleRate;
+	if (outputSampleRate % 48000 == 0)
+		decimatedRate = outputSampleRate / 160 * 147;
 	// ratio of out to in sampling rates
-	ratio = r->getSamplingFreq() / outputSampleRate;
+	ratio = r->getSamplingFreq() / decimatedRate;
 	// how many bytes to skip after each out sample calc.
 	nStep = ratio/8; 
 	
-	// load the required filter into the lookuptable based on in and out sample rate
-	if (ratio == 8)
-		initLookupTable(nCoefs_352,coefs_352,tzero_352);
-	else if (ratio == 16)
-		initLookupTable(nCoefs_176,coefs_176,tzero_176);
-	else if (ratio == 32)
-		initLookupTable(nCoefs_88,coefs_88,tzero_88);
-	else
+	if (ratio < 8 || ratio % 8 || ratio*decimatedRate != r->getSamplingFreq())
 	{
 		valid = false;
 		errorMsg = "Sorry, incompatible sample rate combination";
 		return;
 	}
-	// set the buffer to the length of the table if not long enough
-	if (nLookupTable > reader->getBufferLength())
-		reader->setBufferLength(nLookupTable);
+	// load the required filter into the lookuptable based on in and out sample rate,
+	// a filter loaded with --filter takes the place of the built-in one
+	filter = FirFilter::find(ratio);
+	const BuiltinFilter* builtin = NULL;
+	for (dsf2flac_uint32 i=0; i<sizeof(builtinFilters)/sizeof(builtinFilters[0]); i++)
+		if (builtinFilters[i].quality == quality && builtinFilters[i].ratio == ratio)
+			builtin = &builtinFilters[i];
+	if (filter)
+		initLookupTable(filter->getNumCoefs(),filter->getCoefs(),filter->getTzero(),filter->getTablePath(reader->msbIsPlayedFirst()));
+	else if (builtin)
+		initLookupTable(builtin->nCoefs,builtin->coefs,builtin->tzero);
+	else if (ratio > 32 && !(ratio & (ratio-1)))
+		initCascade();
+	else
+	{
+		valid = false;
+		errorMsg = "Sorry, no filter for this sample rate combination, one can be given with --filter";
+		return;
+	}
+	if (decimatedRate != outputSampleRate)
+		initResampler();
+	// set the buffer to the length of the filter if not long enough
+	if (nHistory > reader->getBufferLength())
+		reader->setBufferLength(nHistory);
 }
 
 DsdDecimator::~DsdDecimator()
 {
-	if (lookupTableAllocated) {
-		for (dsf2flac_uint32 n=0; n<nLookupTable; n++)
-		{
-			delete[] lookupTable[n];
-		}
-		delete[] lookupTable;
-	}
 }
 
 dsf2flac_int64 DsdDecimator::getLength()
 {
-	return reader->getLength()/ratio;
+	return reader->getLength()*outputSampleRate/reader->getSamplingFreq();
 }
 
 dsf2flac_float64 DsdDecimator::getPosition()
 {
-	return (dsf2flac_float64) (reader->getPosition()-tzero)/ratio;
+	// the resamplers know exactly which sample is next, unless the reader has been moved
+	if (!resamplers.empty() && reader->getPosition() == resamplePos)
+		return nextOutput;
+	return (dsf2flac_float64) (reader->getPosition()-tzero)/getDecimationRatio();
+}
+
+/// Floor of a/b for b > 0, rounding down for negative a too.
+static dsf2flac_int64 floorDiv(dsf2flac_int64 a, dsf2flac_int64 b)
+{
+	return a >= 0 ? a/b : -((-a+b-1)/b);
+}
+
+dsf2flac_int64 DsdDecimator::getSamplesBefore(dsf2flac_int64 dsdPos)
+{
+	dsf2flac_int64 pos = reader->getPosition();
+	dsf2flac_int64 n;
+	if (!resamplers.empty()) {
+		// output k is at DSD sample k*fs/rate, counted on from the next one
+		dsf2flac_int64 next = pos == resamplePos ? nextOutput : -floorDiv(-(pos-tzero)*outputSampleRate, reader->getSamplingFreq());
+		n = -floorDiv(-dsdPos*outputSampleRate, reader->getSamplingFreq()) - next;
+	} else {
+		// the next output is at DSD sample pos-tzero and they are ratio apart
+		n = -floorDiv(-(dsdPos-(pos-tzero)), ratio);
+	}
+	return n > 0 ? n : 0;
+}
+
+/// The state of a multiplicative congruential generator (such as std::minstd_rand) started from 1, after n numbers.
+static dsf2flac_uint64 lcgState(dsf2flac_uint64 multiplier, dsf2flac_uint64 modulus, dsf2flac_uint64 n)
+{
+	dsf2flac_uint64 x = 1;
+	for (multiplier %= modulus; n; n >>= 1, multiplier = multiplier*multiplier % modulus)
+		if (n & 1)
+			x = x*multiplier % modulus;
+	return x;
+}
+
+void DsdDecimator::startAt(dsf2flac_int64 start, dsf2flac_int64 dsdPos)
+{
+	// the programme's first sample is the one a decimator stepped on from the beginning of the input gives:
+	// the first at or after start that the filter fully defines.
+	dsf2flac_int64 first = std::max<dsf2flac_int64>(start + tzero, 8*(dsf2flac_int64)nHistory);
+	first = (first + 7) / 8 * 8;
+	dsf2flac_int64 k;
+	if (!resamplers.empty()) {
+		// the resampled outputs don't depend on where the reader stops, just count them
+		dsf2flac_int64 fs = reader->getSamplingFreq();
+		dsf2flac_int64 firstOutput = -floorDiv(-(first-tzero)*outputSampleRate, fs);
+		k = std::max<dsf2flac_int64>(-floorDiv(-dsdPos*outputSampleRate, fs) - firstOutput, 0);
+		while ((reader->getPosition() < first || -floorDiv(-(reader->getPosition()-(dsf2flac_int64)tzero)*outputSampleRate, fs) < firstOutput + k)
+				&& reader->getPosition() < reader->getLength())
+			reader->step();
+	} else {
+		// the samples are every ratio DSD samples on from the first
+		k = std::max<dsf2flac_int64>(-floorDiv(-(dsdPos-(first-tzero)), ratio), 0);
+		while (reader->getPosition() < first + k*ratio && reader->getPosition() < reader->getLength())
+			reader->step();
+	}
+	// and the dither carries on from the k samples before
+	ditherRng.seed(lcgState(std::minstd_rand::multiplier, std::minstd_rand::modulus, 2*k*getNumChannels()));
 }
 
 dsf2flac_float64 DsdDecimator::getFirstValidSample() {
-	return (dsf2flac_float64)nLookupTable / nStep - (dsf2flac_float64)tzero / ratio;
+	return (dsf2flac_float64)(8*nHistory) / getDecimationRatio() - (dsf2flac_float64)tzero / getDecimationRatio();
 }
 
 dsf2flac_float64 DsdDecimator::getLastValidSample() {
-	return (dsf2flac_float64)getLength() - (dsf2flac_float64)tzero / ratio;
+	return (dsf2flac_float64)getLength() - (dsf2flac_float64)tzero / getDecimationRatio();
 }
 
 dsf2flac_uint32 DsdDecimator::getOutputSampleRate()
@@ -114,64 +247,411 @@ std::string DsdDecimator::getErrorMsg() {
 	return errorMsg;
 }
 
-void DsdDecimator::initLookupTable(const int nCoefs,const dsf2flac_float64* coefs,const int tz)
+void DsdDecimator::initLookupTable(const int nCoefs,const dsf2flac_float64* coefs,const int tz,const std::string& tablePath)
 {
 	tzero = tz;
 	// calc how big the lookup table is.
 	nLookupTable = (nCoefs+7)/8;
-	// allocate the table
-	lookupTable = new calc_type*[nLookupTable];
-	for (dsf2flac_uint32 n=0; n<nLookupTable; n++)
-	{
-		lookupTable[n] = new calc_type[256];
-		for (int m=0; m<256; m++)
-			lookupTable[n][m] = 0;
-	}
-	// loop over each entry in the lookup table
-	for (dsf2flac_uint32 t=0; t<nLookupTable; t++) {
-		// how many samples from the filter are spanned in this entry
-		int k = nCoefs - t*8;
-		if (k>8) k=8;
-		// loop over all possible 8bit dsd sequences
-		for (int dsdSeq=0; dsdSeq<256; ++dsdSeq) {
-			dsf2flac_float64 acc = 0.0;
-			for (int bit=0; bit<k; bit++) {
-				dsf2flac_float64 val;
-				if (reader->msbIsPlayedFirst()) {
-					val = -1 + 2*(dsf2flac_float64) !!( dsdSeq & (1<<(7-bit)) );
-				} else {
-					val = -1 + 2*(dsf2flac_float64) !!( dsdSeq & (1<<(bit)) );
+	nHistory = nLookupTable;
+	table = sharedLookupTable(nCoefs,coefs,nLookupTable,reader->msbIsPlayedFirst(),tablePath);
+	lookupTable = &table->rows[0];
+}
+
+void DsdDecimator::initCascade()
+{
+	// the first stage gives one output per char
+	initLookupTable(nCoefs_cascade_first,coefs_cascade_first,tzero_cascade_first);
+	// then the half-band stages, the sharpest filter is needed last
+	const dsf2flac_int32 nCoefs[4] = { nCoefs_halfband_last, nCoefs_halfband_second, nCoefs_halfband_third, nCoefs_halfband_early };
+	const dsf2flac_float64* coefs[4] = { coefs_halfband_last, coefs_halfband_second, coefs_halfband_third, coefs_halfband_early };
+	dsf2flac_uint32 nStages = 0;
+	while ((8u<<nStages) < ratio)
+		nStages++;
+	stages.resize(getNumChannels());
+	cascadeSpan = 1;
+	for (dsf2flac_uint32 i=0; i<nStages; i++) {
+		dsf2flac_uint32 k = nStages-1-i;
+		if (k > 3)
+			k = 3;
+		HalfbandDecimator stage(nCoefs[k],coefs[k]);
+		for (dsf2flac_uint32 c=0; c<getNumChannels(); c++)
+			stages[c].push_back(stage);
+		// the inputs to stage i are 1<<i chars apart
+		tzero += (8*stage.getDelay()) << i;
+		cascadeSpan += (nCoefs[k]-1) << i;
+	}
+	// priming starts a whole number of outputs back, so that every stage starts on an output
+	cascadeSpan = (cascadeSpan - 1 + nStep - 1) / nStep * nStep + 1;
+	nHistory = cascadeSpan - 1 + nLookupTable;
+	cascadeOut.assign(getNumChannels(),0);
+}
+
+void DsdDecimator::primeCascade(dsf2flac_uint32 offset)
+{
+	boost::circular_buffer<dsf2flac_uint8>* buff = reader->getBuffer();
+	for (dsf2flac_uint32 c=0; c<getNumChannels(); c++)
+		for (dsf2flac_uint32 i=0; i<stages[c].size(); i++)
+			stages[c][i].reset();
+	for (dsf2flac_int32 m=cascadeSpan-1+offset; m>=(dsf2flac_int32)offset; m--)
+		for (dsf2flac_uint32 c=0; c<getNumChannels(); c++)
+			pushCascade(c,firstStage(buff[c],m));
+	cascadePos = reader->getPosition();
+}
+
+calc_type DsdDecimator::firstStage(boost::circular_buffer<dsf2flac_uint8>& buff, dsf2flac_uint32 m)
+{
+	calc_type sum = 0.0;
+	for (dsf2flac_uint32 t=0; t<nLookupTable; t++)
+		sum += lookupTable[t][buff[m+t]];
+	return sum;
+}
+
+void DsdDecimator::pushCascade(dsf2flac_uint32 c, calc_type v)
+{
+	std::vector<HalfbandDecimator>& s = stages[c];
+	for (dsf2flac_uint32 i=0; i<s.size(); i++)
+		if (!s[i].push(v,v))
+			return;
+	cascadeOut[c] = v;
+}
+
+void DsdDecimator::initResampler()
+{
+	PolyphaseResampler resampler(160,147);
+	resamplers.assign(getNumChannels(),resampler);
+	decimated.assign(getNumChannels(),0);
+	// the resampler delay is in 1/160 ths of a decimated sample
+	decimatedTzero = tzero;
+	tzero += (resampler.getDelay()*ratio + 80) / 160;
+	// the resamplers start from the decimated samples before the reader position
+	nHistory += resampler.getNumTaps()*nStep;
+}
+
+void DsdDecimator::primeResampler()
+{
+	boost::circular_buffer<dsf2flac_uint8>* buff = reader->getBuffer();
+	dsf2flac_int64 pos = reader->getPosition();
+	// the next output is the first at or after the position
+	nextOutput = -floorDiv(-(pos-tzero)*outputSampleRate, reader->getSamplingFreq());
+	// the decimated samples are the ones every ratio DSD samples from decimatedTzero, wherever the
+	// reader was moved to, so that seeking gives the same output. The next is skip chars ahead.
+	dsf2flac_int64 next = -floorDiv(-(pos-decimatedTzero), ratio);
+	dsf2flac_uint32 skip = (decimatedTzero + next*ratio - pos) / 8;
+	dsf2flac_uint32 nTaps = resamplers[0].getNumTaps();
+	for (dsf2flac_uint32 c=0; c<getNumChannels(); c++)
+		resamplers[c].reset();
+	// decimate the nTaps samples before it from the history in the buffers
+	if (!stages.empty())
+		primeCascade(nTaps*nStep - skip);
+	for (dsf2flac_uint32 h=nTaps; h>0; h--) {
+		dsf2flac_uint32 m = h*nStep - skip;
+		for (dsf2flac_uint32 c=0; c<getNumChannels(); c++) {
+			if (!stages.empty()) {
+				resamplers[c].push(cascadeOut[c]);
+				// run the cascade on towards the following sample, the last chars are read below
+				for (dsf2flac_uint32 k=1; k<=nStep && k<=m; k++)
+					pushCascade(c,firstStage(buff[c],m-k));
+			} else {
+				resamplers[c].push(firstStage(buff[c],m));
+			}
+		}
+	}
+	// and step the reader on to the next one
+	for (dsf2flac_uint32 k=0; k<skip; k++) {
+		reader->step();
+		if (!stages.empty())
+			for (dsf2flac_uint32 c=0; c<getNumChannels(); c++)
+				pushCascade(c,firstStage(buff[c],0));
+	}
+	for (dsf2flac_uint32 c=0; c<getNumChannels(); c++)
+		resamplers[c].setNext(nextOutput*147 + resamplers[c].getDelay() - next*160);
+	resamplePos = reader->getPosition();
+}
+
+std::shared_ptr<const DsdDecimator::LookupTable> DsdDecimator::sharedLookupTable(
+		const dsf2flac_int32 nCoefs,
+		const dsf2flac_float64* coefs,
+		const dsf2flac_uint32 nLookupTable,
+		const bool msbFirst,
+		const std::string& tablePath)
+{
+	// Tables are cached for the life of the process, keyed by the filter coefficients and bit order,
+	// so that converting many files (possibly from several threads) builds each table only once.
+	static std::mutex cacheMutex;
+	static std::map<std::tuple<dsf2flac_uint32,dsf2flac_int32,bool>, std::shared_ptr<const LookupTable> > cache;
+	dsf2flac_uint32 crc = crc32(0, (const Bytef*) coefs, nCoefs*sizeof(dsf2flac_float64));
+	std::lock_guard<std::mutex> lock(cacheMutex);
+	std::shared_ptr<const LookupTable>& cached = cache[std::make_tuple(crc,nCoefs,msbFirst)];
+	if (!cached && !tablePath.empty())
+		cached.reset(mapLookupTable(tablePath,nCoefs,nLookupTable,crc,msbFirst));
+	if (!cached) {
+		LookupTable* lt = new LookupTable;
+		lt->data.assign(nLookupTable*256,0);
+		for (dsf2flac_uint32 t=0; t<nLookupTable; t++)
+			lt->rows.push_back(&lt->data[t*256]);
+		// loop over each entry in the lookup table
+		for (dsf2flac_uint32 t=0; t<nLookupTable; t++) {
+			// how many samples from the filter are spanned in this entry
+			int k = nCoefs - t*8;
+			if (k>8) k=8;
+			// loop over all possible 8bit dsd sequences
+			for (int dsdSeq=0; dsdSeq<256; ++dsdSeq) {
+				dsf2flac_float64 acc = 0.0;
+				for (int bit=0; bit<k; bit++) {
+					dsf2flac_float64 val;
+					if (msbFirst) {
+						val = -1 + 2*(dsf2flac_float64) !!( dsdSeq & (1<<(7-bit)) );
+					} else {
+						val = -1 + 2*(dsf2flac_float64) !!( dsdSeq & (1<<(bit)) );
+					}
+					acc += val * coefs[t*8+bit];
 				}
-				acc += val * coefs[t*8+bit];
+				lt->data[t*256+dsdSeq] = (calc_type) acc;
+			}
+		}
+		cached.reset(lt);
+		if (!tablePath.empty())
+			saveLookupTable(tablePath,lt,nCoefs,nLookupTable,crc,msbFirst);
+	}
+	return cached;
+}
+
+DsdDecimator::LookupTable* DsdDecimator::mapLookupTable(const std::string& path, const dsf2flac_int32 nCoefs, const dsf2flac_uint32 nLookupTable, const dsf2flac_uint32 crc, const bool msbFirst)
+{
+	int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+		return NULL;
+	size_t length = sizeof(LookupTableHeader) + nLookupTable*256*sizeof(calc_type);
+	struct stat st;
+	void* map = MAP_FAILED;
+	if (fstat(fd,&st) == 0 && (size_t) st.st_size == length)
+		map = mmap(NULL, length, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED)
+		return NULL;
+	// a table saved for another filter, bit order or build is ignored and replaced
+	const LookupTableHeader* h = (const LookupTableHeader*) map;
+	if (memcmp(h->magic,"dsf2lut1",8) || h->nCoefs != (dsf2flac_uint32) nCoefs || h->nLookupTable != nLookupTable
+			|| h->crc != crc || h->valueSize != sizeof(calc_type) || h->msbFirst != (dsf2flac_uint32) msbFirst) {
+		munmap(map,length);
+		return NULL;
+	}
+	LookupTable* lt = new LookupTable;
+	lt->map = map;
+	lt->mapLength = length;
+	const calc_type* data = (const calc_type*) (h+1);
+	for (dsf2flac_uint32 t=0; t<nLookupTable; t++)
+		lt->rows.push_back(&data[t*256]);
+	return lt;
+}
+
+void DsdDecimator::saveLookupTable(const std::string& path, const LookupTable* lt, const dsf2flac_int32 nCoefs, const dsf2flac_uint32 nLookupTable, const dsf2flac_uint32 crc, const bool msbFirst)
+{
+	// make the folders on the way
+	for (std::string::size_type p = path.find('/',1); p != std::string::npos; p = path.find('/',p+1))
+		mkdir(path.substr(0,p).c_str(), 0755);
+	LookupTableHeader h;
+	memset(&h,0,sizeof(h));
+	memcpy(h.magic,"dsf2lut1",8);
+	h.nCoefs = nCoefs;
+	h.nLookupTable = nLookupTable;
+	h.crc = crc;
+	h.valueSize = sizeof(calc_type);
+	h.msbFirst = msbFirst;
+	// written under another name and renamed, so that other processes never map half a table
+	std::string tmp = path + ".tmp" + std::to_string(getpid());
+	FILE* f = fopen(tmp.c_str(),"wb");
+	if (!f)
+		return;
+	bool ok = fwrite(&h,sizeof(h),1,f) == 1
+			&& fwrite(&lt->data[0],sizeof(calc_type),lt->data.size(),f) == lt->data.size();
+	ok = fclose(f) == 0 && ok;
+	if (!ok || rename(tmp.c_str(),path.c_str()) != 0)
+		remove(tmp.c_str());
+}
+
+void DsdDecimator::decimate(calc_type* out, dsf2flac_uint32 stride)
+{
+	// get the sample buffer
+	boost::circular_buffer<dsf2flac_uint8>* buff = reader->getBuffer();
+	if (!stages.empty()) {
+		for (dsf2flac_uint32 c=0; c<getNumChannels(); c++)
+			out[c*stride] = cascadeOut[c];
+		// step the buffer, running each new char through the cascade
+		for (dsf2flac_uint32 m=0; m<nStep; m++) {
+			reader->step();
+			for (dsf2flac_uint32 c=0; c<getNumChannels(); c++)
+				pushCascade(c,firstStage(buff[c],0));
+		}
+	} else {
+		// filter each chan in turn
+		for (dsf2flac_uint32 c=0; c<getNumChannels(); c++) {
+			calc_type sum = 0.0;
+			for (dsf2flac_uint32 t=0; t<nLookupTable; t++) {
+				dsf2flac_uint32 byte = (dsf2flac_uint32) buff[c][t] & 0xFF;
+				sum += lookupTable[t][byte];
 			}
-			lookupTable[t][dsdSeq] = (calc_type) acc;
+			out[c*stride] = sum;
 		}
+		// step the buffer
+		for (dsf2flac_uint32 m=0; m<nStep; m++)
+			reader->step();
 	}
-	lookupTableAllocated = true;
 }
 
 template<> void DsdDecimator::getSamples(dsf2flac_int16 *buffer, dsf2flac_uint32 bufferLen, dsf2flac_float64 scale, dsf2flac_float64 tpdfDitherPeakAmplitude,dsf2flac_float64 clipAmplitude)
 {
-	getSamplesInternal(buffer,bufferLen,scale,tpdfDitherPeakAmplitude,clipAmplitude,true);
+	getSamplesInternal(&buffer,false,bufferLen,scale,tpdfDitherPeakAmplitude,clipAmplitude,true);
 }
 template<> void DsdDecimator::getSamples(dsf2flac_int32 *buffer, dsf2flac_uint32 bufferLen, dsf2flac_float64 scale, dsf2flac_float64 tpdfDitherPeakAmplitude,dsf2flac_float64 clipAmplitude)
 {
-	getSamplesInternal(buffer,bufferLen,scale,tpdfDitherPeakAmplitude,clipAmplitude,true);
+	getSamplesInternal(&buffer,false,bufferLen,scale,tpdfDitherPeakAmplitude,clipAmplitude,true);
 }
 template<> void DsdDecimator::getSamples(dsf2flac_int64 *buffer, dsf2flac_uint32 bufferLen, dsf2flac_float64 scale, dsf2flac_float64 tpdfDitherPeakAmplitude,dsf2flac_float64 clipAmplitude)
 {
-	getSamplesInternal(buffer,bufferLen,scale,tpdfDitherPeakAmplitude,clipAmplitude,true);
+	getSamplesInternal(&buffer,false,bufferLen,scale,tpdfDitherPeakAmplitude,clipAmplitude,true);
 }
 template<> void DsdDecimator::getSamples(dsf2flac_float32 *buffer, dsf2flac_uint32 bufferLen, dsf2flac_float64 scale, dsf2flac_float64 tpdfDitherPeakAmplitude,dsf2flac_float64 clipAmplitude)
 {
-	getSamplesInternal(buffer,bufferLen,scale,tpdfDitherPeakAmplitude,clipAmplitude,false);
+	getSamplesInternal(&buffer,false,bufferLen,scale,tpdfDitherPeakAmplitude,clipAmplitude,false);
 }
 template<> void DsdDecimator::getSamples(dsf2flac_float64 *buffer, dsf2flac_uint32 bufferLen, dsf2flac_float64 scale, dsf2flac_float64 tpdfDitherPeakAmplitude,dsf2flac_float64 clipAmplitude)
 {
-	getSamplesInternal(buffer,bufferLen,scale,tpdfDitherPeakAmplitude,clipAmplitude,false);
+	getSamplesInternal(&buffer,false,bufferLen,scale,tpdfDitherPeakAmplitude,clipAmplitude,false);
+}
+template<> void DsdDecimator::getSamplesPlanar(dsf2flac_int16* const* buffers, dsf2flac_uint32 nFrames, dsf2flac_float64 scale, dsf2flac_float64 tpdfDitherPeakAmplitude,dsf2flac_float64 clipAmplitude)
+{
+	getSamplesInternal(buffers,true,nFrames*getNumChannels(),scale,tpdfDitherPeakAmplitude,clipAmplitude,true);
+}
+template<> void DsdDecimator::getSamplesPlanar(dsf2flac_int32* const* buffers, dsf2flac_uint32 nFrames, dsf2flac_float64 scale, dsf2flac_float64 tpdfDitherPeakAmplitude,dsf2flac_float64 clipAmplitude)
+{
+	getSamplesInternal(buffers,true,nFrames*getNumChannels(),scale,tpdfDitherPeakAmplitude,clipAmplitude,true);
+}
+template<> void DsdDecimator::getSamplesPlanar(dsf2flac_int64* const* buffers, dsf2flac_uint32 nFrames, dsf2flac_float64 scale, dsf2flac_float64 tpdfDitherPeakAmplitude,dsf2flac_float64 clipAmplitude)
+{
+	getSamplesInternal(buffers,true,nFrames*getNumChannels(),scale,tpdfDitherPeakAmplitude,clipAmplitude,true);
+}
+template<> void DsdDecimator::getSamplesPlanar(dsf2flac_float32* const* buffers, dsf2flac_uint32 nFrames, dsf2flac_float64 scale, dsf2flac_float64 tpdfDitherPeakAmplitude,dsf2flac_float64 clipAmplitude)
+{
+	getSamplesInternal(buffers,true,nFrames*getNumChannels(),scale,tpdfDitherPeakAmplitude,clipAmplitude,false);
+}
+template<> void DsdDecimator::getSamplesPlanar(dsf2flac_float64* const* buffers, dsf2flac_uint32 nFrames, dsf2flac_float64 scale, dsf2flac_float64 tpdfDitherPeakAmplitude,dsf2flac_float64 clipAmplitude)
+{
+	getSamplesInternal(buffers,true,nFrames*getNumChannels(),scale,tpdfDitherPeakAmplitude,clipAmplitude,false);
+}
+/**
+ * Scales n filter outputs in sums, adds the dither (when dither is true), clips
+ * them to +-clipAmplitude (when clip is true) and rounds them to the nearest integer (when
+ * roundToInt is true, halves away from zero like round()) into buffer. Without branches or libm
+ * calls in the loop the compiler can use SIMD min/max and conversions.
+ */
+template <typename sampleType, bool roundToInt, bool dither, bool clip> static void quantize(
+		const calc_type* sums,
+		const calc_type* ditherSums,
+		sampleType* buffer,
+		dsf2flac_uint32 n,
+		calc_type scale,
+		calc_type clipAmplitude)
+{
+	// whole numbers below 2^31 once clipped, so int32 conversions suffice for the smaller types
+	typedef typename std::conditional<sizeof(sampleType) <= 4, dsf2flac_int32, dsf2flac_int64>::type intType;
+	for (dsf2flac_uint32 i=0; i<n; i++) {
+		calc_type sum = sums[i]*scale;
+		if (dither)
+			sum = sum + ditherSums[i];
+		if (clip)
+			sum = std::min(std::max(sum,-clipAmplitude),clipAmplitude);
+		if (roundToInt)
+			// the largest double below 0.5, so that x.5 goes up and everything below it down, then truncate
+			buffer[i] = static_cast<sampleType>(static_cast<intType>(sum + copysign((calc_type) 0.49999999999999994,sum)));
+		else
+			buffer[i] = static_cast<sampleType>(sum);
+	}
+}
+
+/// Calls the quantize kernel for the modes, ditherSums is NULL for no dither.
+template <typename sampleType> static void quantizeBlock(
+		const calc_type* sums,
+		const calc_type* ditherSums,
+		sampleType* buffer,
+		dsf2flac_uint32 n,
+		calc_type scale,
+		calc_type clipAmplitude,
+		bool roundToInt)
+{
+	bool dither = ditherSums != NULL;
+	bool clip = clipAmplitude > 0;
+	if (roundToInt) {
+		if (dither && clip)
+			quantize<sampleType,true,true,true>(sums,ditherSums,buffer,n,scale,clipAmplitude);
+		else if (dither)
+			quantize<sampleType,true,true,false>(sums,ditherSums,buffer,n,scale,clipAmplitude);
+		else if (clip)
+			quantize<sampleType,true,false,true>(sums,ditherSums,buffer,n,scale,clipAmplitude);
+		else
+			quantize<sampleType,true,false,false>(sums,ditherSums,buffer,n,scale,clipAmplitude);
+	} else {
+		if (dither && clip)
+			quantize<sampleType,false,true,true>(sums,ditherSums,buffer,n,scale,clipAmplitude);
+		else if (dither)
+			quantize<sampleType,false,true,false>(sums,ditherSums,buffer,n,scale,clipAmplitude);
+		else if (clip)
+			quantize<sampleType,false,false,true>(sums,ditherSums,buffer,n,scale,clipAmplitude);
+		else
+			quantize<sampleType,false,false,false>(sums,ditherSums,buffer,n,scale,clipAmplitude);
+	}
+}
+
+/**
+ * The fixed point quantize: adds the dither (when dither is true) to n int64 filter outputs
+ * in sums, rounds them to the shift fraction bits below the lsb and clips them to
+ * +-clipAmplitude (when clip is true) into buffer.
+ */
+template <typename sampleType, bool dither, bool clip> static void quantizeFixed(
+		const dsf2flac_int64* sums,
+		const dsf2flac_int64* ditherSums,
+		sampleType* buffer,
+		dsf2flac_uint32 n,
+		dsf2flac_uint32 shift,
+		dsf2flac_int64 clipAmplitude)
+{
+	const dsf2flac_int64 half = (dsf2flac_int64) 1 << (shift-1);
+	for (dsf2flac_uint32 i=0; i<n; i++) {
+		dsf2flac_int64 sum = sums[i];
+		if (dither)
+			sum += ditherSums[i];
+		// round half up, >> is an arithmetic shift for int64 on every compiler we build with
+		sum = (sum + half) >> shift;
+		if (clip)
+			sum = std::min(std::max(sum,-clipAmplitude),clipAmplitude);
+		buffer[i] = static_cast<sampleType>(sum);
+	}
+}
+
+/// Calls the quantizeFixed kernel for the modes, ditherSums is NULL for no dither and clipAmplitude 0 for no clipping.
+template <typename sampleType> static void quantizeFixedBlock(
+		const dsf2flac_int64* sums,
+		const dsf2flac_int64* ditherSums,
+		sampleType* buffer,
+		dsf2flac_uint32 n,
+		dsf2flac_uint32 shift,
+		dsf2flac_int64 clipAmplitude)
+{
+	bool dither = ditherSums != NULL;
+	bool clip = clipAmplitude > 0;
+	if (dither && clip)
+		quantizeFixed<sampleType,true,true>(sums,ditherSums,buffer,n,shift,clipAmplitude);
+	else if (dither)
+		quantizeFixed<sampleType,true,false>(sums,ditherSums,buffer,n,shift,clipAmplitude);
+	else if (clip)
+		quantizeFixed<sampleType,false,true>(sums,ditherSums,buffer,n,shift,clipAmplitude);
+	else
+		quantizeFixed<sampleType,false,false>(sums,ditherSums,buffer,n,shift,clipAmplitude);
 }
+
 template <typename sampleType> void DsdDecimator::getSamplesInternal(
-		sampleType *buffer,
+		sampleType* const* buffers,
+		bool planar,
 		dsf2flac_uint32 bufferLen,
 		dsf2flac_float64 scale,
 		dsf2flac_float64 tpdfDitherPeakAmplitude,
@@ -184,39 +664,159 @@ template <typename sampleType> void DsdDecimator::getSamplesInternal(
 		fputs("Buffer length is not a multiple of getNumChannels()",stderr);
 		exit(EXIT_FAILURE);
 	}
-	// flag if we need to clip
-	bool clip = clipAmplitude > 0;
-	// get the sample buffer
-	boost::circular_buffer<dsf2flac_uint8>* buff = reader->getBuffer();
-	for (int i=0; i<d.quot ; i++) {
-		// filter each chan in turn
-		for (dsf2flac_uint32 c=0; c<getNumChannels(); c++) {
-			calc_type sum = 0.0;
-			for (dsf2flac_uint32 t=0; t<nLookupTable; t++) {
-				dsf2flac_uint32 byte = (dsf2flac_uint32) buff[c][t] & 0xFF;
-				sum += lookupTable[t][byte];
+	// the fixed point engine, when it is wanted and the filter and scale allow it
+	if (roundToInt && usesFixedPoint(scale)) {
+		getSamplesFixed(buffers,planar,bufferLen,tpdfDitherPeakAmplitude,clipAmplitude);
+		return;
+	}
+	if (sums.size() < bufferLen)
+		sums.resize(bufferLen);
+	// the sums of frame i channel c are at i*frameStride + c*chanStride, a channel at a time for
+	// planar output so each channel is quantised straight through
+	const dsf2flac_uint32 frameStride = planar ? 1 : getNumChannels();
+	const dsf2flac_uint32 chanStride = planar ? d.quot : 1;
+	// filter everything first, then scale and quantise it (timed as two separate stages)
+	{
+		StageScope scope(STAGE_DECIMATE);
+		StageTimer::count(STAGE_DECIMATE, 0, bufferLen);
+		if (!resamplers.empty()) {
+			// like the cascade the resamplers keep their own history
+			if (reader->getPosition() != resamplePos)
+				primeResampler();
+			for (int i=0; i<d.quot ; i++) {
+				while (resamplers[0].needsInput()) {
+					decimate(&decimated[0],1);
+					for (dsf2flac_uint32 c=0; c<getNumChannels(); c++)
+						resamplers[c].push(decimated[c]);
+				}
+				for (dsf2flac_uint32 c=0; c<getNumChannels(); c++)
+					sums[i*frameStride+c*chanStride] = resamplers[c].pull();
 			}
-			sum = sum*scale;
-			// dither before rounding/truncating
-			if (tpdfDitherPeakAmplitude > 0) {
+			nextOutput += d.quot;
+			resamplePos = reader->getPosition();
+		} else {
+			// the cascade keeps its own history, which is lost if something else moved the reader
+			if (!stages.empty() && reader->getPosition() != cascadePos)
+				primeCascade(0);
+			for (int i=0; i<d.quot ; i++)
+				decimate(&sums[i*frameStride],chanStride);
+		}
+		if (!stages.empty())
+			cascadePos = reader->getPosition();
+	}
+	StageScope scope(STAGE_QUANTIZE);
+	StageTimer::count(STAGE_QUANTIZE, 0, bufferLen);
+	bool dither = tpdfDitherPeakAmplitude > 0;
+	if (dither) {
+		// the random numbers come one after the other, so the dither is made up front,
+		// frame by frame so planar output is the same as interleaved
+		if (ditherSums.size() < bufferLen)
+			ditherSums.resize(bufferLen);
+		const calc_type rngRange = (calc_type) (ditherRng.max() - ditherRng.min());
+		for (int i=0; i<d.quot; i++) {
+			for (dsf2flac_uint32 c=0; c<getNumChannels(); c++) {
 				// TPDF dither
-				calc_type rand1 = ((calc_type) rand()) / ((calc_type) RAND_MAX); // rand value between 0 and 1
-				calc_type rand2 = ((calc_type) rand()) / ((calc_type) RAND_MAX); // rand value between 0 and 1
-				sum = sum + (rand1-rand2)*tpdfDitherPeakAmplitude;
+				calc_type rand1 = (calc_type) (ditherRng() - ditherRng.min()) / rngRange; // rand value between 0 and 1
+				calc_type rand2 = (calc_type) (ditherRng() - ditherRng.min()) / rngRange; // rand value between 0 and 1
+				ditherSums[i*frameStride+c*chanStride] = (rand1-rand2)*tpdfDitherPeakAmplitude;
+			}
+		}
+	}
+	// pick the quantiser for the modes once per block (or channel) rather than for every sample
+	const calc_type* dith = dither ? &ditherSums[0] : NULL;
+	if (planar) {
+		for (dsf2flac_uint32 c=0; c<getNumChannels(); c++)
+			quantizeBlock(&sums[c*chanStride],dith ? dith+c*chanStride : NULL,buffers[c],d.quot,scale,clipAmplitude,roundToInt);
+	} else {
+		quantizeBlock(&sums[0],dith,buffers[0],bufferLen,scale,clipAmplitude,roundToInt);
+	}
+}
+
+bool DsdDecimator::usesFixedPoint(dsf2flac_float64 scale)
+{
+	if (!fixedPoint || !stages.empty() || !resamplers.empty())
+		return false;
+	if (scale != fixedScale && !initFixedTable(scale))
+		fixedScale = scale; // does not fit, don't try again for this scale
+	return !fixedTable.empty();
+}
+
+bool DsdDecimator::initFixedTable(dsf2flac_float64 scale)
+{
+	fixedTable.clear();
+	// as many fraction bits as int32 allows for the largest entry, so that the rounding
+	// of the entries stays well below the output lsb
+	dsf2flac_float64 maxEntry = 0;
+	for (dsf2flac_uint32 t=0; t<nLookupTable; t++)
+		for (dsf2flac_uint32 b=0; b<256; b++)
+			maxEntry = std::max(maxEntry, fabs(lookupTable[t][b]*scale));
+	dsf2flac_int32 shift = 30;
+	while (shift >= 0 && ldexp(maxEntry,shift) > 2147483647.0)
+		shift--;
+	if (shift < 1)
+		return false;
+	fixedShift = shift;
+	fixedScale = scale;
+	fixedTable.resize(nLookupTable*256);
+	for (dsf2flac_uint32 t=0; t<nLookupTable; t++)
+		for (dsf2flac_uint32 b=0; b<256; b++)
+			fixedTable[t*256+b] = (dsf2flac_int32) llround(ldexp(lookupTable[t][b]*scale,shift));
+	return true;
+}
+
+template <typename sampleType> void DsdDecimator::getSamplesFixed(
+		sampleType* const* buffers,
+		bool planar,
+		dsf2flac_uint32 bufferLen,
+		dsf2flac_float64 tpdfDitherPeakAmplitude,
+		dsf2flac_float64 clipAmplitude)
+{
+	dsf2flac_uint32 nChans = getNumChannels();
+	dsf2flac_uint32 nFrames = bufferLen / nChans;
+	if (fixedSums.size() < bufferLen)
+		fixedSums.resize(bufferLen);
+	// laid out like the sums in getSamplesInternal, a channel at a time for planar output
+	const dsf2flac_uint32 frameStride = planar ? 1 : nChans;
+	const dsf2flac_uint32 chanStride = planar ? nFrames : 1;
+	{
+		StageScope scope(STAGE_DECIMATE);
+		StageTimer::count(STAGE_DECIMATE, 0, bufferLen);
+		boost::circular_buffer<dsf2flac_uint8>* buff = reader->getBuffer();
+		const dsf2flac_int32* table = &fixedTable[0];
+		for (dsf2flac_uint32 i=0; i<nFrames; i++) {
+			for (dsf2flac_uint32 c=0; c<nChans; c++) {
+				dsf2flac_int64 sum = 0;
+				for (dsf2flac_uint32 t=0; t<nLookupTable; t++)
+					sum += table[t*256 + buff[c][t]];
+				fixedSums[i*frameStride+c*chanStride] = sum;
 			}
-			if (clip) {
-				if (sum > clipAmplitude)
-					sum = clipAmplitude;
-				else if (sum < -clipAmplitude)
-					sum = -clipAmplitude;
+			for (dsf2flac_uint32 m=0; m<nStep; m++)
+				reader->step();
+		}
+	}
+	StageScope scope(STAGE_QUANTIZE);
+	StageTimer::count(STAGE_QUANTIZE, 0, bufferLen);
+	// the dither is the difference of two 31 bit random numbers times its peak, in the same fixed point,
+	// made up front in the same order as the floating point dither
+	const dsf2flac_int64 ditherPeak = llround(ldexp(tpdfDitherPeakAmplitude,fixedShift));
+	if (ditherPeak > 0) {
+		if (fixedDither.size() < bufferLen)
+			fixedDither.resize(bufferLen);
+		for (dsf2flac_uint32 i=0; i<nFrames; i++) {
+			for (dsf2flac_uint32 c=0; c<nChans; c++) {
+				dsf2flac_int64 r1 = ditherRng() - ditherRng.min();
+				dsf2flac_int64 r2 = ditherRng() - ditherRng.min();
+				fixedDither[i*frameStride+c*chanStride] = ((r1-r2)*ditherPeak) >> 31;
 			}
-			if (roundToInt)
-				buffer[i*getNumChannels()+c] = static_cast<sampleType>(round(sum));
-			else
-				buffer[i*getNumChannels()+c] = static_cast<sampleType>(sum);
 		}
-		// step the buffer
-		for (dsf2flac_uint32 m=0; m<nStep; m++)
-			reader->step();
+	}
+	// pick the quantiser for the modes once per block (or channel) rather than for every sample
+	const dsf2flac_int64* dith = ditherPeak > 0 ? &fixedDither[0] : NULL;
+	const dsf2flac_int64 clip = clipAmplitude > 0 ? (dsf2flac_int64) clipAmplitude : 0;
+	if (planar) {
+		for (dsf2flac_uint32 c=0; c<nChans; c++)
+			quantizeFixedBlock(&fixedSums[c*chanStride],dith ? dith+c*chanStride : NULL,buffers[c],nFrames,fixedShift,clip);
+	} else {
+		quantizeFixedBlock(&fixedSums[0],dith,buffers[0],bufferLen,fixedShift,clip);
 	}
 }
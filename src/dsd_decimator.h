@@ -41,9 +41,16 @@
   * Header file for the class dsdDecimator.
   * 
   * The dsdDecimator class does the actual conversion from dsd to pcm. Pass in a dsdSampleReader
-  * to the create function along with the desired pcm sample rate (must be multiple of 44.1k).
+  * to the create function along with the desired pcm sample rate (a multiple of 44.1k or 48k).
   * Then you can simply read pcm samples into a int or float buffer using getSamples.
   * 
+  * Decimation ratios of 8, 16 and 32 use a single FIR filter. Higher power of two ratios use a
+  * cascade: a short FIR filter down to 1/8 of the dsd rate and then half-band stages, each
+  * halving the rate, which is far less work per output sample than one long filter.
+  * 
+  * Rates in the 48kHz family are decimated to the 44.1kHz family rate below them and then
+  * resampled by 160/147 in the same pass.
+  * 
   */
   
 #define calc_type dsf2flac_float64 // you can change the type used to do the filtering... but there is barely any change in calc speed between float and double
@@ -52,12 +59,25 @@
 #define DSDDECIMATOR_H
 
 #include <dsd_sample_reader.h>
+#include "fir_filter.h"
+#include "halfband_decimator.h"
+#include "polyphase_resampler.h"
+#include <memory>
+#include <random>
+#include <vector>
+
+/// The built-in filter sets for ratios 8, 16 and 32, chosen with dsf2flac --quality. Higher ratios always use the cascade.
+enum DsdFilterQuality {
+	DSD_FILTER_REFERENCE,		///< long linear phase filters, the deepest stop band
+	DSD_FILTER_FAST,			///< linear phase with about half the taps, 120dB or more down
+	DSD_FILTER_MINIMUM_PHASE	///< minimum phase, about a third of the delay of the reference filters
+};
 
 /**
  *
  * The DsdDecimator reads DSD samples from a DsdSampleReader and converts them to PCM samples.
  *
- * The DsdDecimator only supports output sample rates which are multiples of 44.1kHz.
+ * The DsdDecimator supports output sample rates which are multiples of 44.1kHz or 48kHz.
  */
 class DsdDecimator
 {
@@ -65,12 +85,13 @@ public:
 	/**
 	 * Class constructor.
 	 * DsdSampleReader must be a valid reader.
-	 * outputSampleRate sets the sampling frequency for the output PCM samples, must be a multiple of 44100.
-	 * Note that not all output sample rates are supported by default.
-	 * Most can be easily added by putting an appropriate filter into the filters.cpp file.
+	 * outputSampleRate sets the sampling frequency for the output PCM samples, must be a multiple of 44100 or 48000.
+	 * The decimation ratio (DSD rate / outputSampleRate, or DSD rate / (outputSampleRate*147/160) for
+	 * multiples of 48000) must be a power of two, 8 or more, or have a filter loaded with FirFilter::add.
+	 * quality picks the built-in filter for ratios 8, 16 and 32.
 	 */
-	DsdDecimator(DsdSampleReader *reader, dsf2flac_uint32 outputSampleRate);
-	/// Class destructor, frees internal buffers and lookup table.
+	DsdDecimator(DsdSampleReader *reader, dsf2flac_uint32 outputSampleRate, DsdFilterQuality quality = getDefaultQuality());
+	/// Class destructor.
 	virtual ~DsdDecimator();
 
 	/// Return false if the reader is invalid (format/file error for example).
@@ -80,8 +101,27 @@ public:
 
 	/// Return the output sample rate in Hz.
 	dsf2flac_uint32 getOutputSampleRate();
-	/// Return the decimation ratio: DSD sample rate / PCM sample rate.
-	dsf2flac_uint32 getDecimationRatio() {return ratio;};
+	/// Return the decimation ratio: DSD sample rate / PCM sample rate, which is not a whole number for the 48kHz family.
+	dsf2flac_float64 getDecimationRatio() {return (dsf2flac_float64) reader->getSamplingFreq() / outputSampleRate;};
+	/**
+	 * Makes integer getSamples use the fixed point engine where it can: int32 lookup tables with
+	 * the scale folded in, summed in int64, so the output is bit exact on every platform. It is
+	 * used for the single filters (not the cascade or the 48kHz family resampler) when the scaled
+	 * table fits in int32, otherwise the floating point engine is used.
+	 */
+	void setFixedPoint(bool f) { fixedPoint = f; };
+	/// Return true if integer samples are computed in fixed point where possible.
+	bool isFixedPoint() { return fixedPoint; };
+	/// Return true if integer samples at this scale actually come from the fixed point engine: it is on, this rate uses a single filter and the scaled table fits in int32.
+	bool usesFixedPoint(dsf2flac_float64 scale);
+	/// Sets whether decimators created from now on use the fixed point engine.
+	static void setDefaultFixedPoint(bool f) { defaultFixedPoint = f; };
+	/// Sets the quality used by decimators created without one.
+	static void setDefaultQuality(DsdFilterQuality q) { defaultQuality = q; };
+	/// Return the quality used by decimators created without one, DSD_FILTER_REFERENCE unless set.
+	static DsdFilterQuality getDefaultQuality() { return defaultQuality; };
+	/// Return the delay through the filter in DSD samples: the output at getPosition() 0 is computed with the reader at this position.
+	dsf2flac_uint32 getFilterDelay() {return tzero;};
 	/// Return the data length in PCM samples.
 	dsf2flac_int64 getLength();
 	/// Return the number of channels if audio data.
@@ -92,6 +132,17 @@ public:
 	dsf2flac_float64 getPositionInSeconds() { return getPosition()/outputSampleRate; };
 	/// Return the current position as a percent of the total data length.
 	dsf2flac_float64 getPositionAsPercent() { return getPosition()/getLength()*100; };
+	/**
+	 * Return how many samples getSamples gives before the first one at or after DSD sample dsdPos,
+	 * 0 if that one has gone. Unlike getPosition this is exact, so tracks can be cut with it.
+	 */
+	dsf2flac_int64 getSamplesBefore(dsf2flac_int64 dsdPos);
+	/**
+	 * Steps on to the first sample at or after DSD sample dsdPos of the programme that starts at DSD sample start.
+	 * The samples and dither are the ones a decimator stepped on to start and read from there gives,
+	 * so parts of a programme read by several decimators join up exactly. The reader must be before it.
+	 */
+	void startAt(dsf2flac_int64 start, dsf2flac_int64 dsdPos);
 	/// Return the position of the first PCM sample that is completely defined.
 	dsf2flac_float64 getFirstValidSample();
 	/// Return the position of the last PCM sample that is completely defined.
@@ -125,27 +176,103 @@ public:
 			dsf2flac_float64 scale,
 			dsf2flac_float64 tpdfDitherPeakAmplitude = 0,
 			dsf2flac_float64 clipAmplitude = 0);
+	/**
+	 * Same as getSamples but writes nFrames samples of each channel c into its own buffer, buffers[c],
+	 * as libFLAC's FLAC::Encoder::Stream::process takes them. The samples are the same as getSamples'.
+	 */
+	template <typename sampleType> void getSamplesPlanar(
+			sampleType* const* buffers,
+			dsf2flac_uint32 nFrames,
+			dsf2flac_float64 scale,
+			dsf2flac_float64 tpdfDitherPeakAmplitude = 0,
+			dsf2flac_float64 clipAmplitude = 0);
 private:	// private methods
-	/// Initializes the filter lookup table.
-	void initLookupTable(const dsf2flac_int32 nCoefs,const dsf2flac_float64* coefs,const dsf2flac_int32 tzero);
-	/// Does the actual calculation for the getSamples method. Using the lookup tables FIR calculation is a pretty simple summing operation.
+	/// Initializes the filter lookup table, which is cached in tablePath if not empty.
+	void initLookupTable(const dsf2flac_int32 nCoefs,const dsf2flac_float64* coefs,const dsf2flac_int32 tzero,const std::string& tablePath = "");
+	/// Initializes the cascade, the lookup table for the first stage and the half-band stages.
+	void initCascade();
+	/// Runs the cascade over the history in the reader buffers, as if the reader were offset chars back, after the reader has been moved by someone else.
+	void primeCascade(dsf2flac_uint32 offset);
+	/// The first stage of the cascade, the filter output m chars back from the newest one.
+	calc_type firstStage(boost::circular_buffer<dsf2flac_uint8>& buff, dsf2flac_uint32 m);
+	/// Passes a first stage output through the half-band stages of channel c.
+	void pushCascade(dsf2flac_uint32 c, calc_type v);
+	/// Initializes a resampler for each channel, after the decimation filter.
+	void initResampler();
+	/// Fills the resamplers with the decimated samples before the reader position and works out the next output.
+	void primeResampler();
+	/// Computes the decimated sample of each channel c at the reader position into out[c*stride] and steps the reader on to the next one.
+	inline void decimate(calc_type* out, dsf2flac_uint32 stride);
+	struct LookupTable;
+	/**
+	 * Returns the lookup table for a filter and bit order, building it on first use. Thread safe.
+	 * If tablePath is given the table is mapped from that file, or saved there once built.
+	 */
+	static std::shared_ptr<const LookupTable> sharedLookupTable(
+			const dsf2flac_int32 nCoefs,
+			const dsf2flac_float64* coefs,
+			const dsf2flac_uint32 nLookupTable,
+			const bool msbFirst,
+			const std::string& tablePath);
+	/// Maps a lookup table saved by saveLookupTable, returns NULL if there is none or it does not match.
+	static LookupTable* mapLookupTable(const std::string& path, const dsf2flac_int32 nCoefs, const dsf2flac_uint32 nLookupTable, const dsf2flac_uint32 crc, const bool msbFirst);
+	/// Saves a lookup table so that later runs can map it, failing silently.
+	static void saveLookupTable(const std::string& path, const LookupTable* lt, const dsf2flac_int32 nCoefs, const dsf2flac_uint32 nLookupTable, const dsf2flac_uint32 crc, const bool msbFirst);
+	/**
+	 * Does the actual calculation for the getSamples methods. Using the lookup tables FIR calculation is a pretty simple summing operation.
+	 * The samples go into buffers[0] interleaved, or into buffers[c] for each channel c if planar,
+	 * in which case the filter outputs are kept a channel at a time too.
+	 */
 	template <typename sampleType> void getSamplesInternal(
-			sampleType *buffer,
+			sampleType* const* buffers,
+			bool planar,
 			dsf2flac_uint32 bufferLen,
 			dsf2flac_float64 scale,
 			dsf2flac_float64 tpdfDitherPeakAmplitude,
 			dsf2flac_float64 clipAmplitude,
 			bool roundToInt);
+	/// Builds fixedTable for scale, returns false if it does not fit in int32.
+	bool initFixedTable(dsf2flac_float64 scale);
+	/// The fixed point version of getSamplesInternal for integer samples.
+	template <typename sampleType> void getSamplesFixed(
+			sampleType* const* buffers,
+			bool planar,
+			dsf2flac_uint32 bufferLen,
+			dsf2flac_float64 tpdfDitherPeakAmplitude,
+			dsf2flac_float64 clipAmplitude);
 private:
 	DsdSampleReader *reader;
 	dsf2flac_uint32 outputSampleRate;
 	dsf2flac_uint32 nLookupTable;
+	dsf2flac_uint32 nHistory; // chars of history each output depends on
 	dsf2flac_uint32 tzero; // filter t=0 position
-	calc_type** lookupTable;
-	dsf2flac_uint32 ratio; // inFs/outFs
+	std::shared_ptr<FirFilter> filter; // the filter loaded from a file, if one is used instead of the built-in one
+	std::shared_ptr<const LookupTable> table; // shared by every decimator using the same filter and bit order
+	const calc_type* const* lookupTable; // row pointers into table
+	dsf2flac_uint32 ratio; // inFs/outFs, or inFs over the rate that is resampled
 	dsf2flac_uint32 nStep;
+	std::minstd_rand ditherRng; // per decimator so that threads do not contend on rand()
+	std::vector<calc_type> sums; // filter outputs waiting to be quantised
+	std::vector<calc_type> ditherSums; // the dither for each of sums
+	std::vector< std::vector<HalfbandDecimator> > stages; // the half-band stages of each channel, empty for a single filter
+	std::vector<calc_type> cascadeOut; // the output of each channel's cascade at cascadePos
+	dsf2flac_int64 cascadePos; // the reader position the cascade has reached, -1 if it needs priming
+	dsf2flac_uint32 cascadeSpan; // first stage outputs each cascade output depends on
+	std::vector<PolyphaseResampler> resamplers; // the resampler of each channel, empty unless resampling
+	std::vector<calc_type> decimated; // the decimated sample of each channel, waiting to be resampled
+	dsf2flac_int64 resamplePos; // the reader position the resamplers have reached, -1 if they need priming
+	dsf2flac_int64 nextOutput; // the PCM sample the resamplers make next
+	dsf2flac_uint32 decimatedTzero; // filter t=0 position before the resampler
+	bool fixedPoint; // use the fixed point engine for integer samples where possible
+	std::vector<dsf2flac_int32> fixedTable; // the lookup table times fixedScale*2^fixedShift, empty until needed
+	dsf2flac_float64 fixedScale; // the scale fixedTable was built for, 0 if it does not fit in int32
+	dsf2flac_uint32 fixedShift; // fraction bits of fixedTable values below the output lsb
+	std::vector<dsf2flac_int64> fixedSums; // fixed point filter outputs waiting to be quantised
+	std::vector<dsf2flac_int64> fixedDither; // the dither for each of fixedSums
 	bool valid;
 	std::string errorMsg;
+	static DsdFilterQuality defaultQuality;
+	static bool defaultFixedPoint;
 };
 
 #endif // DSDDECIMATOR_H
@@ -0,0 +1,274 @@
+/*
+ * dsf2flac - http://code.google.com/p/dsf2flac/
+ *
+ * A file conversion tool for translating dsf dsd audio files into
+ * flac pcm audio files.
+ *
+ * Copyright (c) 2013 by respective authors.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *
+ * Acknowledgments
+ *
+ * Many thanks to the following authors and projects whose work has greatly
+ * helped the development of this tool.
+ *
+ *
+ * Sebastian Gesemann - dsd2pcm (http://code.google.com/p/dsd2pcm/)
+ * SACD Ripper (http://code.google.com/p/sacd-ripper/)
+ * Maxim V.Anisiutkin - foo_input_sacd (http://sourceforge.net/projects/sacddecoder/files/)
+ * Vladislav Goncharov - foo_input_sacd_hq (http://vladgsound.wordpress.com)
+ * Jesus R - www.sonore.us
+ *
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE // copy_file_range
+#endif
+
+#include "dsd_file_writer.h"
+#include "dop_packer.h"
+#include "stage_timer.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+#ifdef __linux__
+#include <sys/sendfile.h>
+#endif
+
+DsdFileWriter::DsdFileWriter(DsdSampleReader *r)
+{
+	reader = r;
+	nChans = r->getNumChannels();
+	fd = -1;
+	ownFd = false;
+	srcFd = -1;
+	srcOffset = 0;
+	copying = false;
+	tryCopyFileRange = true;
+	trySendfile = true;
+	endChar = 0;
+	charsLeft = 0;
+	copyLeft = 0;
+	blocks.resize(nChans);
+}
+
+DsdFileWriter::~DsdFileWriter()
+{
+	if (fd >= 0 && ownFd)
+		::close(fd);
+	if (srcFd >= 0)
+		::close(srcFd);
+}
+
+bool DsdFileWriter::open(const char *path, dsf2flac_uint32 trackNum)
+{
+	// the chars holding the track, a partial char at either end is kept whole.
+	dsf2flac_uint64 charsInFile = (reader->getLength() + 7) / 8;
+	dsf2flac_uint64 trackEnd = reader->getTrackEnd(trackNum);
+	if (trackEnd > (dsf2flac_uint64) reader->getLength())
+		trackEnd = reader->getLength();
+	dsf2flac_uint64 startChar = reader->getTrackStart(trackNum) / 8;
+	endChar = (trackEnd + 7) / 8;
+	if (endChar > charsInFile)
+		endChar = charsInFile;
+	if (startChar >= endChar) {
+		errorMsg = "empty track";
+		return false;
+	}
+	charsLeft = endChar - startChar;
+
+	// render the tag
+	tag.clear();
+	ID3_Tag id3tag = reader->getID3Tag(trackNum);
+	if (id3tag.NumFrames() > 0) {
+		tag.resize(id3tag.Size());
+		tag.resize(id3tag.Render(&tag[0], ID3TT_ID3V2));
+	}
+
+	// can we copy the data as it is?
+	DsdRawLayout layout;
+	copying = false;
+	copyMsg = "";
+	if (reader->getRawLayout(&layout)
+			&& reader->msbIsPlayedFirst() == msbIsPlayedFirst()
+			&& canCopy(layout, startChar, endChar, &srcOffset, &copyLeft)) {
+		if (srcFd >= 0)
+			::close(srcFd);
+		srcFd = ::open(layout.filePath.c_str(), O_RDONLY);
+		copying = srcFd >= 0;
+		if (!copying)
+			copyMsg = "could not reopen " + layout.filePath + ": " + strerror(errno);
+	}
+
+	// otherwise move the reader to the start of the track
+	if (!copying)
+		reader->seek(startChar*8);
+
+	// open the output
+	if (!strcmp(path, "-")) {
+		fd = STDOUT_FILENO;
+		ownFd = false;
+	} else {
+		fd = ::open(path, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+		ownFd = true;
+	}
+	if (fd < 0) {
+		errorMsg = std::string("could not open ") + path + ": " + strerror(errno);
+		return false;
+	}
+
+	std::vector<dsf2flac_uint8> header;
+	makeHeader(trackEnd - startChar*8, endChar - startChar, tag, header);
+	return writeAll(&header[0], header.size());
+}
+
+bool DsdFileWriter::write(dsf2flac_uint32 nChars)
+{
+	if (nChars > charsLeft)
+		nChars = charsLeft;
+
+	if (copying) {
+		dsf2flac_uint64 len = (dsf2flac_uint64) nChars * nChans;
+		if (len > copyLeft || nChars == charsLeft)
+			len = copyLeft; // the copy may include padding after the last char.
+		if (!copyRange(len))
+			return false;
+		copyLeft -= len;
+		dsf2flac_uint64 left = (copyLeft + nChans - 1) / nChans;
+		if (left < charsLeft)
+			charsLeft = left;
+		return true;
+	}
+
+	// samples held in memory in the right bit order are written from where they are.
+	std::vector<const dsf2flac_uint8*> src(nChans);
+	if (reader->msbIsPlayedFirst() != msbIsPlayedFirst() || !reader->readBlockInPlace(&src[0], nChars)) {
+		std::vector<dsf2flac_uint8*> ptrs(nChans);
+		for (dsf2flac_uint32 c=0; c<nChans; c++) {
+			if (blocks[c].size() < nChars)
+				blocks[c].resize(nChars);
+			ptrs[c] = &blocks[c][0];
+		}
+		reader->readBlock(&ptrs[0], nChars);
+		// the two formats store the bits of each char in opposite orders.
+		if (reader->msbIsPlayedFirst() != msbIsPlayedFirst())
+			for (dsf2flac_uint32 c=0; c<nChans; c++)
+				DopPacker::reverse_bits(ptrs[c], nChars);
+		src.assign(ptrs.begin(), ptrs.end());
+	}
+	charsLeft -= nChars;
+	if (!writeChars(&src[0], nChars))
+		return false;
+	if (charsLeft == 0)
+		return finishChars();
+	return true;
+}
+
+bool DsdFileWriter::close()
+{
+	if (fd < 0)
+		return false;
+	std::vector<dsf2flac_uint8> trailer;
+	makeTrailer(tag, trailer);
+	bool ok = true;
+	if (!trailer.empty())
+		ok = writeAll(&trailer[0], trailer.size());
+	if (ownFd && ::close(fd) && ok) {
+		errorMsg = std::string("close failed: ") + strerror(errno);
+		ok = false;
+	}
+	fd = -1;
+	if (srcFd >= 0)
+		::close(srcFd);
+	srcFd = -1;
+	return ok;
+}
+
+bool DsdFileWriter::writeAll(const dsf2flac_uint8 *data, size_t len)
+{
+	StageScope scope(STAGE_WRITE);
+	StageTimer::count(STAGE_WRITE, len, 0);
+	while (len > 0) {
+		ssize_t n = ::write(fd, data, len);
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			errorMsg = std::string("write failed: ") + strerror(errno);
+			return false;
+		}
+		data += n;
+		len -= n;
+	}
+	return true;
+}
+
+bool DsdFileWriter::copyRange(dsf2flac_uint64 len)
+{
+	StageScope scope(STAGE_WRITE);
+	while (len > 0) {
+		ssize_t n;
+		bool inKernel = true; // writeAll() counts the bytes of a plain copy itself
+#if defined(__linux__) && defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 27))
+		if (tryCopyFileRange) {
+			// file to file inside the kernel (no copy at all on filesystems with reflinks)
+			loff_t off = srcOffset;
+			n = copy_file_range(srcFd, &off, fd, NULL, len, 0);
+			if (n < 0 && errno != EINTR) {
+				// not possible for this pair of files (a pipe, or across filesystems on older kernels)
+				tryCopyFileRange = false;
+				continue;
+			}
+		} else
+#endif
+#ifdef __linux__
+		if (trySendfile) {
+			off_t off = srcOffset;
+			n = sendfile(fd, srcFd, &off, len);
+			if (n < 0 && errno != EINTR) {
+				trySendfile = false;
+				continue;
+			}
+		} else
+#endif
+		{
+			// plain read and write
+			inKernel = false;
+			dsf2flac_uint8 buf[65536];
+			size_t m = len < sizeof(buf) ? len : sizeof(buf);
+			n = pread(srcFd, buf, m, srcOffset);
+			if (n < 0 && errno != EINTR) {
+				errorMsg = std::string("read failed: ") + strerror(errno);
+				return false;
+			}
+			if (n > 0 && !writeAll(buf, n))
+				return false;
+		}
+		if (n < 0)
+			continue; // EINTR
+		if (n == 0) {
+			errorMsg = "unexpected end of input file";
+			return false;
+		}
+		if (inKernel)
+			StageTimer::count(STAGE_WRITE, n, 0);
+		srcOffset += n;
+		len -= n;
+	}
+	return true;
+}
@@ -0,0 +1,125 @@
+/*
+ * dsf2flac - http://code.google.com/p/dsf2flac/
+ *
+ * A file conversion tool for translating dsf dsd audio files into
+ * flac pcm audio files.
+ *
+ * Copyright (c) 2013 by respective authors.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *
+ * Acknowledgments
+ *
+ * Many thanks to the following authors and projects whose work has greatly
+ * helped the development of this tool.
+ *
+ *
+ * Sebastian Gesemann - dsd2pcm (http://code.google.com/p/dsd2pcm/)
+ * SACD Ripper (http://code.google.com/p/sacd-ripper/)
+ * Maxim V.Anisiutkin - foo_input_sacd (http://sourceforge.net/projects/sacddecoder/files/)
+ * Vladislav Goncharov - foo_input_sacd_hq (http://vladgsound.wordpress.com)
+ * Jesus R - www.sonore.us
+ *
+ */
+
+#ifndef DSDFILEWRITER_H
+#define DSDFILEWRITER_H
+
+#include <dsf2flac_types.h>
+#include <dsd_sample_reader.h>
+#include <string>
+#include <vector>
+
+/**
+ * Abstract class for anything which writes the DSD samples of a track straight into a DSD file,
+ * without converting them.
+ *
+ * If the reader can describe where its samples are stored (see DsdSampleReader::getRawLayout) and the
+ * track is laid out in the input just as the output needs it, the bytes are copied from file to file
+ * by the kernel (copy_file_range or sendfile). Otherwise the samples are read with readBlock() and
+ * rearranged, this also covers DST compressed input.
+ *
+ * Use open(), then write() until done(), then close().
+ */
+class DsdFileWriter
+{
+public:
+	/// Class constructor.
+	DsdFileWriter(DsdSampleReader *reader);
+	/// Class destructor, closes the output if still open.
+	virtual ~DsdFileWriter();
+
+	/// Open path ("-" for stdout) and write the header for track trackNum of the reader.
+	bool open(const char *path, dsf2flac_uint32 trackNum);
+	/// Write up to the next nChars chars per channel of the track.
+	bool write(dsf2flac_uint32 nChars);
+	/// Returns true once the whole track has been written.
+	bool done() { return charsLeft == 0; };
+	/// Write anything that follows the samples and close the output.
+	bool close();
+
+	/// Returns the position (in DSD samples) of the next sample to be written.
+	dsf2flac_int64 getPosition() { return (endChar - charsLeft)*8; };
+	/// Returns true if the current track is copied without going through the reader.
+	bool isCopying() { return copying; };
+	/// Returns why the current track is not copied although its layout allows it, empty otherwise.
+	std::string getCopyMsg() { return copyMsg; };
+	/// Returns a message explaining the last error.
+	std::string getErrorMsg() { return errorMsg; };
+	/// A short name of the output format for the user.
+	virtual const char* getFormatName() = 0;
+
+protected:
+	/// Build the header written before the samples of a track of nSamples samples per channel
+	/// (nChars chars per channel), tag is the rendered id3 tag of the track (may be empty).
+	virtual void makeHeader(dsf2flac_uint64 nSamples, dsf2flac_uint64 nChars, std::vector<dsf2flac_uint8>& tag, std::vector<dsf2flac_uint8>& header) = 0;
+	/// Build whatever follows the samples.
+	virtual void makeTrailer(std::vector<dsf2flac_uint8>& tag, std::vector<dsf2flac_uint8>& trailer) = 0;
+	/// Returns true if the chars [startChar,endChar) of an input with this layout can be copied as they are,
+	/// and sets the file byte range to copy.
+	virtual bool canCopy(DsdRawLayout& layout, dsf2flac_uint64 startChar, dsf2flac_uint64 endChar, dsf2flac_uint64* offset, dsf2flac_uint64* len) = 0;
+	/// Rearrange n chars per channel read from the reader (already in the right bit order) into the output.
+	virtual bool writeChars(const dsf2flac_uint8* const* buffers, dsf2flac_uint32 n) = 0;
+	/// Called after the last writeChars() of a track, to flush/pad a partial block.
+	virtual bool finishChars() { return true; };
+	/// The bit order of the output format, in the sense of DsdSampleReader::msbIsPlayedFirst().
+	virtual bool msbIsPlayedFirst() = 0;
+
+	/// write(2) all of data, retrying on short writes.
+	bool writeAll(const dsf2flac_uint8 *data, size_t len);
+	/// Copy len bytes from offset of the input file to the output.
+	bool copyRange(dsf2flac_uint64 len);
+
+	DsdSampleReader *reader;
+	dsf2flac_uint32 nChans;
+	std::string errorMsg;
+private:
+	int fd;						//!< The output file descriptor.
+	bool ownFd;					//!< False when writing to stdout.
+	int srcFd;					//!< The input file when copying.
+	dsf2flac_uint64 srcOffset;	//!< Next input byte to copy.
+	bool copying;
+	std::string copyMsg;		//!< Why a track which could be copied is not.
+	bool tryCopyFileRange;
+	bool trySendfile;
+	dsf2flac_uint64 endChar;	//!< One past the last char of the track.
+	dsf2flac_uint64 charsLeft;
+	dsf2flac_uint64 copyLeft;	//!< Bytes left to copy.
+	std::vector<dsf2flac_uint8> tag;
+	std::vector< std::vector<dsf2flac_uint8> > blocks;
+};
+
+#endif // DSDFILEWRITER_H
@@ -0,0 +1,179 @@
+/*
+ * dsf2flac - http://code.google.com/p/dsf2flac/
+ *
+ * A file conversion tool for translating dsf dsd audio files into
+ * flac pcm audio files.
+ *
+ * Copyright (c) 2013 by respective authors.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *
+ * Acknowledgments
+ *
+ * Many thanks to the following authors and projects whose work has greatly
+ * helped the development of this tool.
+ *
+ *
+ * Sebastian Gesemann - dsd2pcm (http://code.google.com/p/dsd2pcm/)
+ * SACD Ripper (http://code.google.com/p/sacd-ripper/)
+ * Maxim V.Anisiutkin - foo_input_sacd (http://sourceforge.net/projects/sacddecoder/files/)
+ * Vladislav Goncharov - foo_input_sacd_hq (http://vladgsound.wordpress.com)
+ * Jesus R - www.sonore.us
+ *
+ */
+
+#include "dsd_memory_reader.h"
+#include <string.h>
+
+DsdMemoryReader::DsdMemoryReader(const dsf2flac_uint8* const* channelData, dsf2flac_uint32 nChannels, dsf2flac_uint64 n, dsf2flac_uint32 f, bool msbIsPlayedFirst)
+	: DsdMemoryReader()
+{
+	setPlanar(channelData, nChannels, n, f, msbIsPlayedFirst);
+}
+
+DsdMemoryReader::DsdMemoryReader(const dsf2flac_uint8* data, dsf2flac_uint32 nChannels, dsf2flac_uint64 n, dsf2flac_uint32 f, dsf2flac_uint32 blockSz, bool msbIsPlayedFirst)
+	: DsdMemoryReader()
+{
+	interleaved = data;
+	blockSzPerChan = blockSz;
+	if (!data || blockSz == 0) {
+		errorMsg = "DsdMemoryReader: no data or a block size of 0";
+		return;
+	}
+	init(nChannels, n, f, msbIsPlayedFirst);
+}
+
+DsdMemoryReader::DsdMemoryReader()
+{
+	interleaved = NULL;
+	blockSzPerChan = 0;
+	nChans = 0;
+	nChars = 0;
+	fs = 0;
+	msbFirst = false;
+	valid = false;
+}
+
+DsdMemoryReader::~DsdMemoryReader()
+{
+}
+
+void DsdMemoryReader::setPlanar(const dsf2flac_uint8* const* channelData, dsf2flac_uint32 nChannels, dsf2flac_uint64 n, dsf2flac_uint32 f, bool msbIsPlayedFirst)
+{
+	for (dsf2flac_uint32 c=0; channelData && c<nChannels; c++)
+		if (!channelData[c] && n) {
+			errorMsg = "DsdMemoryReader: missing the data of a channel";
+			return;
+		}
+	if (!channelData) {
+		errorMsg = "DsdMemoryReader: no data";
+		return;
+	}
+	channels.assign(channelData, channelData + nChannels);
+	init(nChannels, n, f, msbIsPlayedFirst);
+}
+
+bool DsdMemoryReader::init(dsf2flac_uint32 nChannels, dsf2flac_uint64 n, dsf2flac_uint32 f, bool msbIsPlayedFirst)
+{
+	if (nChannels == 0 || f == 0) {
+		errorMsg = "DsdMemoryReader: no channels or a sample rate of 0";
+		return false;
+	}
+	nChans = nChannels;
+	nChars = n;
+	fs = f;
+	msbFirst = msbIsPlayedFirst;
+	samplesPerChar = 8;
+	allocateBuffer();
+	rewind();
+	valid = true;
+	return true;
+}
+
+bool DsdMemoryReader::step()
+{
+	posMarker++;
+	bool ok = posMarker < nChars;
+	for (dsf2flac_uint32 c=0; c<nChans; c++)
+		circularBuffers[c].push_front(ok ? *charAt(c, posMarker) : getIdleSample());
+	return ok;
+}
+
+bool DsdMemoryReader::readBlock(dsf2flac_uint8** buffers, dsf2flac_uint32 n)
+{
+	dsf2flac_int64 first = posMarker + 1;
+	dsf2flac_int64 avail = nChars - first;
+	dsf2flac_uint32 m = avail < 0 ? 0 : avail < n ? avail : n;
+	for (dsf2flac_uint32 c=0; c<nChans; c++) {
+		if (!interleaved) {
+			if (m)
+				memcpy(buffers[c], channels[c] + first, m);
+		} else if (blockSzPerChan == 1) {
+			const dsf2flac_uint8* src = charAt(c, first);
+			for (dsf2flac_uint32 i=0; i<m; i++)
+				buffers[c][i] = src[i * nChans];
+		} else {
+			// copy the part of each block that falls in the range
+			for (dsf2flac_uint32 i=0; i<m; ) {
+				dsf2flac_uint32 run = blockSzPerChan - (first + i) % blockSzPerChan;
+				if (run > m - i)
+					run = m - i;
+				memcpy(buffers[c] + i, charAt(c, first + i), run);
+				i += run;
+			}
+		}
+		memset(buffers[c] + m, getIdleSample(), n - m);
+	}
+	posMarker += n;
+	pushBlockToBuffer(buffers, n);
+	return m == n;
+}
+
+bool DsdMemoryReader::readBlockInPlace(const dsf2flac_uint8** ptrs, dsf2flac_uint32 n)
+{
+	if (interleaved && nChans > 1)
+		return false;
+	if (posMarker + 1 + n > nChars)
+		return false;
+	for (dsf2flac_uint32 c=0; c<nChans; c++)
+		ptrs[c] = charAt(c, posMarker + 1);
+	posMarker += n;
+	pushBlockToBuffer(ptrs, n);
+	return true;
+}
+
+void DsdMemoryReader::rewind()
+{
+	posMarker = -1;
+	clearBuffer();
+}
+
+bool DsdMemoryReader::jumpTo(dsf2flac_int64 charIdx)
+{
+	posMarker = charIdx - 1;
+	clearBuffer();
+	return true;
+}
+
+void DsdMemoryReader::dispFileInfo()
+{
+	fprintf(stderr,"chanNum: %u\n",nChans);
+	fprintf(stderr,"samplingFreq: %u\n",fs);
+	fprintf(stderr,"sampleCount: %ld\n",nChars * 8);
+	fprintf(stderr,"layout: %s\n",interleaved ? "interleaved" : "planar");
+	if (interleaved)
+		fprintf(stderr,"blockSzPerChan: %u\n",blockSzPerChan);
+}
@@ -0,0 +1,99 @@
+/*
+ * dsf2flac - http://code.google.com/p/dsf2flac/
+ *
+ * A file conversion tool for translating dsf dsd audio files into
+ * flac pcm audio files.
+ *
+ * Copyright (c) 2013 by respective authors.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *
+ * Acknowledgments
+ *
+ * Many thanks to the following authors and projects whose work has greatly
+ * helped the development of this tool.
+ *
+ *
+ * Sebastian Gesemann - dsd2pcm (http://code.google.com/p/dsd2pcm/)
+ * SACD Ripper (http://code.google.com/p/sacd-ripper/)
+ * Maxim V.Anisiutkin - foo_input_sacd (http://sourceforge.net/projects/sacddecoder/files/)
+ * Vladislav Goncharov - foo_input_sacd_hq (http://vladgsound.wordpress.com)
+ * Jesus R - www.sonore.us
+ *
+ */
+
+#ifndef DSDMEMORYREADER_H
+#define DSDMEMORYREADER_H
+
+#include <dsd_sample_reader.h>
+#include <vector>
+
+/**
+ * Reads DSD samples held in memory by the caller, so that data which is already in RAM (from another
+ * decoder or off the network) can be converted without writing it to a file first.
+ *
+ * The samples are either planar, one array of chars per channel, or interleaved in blocks of blockSzPerChan
+ * chars per channel as in DSF (4096) or DSDIFF (1) files. The bit order is given in the sense of
+ * msbIsPlayedFirst(): true for chars as stored in DSF files, false for DSDIFF. The data is not copied,
+ * the caller must keep it unchanged for as long as the reader exists.
+ *
+ * Planar data is handed out without copying through readBlockInPlace().
+ */
+class DsdMemoryReader : public DsdSampleReader
+{
+public:
+	/// Class constructor for planar data, channels[c] holds nChars chars of channel c.
+	DsdMemoryReader(const dsf2flac_uint8* const* channels, dsf2flac_uint32 nChannels, dsf2flac_uint64 nChars, dsf2flac_uint32 fs, bool msbIsPlayedFirst);
+	/// Class constructor for interleaved data, nChars chars per channel in blocks of blockSzPerChan.
+	DsdMemoryReader(const dsf2flac_uint8* data, dsf2flac_uint32 nChannels, dsf2flac_uint64 nChars, dsf2flac_uint32 fs, dsf2flac_uint32 blockSzPerChan, bool msbIsPlayedFirst);
+	/// Class destructor.
+	virtual ~DsdMemoryReader();
+public: // methods overriding dsdSampleReader
+	dsf2flac_uint32 getSamplingFreq() { return fs; };
+	dsf2flac_uint32 getNumChannels() { return nChans; };
+	dsf2flac_int64 getLength() { return nChars * 8; };
+	bool msbIsPlayedFirst() { return msbFirst; };
+	bool step();
+	bool readBlock(dsf2flac_uint8** buffers, dsf2flac_uint32 n);
+	bool readBlockInPlace(const dsf2flac_uint8** ptrs, dsf2flac_uint32 n);
+	void rewind();
+	void dispFileInfo();
+protected:
+	/// For child classes which hold the data themselves, they call setPlanar() once it is ready.
+	DsdMemoryReader();
+	/// Set up the reader for planar data, as the planar constructor does.
+	void setPlanar(const dsf2flac_uint8* const* channels, dsf2flac_uint32 nChannels, dsf2flac_uint64 nChars, dsf2flac_uint32 fs, bool msbIsPlayedFirst);
+	bool jumpTo(dsf2flac_int64 charIdx);
+private:
+	/// Returns the address of char idx of channel c.
+	const dsf2flac_uint8* charAt(dsf2flac_uint32 c, dsf2flac_int64 idx) {
+		if (!interleaved)
+			return channels[c] + idx;
+		return interleaved + (idx / blockSzPerChan) * blockSzPerChan * nChans + c * blockSzPerChan + idx % blockSzPerChan;
+	};
+	/// Check the format and finish setting up, returns false (with errorMsg set) if it is not usable.
+	bool init(dsf2flac_uint32 nChannels, dsf2flac_uint64 nChars, dsf2flac_uint32 fs, bool msbIsPlayedFirst);
+private:
+	std::vector<const dsf2flac_uint8*> channels;	//!< planar data, one pointer per channel.
+	const dsf2flac_uint8* interleaved;				//!< interleaved data, or NULL.
+	dsf2flac_uint32 blockSzPerChan;
+	dsf2flac_uint32 nChans;
+	dsf2flac_int64 nChars;
+	dsf2flac_uint32 fs;
+	bool msbFirst;
+};
+
+#endif // DSDMEMORYREADER_H
@@ -36,11 +36,14 @@
  */
 
 #include <dsd_sample_reader.h>
+#include <iterator>
+#include <vector>
 
 DsdSampleReader::DsdSampleReader()
 {
 	bufferLength = defaultBufferLength;
 	isBufferAllocated = false;
+	posMarker = -1;
 }
 
 DsdSampleReader::~DsdSampleReader()
@@ -76,6 +79,62 @@ bool DsdSampleReader::setBufferLength(dsf2flac_uint32 b)
 	return true;
 }
 
+bool DsdSampleReader::readBlock(dsf2flac_uint8** buffers, dsf2flac_uint32 n)
+{
+	bool ok = true;
+	for (dsf2flac_uint32 i=0; i<n; i++) {
+		ok &= step();
+		for (dsf2flac_uint32 c=0; c<getNumChannels(); c++)
+			buffers[c][i] = circularBuffers[c][0];
+	}
+	return ok;
+}
+
+bool DsdSampleReader::seek(dsf2flac_int64 pos)
+{
+	if (pos < 0)
+		pos = 0;
+	// posMarker ends on the char before the one holding pos
+	dsf2flac_int64 target = pos/samplesPerChar - 1;
+	// reading from here on refills the circular buffers with the right history
+	dsf2flac_int64 from = target - getBufferLength() + 1;
+	if (target < posMarker || from > posMarker + 1) {
+		if (from <= 0 || !jumpTo(from)) {
+			if (target < posMarker)
+				rewind();
+		}
+	}
+	// read forward to the target
+	bool ok = true;
+	std::vector< std::vector<dsf2flac_uint8> > scratch(getNumChannels());
+	std::vector<dsf2flac_uint8*> ptrs(getNumChannels());
+	while (posMarker < target) {
+		dsf2flac_int64 n = target - posMarker;
+		if (n > 4096)
+			n = 4096;
+		for (dsf2flac_uint32 c=0; c<getNumChannels(); c++) {
+			scratch[c].resize(n);
+			ptrs[c] = &scratch[c][0];
+		}
+		ok &= readBlock(&ptrs[0], n);
+	}
+	return ok;
+}
+
+void DsdSampleReader::pushBlockToBuffer(const dsf2flac_uint8* const* buffers, dsf2flac_uint32 n)
+{
+	// only the last getBufferLength() chars can still be in the buffers.
+	dsf2flac_uint32 k = n;
+	if (k > getBufferLength())
+		k = getBufferLength();
+	for (dsf2flac_uint32 c=0; c<getNumChannels(); c++) {
+		// the newest char goes to the front, so insert the tail of the block in reverse order.
+		std::reverse_iterator<const dsf2flac_uint8*> first(buffers[c]+n);
+		std::reverse_iterator<const dsf2flac_uint8*> last(buffers[c]+n-k);
+		circularBuffers[c].rinsert(circularBuffers[c].begin(),first,last);
+	}
+}
+
 dsf2flac_float64 DsdSampleReader::getPositionInSeconds()
 {
 	return getPosition() / (dsf2flac_float64) getSamplingFreq();
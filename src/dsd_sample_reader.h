@@ -42,9 +42,20 @@
 #include <dsf2flac_types.h>
 #include <boost/circular_buffer.hpp>
 #include <id3/tag.h>
+#include <string>
 
 static const dsf2flac_uint32 defaultBufferLength = 5000; //!< The default length of the circular buffers.
 
+/**
+ * Describes how uncompressed DSD samples are laid out in an input file,
+ * so that they can be copied without going through a reader.
+ */
+typedef struct {
+	std::string		filePath;		//!< the input file.
+	dsf2flac_uint64	dataOffset;		//!< file offset of the first char of sample data.
+	dsf2flac_uint32	blockSzPerChan;	//!< chars per channel in each block, 1 for byte interleaved data.
+} DsdRawLayout;
+
 /**
  * Abstract class defining anything which reads dsd samples from something.
  */
@@ -81,6 +92,22 @@ public:
 	 *  This causes the next 8 DSD samples to be added into the front of the circular buffers (one uint8).
 	 */
 	virtual bool step() = 0;
+	/** Read the next n chars of every channel into buffers[c][0] ... buffers[c][n-1].
+	 *  This is equivalent to calling step() n times and collecting the front of the circular buffers,
+	 *  the position and the circular buffers are left exactly as step() would leave them.
+	 *  Returns false if the end of the data was reached (the remainder is filled with getIdleSample()).
+	 *  Child classes should override this with something faster than the default step() loop.
+	 */
+	virtual bool readBlock(dsf2flac_uint8** buffers, dsf2flac_uint32 n);
+	/** Zero copy version of readBlock() for readers holding their samples in memory.
+	 *  If the next n chars of every channel are stored contiguously, point ptrs[c] at them, move on exactly as
+	 *  readBlock() would and return true. The pointers stay valid as long as the reader does.
+	 *  Otherwise nothing is read and false is returned, the caller should then use readBlock().
+	 */
+	virtual bool readBlockInPlace(const dsf2flac_uint8** ptrs, dsf2flac_uint32 n) { return false; };
+	/// If the samples are stored uncompressed in a file, describe where they are and return true.
+	/// The samples are stored in the bit order given by msbIsPlayedFirst().
+	virtual bool getRawLayout(DsdRawLayout* layout) { return false; };
 	/// Returns false if there are no more samples left in the reader.
 	virtual bool samplesAvailable() { return getPosition()<getLength(); };
 
@@ -95,6 +122,13 @@ public:
 	/// Set the reader position back to the start of the DSD data.
 	/// Note that child classes implementing this method must call clearBuffer();
 	virtual void rewind() = 0;
+	/**
+	 * Move the reader so that the next step() reads the char holding DSD sample pos.
+	 * The circular buffers are refilled with the chars before it, so the reader is left
+	 * exactly as if it had stepped there from the start. Readers which can jump within
+	 * their data only read getBufferLength() chars, others read forward (or rewind first).
+	 */
+	bool seek(dsf2flac_int64 pos);
 
 	/**
 	 * Returns an array of circular buffers, one for each track.
@@ -131,6 +165,11 @@ protected:
 	void allocateBuffer();
 	/// Clear the buffers and fill with idleSample.
 	void clearBuffer();
+	/// Push the tail of a block returned by readBlock() into the circular buffers, as n calls to step() would have.
+	void pushBlockToBuffer(const dsf2flac_uint8* const* buffers, dsf2flac_uint32 n);
+	/// Position the reader so that the next char read is charIdx, with cleared buffers.
+	/// Returns false if the reader can't jump directly, seek() then reads forward instead.
+	virtual bool jumpTo(dsf2flac_int64 charIdx) { return false; };
 protected:
 	// protected properties
 	boost::circular_buffer<dsf2flac_uint8>* circularBuffers;
@@ -0,0 +1,335 @@
+/*
+ * dsf2flac - http://code.google.com/p/dsf2flac/
+ *
+ * A file conversion tool for translating dsf dsd audio files into
+ * flac pcm audio files.
+ *
+ * Copyright (c) 2013 by respective authors.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *
+ * Acknowledgments
+ *
+ * Many thanks to the following authors and projects whose work has greatly
+ * helped the development of this tool.
+ *
+ *
+ * Sebastian Gesemann - dsd2pcm (http://code.google.com/p/dsd2pcm/)
+ * SACD Ripper (http://code.google.com/p/sacd-ripper/)
+ * Maxim V.Anisiutkin - foo_input_sacd (http://sourceforge.net/projects/sacddecoder/files/)
+ * Vladislav Goncharov - foo_input_sacd_hq (http://vladgsound.wordpress.com)
+ * Jesus R - www.sonore.us
+ *
+ */
+
+#include "dsd_signal_generator.h"
+#include <algorithm>
+#include <complex>
+#include <math.h>
+#include <random>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+
+static const dsf2flac_uint32 inputBlockLength = 4096;	// input samples made at a time
+static const dsf2flac_float64 overloadLimit = 8.0;		// quantiser input beyond which the modulator is reset
+static const dsf2flac_float64 noiseBandwidth = 20000.0;
+
+/**
+ * Design the noise transfer function of the modulator: NTF(z) = B(z)/A(z) with B = (1 - z^-1)^order
+ * and the poles of a digital Butterworth high pass, its cutoff found by bisection so that |NTF(-1)| = 1.5.
+ */
+static void designNtf(dsf2flac_uint32 order, std::vector<dsf2flac_float64>& a, std::vector<dsf2flac_float64>& b)
+{
+	std::vector< std::complex<dsf2flac_float64> > poles(order);
+	dsf2flac_float64 lo = 1e-6, hi = M_PI - 1e-6;
+	for (dsf2flac_uint32 i=0; i<60; i++) {
+		dsf2flac_float64 wc = (lo + hi) / 2;
+		dsf2flac_float64 omega = 2 * tan(wc / 2);
+		dsf2flac_float64 hInf = 1;
+		for (dsf2flac_uint32 k=0; k<order; k++) {
+			// analog low pass prototype pole -> high pass -> bilinear transform
+			std::complex<dsf2flac_float64> s = omega / std::polar(1.0, M_PI * (2*k + order + 1) / (2*order));
+			poles[k] = (1.0 + s / 2.0) / (1.0 - s / 2.0);
+			hInf *= 2 / std::abs(1.0 + poles[k]);
+		}
+		if (hInf > 1.5)
+			hi = wc;
+		else
+			lo = wc;
+	}
+	// expand the products of (1 - p z^-1) and (1 - z^-1)
+	std::vector< std::complex<dsf2flac_float64> > ac(order + 1, 0.0);
+	a.assign(order + 1, 0.0);
+	b.assign(order + 1, 0.0);
+	ac[0] = 1;
+	b[0] = 1;
+	for (dsf2flac_uint32 k=0; k<order; k++) {
+		for (dsf2flac_uint32 j=k+1; j>0; j--) {
+			ac[j] -= poles[k] * ac[j-1];
+			b[j] -= b[j-1];
+		}
+	}
+	for (dsf2flac_uint32 j=0; j<=order; j++)
+		a[j] = ac[j].real();
+}
+
+/// Makes the input of the modulator for one channel, a block at a time.
+class SignalSource
+{
+public:
+	SignalSource(const DsdSignal& s, dsf2flac_uint32 f, dsf2flac_int64 length, dsf2flac_uint32 seed) : rng(seed)
+	{
+		signal = s;
+		fs = f;
+		nSamples = length;
+		n = 0;
+		amp = 0.5 * pow(10, signal.level / 20);
+		re = 1;
+		im = 0;
+		setFreq(signal.freq);
+		lp1 = lp2 = 0;
+		lpCoef = 1 - exp(-2 * M_PI * noiseBandwidth / fs);
+		if (signal.type == SIGNAL_NOISE) {
+			// scale the filtered noise (of unit variance before the filters) to an rms of amp
+			dsf2flac_float64 y1 = 0, y2 = 0, energy = 0;
+			for (dsf2flac_uint32 i=0; i<200 * fs / noiseBandwidth; i++) {
+				y1 += lpCoef * ((i == 0) - y1);
+				y2 += lpCoef * (y1 - y2);
+				energy += y2 * y2;
+			}
+			amp /= sqrt(energy);
+		}
+	}
+	/// Fill x with the next len samples.
+	void fill(dsf2flac_float64* x, dsf2flac_uint32 len)
+	{
+		switch (signal.type) {
+		case SIGNAL_SINE:
+			rotate(x, len);
+			break;
+		case SIGNAL_SWEEP:
+			for (dsf2flac_uint32 i=0; i<len; i+=64) {
+				setFreq(signal.freq * pow(signal.freqEnd / signal.freq, (dsf2flac_float64) (n + i) / nSamples));
+				rotate(x + i, std::min<dsf2flac_uint32>(64, len - i));
+			}
+			break;
+		case SIGNAL_NOISE:
+			for (dsf2flac_uint32 i=0; i<len; i++) {
+				dsf2flac_float64 u = (rng() - rng.min()) / (dsf2flac_float64) (rng.max() - rng.min());
+				lp1 += lpCoef * ((2 * u - 1) * sqrt(3.0) - lp1);
+				lp2 += lpCoef * (lp1 - lp2);
+				x[i] = amp * lp2;
+			}
+			break;
+		case SIGNAL_SILENCE:
+			memset(x, 0, len * sizeof(dsf2flac_float64));
+			break;
+		}
+		n += len;
+	}
+private:
+	void setFreq(dsf2flac_float64 freq)
+	{
+		rotRe = cos(2 * M_PI * freq / fs);
+		rotIm = sin(2 * M_PI * freq / fs);
+	}
+	/// A recursive oscillator, renormalised after each call so its amplitude doesn't drift.
+	void rotate(dsf2flac_float64* x, dsf2flac_uint32 len)
+	{
+		for (dsf2flac_uint32 i=0; i<len; i++) {
+			x[i] = amp * im;
+			dsf2flac_float64 r = re * rotRe - im * rotIm;
+			im = re * rotIm + im * rotRe;
+			re = r;
+		}
+		dsf2flac_float64 mag = sqrt(re * re + im * im);
+		re /= mag;
+		im /= mag;
+	}
+	DsdSignal signal;
+	dsf2flac_uint32 fs;
+	dsf2flac_int64 nSamples;
+	dsf2flac_int64 n;
+	dsf2flac_float64 amp;
+	dsf2flac_float64 re, im, rotRe, rotIm;
+	dsf2flac_float64 lp1, lp2, lpCoef;
+	std::minstd_rand rng;
+};
+
+/**
+ * The modulator, in error feedback form: the quantiser sees the input plus (NTF - 1) applied to past quantisation
+ * errors, so the output is the input plus NTF applied to the error. The filter is in transposed direct form, which
+ * keeps the work between one quantiser decision and the next down to a multiply and add.
+ * Templated on the order so the loops unroll. Returns the number of resets.
+ */
+template<dsf2flac_uint32 N>
+static dsf2flac_uint32 modulate(const dsf2flac_float64* a, const dsf2flac_float64* b, SignalSource& source, dsf2flac_uint8* out, dsf2flac_int64 nChars)
+{
+	dsf2flac_float64 c[N], p[N];
+	for (dsf2flac_uint32 k=0; k<N; k++) {
+		c[k] = b[k+1] - a[k+1];
+		p[k] = a[k+1];
+	}
+	dsf2flac_float64 w[N+1] = {0};	// w[N] stays 0
+	dsf2flac_float64 x[inputBlockLength];
+	dsf2flac_uint32 nResets = 0;
+	for (dsf2flac_int64 i=0; i<nChars; i+=inputBlockLength/8) {
+		dsf2flac_uint32 blockChars = std::min<dsf2flac_int64>(inputBlockLength/8, nChars - i);
+		source.fill(x, blockChars * 8);
+		const dsf2flac_float64* xp = x;
+		for (dsf2flac_uint32 j=0; j<blockChars; j++) {
+			dsf2flac_uint8 ch = 0;
+			for (dsf2flac_uint32 bit=0; bit<8; bit++) {
+				dsf2flac_float64 s = w[0];
+				dsf2flac_float64 v = *xp++ + s;
+				dsf2flac_float64 e = copysign(1.0, v) - v;	// no branch, the decisions are unpredictable
+				for (dsf2flac_uint32 k=0; k<N; k++)
+					w[k] = c[k] * e - p[k] * s + w[k+1];
+				ch = (ch << 1) | !signbit(v);
+				if (fabs(v) > overloadLimit) {
+					for (dsf2flac_uint32 k=0; k<N; k++)
+						w[k] = 0;
+					nResets++;
+				}
+			}
+			out[i + j] = ch;
+		}
+	}
+	return nResets;
+}
+
+DsdSignalGenerator::DsdSignalGenerator(dsf2flac_uint32 f, dsf2flac_float64 seconds, const std::vector<DsdSignal>& s, dsf2flac_uint32 o)
+{
+	fs = f;
+	order = o;
+	signals = s;
+	nChars = 0;
+	nResets = 0;
+
+	if (fs != 2822400 && fs != 5644800 && fs != 11289600 && fs != 22579200) {
+		errorMsg = "DsdSignalGenerator: the DSD rate must be that of DSD64, 128, 256 or 512";
+		return;
+	}
+	if (order < 5 || order > 7) {
+		errorMsg = "DsdSignalGenerator: the modulator order must be 5, 6 or 7";
+		return;
+	}
+	if (signals.empty() || seconds <= 0) {
+		errorMsg = "DsdSignalGenerator: nothing to generate";
+		return;
+	}
+	for (dsf2flac_uint32 c=0; c<signals.size(); c++) {
+		const DsdSignal& sig = signals[c];
+		bool hasFreq = sig.type == SIGNAL_SINE || sig.type == SIGNAL_SWEEP;
+		if ((hasFreq && (sig.freq <= 0 || sig.freq > 100000)) || (sig.type == SIGNAL_SWEEP && (sig.freqEnd <= 0 || sig.freqEnd > 100000))) {
+			errorMsg = "DsdSignalGenerator: frequencies must be between 0 and 100kHz";
+			return;
+		}
+		if (sig.level > 0) {
+			errorMsg = "DsdSignalGenerator: levels above 0dB would overload the modulator";
+			return;
+		}
+	}
+
+	designNtf(order, ntfA, ntfB);
+	nChars = (dsf2flac_int64) (seconds * fs / 8);
+	data.resize(signals.size());
+	for (dsf2flac_uint32 c=0; c<data.size(); c++)
+		data[c].resize(nChars);
+
+	// the channels are independent, so make them all at once
+	std::vector<dsf2flac_uint32> resets(data.size());
+	std::vector<std::thread> threads;
+	for (dsf2flac_uint32 c=0; c<data.size(); c++)
+		threads.push_back(std::thread([this, c, &resets]() { resets[c] = generate(c, signals[c]); }));
+	for (dsf2flac_uint32 c=0; c<threads.size(); c++) {
+		threads[c].join();
+		nResets += resets[c];
+	}
+
+	// the chars are stored as in DSDIFF files, the first sample in the top bit
+	std::vector<const dsf2flac_uint8*> channels(data.size());
+	for (dsf2flac_uint32 c=0; c<data.size(); c++)
+		channels[c] = data[c].data();
+	setPlanar(&channels[0], channels.size(), nChars, fs, false);
+}
+
+DsdSignalGenerator::~DsdSignalGenerator()
+{
+}
+
+dsf2flac_uint32 DsdSignalGenerator::generate(dsf2flac_uint32 chanNum, const DsdSignal& signal)
+{
+	SignalSource source(signal, fs, nChars * 8, chanNum + 1);
+	dsf2flac_uint8* out = &data[chanNum][0];
+	switch (order) {
+	case 5:
+		return modulate<5>(&ntfA[0], &ntfB[0], source, out, nChars);
+	case 6:
+		return modulate<6>(&ntfA[0], &ntfB[0], source, out, nChars);
+	default:
+		return modulate<7>(&ntfA[0], &ntfB[0], source, out, nChars);
+	}
+}
+
+bool DsdSignalGenerator::parseSignal(const std::string& text, DsdSignal* signal)
+{
+	std::vector<std::string> fields;
+	size_t start = 0;
+	for (size_t colon; (colon = text.find(':', start)) != std::string::npos; start = colon + 1)
+		fields.push_back(text.substr(start, colon - start));
+	fields.push_back(text.substr(start));
+
+	std::vector<dsf2flac_float64> nums;
+	for (dsf2flac_uint32 i=1; i<fields.size(); i++) {
+		char* end;
+		nums.push_back(strtod(fields[i].c_str(), &end));
+		if (fields[i].empty() || *end)
+			return false;
+	}
+	signal->freq = 1000;
+	signal->freqEnd = 1000;
+	if (fields[0] == "sine" && (nums.size() == 1 || nums.size() == 2)) {
+		signal->type = SIGNAL_SINE;
+		signal->freq = nums[0];
+		signal->level = nums.size() > 1 ? nums[1] : -6;
+	} else if (fields[0] == "sweep" && (nums.size() == 2 || nums.size() == 3)) {
+		signal->type = SIGNAL_SWEEP;
+		signal->freq = nums[0];
+		signal->freqEnd = nums[1];
+		signal->level = nums.size() > 2 ? nums[2] : -6;
+	} else if (fields[0] == "noise" && nums.size() <= 1) {
+		signal->type = SIGNAL_NOISE;
+		signal->level = nums.size() > 0 ? nums[0] : -20;
+	} else if (fields[0] == "silence" && nums.empty()) {
+		signal->type = SIGNAL_SILENCE;
+		signal->level = 0;
+	} else
+		return false;
+	return true;
+}
+
+void DsdSignalGenerator::dispFileInfo()
+{
+	const char* names[4] = { "sine", "sweep", "noise", "silence" };
+	fprintf(stderr,"samplingFreq: %u\n",fs);
+	fprintf(stderr,"modulatorOrder: %u\n",order);
+	fprintf(stderr,"sampleCount: %ld\n",nChars * 8);
+	for (dsf2flac_uint32 c=0; c<signals.size(); c++)
+		fprintf(stderr,"channel %u: %s %g %g %gdB\n",c,names[signals[c].type],signals[c].freq,signals[c].freqEnd,signals[c].level);
+	fprintf(stderr,"modulatorResets: %u\n",nResets);
+}
@@ -0,0 +1,107 @@
+/*
+ * dsf2flac - http://code.google.com/p/dsf2flac/
+ *
+ * A file conversion tool for translating dsf dsd audio files into
+ * flac pcm audio files.
+ *
+ * Copyright (c) 2013 by respective authors.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *
+ * Acknowledgments
+ *
+ * Many thanks to the following authors and projects whose work has greatly
+ * helped the development of this tool.
+ *
+ *
+ * Sebastian Gesemann - dsd2pcm (http://code.google.com/p/dsd2pcm/)
+ * SACD Ripper (http://code.google.com/p/sacd-ripper/)
+ * Maxim V.Anisiutkin - foo_input_sacd (http://sourceforge.net/projects/sacddecoder/files/)
+ * Vladislav Goncharov - foo_input_sacd_hq (http://vladgsound.wordpress.com)
+ * Jesus R - www.sonore.us
+ *
+ */
+
+#ifndef DSDSIGNALGENERATOR_H
+#define DSDSIGNALGENERATOR_H
+
+#include <dsd_memory_reader.h>
+#include <string>
+#include <vector>
+
+/// The kinds of test signal DsdSignalGenerator can make.
+typedef enum {
+	SIGNAL_SINE,		//!< a sine at freq.
+	SIGNAL_SWEEP,		//!< a logarithmic sweep from freq to freqEnd over the whole length.
+	SIGNAL_NOISE,		//!< white noise, band limited to about 20kHz.
+	SIGNAL_SILENCE		//!< digital silence (the modulator's idle pattern).
+} DsdSignalType;
+
+/// One channel's test signal.
+typedef struct {
+	DsdSignalType		type;
+	dsf2flac_float64	freq;		//!< Hz, the start of a sweep.
+	dsf2flac_float64	freqEnd;	//!< Hz, the end of a sweep.
+	dsf2flac_float64	level;		//!< dB relative to the SACD 0dB level (50% modulation), the peak of a sine or sweep and the rms of noise.
+} DsdSignal;
+
+/**
+ * A DsdSampleReader generating a test signal in memory, for benchmarks and tests which need DSD input
+ * without depending on recordings.
+ *
+ * Each channel's signal goes through a 5th to 7th order sigma delta modulator, with all the zeros of its noise transfer
+ * function at DC and Butterworth poles placed so that its gain is 1.5 at fs/2 (Lee's rule), which is stable for
+ * signals up to 0dB SACD. Should the modulator still overload (the quantiser input getting out of hand) its state is
+ * reset, see getNumResets(). The whole signal is made when the generator is constructed, one thread per channel,
+ * and it is then read as a DsdMemoryReader, or written to a DSF or DSDIFF file with a DsdFileWriter.
+ */
+class DsdSignalGenerator : public DsdMemoryReader
+{
+public:
+	/**
+	 * Class constructor.
+	 * fs is the DSD rate (DSD64 to DSD512), signals holds one signal per channel and order the order of the modulator (5 to 7).
+	 */
+	DsdSignalGenerator(dsf2flac_uint32 fs, dsf2flac_float64 seconds, const std::vector<DsdSignal>& signals, dsf2flac_uint32 order = 5);
+	/// Class destructor.
+	virtual ~DsdSignalGenerator();
+
+	/**
+	 * Parse a signal from text: "sine:FREQ[:LEVEL]", "sweep:FROM:TO[:LEVEL]", "noise[:LEVEL]" or "silence".
+	 * LEVEL is in dB (default -6 for sines and sweeps, -20 for noise). Returns false if text is not understood.
+	 */
+	static bool parseSignal(const std::string& text, DsdSignal* signal);
+	/// Returns the number of times the modulator was reset after overloading, summed over the channels.
+	dsf2flac_uint32 getNumResets() { return nResets; };
+	/// Returns the sample data of a channel, the first sample of each char in its top bit (as in DSDIFF files).
+	const dsf2flac_uint8* getData(dsf2flac_uint32 chanNum) { return data[chanNum].empty() ? NULL : &data[chanNum][0]; };
+public: // methods overriding dsdSampleReader
+	void dispFileInfo();
+private:
+	/// Generate channel chanNum, returns the number of modulator resets.
+	dsf2flac_uint32 generate(dsf2flac_uint32 chanNum, const DsdSignal& signal);
+private:
+	dsf2flac_uint32 fs;
+	dsf2flac_uint32 order;
+	dsf2flac_int64 nChars;
+	std::vector< std::vector<dsf2flac_uint8> > data;
+	std::vector<DsdSignal> signals;
+	std::vector<dsf2flac_float64> ntfA;	//!< denominator of the noise transfer function, ntfA[0] = 1.
+	std::vector<dsf2flac_float64> ntfB;	//!< numerator, (1 - z^-1)^order.
+	dsf2flac_uint32 nResets;
+};
+
+#endif // DSDSIGNALGENERATOR_H
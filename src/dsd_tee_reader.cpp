@@ -0,0 +1,235 @@
+/*
+ * dsf2flac - http://code.google.com/p/dsf2flac/
+ *
+ * A file conversion tool for translating dsf dsd audio files into
+ * flac pcm audio files.
+ *
+ * Copyright (c) 2013 by respective authors.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *
+ * Acknowledgments
+ *
+ * Many thanks to the following authors and projects whose work has greatly
+ * helped the development of this tool.
+ *
+ *
+ * Sebastian Gesemann - dsd2pcm (http://code.google.com/p/dsd2pcm/)
+ * SACD Ripper (http://code.google.com/p/sacd-ripper/)
+ * Maxim V.Anisiutkin - foo_input_sacd (http://sourceforge.net/projects/sacddecoder/files/)
+ * Vladislav Goncharov - foo_input_sacd_hq (http://vladgsound.wordpress.com)
+ * Jesus R - www.sonore.us
+ *
+ */
+
+#include "dsd_tee_reader.h"
+#include <string.h>
+
+static const dsf2flac_uint32 teeChunkLength = 65536; //!< chars per channel read from the source at a time.
+
+DsdTeeReader::DsdTeeReader(DsdSampleReader *s)
+{
+	source = s;
+	chunkLength = teeChunkLength;
+	firstChunk = 0;
+	// nobody looks at the source's own circular buffers any more, keep them tiny.
+	source->setBufferLength(1);
+}
+
+DsdTeeReader::~DsdTeeReader()
+{
+	for (dsf2flac_uint32 i=0; i<branches.size(); i++)
+		delete branches[i];
+	while (!chunks.empty()) {
+		spareChunks.push_back(chunks.front());
+		chunks.pop_front();
+	}
+	for (dsf2flac_uint32 i=0; i<spareChunks.size(); i++)
+		for (dsf2flac_uint32 c=0; c<spareChunks[i].size(); c++)
+			delete[] spareChunks[i][c];
+}
+
+DsdTeeBranch* DsdTeeReader::newBranch()
+{
+	DsdTeeBranch* b = new DsdTeeBranch(this);
+	branches.push_back(b);
+	return b;
+}
+
+bool DsdTeeReader::seek(dsf2flac_int64 pos)
+{
+	// the branches refill their circular buffers with the chars before pos, keep those.
+	dsf2flac_int64 history = 0;
+	for (dsf2flac_uint32 i=0; i<branches.size(); i++)
+		if (branches[i]->getBufferLength() > history)
+			history = branches[i]->getBufferLength();
+	dsf2flac_int64 start = pos/8 - history;
+	if (start < 0)
+		start = 0;
+	// drop everything and restart the source at the chunk holding start
+	while (!chunks.empty()) {
+		spareChunks.push_back(chunks.front());
+		chunks.pop_front();
+	}
+	firstChunk = start / chunkLength;
+	bool ok = source->seek(firstChunk*chunkLength*8);
+	for (dsf2flac_uint32 i=0; i<branches.size(); i++) {
+		branches[i]->chunk = NULL; // it may point at a dropped chunk
+		branches[i]->chunkIdx = -1;
+	}
+	for (dsf2flac_uint32 i=0; i<branches.size(); i++)
+		ok &= branches[i]->seek(pos);
+	return ok;
+}
+
+dsf2flac_uint8** DsdTeeReader::getChunk(dsf2flac_int64 chunkIdx)
+{
+	if (chunkIdx < firstChunk)
+		return NULL;
+	// read from the source until we have the requested chunk
+	while (chunkIdx >= firstChunk + (dsf2flac_int64) chunks.size()) {
+		releaseChunks();
+		std::vector<dsf2flac_uint8*> chunk;
+		if (spareChunks.empty()) {
+			for (dsf2flac_uint32 c=0; c<source->getNumChannels(); c++)
+				chunk.push_back(new dsf2flac_uint8[chunkLength]);
+		} else {
+			chunk = spareChunks.back();
+			spareChunks.pop_back();
+		}
+		// past the end of the data this fills the chunk with the idle sample, just as step() would.
+		source->readBlock(&chunk[0],chunkLength);
+		chunks.push_back(chunk);
+	}
+	return &chunks[chunkIdx - firstChunk][0];
+}
+
+void DsdTeeReader::releaseChunks()
+{
+	if (branches.empty())
+		return;
+	// the oldest chunk still needed by any branch.
+	dsf2flac_int64 needed = -1;
+	for (dsf2flac_uint32 i=0; i<branches.size(); i++) {
+		dsf2flac_int64 p = branches[i]->getPosition() / 8;
+		if (p < 0)
+			p = 0; // a branch that has not started yet (or may still rewind) needs chunk 0.
+		p /= chunkLength;
+		if (needed < 0 || p < needed)
+			needed = p;
+	}
+	while (!chunks.empty() && firstChunk < needed) {
+		spareChunks.push_back(chunks.front());
+		chunks.pop_front();
+		firstChunk++;
+	}
+}
+
+DsdTeeBranch::DsdTeeBranch(DsdTeeReader *t)
+{
+	tee = t;
+	source = t->getSource();
+	samplesPerChar = 8; // 8 samples per char (1 bit per sample)
+	valid = true;
+	errorMsg = "";
+	allocateBuffer();
+	rewind();
+}
+
+DsdTeeBranch::~DsdTeeBranch()
+{
+}
+
+bool DsdTeeBranch::loadChunk(dsf2flac_int64 idx)
+{
+	dsf2flac_int64 c = idx / tee->getChunkLength();
+	if (c != chunkIdx) {
+		chunk = tee->getChunk(c);
+		chunkIdx = c;
+	}
+	return chunk != NULL;
+}
+
+bool DsdTeeBranch::step()
+{
+	bool ok = samplesAvailable();
+	posMarker++;
+
+	if (!loadChunk(posMarker)) {
+		for (dsf2flac_uint32 c=0; c<getNumChannels(); c++)
+			circularBuffers[c].push_front(getIdleSample());
+		return false;
+	}
+
+	dsf2flac_uint32 i = posMarker - chunkIdx * tee->getChunkLength();
+	for (dsf2flac_uint32 c=0; c<getNumChannels(); c++)
+		circularBuffers[c].push_front(chunk[c][i]);
+	return ok;
+}
+
+bool DsdTeeBranch::readBlock(dsf2flac_uint8** buffers, dsf2flac_uint32 n)
+{
+	if (n == 0)
+		return true;
+	// step() would return false from the first char beyond the end of the data.
+	bool ok = (posMarker + n - 1) * samplesPerChar < getLength();
+
+	dsf2flac_uint32 i = 0;
+	while (i<n) {
+		if (!loadChunk(posMarker + 1)) {
+			for (dsf2flac_uint32 c=0; c<getNumChannels(); c++)
+				memset(buffers[c]+i,getIdleSample(),n-i);
+			posMarker += n-i;
+			ok = false;
+			break;
+		}
+		// copy as much as we can out of this chunk
+		dsf2flac_uint32 offset = posMarker + 1 - chunkIdx * tee->getChunkLength();
+		dsf2flac_uint32 m = n - i;
+		if (m > tee->getChunkLength() - offset)
+			m = tee->getChunkLength() - offset;
+		for (dsf2flac_uint32 c=0; c<getNumChannels(); c++)
+			memcpy(buffers[c]+i,chunk[c]+offset,m);
+		posMarker += m;
+		i += m;
+	}
+
+	pushBlockToBuffer(buffers,n);
+	return ok;
+}
+
+bool DsdTeeBranch::jumpTo(dsf2flac_int64 charIdx)
+{
+	if (charIdx / tee->getChunkLength() < tee->getFirstChunk())
+		return false;
+	posMarker = charIdx - 1;
+	chunk = NULL;
+	chunkIdx = -1;
+	clearBuffer();
+	return true;
+}
+
+void DsdTeeBranch::rewind()
+{
+	posMarker = -1;
+	chunk = NULL;
+	chunkIdx = -1;
+	clearBuffer();
+	if (!loadChunk(0)) {
+		valid = false;
+		errorMsg = "DsdTeeBranch::rewind:the start of the data has already been released";
+	}
+}
@@ -0,0 +1,134 @@
+/*
+ * dsf2flac - http://code.google.com/p/dsf2flac/
+ *
+ * A file conversion tool for translating dsf dsd audio files into
+ * flac pcm audio files.
+ *
+ * Copyright (c) 2013 by respective authors.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *
+ * Acknowledgments
+ *
+ * Many thanks to the following authors and projects whose work has greatly
+ * helped the development of this tool.
+ *
+ *
+ * Sebastian Gesemann - dsd2pcm (http://code.google.com/p/dsd2pcm/)
+ * SACD Ripper (http://code.google.com/p/sacd-ripper/)
+ * Maxim V.Anisiutkin - foo_input_sacd (http://sourceforge.net/projects/sacddecoder/files/)
+ * Vladislav Goncharov - foo_input_sacd_hq (http://vladgsound.wordpress.com)
+ * Jesus R - www.sonore.us
+ *
+ */
+
+#ifndef DSDTEEREADER_H
+#define DSDTEEREADER_H
+
+#include <dsd_sample_reader.h>
+#include <deque>
+#include <vector>
+
+class DsdTeeBranch;
+
+/**
+ * Shares one DsdSampleReader between several consumers.
+ *
+ * The source is read once, in chunks, with readBlock(). Each consumer gets its own DsdTeeBranch,
+ * which is a complete DsdSampleReader with its own position and circular buffers, so decimators
+ * and DoP packers can be attached to it as usual. Chunks are kept until every branch has moved past
+ * them, so consumers should be driven roughly in step (always advance the one that is furthest behind).
+ */
+class DsdTeeReader
+{
+public:
+	/// Class constructor. The source is rewound and then only read through this class.
+	DsdTeeReader(DsdSampleReader *source);
+	/// Class destructor, frees the branches and the chunks.
+	virtual ~DsdTeeReader();
+
+	/// Create a new branch reading from the start of the source. The tee owns the branch.
+	DsdTeeBranch* newBranch();
+	/**
+	 * Move every branch to DSD sample pos (see DsdSampleReader::seek).
+	 * Everything held is dropped and the source is moved to just before pos, so this is
+	 * how a branch can start part way into the data without the tee reading what comes before.
+	 */
+	bool seek(dsf2flac_int64 pos);
+	/// Returns the underlying reader.
+	DsdSampleReader* getSource() { return source; };
+
+	/// Returns the chars of chunk chunkIdx (one array per channel), reading from the source if needed.
+	/// Returns NULL if the chunk has already been released.
+	dsf2flac_uint8** getChunk(dsf2flac_int64 chunkIdx);
+	/// The number of chars per channel in each chunk.
+	dsf2flac_uint32 getChunkLength() { return chunkLength; };
+	/// Returns the number of chunks currently held in memory.
+	dsf2flac_uint32 getNumChunksHeld() { return chunks.size(); };
+	/// Returns the index of the oldest chunk still held.
+	dsf2flac_int64 getFirstChunk() { return firstChunk; };
+private:
+	/// Drop the chunks that every branch has finished with.
+	void releaseChunks();
+private:
+	DsdSampleReader *source;
+	dsf2flac_uint32 chunkLength;
+	std::vector<DsdTeeBranch*> branches;
+	std::deque< std::vector<dsf2flac_uint8*> > chunks; // per channel pointers for each chunk
+	std::vector< std::vector<dsf2flac_uint8*> > spareChunks; // released chunks waiting to be reused
+	dsf2flac_int64 firstChunk; // index of chunks.front()
+};
+
+/**
+ * One consumer's view of a DsdTeeReader.
+ */
+class DsdTeeBranch : public DsdSampleReader
+{
+	friend class DsdTeeReader;
+public:
+	/// Class constructor, use DsdTeeReader::newBranch() rather than calling this directly.
+	DsdTeeBranch(DsdTeeReader *tee);
+	/// Class destructor.
+	virtual ~DsdTeeBranch();
+public: // methods overriding dsdSampleReader
+	dsf2flac_uint32 getSamplingFreq() { return source->getSamplingFreq(); };
+	dsf2flac_uint32 getNumChannels() { return source->getNumChannels(); };
+	dsf2flac_int64 getLength() { return source->getLength(); };
+	dsf2flac_uint32 getNumTracks() { return source->getNumTracks(); };
+	dsf2flac_uint64 getTrackStart(dsf2flac_uint32 trackNum) { return source->getTrackStart(trackNum); };
+	dsf2flac_uint64 getTrackEnd(dsf2flac_uint32 trackNum) { return source->getTrackEnd(trackNum); };
+	bool msbIsPlayedFirst() { return source->msbIsPlayedFirst(); };
+	ID3_Tag getID3Tag(dsf2flac_uint32 trackNum) { return source->getID3Tag(trackNum); };
+	dsf2flac_uint8 getIdleSample() { return source->getIdleSample(); };
+	bool step();
+	bool readBlock(dsf2flac_uint8** buffers, dsf2flac_uint32 n);
+	/// Only possible before the branch (or its siblings) has released the first chunk.
+	void rewind();
+	void dispFileInfo() { source->dispFileInfo(); };
+protected:
+	/// Possible while the tee still holds the chunk with charIdx.
+	bool jumpTo(dsf2flac_int64 charIdx);
+private:
+	/// Point chunk at the chunk holding char index idx.
+	bool loadChunk(dsf2flac_int64 idx);
+private:
+	DsdTeeReader *tee;
+	DsdSampleReader *source;
+	dsf2flac_uint8** chunk; // the chunk holding the current position
+	dsf2flac_int64 chunkIdx;
+};
+
+#endif // DSDTEEREADER_H
@@ -38,15 +38,18 @@
 
 #include "dsdiff_file_reader.h"
 #include "iostream"
+#include <string.h>
+#include <vector>
+#include "stage_timer.h"
 #include "libdstdec/dst_init.h"
 #include "libdstdec/dst_fram.h"
-static bool chanIdentsAllocated = false;
-static bool sampleBufferAllocated = false;
-static ebunch dstEbunch;
-static bool dstEbunchAllocated = false;
+
 DsdiffFileReader::DsdiffFileReader(char* filePath) : DsdSampleReader()
 {
 	// set some defaults
+	chanIdentsAllocated = false;
+	sampleBufferAllocated = false;
+	dstEbunch = NULL;
 	ast.hours = 0;
 	ast.minutes = 0;
 	ast.seconds = 0;
@@ -57,6 +60,7 @@ DsdiffFileReader::DsdiffFileReader(char* filePath) : DsdSampleReader()
 	errorMsg = "";
 	lsConfig=65535;
 	isEm=false;
+	this->filePath = filePath;
 	// first let's open the file
 	file.open(filePath, fstreamPlus::in | fstreamPlus::binary);
 	// throw exception if that did not work.
@@ -74,8 +78,8 @@ DsdiffFileReader::DsdiffFileReader(char* filePath) : DsdSampleReader()
 		
 	// if DST data, then initialise the decoder
 	if (checkIdent(compressionType,const_cast<dsf2flac_int8*>("DST "))) {
-		DST_InitDecoder(&dstEbunch, getNumChannels(), getSamplingFreq()/44100);
-		dstEbunchAllocated = true;
+		dstEbunch = new ebunch;
+		DST_InitDecoder(dstEbunch, getNumChannels(), getSamplingFreq()/44100);
 	}
 	
 	rewind(); // calls allocateBlockBuffer
@@ -115,8 +119,9 @@ DsdiffFileReader::~DsdiffFileReader()
 		delete[] emid;
 	
 	// free the DST decoder (assuming one was used)
-	if (dstEbunchAllocated) {
-		DST_CloseDecoder(&dstEbunch);
+	if (dstEbunch) {
+		DST_CloseDecoder(dstEbunch);
+		delete dstEbunch;
 	}
 }
 
@@ -132,19 +137,82 @@ void DsdiffFileReader::rewind()
 {
 	// position the file at the start of the data chunk
 	if (file.seekg(sampleDataPointer)) {
-		errorMsg = "dsfFileReader::rewind:file seek error";
+		errorMsg = "dsfFileReader::rewind:file seek error"; // a stream which has gone too far
+		return;
 	}
 	allocateSampleBuffer();
 	bufferCounter = 0;
 	bufferMarker = 0;
+	posMarker = -1; // readNextBlock works out what is left from this
 	readNextBlock();
 	bufferCounter = 0;
-	posMarker = -1;
 	clearBuffer();
 }
 
+dsf2flac_uint64 DsdiffFileReader::findDstFrame(dsf2flac_uint64 frame)
+{
+	dsf2flac_int8 ident[5];
+	ident[4]='\0';
+	dsf2flac_uint64 chunkSz;
+	// the DSTI chunk, if there is one, says where each frame is. Check that it points at a DSTF chunk.
+	if (frame < dstFrameIndices.size()) {
+		dsf2flac_uint64 offset = dstFrameIndices[frame].offset;
+		if (readChunkHeader(ident,offset,&chunkSz) && checkIdent(ident,const_cast<dsf2flac_int8*>("DSTF")))
+			return offset;
+		// some writers give the position of the frame data rather than its chunk
+		if (offset >= 12 && readChunkHeader(ident,offset-12,&chunkSz) && checkIdent(ident,const_cast<dsf2flac_int8*>("DSTF")))
+			return offset-12;
+	}
+	// otherwise walk the chunk headers on from the last frame found, nothing is decoded
+	if (dstFrameOffsets.empty())
+		dstFrameOffsets.push_back(sampleDataPointer);
+	dsf2flac_uint64 chunkStart = dstFrameOffsets.back();
+	while (dstFrameOffsets.size() <= frame) {
+		// step over this frame and any other chunks (DSTC) before the next
+		if (!readChunkHeader(ident,chunkStart,&chunkSz))
+			return 0;
+		do {
+			chunkStart += chunkSz;
+			if (chunkStart > dstChunkEnd || !readChunkHeader(ident,chunkStart,&chunkSz))
+				return 0;
+		} while (!checkIdent(ident,const_cast<dsf2flac_int8*>("DSTF")));
+		dstFrameOffsets.push_back(chunkStart);
+	}
+	return dstFrameOffsets[frame];
+}
+
+bool DsdiffFileReader::jumpTo(dsf2flac_int64 charIdx)
+{
+	if (file.isForwardOnly())
+		return false;
+	// start at the buffer load holding charIdx: for DSD the chars are interleaved by channel,
+	// each DST frame decodes on its own so it is found and decoded from there.
+	dsf2flac_int64 load = charIdx / sampleBufferLenPerChan;
+	dsf2flac_uint64 loadStart;
+	file.clear();
+	if (checkIdent(compressionType,const_cast<dsf2flac_int8*>("DST "))) {
+		loadStart = findDstFrame(load);
+		if (!loadStart)
+			return false;
+		file.clear();
+	} else
+		loadStart = sampleDataPointer + load*sampleBufferLenPerChan*chanNum;
+	if (file.seekg(loadStart)) {
+		errorMsg = "dsdiffFileReader::jumpTo:file seek error";
+		return false;
+	}
+	posMarker = load*sampleBufferLenPerChan - 1; // readNextBlock works out what is left from this
+	readNextBlock();
+	bufferCounter = load;
+	bufferMarker = charIdx - load*sampleBufferLenPerChan;
+	posMarker = charIdx - 1;
+	clearBuffer();
+	return true;
+}
+
 bool DsdiffFileReader::readNextBlock() {
 	
+	StageScope scope(STAGE_READ);
 	bool ok = true;
 	// return false if this is the end of the file
 	if (!samplesAvailable()) {
@@ -152,20 +220,25 @@ bool DsdiffFileReader::readNextBlock() {
 		ok = false;
 	}
 	
-	dsf2flac_int64 samplesLeft = getLength()-getPosition();
+	// the next char to be read is posMarker+1
+	dsf2flac_int64 samplesLeft = getLength()-(posMarker+1)*samplesPerChar;
 	
 	if (ok && checkIdent(compressionType,const_cast<dsf2flac_int8*>("DSD "))) {
 		if (samplesLeft/samplesPerChar < sampleBufferLenPerChan) {
 			// fill the blockBuffer with the idle sample
 			for (dsf2flac_uint32 i=0; i<chanNum*sampleBufferLenPerChan; i++)
 				sampleBuffer[i] = getIdleSample();
+			StageTimer::count(STAGE_READ, chanNum*samplesLeft/samplesPerChar, 0);
 			if (file.read_uint8(sampleBuffer,chanNum*samplesLeft/samplesPerChar)) {
 				errorMsg = "dsfFileReader::readNextBlock:file read error";
 				ok = false;
 			}
-		} else if (file.read_uint8(sampleBuffer,chanNum*sampleBufferLenPerChan)) {
-			errorMsg = "dsfFileReader::readNextBlock:file read error";
-			ok = false;
+		} else {
+			StageTimer::count(STAGE_READ, (dsf2flac_uint64) chanNum*sampleBufferLenPerChan, 0);
+			if (file.read_uint8(sampleBuffer,chanNum*sampleBufferLenPerChan)) {
+				errorMsg = "dsfFileReader::readNextBlock:file read error";
+				ok = false;
+			}
 		}
 	} else if (ok && checkIdent(compressionType,const_cast<dsf2flac_int8*>("DST "))) {
 		
@@ -182,9 +255,10 @@ bool DsdiffFileReader::readNextBlock() {
 			ok = readChunkHeader(ident,chunkStart,&chunkSz);
 		
 		// we might have a DSTC chunk, which we will ignore
-		if (ok)
-			if (checkIdent(ident,const_cast<dsf2flac_int8*>("DSTC")))
-				ok = readChunkHeader(ident,chunkStart,&chunkSz);
+		if (ok && checkIdent(ident,const_cast<dsf2flac_int8*>("DSTC"))) {
+			chunkStart += chunkSz;
+			ok = readChunkHeader(ident,chunkStart,&chunkSz);
+		}
 				
 		// decode
 		if (ok)
@@ -230,6 +304,54 @@ bool DsdiffFileReader::step()
 	return ok;
 }
 
+bool DsdiffFileReader::readBlock(dsf2flac_uint8** buffers, dsf2flac_uint32 n)
+{
+	bool ok = true;
+	// step() takes real data while posMarker is below this.
+	dsf2flac_int64 charsInFile = (getLength() + samplesPerChar - 1) / samplesPerChar;
+
+	dsf2flac_uint32 i = 0;
+	while (i<n) {
+		if (!samplesAvailable()) {
+			// nothing left, the rest of the block is idle
+			for (dsf2flac_uint16 c=0; c<chanNum; c++)
+				memset(buffers[c]+i,getIdleSample(),n-i);
+			posMarker += n-i;
+			ok = false;
+			break;
+		}
+		if (bufferMarker>=sampleBufferLenPerChan && !readNextBlock()) {
+			// same as a failed step()
+			for (dsf2flac_uint16 c=0; c<chanNum; c++)
+				buffers[c][i] = getIdleSample();
+			posMarker++;
+			i++;
+			ok = false;
+			continue;
+		}
+		// de-interleave as much as we can straight out of the sample buffer
+		dsf2flac_int64 m = n - i;
+		if (m > sampleBufferLenPerChan - bufferMarker)
+			m = sampleBufferLenPerChan - bufferMarker;
+		if (m > charsInFile - posMarker)
+			m = charsInFile - posMarker;
+		if (file.eof())
+			m = 1; // step() would go idle after this char
+		dsf2flac_uint8* src = sampleBuffer + bufferMarker*chanNum;
+		for (dsf2flac_uint16 c=0; c<chanNum; c++) {
+			dsf2flac_uint8* dst = buffers[c]+i;
+			for (dsf2flac_int64 j=0; j<m; j++)
+				dst[j] = src[j*chanNum+c];
+		}
+		bufferMarker += m;
+		posMarker += m;
+		i += m;
+	}
+
+	pushBlockToBuffer(buffers,n);
+	return ok;
+}
+
 dsf2flac_uint64 DsdiffFileReader::getTrackStart(dsf2flac_uint32 trackNum) {
 	if (trackNum >= numTracks)
 		return 0;
@@ -241,6 +363,17 @@ dsf2flac_uint64 DsdiffFileReader::getTrackEnd(dsf2flac_uint32 trackNum) {
 		return getLength();
 	return trackEndPositions[trackNum];
 		
+}
+
+ bool DsdiffFileReader::getRawLayout(DsdRawLayout* layout)
+{
+	// DST frames can't be copied as samples, nor can a stream be opened again.
+	if (!checkIdent(compressionType,const_cast<dsf2flac_int8*>("DSD ")) || file.isForwardOnly())
+		return false;
+	layout->filePath = filePath;
+	layout->dataOffset = sampleDataPointer;
+	layout->blockSzPerChan = 1;
+	return true;
 }
 
  ID3_Tag DsdiffFileReader::getID3Tag(dsf2flac_uint32 trackNum) {
@@ -331,6 +464,9 @@ bool DsdiffFileReader::readChunk_FRM8(dsf2flac_uint64 chunkStart)
 			fprintf(stderr,"WARNING: unknown chunk type: %s\n",ident);
 		// move to the next chunk
 		subChunkStart = subChunkStart + subChunkSz;
+		// a stream can't come back to the sound data, so the chunks after it (markers, tags...) are left unread
+		if (found_dsdt && file.isForwardOnly())
+			break;
 	}
 	// return true if all required chunks are ok.
 	if (!found_fver) {
@@ -470,6 +606,9 @@ bool DsdiffFileReader::readChunk_CHNL(dsf2flac_uint64 chunkStart)
 	}
 	// read channel identifiers
 	chanIdents = new dsf2flac_int8*[chanNum];
+	for (dsf2flac_uint16 i=0; i<chanNum; i++)
+		chanIdents[i] = NULL;
+	chanIdentsAllocated = true;
 	for (dsf2flac_uint16 i=0; i<chanNum; i++) {
 		chanIdents[i] = new dsf2flac_int8[5];
 		if (file.read_int8(chanIdents[i],4)) {
@@ -678,7 +817,8 @@ bool DsdiffFileReader::readChunk_DSTI(dsf2flac_uint64 chunkStart)
 		errorMsg = "dsdiffFileReader::readChunk_DSTI:chunk ident error";
 		return false;
 	}
-	dsf2flac_uint64 n = (chunkSz - 12)/(32+64);
+	// each entry is an 8 byte offset and a 4 byte length
+	dsf2flac_uint64 n = (chunkSz - 12)/(8+4);
 	for (dsf2flac_uint64 i=0; i<n; i++) {
 		DSTFrameIndex in;
 		if (file.read_uint64_rev(&in.offset,1)) {
@@ -929,13 +1069,16 @@ bool DsdiffFileReader::readChunk_DSTF(dsf2flac_uint64 chunkStart)
 		return false;
 	}
 	dsf2flac_uint64 dst_framesize = chunkLen-12;
-	dsf2flac_uint8* dst_data = new dsf2flac_uint8[dst_framesize];
-	if (file.read_uint8_rev(dst_data,dst_framesize)) {
+	std::vector<dsf2flac_uint8> dst_data(dst_framesize);
+	StageTimer::count(STAGE_READ, dst_framesize, 0);
+	if (file.read_uint8_rev(&dst_data[0],dst_framesize)) {
 		errorMsg = "dsdiffFileReader::readChunk_DSTF:file read error";
 		return false;
 	}
 	
-	if (DST_FramDSTDecode(dst_data, sampleBuffer,dst_framesize, dstInfo.numFrames, &dstEbunch))
+	StageScope scope(STAGE_DST_DECODE);
+	StageTimer::count(STAGE_DST_DECODE, dst_framesize, (dsf2flac_uint64) chanNum*sampleBufferLenPerChan*samplesPerChar);
+	if (DST_FramDSTDecode(&dst_data[0], sampleBuffer,dst_framesize, dstInfo.numFrames, dstEbunch))
 		return false;
 	
 	return true;
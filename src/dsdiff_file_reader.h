@@ -40,6 +40,7 @@
 
 #include "dsd_sample_reader.h" // Base class: dsdSampleReader
 #include "fstream_plus.h"
+#include "libdstdec/types.h"
 #include <boost/ptr_container/ptr_vector.hpp>
 
 // this struct holds comments
@@ -103,7 +104,7 @@ class DsdiffFileReader : public DsdSampleReader
 {
 public:
 	/** Class constructor.
-	 *  filePath must be a valid dsdff file location.
+	 *  filePath must be a valid dsdff file location, the reader keeps its own copy.
 	 *  If there is an issue reading or loading the file then isValid() will be false.
 	 */
 	DsdiffFileReader(char* filePath);
@@ -114,6 +115,7 @@ public:
 public:
 	// public overridden from dsdSampleReader
 	bool step();
+	bool readBlock(dsf2flac_uint8** buffers, dsf2flac_uint32 n);
 	void rewind();
 	dsf2flac_int64 getLength() {return sampleCountPerChan;};
 	dsf2flac_uint32 getNumChannels() {return chanNum;};
@@ -124,6 +126,9 @@ public:
 	dsf2flac_uint32 getNumTracks() {return numTracks;}; // the number of audio tracks in the dsd data
 	dsf2flac_uint64 getTrackStart(dsf2flac_uint32 trackNum);// return the index to the first sample of the nth track
 	dsf2flac_uint64 getTrackEnd(dsf2flac_uint32 trackNum); // return the index to the first sample of the nth track
+	bool getRawLayout(DsdRawLayout* layout); // only for uncompressed (DSD) data
+protected:
+	bool jumpTo(dsf2flac_int64 charIdx); // DST frames are found with the DSTI chunk or by their chunk headers
 public: // other public methods
 	/// Can be called to display some useful info to stdout.
 	void dispFileInfo();
@@ -132,6 +137,8 @@ private: // private methods
 	void allocateSampleBuffer();
 	/// Read the next block of samples into the buffer.
 	bool readNextBlock();
+	/// Return the file position of the DSTF chunk of DST frame number frame, 0 if it can't be found.
+	dsf2flac_uint64 findDstFrame(dsf2flac_uint64 frame);
 	/// Finds the number, start and end points of the tracks in the file.
 	/// Must be called after the marker chunks have been read.
 	void processTracks();
@@ -185,12 +192,14 @@ private: // private methods
 	void dispMarker(DsdiffMarker m);
 private:
 	// private variables
+	std::string filePath;
 	fstreamPlus file;
 	// read from the file - these are always present...
 	dsf2flac_uint32 dsdiffVersion;
 	dsf2flac_uint32 samplingFreq;
 	dsf2flac_uint16 chanNum;
 	dsf2flac_int8** chanIdents;
+	bool chanIdentsAllocated;
 	dsf2flac_int8  compressionType[5];
 	dsf2flac_int8* compressionName;
 	DsdiffAst ast;
@@ -205,6 +214,7 @@ private:
 	bool isEm;
 	char* emid;
 	std::vector<DSTFrameIndex> dstFrameIndices;
+	std::vector<dsf2flac_uint64> dstFrameOffsets; // the DSTF chunks found so far by findDstFrame
 	DSTFrameInformation dstInfo;
 	// track info
 	dsf2flac_uint32 numTracks;
@@ -213,6 +223,8 @@ private:
 	
 	// vars to hold the data
 	dsf2flac_uint8* sampleBuffer;
+	bool sampleBufferAllocated;
+	ebunch* dstEbunch; // the DST decoder state, NULL for uncompressed data
 	dsf2flac_uint32 sampleBufferLenPerChan;
 	dsf2flac_int64 bufferCounter; // stores the index to the current blockBuffer
 	dsf2flac_int64 bufferMarker; // stores the current position in the blockBuffer
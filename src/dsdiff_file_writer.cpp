@@ -0,0 +1,156 @@
+/*
+ * dsf2flac - http://code.google.com/p/dsf2flac/
+ *
+ * A file conversion tool for translating dsf dsd audio files into
+ * flac pcm audio files.
+ *
+ * Copyright (c) 2013 by respective authors.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *
+ * Acknowledgments
+ *
+ * Many thanks to the following authors and projects whose work has greatly
+ * helped the development of this tool.
+ *
+ *
+ * Sebastian Gesemann - dsd2pcm (http://code.google.com/p/dsd2pcm/)
+ * SACD Ripper (http://code.google.com/p/sacd-ripper/)
+ * Maxim V.Anisiutkin - foo_input_sacd (http://sourceforge.net/projects/sacddecoder/files/)
+ * Vladislav Goncharov - foo_input_sacd_hq (http://vladgsound.wordpress.com)
+ * Jesus R - www.sonore.us
+ *
+ */
+
+#include "dsdiff_file_writer.h"
+#include <stdio.h>
+#include <string.h>
+
+/// append an n byte big endian number.
+static void put_be(std::vector<dsf2flac_uint8>& v, dsf2flac_uint64 x, int n)
+{
+	for (int i=n-1; i>=0; i--)
+		v.push_back((x >> (8*i)) & 0xff);
+}
+
+static void put_ident(std::vector<dsf2flac_uint8>& v, const char* ident)
+{
+	for (int i=0; i<4; i++)
+		v.push_back(ident[i]);
+}
+
+DsdiffFileWriter::DsdiffFileWriter(DsdSampleReader *r) : DsdFileWriter(r)
+{
+	dataSz = 0;
+}
+
+DsdiffFileWriter::~DsdiffFileWriter()
+{
+}
+
+void DsdiffFileWriter::makeHeader(dsf2flac_uint64 nSamples, dsf2flac_uint64 nChars, std::vector<dsf2flac_uint8>& tag, std::vector<dsf2flac_uint8>& header)
+{
+	dataSz = nChars * nChans;
+
+	// PROP chunk contents
+	std::vector<dsf2flac_uint8> prop;
+	put_ident(prop,"SND ");
+	put_ident(prop,"FS  ");
+	put_be(prop,4,8);
+	put_be(prop,reader->getSamplingFreq(),4);
+	put_ident(prop,"CHNL");
+	put_be(prop,2 + 4*nChans,8);
+	put_be(prop,nChans,2);
+	static const char* stereo[] = {"SLFT","SRGT"};
+	static const char* five[] = {"MLFT","MRGT","C   ","LS  ","RS  "};
+	static const char* six[] = {"MLFT","MRGT","C   ","LFE ","LS  ","RS  "};
+	for (dsf2flac_uint32 c=0; c<nChans; c++) {
+		if (nChans == 2) {
+			put_ident(prop,stereo[c]);
+		} else if (nChans == 5) {
+			put_ident(prop,five[c]);
+		} else if (nChans == 6) {
+			put_ident(prop,six[c]);
+		} else {
+			char ident[5];
+			snprintf(ident,sizeof(ident),"C%03u",c % 1000);
+			put_ident(prop,ident);
+		}
+	}
+	const char* cmprName = "not compressed";
+	put_ident(prop,"CMPR");
+	put_be(prop,4 + 1 + strlen(cmprName),8);
+	put_ident(prop,"DSD ");
+	prop.push_back(strlen(cmprName));
+	prop.insert(prop.end(),cmprName,cmprName + strlen(cmprName));
+	if (prop.size() & 1)
+		prop.push_back(0); // chunks start on even offsets
+
+	// size of everything in the FRM8 chunk
+	dsf2flac_uint64 frm8Sz = 4 + 16 + 12 + prop.size() + 12 + dataSz + (dataSz & 1);
+	if (!tag.empty())
+		frm8Sz += 12 + tag.size() + (tag.size() & 1);
+
+	header.clear();
+	put_ident(header,"FRM8");
+	put_be(header,frm8Sz,8);
+	put_ident(header,"DSD ");
+	// FVER chunk
+	put_ident(header,"FVER");
+	put_be(header,4,8);
+	put_be(header,0x01050000,4); // version 1.5.0.0
+	// PROP chunk
+	put_ident(header,"PROP");
+	put_be(header,prop.size(),8);
+	header.insert(header.end(),prop.begin(),prop.end());
+	// DSD chunk header
+	put_ident(header,"DSD ");
+	put_be(header,dataSz,8);
+}
+
+void DsdiffFileWriter::makeTrailer(std::vector<dsf2flac_uint8>& tag, std::vector<dsf2flac_uint8>& trailer)
+{
+	trailer.clear();
+	if (dataSz & 1)
+		trailer.push_back(0);
+	if (tag.empty())
+		return;
+	put_ident(trailer,"ID3 ");
+	put_be(trailer,tag.size(),8);
+	trailer.insert(trailer.end(),tag.begin(),tag.end());
+	if (tag.size() & 1)
+		trailer.push_back(0);
+}
+
+bool DsdiffFileWriter::canCopy(DsdRawLayout& layout, dsf2flac_uint64 startChar, dsf2flac_uint64 endChar, dsf2flac_uint64* offset, dsf2flac_uint64* len)
+{
+	// any range of byte interleaved data is already what we need.
+	if (layout.blockSzPerChan != 1)
+		return false;
+	*offset = layout.dataOffset + startChar * nChans;
+	*len = (endChar - startChar) * nChans;
+	return true;
+}
+
+bool DsdiffFileWriter::writeChars(const dsf2flac_uint8* const* buffers, dsf2flac_uint32 n)
+{
+	interleaved.resize(n * nChans);
+	dsf2flac_uint8* p = &interleaved[0];
+	for (dsf2flac_uint32 i=0; i<n; i++)
+		for (dsf2flac_uint32 c=0; c<nChans; c++)
+			*p++ = buffers[c][i];
+	return writeAll(&interleaved[0],interleaved.size());
+}
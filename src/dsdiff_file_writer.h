@@ -0,0 +1,68 @@
+/*
+ * dsf2flac - http://code.google.com/p/dsf2flac/
+ *
+ * A file conversion tool for translating dsf dsd audio files into
+ * flac pcm audio files.
+ *
+ * Copyright (c) 2013 by respective authors.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *
+ * Acknowledgments
+ *
+ * Many thanks to the following authors and projects whose work has greatly
+ * helped the development of this tool.
+ *
+ *
+ * Sebastian Gesemann - dsd2pcm (http://code.google.com/p/dsd2pcm/)
+ * SACD Ripper (http://code.google.com/p/sacd-ripper/)
+ * Maxim V.Anisiutkin - foo_input_sacd (http://sourceforge.net/projects/sacddecoder/files/)
+ * Vladislav Goncharov - foo_input_sacd_hq (http://vladgsound.wordpress.com)
+ * Jesus R - www.sonore.us
+ *
+ */
+
+#ifndef DSDIFFFILEWRITER_H
+#define DSDIFFFILEWRITER_H
+
+#include <dsd_file_writer.h>
+
+/**
+ * Writes DSD samples into uncompressed dsdiff (dff) files.
+ *
+ * Samples are byte interleaved in a single DSD chunk. The id3 tag (if any) is stored in
+ * the (unofficial but widely used) ID3 chunk after the sample data.
+ */
+class DsdiffFileWriter : public DsdFileWriter
+{
+public:
+	/// Class constructor.
+	DsdiffFileWriter(DsdSampleReader *reader);
+	/// Class destructor.
+	virtual ~DsdiffFileWriter();
+	const char* getFormatName() { return "DFF"; };
+protected: // methods overriding DsdFileWriter
+	void makeHeader(dsf2flac_uint64 nSamples, dsf2flac_uint64 nChars, std::vector<dsf2flac_uint8>& tag, std::vector<dsf2flac_uint8>& header);
+	void makeTrailer(std::vector<dsf2flac_uint8>& tag, std::vector<dsf2flac_uint8>& trailer);
+	bool canCopy(DsdRawLayout& layout, dsf2flac_uint64 startChar, dsf2flac_uint64 endChar, dsf2flac_uint64* offset, dsf2flac_uint64* len);
+	bool writeChars(const dsf2flac_uint8* const* buffers, dsf2flac_uint32 n);
+	bool msbIsPlayedFirst() { return false; };
+private:
+	std::vector<dsf2flac_uint8> interleaved;	//!< chars waiting to be written.
+	dsf2flac_uint64 dataSz;						//!< size of the DSD chunk data.
+};
+
+#endif // DSDIFFFILEWRITER_H
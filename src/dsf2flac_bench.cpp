@@ -0,0 +1,587 @@
+/*
+ * dsf2flac - http://code.google.com/p/dsf2flac/
+ *
+ * A file conversion tool for translating dsf dsd audio files into
+ * flac pcm audio files.
+ *
+ * Copyright (c) 2013 by respective authors.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *
+ * Acknowledgments
+ *
+ * Many thanks to the following authors and projects whose work has greatly
+ * helped the development of this tool.
+ *
+ *
+ * Sebastian Gesemann - dsd2pcm (http://code.google.com/p/dsd2pcm/)
+ * SACD Ripper (http://code.google.com/p/sacd-ripper/)
+ * Maxim V.Anisiutkin - foo_input_sacd (http://sourceforge.net/projects/sacddecoder/files/)
+ * Vladislav Goncharov - foo_input_sacd_hq (http://vladgsound.wordpress.com)
+ * Jesus R - www.sonore.us
+ *
+ */
+
+/**
+ * dsf2flac_bench
+ *
+ * Measures the speed of the parts of the conversion, so that changes to them can be compared.
+ *
+ * The micro benchmarks run on a test signal made by DsdSignalGenerator, held in memory (or written to temporary files
+ * for the readers): the decimation for each filter (or cascade) and DSD rate, DoP packing, the readers
+ * stepping and reading blocks, and DST decoding of a compressed DSDIFF file given with --dst.
+ * The file benchmarks convert whole files, the test signal and any given on the command line,
+ * and pass them through into the same format. The test signal must be copied directly by the
+ * passthrough, the exit status is 1 if it falls back to reading it.
+ *
+ * Every benchmark is run several times and the fastest run is kept. The results are printed as
+ * JSON, in DSD samples (per channel) per second and as a multiple of real time. Given the output
+ * of an earlier run with --baseline, each result is compared with it and the exit status is 1 if
+ * anything got slower by more than --tolerance percent.
+ */
+
+#include <dsd_sample_reader.h>
+#include <dsd_signal_generator.h>
+#include <dsf_file_reader.h>
+#include <dsdiff_file_reader.h>
+#include <dsf_file_writer.h>
+#include <dsdiff_file_writer.h>
+#include <dsd_decimator.h>
+#include <dop_packer.h>
+#include <conversion_sink.h>
+#include <stage_timer.h>
+#include <cmdline.h>
+#include <boost/filesystem.hpp>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <math.h>
+#include <memory>
+#include <sstream>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+/// The signals of the test signal: a 1kHz and a 1.5kHz sine at -6dB.
+static std::vector<DsdSignal> testSignals()
+{
+	std::vector<DsdSignal> signals(2);
+	DsdSignalGenerator::parseSignal("sine:1000", &signals[0]);
+	DsdSignalGenerator::parseSignal("sine:1500", &signals[1]);
+	return signals;
+}
+
+/// The test signal held in memory.
+static DsdSignalGenerator* newTestSignal(dsf2flac_uint32 fs, dsf2flac_float64 seconds)
+{
+	return new DsdSignalGenerator(fs, seconds, testSignals());
+}
+
+/// The result of one benchmark.
+typedef struct {
+	std::string name;
+	dsf2flac_float64 seconds;			// fastest run
+	dsf2flac_float64 samplesPerSec;		// DSD samples per channel per second
+	dsf2flac_float64 realtimeFactor;
+} BenchResult;
+
+/// One run of a benchmark, returns the seconds taken by the part being measured.
+typedef std::function<dsf2flac_float64 ()> BenchRun;
+
+static std::vector<BenchResult> results;
+static std::string nameFilter;			// only run benchmarks with this in their name
+static dsf2flac_float64 minTime = 1.0;	// seconds to keep repeating each benchmark for
+
+/// Time all of f.
+static dsf2flac_float64 timeIt(std::function<void ()> f)
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	f();
+	return std::chrono::duration<dsf2flac_float64>(std::chrono::steady_clock::now() - start).count();
+}
+
+/// True if the benchmark called name is to be run.
+static bool wanted(const std::string& name)
+{
+	return nameFilter.empty() || name.find(nameFilter) != std::string::npos;
+}
+
+/**
+ * Repeat run (at least three times, then until minTime has passed) and record the fastest.
+ * Each run handles dsdSamples DSD samples per channel at fs.
+ */
+static void bench(const std::string& name, dsf2flac_uint64 dsdSamples, dsf2flac_uint32 fs, BenchRun run)
+{
+	run(); // warm up
+	dsf2flac_float64 best = 1e300;
+	dsf2flac_float64 total = 0;
+	for (dsf2flac_uint32 i=0; i<1000 && (i < 3 || total < minTime); i++) {
+		dsf2flac_float64 t = run();
+		best = std::min(best, t);
+		total += t;
+	}
+	BenchResult r;
+	r.name = name;
+	r.seconds = best;
+	r.samplesPerSec = best > 0 ? dsdSamples / best : 0;
+	r.realtimeFactor = r.samplesPerSec / fs;
+	results.push_back(r);
+	fprintf(stderr, "%-40s %12.4gs %12.4g samples/s %9.1fx realtime\n", name.c_str(), r.seconds, r.samplesPerSec, r.realtimeFactor);
+}
+
+/**
+ * The decimation (and quantisation to 24 bits) for each filter or cascade at each DSD rate, down to 44.1kHz and 48kHz.
+ * The single filters are timed for each --quality preset, named with /fast or /minphase after the rate,
+ * and with the fixed point engine (/fixed, which does not cover the 48kHz family).
+ */
+static void benchDecimators(dsf2flac_float64 seconds)
+{
+	const dsf2flac_uint32 dsdRates[3] = { 2822400, 5644800, 11289600 };
+	const dsf2flac_uint32 ratios[6] = { 8, 16, 32, 64, 128, 256 };
+	const DsdFilterQuality qualities[4] = { DSD_FILTER_REFERENCE, DSD_FILTER_FAST, DSD_FILTER_MINIMUM_PHASE, DSD_FILTER_REFERENCE };
+	const char* qualityNames[4] = { "", "/fast", "/minphase", "/fixed" };
+	for (dsf2flac_uint32 i=0; i<3; i++) {
+		DsdSignalGenerator* reader = NULL;
+		for (dsf2flac_uint32 j=0; j<6; j++) {
+			if (dsdRates[i] / ratios[j] < 44100)
+				break;
+			// each 44.1kHz family rate and the 48kHz family rate resampled from it
+			for (dsf2flac_uint32 k=0; k<2*4; k++) {
+				dsf2flac_uint32 q = k/2;
+				// the cascade is the same for every preset
+				if (q && ratios[j] > 32)
+					break;
+				if (q == 3 && k%2)
+					continue;
+				dsf2flac_uint32 pcmRate = dsdRates[i] / ratios[j] / 147 * (k%2 ? 160 : 147);
+				std::ostringstream name;
+				name << "fir/" << dsdRates[i] << "/" << pcmRate << qualityNames[q];
+				if (!wanted(name.str()))
+					continue;
+				if (!reader)
+					reader = newTestSignal(dsdRates[i], seconds);
+				DsdDecimator dec(reader, pcmRate, qualities[q]);
+				dec.setFixedPoint(q == 3);
+				const dsf2flac_uint32 blockFrames = 4096;
+				dsf2flac_uint64 nBlocks = dec.getLength() / blockFrames;
+				std::vector<dsf2flac_int32> buffer(blockFrames * 2);
+				bench(name.str(), (dsf2flac_uint64) (nBlocks * blockFrames * dec.getDecimationRatio()), dsdRates[i], [&]() {
+					reader->rewind();
+					return timeIt([&]() {
+						for (dsf2flac_uint64 b=0; b<nBlocks; b++)
+							dec.getSamples(&buffer[0], buffer.size(), 8388608.0, 1.0, 8388607.0);
+					});
+				});
+			}
+		}
+		delete reader;
+	}
+}
+
+/// DoP packing, for FLAC (int32 samples) and for wave files (packed 24 bit).
+static void benchDop(dsf2flac_float64 seconds)
+{
+	if (!wanted("dop/int32") && !wanted("dop/packed24"))
+		return;
+	std::unique_ptr<DsdSignalGenerator> signal(newTestSignal(2822400, seconds));
+	DsdSignalGenerator& reader = *signal;
+	DopPacker packer(&reader);
+	const dsf2flac_uint32 blockFrames = 4096;
+	dsf2flac_uint64 nBlocks = reader.getLength() / 16 / blockFrames;
+	if (wanted("dop/int32")) {
+		std::vector<dsf2flac_int32> buffer(blockFrames * 2);
+		bench("dop/int32", nBlocks * blockFrames * 16, 2822400, [&]() {
+			reader.rewind();
+			return timeIt([&]() {
+				for (dsf2flac_uint64 b=0; b<nBlocks; b++)
+					packer.pack_buffer(&buffer[0], buffer.size());
+			});
+		});
+	}
+	if (wanted("dop/packed24")) {
+		std::vector<dsf2flac_uint8> buffer(blockFrames * 2 * 3);
+		bench("dop/packed24", nBlocks * blockFrames * 16, 2822400, [&]() {
+			reader.rewind();
+			return timeIt([&]() {
+				for (dsf2flac_uint64 b=0; b<nBlocks; b++)
+					packer.pack_buffer_24(&buffer[0], blockFrames);
+			});
+		});
+	}
+}
+
+/// Read the whole of reader, with step() or with readBlock().
+static void benchReader(const std::string& name, DsdSampleReader* reader)
+{
+	dsf2flac_int64 nChars = reader->getLength() / 8;
+	if (wanted(name + "/step")) {
+		bench(name + "/step", nChars * 8, reader->getSamplingFreq(), [&]() {
+			reader->rewind();
+			return timeIt([&]() {
+				for (dsf2flac_int64 i=0; i<nChars; i++)
+					reader->step();
+			});
+		});
+	}
+	if (wanted(name + "/block")) {
+		const dsf2flac_uint32 blockChars = 4096;
+		std::vector< std::vector<dsf2flac_uint8> > blocks(reader->getNumChannels(), std::vector<dsf2flac_uint8>(blockChars));
+		std::vector<dsf2flac_uint8*> ptrs(reader->getNumChannels());
+		for (dsf2flac_uint32 c=0; c<ptrs.size(); c++)
+			ptrs[c] = &blocks[c][0];
+		bench(name + "/block", nChars * 8, reader->getSamplingFreq(), [&]() {
+			reader->rewind();
+			return timeIt([&]() {
+				for (dsf2flac_int64 i=0; i<nChars; i+=blockChars)
+					reader->readBlock(&ptrs[0], std::min<dsf2flac_int64>(blockChars, nChars - i));
+			});
+		});
+	}
+}
+
+/// Write the whole of reader to path with writer. Returns false on failure.
+static bool writeFile(DsdFileWriter& writer, const boost::filesystem::path& path)
+{
+	if (!writer.open(path.c_str(), 0)) {
+		fprintf(stderr, "Sorry, can't write %s: %s\n", path.c_str(), writer.getErrorMsg().c_str());
+		return false;
+	}
+	while (!writer.done())
+		if (!writer.write(4096))
+			break;
+	return writer.close();
+}
+
+/// The time spent decoding DST frames while reading the whole of a compressed DSDIFF file.
+static void benchDst(const char* path)
+{
+	if (!wanted("dst/decode"))
+		return;
+	DsdiffFileReader reader((char*) path);
+	if (!reader.isValid()) {
+		fprintf(stderr, "Sorry, can't read %s: %s\n", path, reader.getErrorMsg().c_str());
+		return;
+	}
+	const dsf2flac_uint32 blockChars = 4096;
+	std::vector< std::vector<dsf2flac_uint8> > blocks(reader.getNumChannels(), std::vector<dsf2flac_uint8>(blockChars));
+	std::vector<dsf2flac_uint8*> ptrs(reader.getNumChannels());
+	for (dsf2flac_uint32 c=0; c<ptrs.size(); c++)
+		ptrs[c] = &blocks[c][0];
+	dsf2flac_int64 nChars = reader.getLength() / 8;
+	StageTimer::setEnabled(true);
+	bench("dst/decode", nChars * 8, reader.getSamplingFreq(), [&]() {
+		reader.rewind();
+		StageTotals before[NUM_STAGES], after[NUM_STAGES];
+		StageTimer::getThreadTotals(before);
+		for (dsf2flac_int64 i=0; i<nChars; i+=blockChars)
+			reader.readBlock(&ptrs[0], std::min<dsf2flac_int64>(blockChars, nChars - i));
+		StageTimer::getThreadTotals(after);
+		return (after[STAGE_DST_DECODE].wallNs - before[STAGE_DST_DECODE].wallNs) / 1e9;
+	});
+	StageTimer::setEnabled(false);
+}
+
+/**
+ * Convert the whole of the file at path to 88.2kHz 24 bit FLAC and to DoP FLAC, and pass it through
+ * into the same format, as dsf2flac does. Returns false if mustCopy is set but the passthrough did
+ * not copy the sample data directly.
+ */
+static bool benchFile(const boost::filesystem::path& path, const boost::filesystem::path& tmpDir, bool mustCopy)
+{
+	bool ok = true;
+	const char* kinds[3] = { "flac88200", "dop", "passthrough" };
+	for (dsf2flac_uint32 k=0; k<3; k++) {
+		std::string name = "file/" + path.filename().string() + "/" + kinds[k];
+		if (!wanted(name))
+			continue;
+		DsdSampleReader* reader;
+		if (path.extension() == ".dsf" || path.extension() == ".DSF")
+			reader = new DsfFileReader((char*) path.c_str());
+		else
+			reader = new DsdiffFileReader((char*) path.c_str());
+		if (!reader->isValid()) {
+			fprintf(stderr, "Sorry, can't read %s: %s\n", path.c_str(), reader->getErrorMsg().c_str());
+			delete reader;
+			return ok;
+		}
+		bool dsf = path.extension() == ".dsf" || path.extension() == ".DSF";
+		ConversionSink* sink;
+		DsdFileWriter* writer = NULL;
+		boost::filesystem::path outpath = tmpDir / "out.flac";
+		if (k == 0) {
+			sink = new PcmFlacSink(reader, 88200, 24, true, 1.0);
+		} else if (k == 1) {
+			sink = new DopFlacSink(reader);
+		} else {
+			if (dsf)
+				writer = new DsfFileWriter(reader);
+			else
+				writer = new DsdiffFileWriter(reader);
+			sink = new DsdFileSink(reader, writer);
+			outpath = tmpDir / (dsf ? "out.dsf" : "out.dff");
+		}
+		sink->setVerbose(false);
+		if (sink->isValid()) {
+			dsf2flac_uint64 length = 0;
+			for (dsf2flac_uint32 n=0; n<reader->getNumTracks(); n++)
+				length += reader->getTrackEnd(n) - reader->getTrackStart(n);
+			bool copied = true;
+			bench(name, length, reader->getSamplingFreq(), [&]() {
+				reader->rewind();
+				return timeIt([&]() {
+					for (dsf2flac_uint32 n=0; n<reader->getNumTracks(); n++) {
+						if (!sink->openTrack(n, outpath))
+							break;
+						if (writer && !writer->isCopying())
+							copied = false;
+						while (!sink->trackDone())
+							if (!sink->process())
+								break;
+						sink->closeTrack();
+					}
+				});
+			});
+			if (mustCopy && writer && !copied) {
+				fprintf(stderr, "Sorry, %s did not copy the sample data directly\n", name.c_str());
+				ok = false;
+			}
+		} else {
+			fprintf(stderr, "%-40s skipped: %s\n", name.c_str(), sink->getErrorMsg().c_str());
+		}
+		delete sink;
+		delete reader;
+	}
+	return ok;
+}
+
+/// The results as JSON, one benchmark per line.
+static std::string resultsJson()
+{
+	std::ostringstream s;
+	s << "{\n\"version\": \"" << CMDLINE_PARSER_VERSION << "\",\n";
+	s << "\"threads\": " << std::thread::hardware_concurrency() << ",\n";
+	s << "\"benchmarks\": [\n";
+	char line[512];
+	for (dsf2flac_uint32 i=0; i<results.size(); i++) {
+		snprintf(line, sizeof(line), "{\"name\": %s, \"seconds\": %.6g, \"samples_per_s\": %.6g, \"realtime_factor\": %.6g}%s\n",
+				StageTimer::jsonString(results[i].name).c_str(), results[i].seconds, results[i].samplesPerSec,
+				results[i].realtimeFactor, i + 1 < results.size() ? "," : "");
+		s << line;
+	}
+	s << "]\n}\n";
+	return s.str();
+}
+
+/**
+ * Compare the results with the output of an earlier run, returns the number of benchmarks
+ * which are slower by more than tolerance percent, or -1 if the baseline can't be read.
+ */
+static int compareBaseline(const char* path, dsf2flac_float64 tolerance)
+{
+	std::ifstream in(path);
+	if (!in) {
+		fprintf(stderr, "Sorry, can't read the baseline %s\n", path);
+		return -1;
+	}
+	// our own output has one benchmark per line, so it is enough to pick the two fields out of each line
+	std::map<std::string, dsf2flac_float64> baseline;
+	std::string line;
+	while (std::getline(in, line)) {
+		size_t n = line.find("\"name\": \"");
+		size_t v = line.find("\"samples_per_s\": ");
+		if (n == std::string::npos || v == std::string::npos)
+			continue;
+		n += 9;
+		size_t e = line.find('"', n);
+		if (e == std::string::npos)
+			continue;
+		baseline[line.substr(n, e - n)] = atof(line.c_str() + v + 17);
+	}
+
+	int nSlower = 0;
+	fprintf(stderr, "\nCompared with %s\n", path);
+	for (dsf2flac_uint32 i=0; i<results.size(); i++) {
+		std::map<std::string, dsf2flac_float64>::iterator b = baseline.find(results[i].name);
+		if (b == baseline.end() || b->second <= 0) {
+			fprintf(stderr, "%-40s not in the baseline\n", results[i].name.c_str());
+			continue;
+		}
+		dsf2flac_float64 change = 100 * (results[i].samplesPerSec / b->second - 1);
+		bool slower = change < -tolerance;
+		nSlower += slower;
+		fprintf(stderr, "%-40s %12.4g -> %12.4g samples/s %+7.1f%%%s\n", results[i].name.c_str(), b->second,
+				results[i].samplesPerSec, change, slower ? "  SLOWER" : "");
+	}
+	return nSlower;
+}
+
+/// Write seconds of signals (one per channel) at DSD rate fs to path, a DSDIFF file if it ends with .dff and a DSF file otherwise.
+static int generateFile(const boost::filesystem::path& path, dsf2flac_uint32 fs, dsf2flac_float64 seconds, const std::vector<DsdSignal>& signals, dsf2flac_uint32 order)
+{
+	DsdSignalGenerator generator(fs, seconds, signals, order);
+	if (!generator.isValid()) {
+		fprintf(stderr, "Sorry, %s\n", generator.getErrorMsg().c_str());
+		return 2;
+	}
+	if (generator.getNumResets())
+		fprintf(stderr, "Warning, the modulator overloaded %u times, try a lower level\n", generator.getNumResets());
+	std::unique_ptr<DsdFileWriter> writer;
+	if (path.extension() == ".dff")
+		writer.reset(new DsdiffFileWriter(&generator));
+	else
+		writer.reset(new DsfFileWriter(&generator));
+	return writeFile(*writer, path) ? 0 : 1;
+}
+
+static void usage(const char* prog)
+{
+	fprintf(stderr, "Usage: %s [options] [FILE.dsf|FILE.dff ...]\n\n", prog);
+	fprintf(stderr, "Benchmarks the parts of dsf2flac and prints the results as JSON on stdout.\n\n");
+	fprintf(stderr, "  --filter=TEXT      only run the benchmarks with TEXT in their name (e.g. fir/ or file/)\n");
+	fprintf(stderr, "  --seconds=S        length of the synthetic signal (default 5)\n");
+	fprintf(stderr, "  --min-time=S       repeat each benchmark for at least S seconds (default 1)\n");
+	fprintf(stderr, "  --dst=FILE.dff     a DST compressed DSDIFF file for the DST decoding benchmark\n");
+	fprintf(stderr, "  --baseline=FILE    compare with the output of an earlier run, exit status 1 if slower\n");
+	fprintf(stderr, "  --tolerance=PCT    how much slower than the baseline is allowed (default 5)\n");
+	fprintf(stderr, "  --output=FILE      write the JSON to FILE as well as stdout (to keep as a baseline)\n");
+	fprintf(stderr, "\nInstead of benchmarking, write a test signal to a DSF (or with .dff, DSDIFF) file:\n\n");
+	fprintf(stderr, "  --generate=FILE    the file to write, --seconds long\n");
+	fprintf(stderr, "  --signal=SPEC      one channel's signal, give once per channel (default two sines):\n");
+	fprintf(stderr, "                     sine:FREQ[:DB], sweep:FROM:TO[:DB], noise[:DB] or silence\n");
+	fprintf(stderr, "  --rate=N           DSD64, 128, 256 or 512 (default 64)\n");
+	fprintf(stderr, "  --order=N          order of the sigma delta modulator, 5 to 7 (default 5)\n");
+}
+
+int main(int argc, char **argv)
+{
+	dsf2flac_float64 seconds = 5;
+	dsf2flac_float64 tolerance = 5;
+	std::string dstPath;
+	std::string baselinePath;
+	std::string outputPath;
+	std::vector<boost::filesystem::path> files;
+	std::string generatePath;
+	std::vector<DsdSignal> signals;
+	dsf2flac_uint32 dsdRate = 64;
+	dsf2flac_uint32 order = 5;
+	for (int i=1; i<argc; i++) {
+		std::string arg = argv[i];
+		std::string value;
+		size_t eq = arg.find('=');
+		if (arg.compare(0, 2, "--") == 0 && eq != std::string::npos) {
+			value = arg.substr(eq + 1);
+			arg = arg.substr(0, eq);
+		} else if (arg.compare(0, 2, "--") == 0 && arg != "--help" && i + 1 < argc) {
+			value = argv[++i];
+		}
+		if (arg == "--filter")
+			nameFilter = value;
+		else if (arg == "--seconds")
+			seconds = atof(value.c_str());
+		else if (arg == "--min-time")
+			minTime = atof(value.c_str());
+		else if (arg == "--dst")
+			dstPath = value;
+		else if (arg == "--baseline")
+			baselinePath = value;
+		else if (arg == "--tolerance")
+			tolerance = atof(value.c_str());
+		else if (arg == "--output")
+			outputPath = value;
+		else if (arg == "--generate")
+			generatePath = value;
+		else if (arg == "--signal") {
+			DsdSignal signal;
+			if (!DsdSignalGenerator::parseSignal(value, &signal)) {
+				fprintf(stderr, "Sorry, can't understand the signal %s\n", value.c_str());
+				return 2;
+			}
+			signals.push_back(signal);
+		} else if (arg == "--rate")
+			dsdRate = atoi(value.c_str());
+		else if (arg == "--order")
+			order = atoi(value.c_str());
+		else if (arg.compare(0, 1, "-") != 0)
+			files.push_back(arg);
+		else {
+			usage(argv[0]);
+			return arg == "--help" ? 0 : 2;
+		}
+	}
+	if (seconds <= 0) {
+		fprintf(stderr, "Sorry, --seconds must be more than 0\n");
+		return 2;
+	}
+	if (!generatePath.empty()) {
+		if (signals.empty())
+			signals = testSignals();
+		return generateFile(generatePath, dsdRate * 44100, seconds, signals, order);
+	}
+
+	boost::filesystem::path tmpDir = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("dsf2flac-bench-%%%%%%%%");
+	boost::filesystem::create_directories(tmpDir);
+
+	benchDecimators(seconds);
+	benchDop(seconds);
+
+	// the readers and the whole conversion run on the synthetic signal written to files
+	const char* fileBenches[9] = { "reader/memory/step", "reader/memory/block", "reader/dsf/step", "reader/dsf/block",
+			"reader/dff/step", "reader/dff/block", "file/synthetic.dsf/flac88200", "file/synthetic.dsf/dop",
+			"file/synthetic.dsf/passthrough" };
+	bool ok = true;
+	bool fileBenchWanted = false;
+	for (dsf2flac_uint32 i=0; i<9; i++)
+		fileBenchWanted |= wanted(fileBenches[i]);
+	if (fileBenchWanted) {
+		std::unique_ptr<DsdSignalGenerator> synthetic(newTestSignal(2822400, seconds));
+		DsfFileWriter dsfWriter(synthetic.get());
+		DsdiffFileWriter dffWriter(synthetic.get());
+		boost::filesystem::path dsfPath = tmpDir / "synthetic.dsf";
+		boost::filesystem::path dffPath = tmpDir / "synthetic.dff";
+		if (writeFile(dsfWriter, dsfPath) && writeFile(dffWriter, dffPath)) {
+			benchReader("reader/memory", synthetic.get());
+			DsfFileReader dsf((char*) dsfPath.c_str());
+			benchReader("reader/dsf", &dsf);
+			DsdiffFileReader dff((char*) dffPath.c_str());
+			benchReader("reader/dff", &dff);
+			ok = benchFile(dsfPath, tmpDir, true);
+		}
+	}
+	if (!dstPath.empty())
+		benchDst(dstPath.c_str());
+	for (dsf2flac_uint32 i=0; i<files.size(); i++)
+		benchFile(files[i], tmpDir, false);
+
+	boost::system::error_code ec;
+	boost::filesystem::remove_all(tmpDir, ec);
+
+	std::string json = resultsJson();
+	fputs(json.c_str(), stdout);
+	if (!outputPath.empty()) {
+		std::ofstream out(outputPath.c_str());
+		out << json;
+		if (!out)
+			fprintf(stderr, "Sorry, can't write %s\n", outputPath.c_str());
+	}
+	if (!baselinePath.empty()) {
+		int nSlower = compareBaseline(baselinePath.c_str(), tolerance);
+		if (nSlower)
+			return 1;
+	}
+	return ok ? 0 : 1;
+}
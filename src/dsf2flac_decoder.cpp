@@ -0,0 +1,447 @@
+/*
+ * dsf2flac - http://code.google.com/p/dsf2flac/
+ *
+ * A file conversion tool for translating dsf dsd audio files into
+ * flac pcm audio files.
+ *
+ * Copyright (c) 2013 by respective authors.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *
+ * Acknowledgments
+ *
+ * Many thanks to the following authors and projects whose work has greatly
+ * helped the development of this tool.
+ *
+ *
+ * Sebastian Gesemann - dsd2pcm (http://code.google.com/p/dsd2pcm/)
+ * SACD Ripper (http://code.google.com/p/sacd-ripper/)
+ * Maxim V.Anisiutkin - foo_input_sacd (http://sourceforge.net/projects/sacddecoder/files/)
+ * Vladislav Goncharov - foo_input_sacd_hq (http://vladgsound.wordpress.com)
+ * Jesus R - www.sonore.us
+ *
+ */
+
+#include <dsf2flac_decoder.h>
+#include <dsf_file_reader.h>
+#include <dsdiff_file_reader.h>
+#include <dsd_memory_reader.h>
+#include <dsd_decimator.h>
+#include <dop_packer.h>
+#include <math.h>
+#include <string.h>
+#include <strings.h>
+#include <string>
+#include <vector>
+
+struct dsf2flac_decoder {
+	std::string path;				// the input file
+	DsdSampleReader* reader;
+	DsdDecimator* decimator;		// set for PCM output
+	DopPacker* packer;				// set for DoP output
+	dsf2flac_sample_format format;
+	dsf2flac_filter_quality quality;	// the filters for the next PCM output
+	dsf2flac_uint32 frameRate;		// output frames per second
+	dsf2flac_int64 position;		// the next frame to read
+	dsf2flac_float64 scale;
+	dsf2flac_float64 tpdfDitherPeakAmplitude;
+	dsf2flac_float64 clipAmplitude;
+	std::vector<dsf2flac_uint8> scratch;	// interleaved frames on their way to planar buffers
+	std::string errorMsg;
+};
+
+/// Frees the decimator or packer, ready for a new output format.
+static void clearOutput(dsf2flac_decoder* dec)
+{
+	delete dec->decimator;
+	delete dec->packer;
+	dec->decimator = NULL;
+	dec->packer = NULL;
+	dec->frameRate = 0;
+	dec->position = 0;
+}
+
+/// The frame a DSD sample position falls in, the 48kHz family has a fractional number of DSD samples per frame.
+static dsf2flac_int64 toFrames(dsf2flac_decoder* dec, dsf2flac_int64 dsdPos)
+{
+	return dsdPos * dec->frameRate / dec->reader->getSamplingFreq();
+}
+
+/// True if an output format has been set, otherwise sets the error message.
+static bool hasOutput(dsf2flac_decoder* dec)
+{
+	if (dec->decimator || dec->packer)
+		return true;
+	dec->errorMsg = "no output format has been set";
+	return false;
+}
+
+/// Returns the size in bytes of one sample.
+static dsf2flac_uint32 sampleSize(dsf2flac_sample_format format)
+{
+	switch (format) {
+	case DSF2FLAC_SAMPLE_INT16: return sizeof(dsf2flac_int16);
+	case DSF2FLAC_SAMPLE_INT32: return sizeof(dsf2flac_int32);
+	case DSF2FLAC_SAMPLE_FLOAT32: return sizeof(dsf2flac_float32);
+	default: return sizeof(dsf2flac_float64);
+	}
+}
+
+/// Split interleaved frames into one buffer per channel.
+template <typename sampleType> static void deinterleave(
+		const sampleType* in,
+		void** buffers,
+		dsf2flac_uint32 nChans,
+		dsf2flac_uint32 frames)
+{
+	for (dsf2flac_uint32 c=0; c<nChans; c++) {
+		sampleType* out = (sampleType*) buffers[c];
+		for (dsf2flac_uint32 i=0; i<frames; i++)
+			out[i] = in[i*nChans+c];
+	}
+}
+
+/// A new decoder with no reader yet.
+static dsf2flac_decoder* newDecoder()
+{
+	dsf2flac_decoder* dec = new dsf2flac_decoder;
+	dec->reader = NULL;
+	dec->decimator = NULL;
+	dec->packer = NULL;
+	dec->format = DSF2FLAC_SAMPLE_INT32;
+	dec->quality = DSF2FLAC_FILTER_REFERENCE;
+	dec->frameRate = 0;
+	dec->position = 0;
+	dec->scale = 1;
+	dec->tpdfDitherPeakAmplitude = 0;
+	dec->clipAmplitude = 0;
+	return dec;
+}
+
+/// Keep the reader only if it is valid, otherwise take its error message.
+static dsf2flac_decoder* checkReader(dsf2flac_decoder* dec)
+{
+	if (dec->reader && !dec->reader->isValid()) {
+		dec->errorMsg = dec->reader->getErrorMsg();
+		delete dec->reader;
+		dec->reader = NULL;
+	}
+	return dec;
+}
+
+dsf2flac_decoder* dsf2flac_open(const char* path)
+{
+	dsf2flac_decoder* dec = newDecoder();
+	dec->path = path ? path : "";
+
+	// choose the reader from the extension, as the dsf2flac program does
+	std::string ext = dec->path.size() < 4 ? "" : dec->path.substr(dec->path.size() - 4);
+	if (!strcasecmp(ext.c_str(), ".dsf"))
+		dec->reader = new DsfFileReader((char*) dec->path.c_str());
+	else if (!strcasecmp(ext.c_str(), ".dff"))
+		dec->reader = new DsdiffFileReader((char*) dec->path.c_str());
+	else
+		dec->errorMsg = "only .dsf and .dff files are supported";
+	return checkReader(dec);
+}
+
+dsf2flac_decoder* dsf2flac_open_memory(
+		const dsf2flac_uint8* const* channels,
+		dsf2flac_uint32 num_channels,
+		dsf2flac_uint64 bytes_per_channel,
+		dsf2flac_uint32 dsd_sample_rate,
+		int lsb_first)
+{
+	dsf2flac_decoder* dec = newDecoder();
+	dec->reader = new DsdMemoryReader(channels, num_channels, bytes_per_channel, dsd_sample_rate, lsb_first != 0);
+	return checkReader(dec);
+}
+
+dsf2flac_decoder* dsf2flac_open_memory_interleaved(
+		const dsf2flac_uint8* data,
+		dsf2flac_uint32 num_channels,
+		dsf2flac_uint64 bytes_per_channel,
+		dsf2flac_uint32 block_size,
+		dsf2flac_uint32 dsd_sample_rate,
+		int lsb_first)
+{
+	dsf2flac_decoder* dec = newDecoder();
+	dec->reader = new DsdMemoryReader(data, num_channels, bytes_per_channel, dsd_sample_rate, block_size, lsb_first != 0);
+	return checkReader(dec);
+}
+
+void dsf2flac_close(dsf2flac_decoder* dec)
+{
+	if (!dec)
+		return;
+	clearOutput(dec);
+	delete dec->reader;
+	delete dec;
+}
+
+int dsf2flac_is_valid(dsf2flac_decoder* dec)
+{
+	return dec && dec->reader;
+}
+
+const char* dsf2flac_get_error_msg(dsf2flac_decoder* dec)
+{
+	return dec ? dec->errorMsg.c_str() : "no decoder";
+}
+
+dsf2flac_uint32 dsf2flac_get_num_channels(dsf2flac_decoder* dec)
+{
+	return dsf2flac_is_valid(dec) ? dec->reader->getNumChannels() : 0;
+}
+
+dsf2flac_uint32 dsf2flac_get_dsd_sample_rate(dsf2flac_decoder* dec)
+{
+	return dsf2flac_is_valid(dec) ? dec->reader->getSamplingFreq() : 0;
+}
+
+dsf2flac_float64 dsf2flac_get_length_in_seconds(dsf2flac_decoder* dec)
+{
+	return dsf2flac_is_valid(dec) ? dec->reader->getLengthInSeconds() : 0;
+}
+
+dsf2flac_uint32 dsf2flac_get_num_tracks(dsf2flac_decoder* dec)
+{
+	return dsf2flac_is_valid(dec) ? dec->reader->getNumTracks() : 0;
+}
+
+int dsf2flac_set_pcm_output(
+		dsf2flac_decoder* dec,
+		dsf2flac_uint32 sampleRate,
+		dsf2flac_sample_format format,
+		dsf2flac_uint32 bits,
+		dsf2flac_float64 scaleDB,
+		int dither)
+{
+	if (!dsf2flac_is_valid(dec))
+		return 0;
+	clearOutput(dec);
+
+	bool isInt = format == DSF2FLAC_SAMPLE_INT16 || format == DSF2FLAC_SAMPLE_INT32;
+	if (format < DSF2FLAC_SAMPLE_INT16 || format > DSF2FLAC_SAMPLE_FLOAT64) {
+		dec->errorMsg = "unknown sample format";
+		return 0;
+	}
+	if (isInt && (bits < 2 || bits > 8*sampleSize(format))) {
+		dec->errorMsg = "the number of bits does not fit the sample format";
+		return 0;
+	}
+	if (sampleRate == 0) {
+		dec->errorMsg = "Sorry, incompatible sample rate combination";
+		return 0;
+	}
+	DsdDecimator* decimator = new DsdDecimator(dec->reader, sampleRate, (DsdFilterQuality) dec->quality);
+	if (!decimator->isValid()) {
+		dec->errorMsg = decimator->getErrorMsg();
+		delete decimator;
+		return 0;
+	}
+
+	// scale, dither and clip exactly as the flac output does
+	dsf2flac_float64 userScale = pow(10.0, scaleDB / 20);
+	if (isInt) {
+		dec->scale = userScale * pow(2.0, bits - 1);
+		dec->tpdfDitherPeakAmplitude = dither ? 1.0 : 0.0;
+		dec->clipAmplitude = pow(2.0, bits - 1) - 1;
+	} else {
+		dec->scale = userScale;
+		dec->tpdfDitherPeakAmplitude = 0;
+		dec->clipAmplitude = 0;
+	}
+	dec->decimator = decimator;
+	dec->format = format;
+	dec->frameRate = sampleRate;
+	return dsf2flac_seek(dec, 0);
+}
+
+int dsf2flac_set_filter_quality(dsf2flac_decoder* dec, dsf2flac_filter_quality quality)
+{
+	if (!dec)
+		return 0;
+	if (quality < DSF2FLAC_FILTER_REFERENCE || quality > DSF2FLAC_FILTER_MINIMUM_PHASE) {
+		dec->errorMsg = "unknown filter quality";
+		return 0;
+	}
+	dec->quality = quality;
+	return 1;
+}
+
+int dsf2flac_set_dop_output(dsf2flac_decoder* dec)
+{
+	if (!dsf2flac_is_valid(dec))
+		return 0;
+	clearOutput(dec);
+	dec->packer = new DopPacker(dec->reader);
+	dec->format = DSF2FLAC_SAMPLE_INT32;
+	dec->frameRate = dec->reader->getSamplingFreq() / 16;
+	return dsf2flac_seek(dec, 0);
+}
+
+dsf2flac_uint32 dsf2flac_get_sample_rate(dsf2flac_decoder* dec)
+{
+	if (!dsf2flac_is_valid(dec) || !dec->frameRate)
+		return 0;
+	return dec->frameRate;
+}
+
+dsf2flac_sample_format dsf2flac_get_sample_format(dsf2flac_decoder* dec)
+{
+	return dec ? dec->format : DSF2FLAC_SAMPLE_INT32;
+}
+
+dsf2flac_int64 dsf2flac_get_length(dsf2flac_decoder* dec)
+{
+	if (!dsf2flac_is_valid(dec) || !dec->frameRate)
+		return 0;
+	return toFrames(dec, dec->reader->getLength());
+}
+
+dsf2flac_int64 dsf2flac_get_track_start(dsf2flac_decoder* dec, dsf2flac_uint32 track)
+{
+	if (!dsf2flac_is_valid(dec) || !dec->frameRate || track >= dec->reader->getNumTracks())
+		return 0;
+	return toFrames(dec, dec->reader->getTrackStart(track));
+}
+
+dsf2flac_int64 dsf2flac_get_track_end(dsf2flac_decoder* dec, dsf2flac_uint32 track)
+{
+	if (!dsf2flac_is_valid(dec) || !dec->frameRate || track >= dec->reader->getNumTracks())
+		return 0;
+	dsf2flac_int64 end = toFrames(dec, dec->reader->getTrackEnd(track));
+	if (end > dsf2flac_get_length(dec))
+		end = dsf2flac_get_length(dec);
+	return end;
+}
+
+int dsf2flac_seek(dsf2flac_decoder* dec, dsf2flac_int64 frame)
+{
+	if (!dsf2flac_is_valid(dec) || !hasOutput(dec))
+		return 0;
+	if (frame < 0 || frame > dsf2flac_get_length(dec)) {
+		dec->errorMsg = "seek beyond the end of the file";
+		return 0;
+	}
+	// the reader position is that of the newest char in the buffers, which is the one
+	// before the char seek() leaves next.
+	dsf2flac_int64 readerPos = frame * dec->reader->getSamplingFreq() / dec->frameRate + 8;
+	if (dec->decimator)
+		readerPos += dec->decimator->getFilterDelay();
+	if (!dec->reader->seek(readerPos) && readerPos <= dec->reader->getLength()) {
+		dec->errorMsg = "can't read up to the seek position";
+		return 0;
+	}
+	dec->position = frame;
+	return 1;
+}
+
+dsf2flac_int64 dsf2flac_tell(dsf2flac_decoder* dec)
+{
+	return dec ? dec->position : 0;
+}
+
+dsf2flac_int64 dsf2flac_read(dsf2flac_decoder* dec, void* buffer, dsf2flac_uint32 frames)
+{
+	if (!dsf2flac_is_valid(dec) || !hasOutput(dec))
+		return -1;
+	dsf2flac_int64 left = dsf2flac_get_length(dec) - dec->position;
+	if (frames > left)
+		frames = left;
+	if (frames == 0)
+		return 0;
+
+	dsf2flac_uint32 n = frames * dec->reader->getNumChannels();
+	if (dec->packer) {
+		dec->packer->pack_buffer((dsf2flac_int32*) buffer, n);
+	} else {
+		DsdDecimator* d = dec->decimator;
+		switch (dec->format) {
+		case DSF2FLAC_SAMPLE_INT16:
+			d->getSamples((dsf2flac_int16*) buffer, n, dec->scale, dec->tpdfDitherPeakAmplitude, dec->clipAmplitude);
+			break;
+		case DSF2FLAC_SAMPLE_INT32:
+			d->getSamples((dsf2flac_int32*) buffer, n, dec->scale, dec->tpdfDitherPeakAmplitude, dec->clipAmplitude);
+			break;
+		case DSF2FLAC_SAMPLE_FLOAT32:
+			d->getSamples((dsf2flac_float32*) buffer, n, dec->scale, dec->tpdfDitherPeakAmplitude, dec->clipAmplitude);
+			break;
+		default:
+			d->getSamples((dsf2flac_float64*) buffer, n, dec->scale, dec->tpdfDitherPeakAmplitude, dec->clipAmplitude);
+			break;
+		}
+	}
+	dec->position += frames;
+	return frames;
+}
+
+dsf2flac_int64 dsf2flac_read_planar(dsf2flac_decoder* dec, void** buffers, dsf2flac_uint32 frames)
+{
+	if (!dsf2flac_is_valid(dec) || !hasOutput(dec))
+		return -1;
+	dsf2flac_uint32 nChans = dec->reader->getNumChannels();
+	if (!dec->packer) {
+		// the decimator writes each channel straight into its buffer.
+		dsf2flac_int64 left = dsf2flac_get_length(dec) - dec->position;
+		if (frames > left)
+			frames = left;
+		if (frames == 0)
+			return 0;
+		DsdDecimator* d = dec->decimator;
+		switch (dec->format) {
+		case DSF2FLAC_SAMPLE_INT16:
+			d->getSamplesPlanar((dsf2flac_int16**) buffers, frames, dec->scale, dec->tpdfDitherPeakAmplitude, dec->clipAmplitude);
+			break;
+		case DSF2FLAC_SAMPLE_INT32:
+			d->getSamplesPlanar((dsf2flac_int32**) buffers, frames, dec->scale, dec->tpdfDitherPeakAmplitude, dec->clipAmplitude);
+			break;
+		case DSF2FLAC_SAMPLE_FLOAT32:
+			d->getSamplesPlanar((dsf2flac_float32**) buffers, frames, dec->scale, dec->tpdfDitherPeakAmplitude, dec->clipAmplitude);
+			break;
+		default:
+			d->getSamplesPlanar((dsf2flac_float64**) buffers, frames, dec->scale, dec->tpdfDitherPeakAmplitude, dec->clipAmplitude);
+			break;
+		}
+		dec->position += frames;
+		return frames;
+	}
+
+	// DoP is packed interleaved, so split it up afterwards.
+	dsf2flac_uint32 size = sampleSize(dec->format);
+	if (dec->scratch.size() < (size_t) frames * nChans * size)
+		dec->scratch.resize((size_t) frames * nChans * size);
+
+	dsf2flac_int64 n = dsf2flac_read(dec, &dec->scratch[0], frames);
+	if (n <= 0)
+		return n;
+	switch (dec->format) {
+	case DSF2FLAC_SAMPLE_INT16:
+		deinterleave((dsf2flac_int16*) &dec->scratch[0], buffers, nChans, n);
+		break;
+	case DSF2FLAC_SAMPLE_INT32:
+		deinterleave((dsf2flac_int32*) &dec->scratch[0], buffers, nChans, n);
+		break;
+	case DSF2FLAC_SAMPLE_FLOAT32:
+		deinterleave((dsf2flac_float32*) &dec->scratch[0], buffers, nChans, n);
+		break;
+	default:
+		deinterleave((dsf2flac_float64*) &dec->scratch[0], buffers, nChans, n);
+		break;
+	}
+	return n;
+}
@@ -0,0 +1,187 @@
+/*
+ * dsf2flac - http://code.google.com/p/dsf2flac/
+ *
+ * A file conversion tool for translating dsf dsd audio files into
+ * flac pcm audio files.
+ *
+ * Copyright (c) 2013 by respective authors.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *
+ * Acknowledgments
+ *
+ * Many thanks to the following authors and projects whose work has greatly
+ * helped the development of this tool.
+ *
+ *
+ * Sebastian Gesemann - dsd2pcm (http://code.google.com/p/dsd2pcm/)
+ * SACD Ripper (http://code.google.com/p/sacd-ripper/)
+ * Maxim V.Anisiutkin - foo_input_sacd (http://sourceforge.net/projects/sacddecoder/files/)
+ * Vladislav Goncharov - foo_input_sacd_hq (http://vladgsound.wordpress.com)
+ * Jesus R - www.sonore.us
+ *
+ */
+
+/**
+ * dsf2flac_decoder.h
+ *
+ * The C interface of libdsf2flac, for decoding DSF and DSDIFF files inside another program.
+ *
+ * A decoder is opened on a file (or on DSD samples in memory), given an output format with dsf2flac_set_pcm_output or
+ * dsf2flac_set_dop_output, and then read from like a stream of frames (one sample for each
+ * channel). Frames are counted from the start of the file at the output rate, so a track
+ * runs from dsf2flac_get_track_start to dsf2flac_get_track_end and any frame can be sought to.
+ *
+ * PCM frames are the output of the same filters the dsf2flac program uses, with the filter
+ * delay taken out so that frame n is the audio at time n / sample rate.
+ * DoP frames are 24 bit DoP words (16 DSD samples each) held in int32 samples.
+ *
+ * A decoder must only be used by one thread at a time, different decoders are independent.
+ */
+
+#ifndef DSF2FLACDECODER_H
+#define DSF2FLACDECODER_H
+
+#include "dsf2flac_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// A decoder reading one DSF or DSDIFF file.
+typedef struct dsf2flac_decoder dsf2flac_decoder;
+
+/// The type of the samples written into the caller's buffers.
+typedef enum {
+	DSF2FLAC_SAMPLE_INT16 = 0,		//!< dsf2flac_int16
+	DSF2FLAC_SAMPLE_INT32 = 1,		//!< dsf2flac_int32
+	DSF2FLAC_SAMPLE_FLOAT32 = 2,	//!< dsf2flac_float32, full scale is +-1
+	DSF2FLAC_SAMPLE_FLOAT64 = 3		//!< dsf2flac_float64, full scale is +-1
+} dsf2flac_sample_format;
+
+/// The built-in filter sets for PCM output (see dsf2flac --quality).
+typedef enum {
+	DSF2FLAC_FILTER_REFERENCE = 0,		//!< long linear phase filters, the deepest stop band
+	DSF2FLAC_FILTER_FAST = 1,			//!< linear phase with about half the taps, for previews
+	DSF2FLAC_FILTER_MINIMUM_PHASE = 2	//!< minimum phase, about a third of the delay, for real time use
+} dsf2flac_filter_quality;
+
+/**
+ * Open a .dsf or .dff file. A decoder is returned even if the file can't be read,
+ * check it with dsf2flac_is_valid and free it with dsf2flac_close either way.
+ */
+dsf2flac_decoder* dsf2flac_open(const char* path);
+/**
+ * Open DSD samples held in memory, channels[c] holding bytes_per_channel bytes of channel c.
+ * lsb_first is 1 if the first sample of each byte is in its lowest bit (as in DSF files) and
+ * 0 if it is in the top bit (as in DSDIFF files). The samples are not copied, they must stay
+ * in place until dsf2flac_close. Check the decoder with dsf2flac_is_valid as for dsf2flac_open.
+ */
+dsf2flac_decoder* dsf2flac_open_memory(
+		const dsf2flac_uint8* const* channels,
+		dsf2flac_uint32 num_channels,
+		dsf2flac_uint64 bytes_per_channel,
+		dsf2flac_uint32 dsd_sample_rate,
+		int lsb_first);
+/**
+ * Same as dsf2flac_open_memory for interleaved samples: block_size bytes of each channel in turn,
+ * 4096 for the sample data of a DSF file and 1 for that of a DSDIFF file.
+ */
+dsf2flac_decoder* dsf2flac_open_memory_interleaved(
+		const dsf2flac_uint8* data,
+		dsf2flac_uint32 num_channels,
+		dsf2flac_uint64 bytes_per_channel,
+		dsf2flac_uint32 block_size,
+		dsf2flac_uint32 dsd_sample_rate,
+		int lsb_first);
+/// Close the file and free the decoder.
+void dsf2flac_close(dsf2flac_decoder* dec);
+
+/// Returns 0 if the file could not be opened, the other calls then fail.
+int dsf2flac_is_valid(dsf2flac_decoder* dec);
+/// Describes why the file could not be opened, or why the last call failed.
+const char* dsf2flac_get_error_msg(dsf2flac_decoder* dec);
+
+/// The number of audio channels.
+dsf2flac_uint32 dsf2flac_get_num_channels(dsf2flac_decoder* dec);
+/// The DSD sample rate of the file in Hz.
+dsf2flac_uint32 dsf2flac_get_dsd_sample_rate(dsf2flac_decoder* dec);
+/// The length of the file in seconds.
+dsf2flac_float64 dsf2flac_get_length_in_seconds(dsf2flac_decoder* dec);
+/// The number of tracks in the file, 1 unless it is an edited master DSDIFF file.
+dsf2flac_uint32 dsf2flac_get_num_tracks(dsf2flac_decoder* dec);
+
+/**
+ * Decode to PCM at sample_rate, the DSD rate divided by a power of two of 8 or more (352800,
+ * 176400, 88200, 44100 Hz... for DSD64, from 705600 Hz down for DSD128 and so on), or the
+ * 48kHz family rate 160/147 times one of those (384000, 192000, 96000, 48000 Hz... for DSD64).
+ * Integer samples are scaled so that full scale uses bits bits (at most 16 for int16 and
+ * 32 for int32) and are clipped to that range; TPDF dither of one lsb is added if dither is
+ * not 0. scale_db adjusts the level, raw DSD peaks about 6dB below full scale (dsf2flac uses 4dB).
+ * The position is set to frame 0. Returns 0 (see dsf2flac_get_error_msg) if the format is not supported.
+ */
+int dsf2flac_set_pcm_output(
+		dsf2flac_decoder* dec,
+		dsf2flac_uint32 sample_rate,
+		dsf2flac_sample_format format,
+		dsf2flac_uint32 bits,
+		dsf2flac_float64 scale_db,
+		int dither);
+/**
+ * Choose the filters used from the next dsf2flac_set_pcm_output on, DSF2FLAC_FILTER_REFERENCE
+ * unless set. They apply to rates of 1/8, 1/16 and 1/32 of the DSD rate (and the 48kHz family
+ * rates above them), lower rates always use the same cascade. Returns 0 for an unknown quality.
+ */
+int dsf2flac_set_filter_quality(dsf2flac_decoder* dec, dsf2flac_filter_quality quality);
+/**
+ * Pack the DSD samples into DoP frames, read as DSF2FLAC_SAMPLE_INT32 with the 24 bit DoP word
+ * in the low bits. The frame rate is the DSD sample rate / 16. The position is set to frame 0.
+ */
+int dsf2flac_set_dop_output(dsf2flac_decoder* dec);
+
+/// The number of output frames per second.
+dsf2flac_uint32 dsf2flac_get_sample_rate(dsf2flac_decoder* dec);
+/// The type of the output samples.
+dsf2flac_sample_format dsf2flac_get_sample_format(dsf2flac_decoder* dec);
+/// The length of the output in frames.
+dsf2flac_int64 dsf2flac_get_length(dsf2flac_decoder* dec);
+/// The first frame of track (counting from 0).
+dsf2flac_int64 dsf2flac_get_track_start(dsf2flac_decoder* dec, dsf2flac_uint32 track);
+/// The frame after the last frame of track (counting from 0).
+dsf2flac_int64 dsf2flac_get_track_end(dsf2flac_decoder* dec, dsf2flac_uint32 track);
+
+/// Move to frame, returns 0 if the decoder has no output format or frame is out of range.
+int dsf2flac_seek(dsf2flac_decoder* dec, dsf2flac_int64 frame);
+/// The next frame to be read.
+dsf2flac_int64 dsf2flac_tell(dsf2flac_decoder* dec);
+
+/**
+ * Read up to frames frames into buffer, interleaved by channel. buffer must have room for
+ * frames * dsf2flac_get_num_channels() samples of the output format.
+ * Returns the number of frames read, 0 at the end of the file and -1 on error.
+ */
+dsf2flac_int64 dsf2flac_read(dsf2flac_decoder* dec, void* buffer, dsf2flac_uint32 frames);
+/**
+ * Same as dsf2flac_read but writes each channel c into its own buffer, buffers[c],
+ * which must have room for frames samples of the output format.
+ */
+dsf2flac_int64 dsf2flac_read_planar(dsf2flac_decoder* dec, void** buffers, dsf2flac_uint32 frames);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // DSF2FLACDECODER_H
@@ -36,12 +36,13 @@
  */
 
 #include <dsf_file_reader.h>
-
-static bool blockBufferAllocated = false;
+#include <stage_timer.h>
+#include <string.h>
 
 DsfFileReader::DsfFileReader(char* filePath) : DsdSampleReader()
 {
 	this->filePath = filePath;
+	blockBufferAllocated = false;
 	// first let's open the file
 	file.open(filePath, fstreamPlus::in | fstreamPlus::binary);
 	// throw exception if that did not work.
@@ -102,9 +103,65 @@ bool DsfFileReader::step()
 	return ok;
 }
 
+bool DsfFileReader::readBlock(dsf2flac_uint8** buffers, dsf2flac_uint32 n)
+{
+	bool ok = true;
+	// step() takes real data while posMarker is below this.
+	dsf2flac_int64 charsInFile = (getLength() + samplesPerChar - 1) / samplesPerChar;
+
+	dsf2flac_uint32 i = 0;
+	while (i<n) {
+		if (!samplesAvailable()) {
+			// nothing left, the rest of the block is idle
+			for (dsf2flac_uint32 c=0; c<chanNum; c++)
+				memset(buffers[c]+i,getIdleSample(),n-i);
+			posMarker += n-i;
+			ok = false;
+			break;
+		}
+		if (blockMarker>=blockSzPerChan && !readNextBlock()) {
+			// same as a failed step()
+			for (dsf2flac_uint32 c=0; c<chanNum; c++)
+				buffers[c][i] = getIdleSample();
+			posMarker++;
+			i++;
+			ok = false;
+			continue;
+		}
+		// copy as much as we can straight out of the block buffer
+		dsf2flac_int64 m = n - i;
+		if (m > blockSzPerChan - blockMarker)
+			m = blockSzPerChan - blockMarker;
+		if (m > charsInFile - posMarker)
+			m = charsInFile - posMarker;
+		if (file.eof())
+			m = 1; // step() would go idle after this char
+		for (dsf2flac_uint32 c=0; c<chanNum; c++)
+			memcpy(buffers[c]+i,blockBuffer[c]+blockMarker,m);
+		blockMarker += m;
+		posMarker += m;
+		i += m;
+	}
+
+	pushBlockToBuffer(buffers,n);
+	return ok;
+}
+
+bool DsfFileReader::getRawLayout(DsdRawLayout* layout)
+{
+	// a stream can't be opened again
+	if (file.isForwardOnly())
+		return false;
+	layout->filePath = filePath;
+	layout->dataOffset = sampleDataPointer;
+	layout->blockSzPerChan = blockSzPerChan;
+	return true;
+}
+
 void DsfFileReader::rewind()
 {
 	// position the file at the start of the data chunk
+	file.clear(); // the end of the file may have been reached
 	if (file.seekg(sampleDataPointer)) {
 		errorMsg = "dsfFileReader::readFirstBlock:file seek error";
 		return;
@@ -112,13 +169,31 @@ void DsfFileReader::rewind()
 	allocateBlockBuffer();
 	blockCounter = 0;
 	blockMarker = 0;
+	posMarker = -1; // before readNextBlock(), which checks samplesAvailable()
 	readNextBlock();
 	blockCounter = 0;
-	posMarker = -1;
 	clearBuffer();
 	return;
 }
 
+bool DsfFileReader::jumpTo(dsf2flac_int64 charIdx)
+{
+	// the channels are stored in blocks, so start at the block holding charIdx
+	dsf2flac_int64 block = charIdx / blockSzPerChan;
+	file.clear();
+	if (file.seekg(sampleDataPointer + block*blockSzPerChan*chanNum)) {
+		errorMsg = "dsfFileReader::jumpTo:file seek error";
+		return false;
+	}
+	posMarker = block*blockSzPerChan - 1;
+	readNextBlock();
+	blockCounter = block;
+	blockMarker = charIdx - block*blockSzPerChan;
+	posMarker = charIdx - 1;
+	clearBuffer();
+	return true;
+}
+
 bool DsfFileReader::readNextBlock()
 {
 	// return false if this is the end of the file
@@ -131,6 +206,8 @@ bool DsfFileReader::readNextBlock()
 		return false;
 	}
 
+	StageScope scope(STAGE_READ);
+	StageTimer::count(STAGE_READ, (dsf2flac_uint64) chanNum*blockSzPerChan, 0);
 	for (dsf2flac_uint32 i=0; i<chanNum; i++) {
 		if (file.read_uint8(blockBuffer[i],blockSzPerChan)) {
 			// if read failed fill the blockBuffer with the idle sample
@@ -303,8 +380,8 @@ void DsfFileReader::allocateBlockBuffer()
 void DsfFileReader::readMetadata()
 {
 
-	// zero if no metadata
-	if (metaChunkPointer == 0) {
+	// zero if no metadata, a stream would have to read past the samples to get to it.
+	if (metaChunkPointer == 0 || file.isForwardOnly()) {
 		return;
 	}
 
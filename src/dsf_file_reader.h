@@ -52,7 +52,7 @@ class DsfFileReader : public DsdSampleReader
 {
 public:
 	/** Class constructor.
-	 *  filePath must be a valid dsf file location.
+	 *  filePath must be a valid dsf file location, the reader keeps its own copy.
 	 *  If there is an issue reading or loading the file then isValid() will be false.
 	 */
 	DsfFileReader(char* filePath);
@@ -64,12 +64,16 @@ public: // methods overriding dsdSampleReader
 
 	dsf2flac_uint32 getSamplingFreq() {return samplingFreq;};
 	bool step();
+	bool readBlock(dsf2flac_uint8** buffers, dsf2flac_uint32 n);
 	void rewind();
 	dsf2flac_int64 getLength() {return sampleCount;};
 	dsf2flac_uint32 getNumChannels() {return chanNum;};
 	bool msbIsPlayedFirst() { return true;}
 	bool samplesAvailable() { return !file.eof() && DsdSampleReader::samplesAvailable(); }; // false when no more samples left
 	ID3_Tag getID3Tag(dsf2flac_uint32 trackNum) {return metadata;}
+	bool getRawLayout(DsdRawLayout* layout);
+protected:
+	bool jumpTo(dsf2flac_int64 charIdx);
 public:
 	/// Can be called to display some useful info to stdout.
 	void dispFileInfo();
@@ -86,7 +90,7 @@ private:
 	static bool checkIdent(dsf2flac_int8* a, dsf2flac_int8* b); // MUST be used with the char[4]s or you'll get segfaults!
 private:
 	// private variables
-	char* filePath;
+	std::string filePath;
 	fstreamPlus file;
 	// below store file info
 	dsf2flac_uint64 fileSz;
@@ -103,6 +107,7 @@ private:
 	ID3_Tag metadata;
 	// vars to hold the data and mark position
 	dsf2flac_uint8** blockBuffer; // used to store blocks of raw data from the file
+	bool blockBufferAllocated;
 	dsf2flac_int64 blockCounter; // stores the index to the current blockBuffer
 	dsf2flac_int64 blockMarker; // stores the current position in the blockBuffer
 };
@@ -0,0 +1,155 @@
+/*
+ * dsf2flac - http://code.google.com/p/dsf2flac/
+ *
+ * A file conversion tool for translating dsf dsd audio files into
+ * flac pcm audio files.
+ *
+ * Copyright (c) 2013 by respective authors.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *
+ * Acknowledgments
+ *
+ * Many thanks to the following authors and projects whose work has greatly
+ * helped the development of this tool.
+ *
+ *
+ * Sebastian Gesemann - dsd2pcm (http://code.google.com/p/dsd2pcm/)
+ * SACD Ripper (http://code.google.com/p/sacd-ripper/)
+ * Maxim V.Anisiutkin - foo_input_sacd (http://sourceforge.net/projects/sacddecoder/files/)
+ * Vladislav Goncharov - foo_input_sacd_hq (http://vladgsound.wordpress.com)
+ * Jesus R - www.sonore.us
+ *
+ */
+
+#include "dsf_file_writer.h"
+#include <string.h>
+
+static const dsf2flac_uint32 dsfBlockSzPerChan = 4096;
+
+/// append an n byte little endian number.
+static void put_le(std::vector<dsf2flac_uint8>& v, dsf2flac_uint64 x, int n)
+{
+	for (int i=0; i<n; i++)
+		v.push_back((x >> (8*i)) & 0xff);
+}
+
+static void put_ident(std::vector<dsf2flac_uint8>& v, const char* ident)
+{
+	for (int i=0; i<4; i++)
+		v.push_back(ident[i]);
+}
+
+DsfFileWriter::DsfFileWriter(DsdSampleReader *r) : DsdFileWriter(r)
+{
+	block.resize(nChans*dsfBlockSzPerChan);
+	blockFill = 0;
+}
+
+DsfFileWriter::~DsfFileWriter()
+{
+}
+
+void DsfFileWriter::makeHeader(dsf2flac_uint64 nSamples, dsf2flac_uint64 nChars, std::vector<dsf2flac_uint8>& tag, std::vector<dsf2flac_uint8>& header)
+{
+	dsf2flac_uint64 dataSz = (nChars + dsfBlockSzPerChan - 1) / dsfBlockSzPerChan * dsfBlockSzPerChan * nChans;
+	dsf2flac_uint64 metaPointer = tag.empty() ? 0 : 28 + 52 + 12 + dataSz;
+	// channel type, see the dsf spec
+	dsf2flac_uint32 chanType;
+	switch (nChans) {
+		case 1: chanType = 1; break; // mono
+		case 2: chanType = 2; break; // stereo
+		case 3: chanType = 3; break; // 3 channels
+		case 4: chanType = 4; break; // quad
+		case 5: chanType = 6; break; // 5 channels
+		case 6: chanType = 7; break; // 5.1 channels
+		default: chanType = 2;
+	}
+
+	header.clear();
+	// DSD chunk
+	put_ident(header,"DSD ");
+	put_le(header,28,8);
+	put_le(header,28 + 52 + 12 + dataSz + tag.size(),8);
+	put_le(header,metaPointer,8);
+	// fmt chunk
+	put_ident(header,"fmt ");
+	put_le(header,52,8);
+	put_le(header,1,4); // format version
+	put_le(header,0,4); // format id: DSD raw
+	put_le(header,chanType,4);
+	put_le(header,nChans,4);
+	put_le(header,reader->getSamplingFreq(),4);
+	put_le(header,1,4); // bits per sample
+	put_le(header,nSamples,8);
+	put_le(header,dsfBlockSzPerChan,4);
+	put_le(header,0,4); // reserved
+	// data chunk header
+	put_ident(header,"data");
+	put_le(header,12 + dataSz,8);
+
+	blockFill = 0;
+}
+
+void DsfFileWriter::makeTrailer(std::vector<dsf2flac_uint8>& tag, std::vector<dsf2flac_uint8>& trailer)
+{
+	trailer = tag;
+}
+
+bool DsfFileWriter::canCopy(DsdRawLayout& layout, dsf2flac_uint64 startChar, dsf2flac_uint64 endChar, dsf2flac_uint64* offset, dsf2flac_uint64* len)
+{
+	// only whole blocks of a dsf file can be copied, and the last one only if it is the last of the input too.
+	dsf2flac_uint64 charsInFile = (reader->getLength() + 7) / 8;
+	if (layout.blockSzPerChan != dsfBlockSzPerChan
+			|| startChar % dsfBlockSzPerChan != 0
+			|| (endChar % dsfBlockSzPerChan != 0 && endChar != charsInFile))
+		return false;
+	dsf2flac_uint64 nBlocks = (endChar - startChar + dsfBlockSzPerChan - 1) / dsfBlockSzPerChan;
+	*offset = layout.dataOffset + startChar * nChans;
+	*len = nBlocks * dsfBlockSzPerChan * nChans;
+	return true;
+}
+
+bool DsfFileWriter::writeChars(const dsf2flac_uint8* const* buffers, dsf2flac_uint32 n)
+{
+	dsf2flac_uint32 i = 0;
+	while (i<n) {
+		dsf2flac_uint32 m = n - i;
+		if (m > dsfBlockSzPerChan - blockFill)
+			m = dsfBlockSzPerChan - blockFill;
+		for (dsf2flac_uint32 c=0; c<nChans; c++)
+			memcpy(&block[c*dsfBlockSzPerChan + blockFill],buffers[c]+i,m);
+		blockFill += m;
+		i += m;
+		if (blockFill == dsfBlockSzPerChan) {
+			if (!writeAll(&block[0],block.size()))
+				return false;
+			blockFill = 0;
+		}
+	}
+	return true;
+}
+
+bool DsfFileWriter::finishChars()
+{
+	if (blockFill == 0)
+		return true;
+	// pad the last block with zeros
+	for (dsf2flac_uint32 c=0; c<nChans; c++)
+		memset(&block[c*dsfBlockSzPerChan + blockFill],0,dsfBlockSzPerChan - blockFill);
+	blockFill = 0;
+	return writeAll(&block[0],block.size());
+}
@@ -0,0 +1,69 @@
+/*
+ * dsf2flac - http://code.google.com/p/dsf2flac/
+ *
+ * A file conversion tool for translating dsf dsd audio files into
+ * flac pcm audio files.
+ *
+ * Copyright (c) 2013 by respective authors.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *
+ * Acknowledgments
+ *
+ * Many thanks to the following authors and projects whose work has greatly
+ * helped the development of this tool.
+ *
+ *
+ * Sebastian Gesemann - dsd2pcm (http://code.google.com/p/dsd2pcm/)
+ * SACD Ripper (http://code.google.com/p/sacd-ripper/)
+ * Maxim V.Anisiutkin - foo_input_sacd (http://sourceforge.net/projects/sacddecoder/files/)
+ * Vladislav Goncharov - foo_input_sacd_hq (http://vladgsound.wordpress.com)
+ * Jesus R - www.sonore.us
+ *
+ */
+
+#ifndef DSFFILEWRITER_H
+#define DSFFILEWRITER_H
+
+#include <dsd_file_writer.h>
+
+/**
+ * Writes DSD samples into dsf files.
+ *
+ * Samples are stored in blocks of 4096 chars per channel, the last block is padded with zeros.
+ * The id3 tag (if any) is stored at the end of the file.
+ */
+class DsfFileWriter : public DsdFileWriter
+{
+public:
+	/// Class constructor.
+	DsfFileWriter(DsdSampleReader *reader);
+	/// Class destructor.
+	virtual ~DsfFileWriter();
+	const char* getFormatName() { return "DSF"; };
+protected: // methods overriding DsdFileWriter
+	void makeHeader(dsf2flac_uint64 nSamples, dsf2flac_uint64 nChars, std::vector<dsf2flac_uint8>& tag, std::vector<dsf2flac_uint8>& header);
+	void makeTrailer(std::vector<dsf2flac_uint8>& tag, std::vector<dsf2flac_uint8>& trailer);
+	bool canCopy(DsdRawLayout& layout, dsf2flac_uint64 startChar, dsf2flac_uint64 endChar, dsf2flac_uint64* offset, dsf2flac_uint64* len);
+	bool writeChars(const dsf2flac_uint8* const* buffers, dsf2flac_uint32 n);
+	bool finishChars();
+	bool msbIsPlayedFirst() { return true; };
+private:
+	std::vector<dsf2flac_uint8> block;	//!< one block of every channel, as stored in the file.
+	dsf2flac_uint32 blockFill;			//!< chars per channel in block so far.
+};
+
+#endif // DSFFILEWRITER_H
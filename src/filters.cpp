@@ -38,11 +38,16 @@
 /**
  * filters.cpp
  * 
- * Each filter corresponds to one of the in/out sample rates. Note that dsf2flac can only
- * convert to samples rates which are multiples of 44.1kHz. The filters are used by dsdDecimator
- * which converts the simple double arrays, which are impulse responses defined at dsd sampling rate,
- * into lookup tables for efficient filtering. Currently only 64x dsd is supported but it should be 
- * fairly easy to add filters suitable for 128x dsd.
+ * Each filter corresponds to one of the in/out sample rates (the 48kHz family is resampled from
+ * the 44.1kHz family). The filters are used by dsdDecimator which converts the simple double arrays,
+ * which are impulse responses defined at dsd sampling rate, into lookup tables for efficient
+ * filtering. These single filters are used for ratios 8, 16 and 32, unless a filter file for the
+ * ratio is loaded with --filter (see fir_filter.h). --quality fast and minphase swap them for the
+ * shorter filter sets below.
+ * 
+ * Higher ratios (64 and up, e.g. DSD64 -> 44.1kHz or DSD256 -> 88.2kHz) go through a cascade: a
+ * short lookup table filter down to 1/8 of the dsd rate and then half-band stages, each halving
+ * the rate. Their specification is relative to the output rate, so one set covers every ratio.
  * 
  */
 
@@ -113,3 +118,232 @@ const static dsf2flac_float64 coefs_352[96] = {
 	+2.490921351762261093e-02,+3.794294849101870204e-02,+5.172629311427257015e-02,+6.534876523171298524e-02,+7.782552527068174741e-02,+8.819647126516944047e-02,+9.562845727714668065e-02,+9.950731974056657714e-02,+9.950731974056657714e-02,+9.562845727714668065e-02,+8.819647126516944047e-02,+7.782552527068174741e-02,+6.534876523171298524e-02,+5.172629311427257015e-02,+3.794294849101870204e-02,+2.490921351762261093e-02,+1.337747462658970057e-02,+3.883043418804416145e-03,-3.284703416210725969e-03,-8.080250212687496714e-03,
 	-1.067241812471033009e-02,-1.139427235000863015e-02,-1.068138779745870029e-02,-9.007905078766049317e-03,-6.828859761015334574e-03,-4.535184322001496043e-03,-2.425035959059578146e-03,-6.922187080790708326e-04,+5.700762133516592374e-04,+1.353838005269448076e-03,+1.713709169690936975e-03,+1.742046839472948102e-03,+1.545601648013235048e-03,+1.226696225277854957e-03,+8.704322683580221955e-04,+5.381636200535649473e-04,+2.664463454252759917e-04,+7.002968738383527972e-05,-5.279407053811266003e-05,-1.140625650874684021e-04,
 	-1.304796361231894922e-04,-1.189970287491284975e-04,-9.396247155265073355e-05,-6.577634378272832012e-05,-4.074928958725350180e-05,-2.174079575545870077e-05,-9.163058931391722015e-06,-2.017460145032201133e-06,+1.249721855219005082e-06,+2.166655190537391817e-06,+1.930520892991081870e-06,+1.319400334374194979e-06,+7.410039764949090706e-07,+3.423230509967408957e-07,+1.244182214744588123e-07,+3.130441005359395694e-08,};
+
+
+// The --quality presets, used in place of the three filters above. Both are shorter and have
+// a passband flat to 0.1dB up to 20kHz. fast trades stop band depth for fewer taps, minphase
+// is minimum phase: its impulse response is bunched at the start, so tzero (the delay) is
+// about a third of the linear phase filters'.
+
+// fast preset, DSD64 -> 88.2kHz: linear phase, 121dB down from 68kHz
+const static dsf2flac_int32 tzero_fast_88 = 144;
+const static dsf2flac_int32 nCoefs_fast_88 = 288;
+const static dsf2flac_float64 coefs_fast_88[288] = {
+	+7.556852831449594196e-07,+7.757917911864621527e-07,+1.165434344547158041e-06,+1.677541443499937181e-06,+2.337234868075893836e-06,+3.171860004272551316e-06,+4.214831922446635643e-06,+5.498471662931542981e-06,
+	+7.062979027335653975e-06,+8.949335995232171137e-06,+1.120171630581266544e-05,+1.386801227759418895e-05,+1.699887126147046310e-05,+2.064737467080698407e-05,+2.486885311711891676e-05,+2.972039614357636035e-05,
+	+3.525939981127889424e-05,+4.154476474064430525e-05,+4.863453438605674272e-05,+5.658599096501380424e-05,+6.545380899193373029e-05,+7.528999465183153748e-05,+8.614152666228889468e-05,+9.805071938668521601e-05,
+	+1.110525128718761192e-04,+1.251740482441232735e-04,+1.404324240968029365e-04,+1.568340867770039680e-04,+1.743723282349557392e-04,+1.930268282938080312e-04,+2.127612312608157322e-04,+2.335223114294532755e-04,
+	+2.552380736383181247e-04,+2.778168536981568282e-04,+3.011454249715348006e-04,+3.250883997603101023e-04,+3.494868045771754809e-04,+3.741575458314833806e-04,+3.988926810415314127e-04,+4.234591469070041929e-04,
+	+4.475983802926996810e-04,+4.710266422084000517e-04,+4.934353828260286574e-04,+5.144920055986753520e-04,+5.338411274750711486e-04,+5.511060037511885876e-04,+5.658904534536061438e-04,+5.777811290680614446e-04,
+	+5.863502900639482518e-04,+5.911587065261334362e-04,+5.917593658839316291e-04,+5.877012225705330111e-04,+5.785336359110636057e-04,+5.638109801214570690e-04,+5.430978094699577324e-04,+5.159740266068329377e-04,
+	+4.820407239745618183e-04,+4.409259682873374608e-04,+3.922910185928483594e-04,+3.358365793798049844e-04,+2.713092857205631628e-04,+1.985080680074787895e-04,+1.172907161164324260e-04,+2.758022507132375443e-05,
+	-7.062897914201307647e-05,-1.772649889387857092e-04,-2.921727114468659859e-04,-4.151085187720762650e-04,-5.457353519879321740e-04,-6.836182988451815516e-04,-8.282209237556518956e-04,-9.789020541642373587e-04,
+	-1.134913511585793240e-03,-1.295398495240570030e-03,-1.459391003057315022e-03,-1.625816012486206493e-03,-1.793490904998139377e-03,-1.961127625122230465e-03,-2.127336165306841203e-03,-2.290628925258339846e-03,
+	-2.449426368263647215e-03,-2.602063581589689548e-03,-2.746798200782981335e-03,-2.881819167857696366e-03,-3.005256788665618042e-03,-3.115193654833336469e-03,-3.209676671170876971e-03,-3.286729850779820678e-03,
+	-3.344368116594335222e-03,-3.380611700158978050e-03,-3.393501322164855279e-03,-3.381113870134918806e-03,-3.341578530284067955e-03,-3.273093199173692219e-03,-3.173941121901981566e-03,-3.042507535214165372e-03,
+	-2.877296203104001606e-03,-2.676945758917693031e-03,-2.440245558267435926e-03,-2.166151046909736786e-03,-1.853798364623381002e-03,-1.502518138550291244e-03,-1.111848170352067004e-03,-6.815450981269252943e-04,
+	-2.115946267489488626e-04,+2.977795403485546609e-04,+8.461084022896882533e-04,+1.432671927602839753e-03,+2.056495181722616319e-03,+2.716346148823667057e-03,+3.410735584853425480e-03,+4.137918724039315460e-03,
+	+4.895899045058983885e-03,+5.682433998385972608e-03,+6.495042819108236450e-03,+7.331016255051267527e-03,+8.187428326696544884e-03,+9.061149964167619988e-03,+9.948864474830532503e-03,+1.084708477705162086e-02,
+	+1.175217227067659048e-02,+1.266035722833102478e-02,+1.356776055801263772e-02,+1.447041684694357240e-02,+1.536429837927566315e-02,+1.624534012310874936e-02,+1.710946532950637089e-02,+1.795261169093387982e-02,
+	+1.877075771083383179e-02,+1.955994926296823408e-02,+2.031632588061428948e-02,+2.103614682395773053e-02,+2.171581647129006837e-02,+2.235190902176166852e-02,+2.294119211525039864e-02,+2.348064938839321963e-02,
+	+2.396750152513952084e-02,+2.439922587189609707e-02,+2.477357424418119916e-02,+2.508858891917380846e-02,+2.534261654935425143e-02,+2.553432001920240280e-02,+2.566268798455528799e-02,+2.572704215156088395e-02,
+	+2.572704215156088395e-02,+2.566268798455528799e-02,+2.553432001920240280e-02,+2.534261654935425143e-02,+2.508858891917380846e-02,+2.477357424418119916e-02,+2.439922587189609707e-02,+2.396750152513952084e-02,
+	+2.348064938839321963e-02,+2.294119211525039864e-02,+2.235190902176166852e-02,+2.171581647129006837e-02,+2.103614682395773053e-02,+2.031632588061428948e-02,+1.955994926296823408e-02,+1.877075771083383179e-02,
+	+1.795261169093387982e-02,+1.710946532950637089e-02,+1.624534012310874936e-02,+1.536429837927566315e-02,+1.447041684694357240e-02,+1.356776055801263772e-02,+1.266035722833102478e-02,+1.175217227067659048e-02,
+	+1.084708477705162086e-02,+9.948864474830532503e-03,+9.061149964167619988e-03,+8.187428326696544884e-03,+7.331016255051267527e-03,+6.495042819108236450e-03,+5.682433998385972608e-03,+4.895899045058983885e-03,
+	+4.137918724039315460e-03,+3.410735584853425480e-03,+2.716346148823667057e-03,+2.056495181722616319e-03,+1.432671927602839753e-03,+8.461084022896882533e-04,+2.977795403485546609e-04,-2.115946267489488626e-04,
+	-6.815450981269252943e-04,-1.111848170352067004e-03,-1.502518138550291244e-03,-1.853798364623381002e-03,-2.166151046909736786e-03,-2.440245558267435926e-03,-2.676945758917693031e-03,-2.877296203104001606e-03,
+	-3.042507535214165372e-03,-3.173941121901981566e-03,-3.273093199173692219e-03,-3.341578530284067955e-03,-3.381113870134918806e-03,-3.393501322164855279e-03,-3.380611700158978050e-03,-3.344368116594335222e-03,
+	-3.286729850779820678e-03,-3.209676671170876971e-03,-3.115193654833336469e-03,-3.005256788665618042e-03,-2.881819167857696366e-03,-2.746798200782981335e-03,-2.602063581589689548e-03,-2.449426368263647215e-03,
+	-2.290628925258339846e-03,-2.127336165306841203e-03,-1.961127625122230465e-03,-1.793490904998139377e-03,-1.625816012486206493e-03,-1.459391003057315022e-03,-1.295398495240570030e-03,-1.134913511585793240e-03,
+	-9.789020541642373587e-04,-8.282209237556518956e-04,-6.836182988451815516e-04,-5.457353519879321740e-04,-4.151085187720762650e-04,-2.921727114468659859e-04,-1.772649889387857092e-04,-7.062897914201307647e-05,
+	+2.758022507132375443e-05,+1.172907161164324260e-04,+1.985080680074787895e-04,+2.713092857205631628e-04,+3.358365793798049844e-04,+3.922910185928483594e-04,+4.409259682873374608e-04,+4.820407239745618183e-04,
+	+5.159740266068329377e-04,+5.430978094699577324e-04,+5.638109801214570690e-04,+5.785336359110636057e-04,+5.877012225705330111e-04,+5.917593658839316291e-04,+5.911587065261334362e-04,+5.863502900639482518e-04,
+	+5.777811290680614446e-04,+5.658904534536061438e-04,+5.511060037511885876e-04,+5.338411274750711486e-04,+5.144920055986753520e-04,+4.934353828260286574e-04,+4.710266422084000517e-04,+4.475983802926996810e-04,
+	+4.234591469070041929e-04,+3.988926810415314127e-04,+3.741575458314833806e-04,+3.494868045771754809e-04,+3.250883997603101023e-04,+3.011454249715348006e-04,+2.778168536981568282e-04,+2.552380736383181247e-04,
+	+2.335223114294532755e-04,+2.127612312608157322e-04,+1.930268282938080312e-04,+1.743723282349557392e-04,+1.568340867770039680e-04,+1.404324240968029365e-04,+1.251740482441232735e-04,+1.110525128718761192e-04,
+	+9.805071938668521601e-05,+8.614152666228889468e-05,+7.528999465183153748e-05,+6.545380899193373029e-05,+5.658599096501380424e-05,+4.863453438605674272e-05,+4.154476474064430525e-05,+3.525939981127889424e-05,
+	+2.972039614357636035e-05,+2.486885311711891676e-05,+2.064737467080698407e-05,+1.699887126147046310e-05,+1.386801227759418895e-05,+1.120171630581266544e-05,+8.949335995232171137e-06,+7.062979027335653975e-06,
+	+5.498471662931542981e-06,+4.214831922446635643e-06,+3.171860004272551316e-06,+2.337234868075893836e-06,+1.677541443499937181e-06,+1.165434344547158041e-06,+7.757917911864621527e-07,+7.556852831449594196e-07,
+};
+
+// fast preset, DSD64 -> 176.4kHz: linear phase, 130dB down from 156kHz
+const static dsf2flac_int32 tzero_fast_176 = 56;
+const static dsf2flac_int32 nCoefs_fast_176 = 112;
+const static dsf2flac_float64 coefs_fast_176[112] = {
+	-5.444234031308620476e-07,-1.417201791268847407e-06,-3.188999121522632427e-06,-6.328997269675042094e-06,-1.153105526140211855e-05,-1.970956239814046550e-05,-3.202688513388533674e-05,-4.991403642808737713e-05,
+	-7.507769362405010969e-05,-1.094880957161772591e-04,-1.553467299404005222e-04,-2.150229645161706694e-04,-2.909617944404428551e-04,-3.855562415923940458e-04,-5.009828173535920033e-04,-6.390035475922696724e-04,
+	-8.007354280218820534e-04,-9.863925279442759680e-04,-1.195011736930129062e-03,-1.424171239296872799e-03,-1.669716223029467849e-03,-1.925508102578926076e-03,-2.183215027323256573e-03,-2.432161827313115542e-03,
+	-2.659257436637149554e-03,-2.849017743479445672e-03,-2.983698729730564943e-03,-3.043549825724661817e-03,-3.007195336569476116e-03,-2.852145080426529093e-03,-2.555428472558576684e-03,-2.094340163303180530e-03,
+	-1.447278375104006859e-03,-5.946503691979618689e-04,+4.801866062609037975e-04,+1.789986024687268643e-03,+3.342714512304707872e-03,+5.140738422417454913e-03,+7.180136586457853791e-03,+9.450179368384731965e-03,
+	+1.193301022718929773e-02,+1.460355885568141894e-02,+1.742970668992131072e-02,+2.037271646041427520e-02,+2.338792595600861987e-02,+2.642569463647748487e-02,+2.943257996888058031e-02,+3.235270924275014670e-02,
+	+3.512930258697541386e-02,+3.770629442282290994e-02,+4.002999457264662386e-02,+4.205072636727501950e-02,+4.372437796957219514e-02,+4.501380574994474221e-02,+4.589003319727652519e-02,+4.633319626640262229e-02,
+	+4.633319626640262229e-02,+4.589003319727652519e-02,+4.501380574994474221e-02,+4.372437796957219514e-02,+4.205072636727501950e-02,+4.002999457264662386e-02,+3.770629442282290994e-02,+3.512930258697541386e-02,
+	+3.235270924275014670e-02,+2.943257996888058031e-02,+2.642569463647748487e-02,+2.338792595600861987e-02,+2.037271646041427520e-02,+1.742970668992131072e-02,+1.460355885568141894e-02,+1.193301022718929773e-02,
+	+9.450179368384731965e-03,+7.180136586457853791e-03,+5.140738422417454913e-03,+3.342714512304707872e-03,+1.789986024687268643e-03,+4.801866062609037975e-04,-5.946503691979618689e-04,-1.447278375104006859e-03,
+	-2.094340163303180530e-03,-2.555428472558576684e-03,-2.852145080426529093e-03,-3.007195336569476116e-03,-3.043549825724661817e-03,-2.983698729730564943e-03,-2.849017743479445672e-03,-2.659257436637149554e-03,
+	-2.432161827313115542e-03,-2.183215027323256573e-03,-1.925508102578926076e-03,-1.669716223029467849e-03,-1.424171239296872799e-03,-1.195011736930129062e-03,-9.863925279442759680e-04,-8.007354280218820534e-04,
+	-6.390035475922696724e-04,-5.009828173535920033e-04,-3.855562415923940458e-04,-2.909617944404428551e-04,-2.150229645161706694e-04,-1.553467299404005222e-04,-1.094880957161772591e-04,-7.507769362405010969e-05,
+	-4.991403642808737713e-05,-3.202688513388533674e-05,-1.970956239814046550e-05,-1.153105526140211855e-05,-6.328997269675042094e-06,-3.188999121522632427e-06,-1.417201791268847407e-06,-5.444234031308620476e-07,
+};
+
+// fast preset, DSD64 -> 352.8kHz: linear phase, 120dB down from 332kHz
+const static dsf2flac_int32 tzero_fast_352 = 24;
+const static dsf2flac_int32 nCoefs_fast_352 = 48;
+const static dsf2flac_float64 coefs_fast_352[48] = {
+	-5.685588143422810166e-06,-2.593467024171417583e-05,-7.891740601203085694e-05,-1.913518798406120742e-04,-3.962466320392489549e-04,-7.248925698169795010e-04,-1.192528178665111559e-03,-1.778252143554361888e-03,
+	-2.402077037008977772e-03,-2.904389438823873348e-03,-3.034774680855935065e-03,-2.457391555621191159e-03,-7.783094895268760985e-04,+2.403725575944171480e-03,+7.427121350886871712e-03,+1.448779312988858828e-02,
+	+2.356478436389614767e-02,+3.436802701583391295e-02,+4.632351315885010340e-02,+5.860562038749642100e-02,+7.021760762049029936e-02,+8.011125582345567098e-02,+8.732747802928345071e-02,+9.113382481412470038e-02,
+	+9.113382481412470038e-02,+8.732747802928345071e-02,+8.011125582345567098e-02,+7.021760762049029936e-02,+5.860562038749642100e-02,+4.632351315885010340e-02,+3.436802701583391295e-02,+2.356478436389614767e-02,
+	+1.448779312988858828e-02,+7.427121350886871712e-03,+2.403725575944171480e-03,-7.783094895268760985e-04,-2.457391555621191159e-03,-3.034774680855935065e-03,-2.904389438823873348e-03,-2.402077037008977772e-03,
+	-1.778252143554361888e-03,-1.192528178665111559e-03,-7.248925698169795010e-04,-3.962466320392489549e-04,-1.913518798406120742e-04,-7.891740601203085694e-05,-2.593467024171417583e-05,-5.685588143422810166e-06,
+};
+
+// minimum phase preset, DSD64 -> 88.2kHz: 137dB down from 68kHz
+const static dsf2flac_int32 tzero_minphase_88 = 88;
+const static dsf2flac_int32 nCoefs_minphase_88 = 320;
+const static dsf2flac_float64 coefs_minphase_88[320] = {
+	+1.244153636390878800e-07,+1.698032576206218422e-07,+2.840604780661183900e-07,+4.478539589208880672e-07,+6.763376619798491085e-07,+9.880950561321009020e-07,+1.405573776761400555e-06,+1.955747105581296537e-06,
+	+2.670662740451800227e-06,+3.588257554664435083e-06,+4.752987873201609524e-06,+6.216782933940410023e-06,+8.039701476313610700e-06,+1.029100880579026129e-05,+1.304991879685237199e-05,+1.640680203170977850e-05,
+	+2.046402439545469041e-05,+2.533717278069390485e-05,+3.115593171260019482e-05,+3.806533027769198446e-05,+4.622665628115028825e-05,+5.581873326679590849e-05,+6.703882547127354744e-05,+8.010377897756360791e-05,
+	+9.525078528842097149e-05,+1.127385218823854146e-04,+1.328478002199657681e-04,+1.558825492253837963e-04,+1.821700663654898713e-04,+2.120617849221206690e-04,+2.459333656856461979e-04,+2.841853691558880453e-04,
+	+3.272423149201553238e-04,+3.755532452327958086e-04,+4.295910688319011712e-04,+4.898514003537977717e-04,+5.568522587352298971e-04,+6.311322089237677863e-04,+7.132491922653956627e-04,+8.037784347814906508e-04,
+	+9.033104346812571850e-04,+1.012448331197819597e-03,+1.131805141211486999e-03,+1.262000569027635225e-03,+1.403657498838907893e-03,+1.557398174880485729e-03,+1.723840036933537529e-03,+1.903591226242734016e-03,
+	+2.097245817331862966e-03,+2.305378773464048740e-03,+2.528540599104712582e-03,+2.767251786678921310e-03,+3.021997027199211858e-03,+3.293219287884073792e-03,+3.581313722440968191e-03,+3.886621505490053287e-03,
+	+4.209423535492783260e-03,+4.549934264633554923e-03,+4.908295494963788724e-03,+5.284570295411733856e-03,+5.678736993228456278e-03,+6.090683567222750054e-03,+6.520202128162803402e-03,+6.966983862280177325e-03,
+	+7.430614196771969694e-03,+7.910568805896071864e-03,+8.406209534203274922e-03,+8.916781555761236003e-03,+9.441410648762114249e-03,+9.979101469803387803e-03,+1.052873641751456667e-02,+1.108907538002677426e-02,
+	+1.165875624121305749e-02,+1.223629634379870372e-02,+1.282009476492895240e-02,+1.340843560566384526e-02,+1.399949219574306639e-02,+1.459133229281244469e-02,+1.518192419119429072e-02,+1.576914391307225258e-02,
+	+1.635078320048914680e-02,+1.692455861722863553e-02,+1.748812142097046912e-02,+1.803906840251408294e-02,+1.857495345719316002e-02,+1.909330005106265465e-02,+1.959161426937324965e-02,+2.006739858165683052e-02,
+	+2.051816610718836323e-02,+2.094145540148592555e-02,+2.133484557246318608e-02,+2.169597167719210240e-02,+2.202254027717393675e-02,+2.231234509322432488e-02,+2.256328251105920238e-02,+2.277336696640945568e-02,
+	+2.294074603562036921e-02,+2.306371507049567726e-02,+2.314073123432201090e-02,+2.317042704553532936e-02,+2.315162287536091587e-02,+2.308333882152169281e-02,+2.296480528907459198e-02,+2.279547271839588857e-02,
+	+2.257501983990382183e-02,+2.230336083772856484e-02,+2.198065094119586518e-02,+2.160729068038022560e-02,+2.118392849106331272e-02,+2.071146186111215773e-02,+2.019103670433030490e-02,+1.962404524303991427e-02,
+	+1.901212204369196954e-02,+1.835713857051437040e-02,+1.766119589485799085e-02,+1.692661594604105008e-02,+1.615593099077189745e-02,+1.535187175946410749e-02,+1.451735391796341382e-02,+1.365546328801583997e-02,
+	+1.276943964210249319e-02,+1.186265944809314701e-02,+1.093861733029906011e-02,+1.000090675458313247e-02,+9.053199766195009837e-03,+8.099226110044824983e-03,+7.142751739226436275e-03,+6.187557052479683573e-03,
+	+5.237414781535154433e-03,+4.296067907102604604e-03,+3.367207636061959278e-03,+2.454451676049079420e-03,+1.561322874158956996e-03,+6.912285518762909800e-04,-1.525595512679013099e-04,-9.669242942612891372e-04,
+	-1.748921235701317040e-03,-2.495795462249237023e-03,-3.204997222177697041e-03,-3.874195976012388080e-03,-4.501293154331621228e-03,-5.084433053053356161e-03,-5.622012239881054273e-03,-6.112687067573245071e-03,
+	-6.555379476341818487e-03,-6.949280825310102765e-03,-7.293854037714325375e-03,-7.588833674573211216e-03,-7.834224334375096063e-03,-8.030297051214869627e-03,-8.177584057406836124e-03,-8.276871651278081693e-03,
+	-8.329191542200709356e-03,-8.335810471406003563e-03,-8.298218472980779109e-03,-8.218115590445449273e-03,-8.097397512826558230e-03,-7.938139839585972232e-03,-7.742581583313728165e-03,-7.513107557592707021e-03,
+	-7.252230228981493623e-03,-6.962570879670997893e-03,-6.646840434867061845e-03,-6.307819914493578185e-03,-5.948340911632238326e-03,-5.571265990587680184e-03,-5.179469357410845624e-03,-4.775817826933793919e-03,
+	-4.363152312997101677e-03,-3.944269867678013020e-03,-3.521906561622622535e-03,-3.098721119748050479e-03,-2.677279640815496010e-03,-2.260041259930695417e-03,-1.849345122586387507e-03,-1.447398418490486319e-03,
+	-1.056265897145115167e-03,-6.778605705529281095e-04,-3.139359245433625449e-04,+3.392054218117886659e-05,+3.642922533855884998e-04,+6.759372102984415737e-04,+9.677900293772294382e-04,+1.238962789302787979e-03,
+	+1.488744376444837937e-03,+1.716598582035695634e-03,+1.922160911887659798e-03,+2.105234258403624551e-03,+2.265783344930164239e-03,+2.403928313908965716e-03,+2.519937117908803686e-03,+2.614217346587273047e-03,
+	+2.687306997195752604e-03,+2.739864882831967961e-03,+2.772660216759595658e-03,+2.786561990052018999e-03,+2.782527807426325803e-03,+2.761592668377248726e-03,+2.724857465914301731e-03,+2.673477592697851360e-03,
+	+2.608651474103344716e-03,+2.531609419371327364e-03,+2.443602583553957774e-03,+2.345892387979386928e-03,+2.239740232327672772e-03,+2.126397831894665056e-03,+2.007097929621281650e-03,+1.883045795410870056e-03,
+	+1.755411197485714971e-03,+1.625321232300556279e-03,+1.493853694442427021e-03,+1.362031378423650581e-03,+1.230816973373212138e-03,+1.101108861373344778e-03,+9.737375746020159430e-04,+8.494631022093304716e-04,
+	+7.289728663613316735e-04,+6.128805291618325164e-04,+5.017253759754153634e-04,+3.959724708864317583e-04,+2.960134150159917060e-04,+2.021676657213079180e-04,+1.146844607039965874e-04,+3.374524192096902569e-05,
+	-4.053358177064855523e-05,-1.080972350319217866e-04,-1.689491190010144984e-04,-2.231467885381210241e-04,-2.707979127754253147e-04,-3.120558351985140201e-04,-3.471152289673033416e-04,-3.762074215411397070e-04,
+	-3.995958905704246277e-04,-4.175716109470783998e-04,-4.304486036632454720e-04,-4.385593905267275877e-04,-4.422507900582070507e-04,-4.418796641576464707e-04,-4.378090681441421800e-04,-4.304044053978919675e-04,
+	-4.200300373688890723e-04,-4.070459226055299817e-04,-3.918048054508371488e-04,-3.746493923709144701e-04,-3.559100834438093971e-04,-3.359027924815339108e-04,-3.149272523409937514e-04,-2.932654110099995452e-04,
+	-2.711803503995733320e-04,-2.489152176793573931e-04,-2.266927200588461980e-04,-2.047145753950619653e-04,-1.831614824453677980e-04,-1.621931100998883911e-04,-1.419483426556643986e-04,-1.225458937757412700e-04,
+	-1.040847300174447708e-04,-8.664499157197740541e-05,-7.028892569970357929e-05,-5.506176622292106946e-05,-4.099298090383506884e-05,-2.809738424087361805e-05,-1.637642277843608715e-05,-5.819341999051367374e-06,
+	+3.595409809499096192e-06,+1.189900112210578633e-05,+1.913083413041388126e-05,+2.533742976468460236e-05,+3.057110633793649218e-05,+3.488891189967204090e-05,+3.835141529965279371e-05,+4.102180293683682329e-05,
+	+4.296477883411788914e-05,+4.424580546494972328e-05,+4.493016049420527227e-05,+4.508235011651076809e-05,+4.476530982760796212e-05,+4.404003827883739403e-05,+4.296487974916519704e-05,+4.159536113857916233e-05,
+	+3.998364411927037883e-05,+3.817851038867093525e-05,+3.622490708064515840e-05,+3.416417024299425579e-05,+3.203349660882166133e-05,+2.986660789061621995e-05,+2.769298300815616239e-05,+2.553863688594348757e-05,
+	+2.342609394230667113e-05,+2.137404033837106337e-05,+1.939823068044506198e-05,+1.751127859809422567e-05,+1.572298347152007562e-05,+1.404043532315842204e-05,+1.246849363632945805e-05,+1.100988651703888679e-05,
+	+9.665486174953072227e-06,+8.434450817269937631e-06,+7.314589692434846077e-06,+6.302513666806673128e-06,+5.393912872692577587e-06,+4.583674334978440065e-06,+3.866086809263207055e-06,+3.235005296135335633e-06,
+	+2.684041037941370972e-06,+2.206683740105634615e-06,+1.796390942195512181e-06,+1.446705227673574641e-06,+1.151317562524514630e-06,+9.041736766540414365e-07,+6.995316164286534672e-07,+5.320000341505438706e-07,
+	+3.965915168256445446e-07,+2.886917963705361275e-07,+2.041832453177923206e-07,+1.398291608558581296e-07,+9.583401301103009338e-08,+8.173177805525580615e-08,-1.962613374796372482e-08,+1.033237420015365837e-09,
+};
+
+// minimum phase preset, DSD64 -> 176.4kHz: 141dB down from 156kHz
+const static dsf2flac_int32 tzero_minphase_176 = 40;
+const static dsf2flac_int32 nCoefs_minphase_176 = 120;
+const static dsf2flac_float64 coefs_minphase_176[120] = {
+	+1.813181560265660696e-07,+5.564055619360278752e-07,+1.384228967971451036e-06,+2.990515283744178645e-06,+5.880258927299524435e-06,+1.078854687982980137e-05,+1.874993278954372917e-05,+3.117859774313735477e-05,
+	+4.995745722928214203e-05,+7.753402046709253223e-05,+1.170201782928713532e-04,+1.722902280745894528e-04,+2.480732275412185278e-04,+3.500313718765652913e-04,+4.848180754910626526e-04,+6.601075820783008702e-04,
+	+8.845871332886895942e-04,+1.167904614886627933e-03,+1.520563890651088421e-03,+1.953761466594679599e-03,+2.479160860799878210e-03,+3.108602417983888627e-03,+3.853749479641203988e-03,+4.725675219578492035e-03,
+	+5.734397981532316814e-03,+6.888376492765682299e-03,+8.193979654272655691e-03,+9.654949803088827553e-03,+1.127188029231460976e-02,+1.304173061637037626e-02,+1.495740383463172937e-02,+1.700741105785109203e-02,
+	+1.917564664886036233e-02,+2.144129571281926105e-02,+2.377889177448444177e-02,+2.615853821784126093e-02,+2.854630079064505305e-02,+3.090477221265905058e-02,+3.319380245536721064e-02,+3.537138112916080740e-02,
+	+3.739465061492143472e-02,+3.922102167861553357e-02,+4.080935713472220311e-02,+4.212118438987339647e-02,+4.312189374155640104e-02,+4.378187793385686366e-02,+4.407756826272321571e-02,+4.399232495712818852e-02,
+	+4.351714338739082200e-02,+4.265114389766044845e-02,+4.140182032254274141e-02,+3.978503144738691072e-02,+3.782472932306848307e-02,+3.555242900800146405e-02,+3.300643426591672730e-02,+3.023084405779775247e-02,
+	+2.727437334067949956e-02,+2.418902961280832223e-02,+2.102869213471567078e-02,+1.784764484909170598e-02,+1.469911541364331449e-02,+1.163387242572770132e-02,+8.698929621560672065e-03,+5.936401217290382740e-03,
+	+3.382545430321038608e-03,+1.067025239043000329e-03,-9.875943063471748998e-04,-2.766102437618281340e-03,-4.260653332326508856e-03,-5.470541221921826174e-03,-6.401759367498515048e-03,-7.066369706342860366e-03,
+	-7.481716520450885748e-03,-7.669521739868892171e-03,-7.654902537412241331e-03,-7.465352156964696201e-03,-7.129724195828800702e-03,-6.677257402772782818e-03,-6.136674204687496068e-03,-5.535380283467648994e-03,
+	-4.898786631791884026e-03,-4.249768425219914089e-03,-3.608268354449900833e-03,-2.991045213988486988e-03,-2.411562762869494479e-03,-1.880007852321013842e-03,-1.403422959075289762e-03,-9.859345961008921140e-04,
+	-6.290573910163341437e-04,-3.320520942370112048e-04,-9.231629785140017547e-05,+9.421241751777555964e-05,+2.326589785405251470e-04,+3.288348332793974852e-04,+3.888959618576325462e-04,+4.190445736450239874e-04,
+	+4.252800300919913927e-04,+4.132023600481017850e-04,+3.878683451978496687e-04,+3.536976118912039772e-04,+3.144241443051680723e-04,+2.730877331231639383e-04,+2.320580849898775148e-04,+1.930844586258575839e-04,
+	+1.573632451383182452e-04,+1.256172578319892795e-04,+9.817962669706240507e-05,+7.507749362783827098e-05,+5.611145668714619431e-05,+4.092701540955143196e-05,+2.907619285469095112e-05,+2.006890757076636785e-05,
+	+1.341218201857111523e-05,+8.639799646715644207e-06,+5.331382269438287303e-06,+3.123636343802623704e-06,+1.714626661110776140e-06,+8.627212641032357052e-07,+3.820590127015599460e-07,+1.454447891739547514e-07,
+};
+
+// minimum phase preset, DSD64 -> 352.8kHz: 167dB down from 332kHz
+const static dsf2flac_int32 tzero_minphase_352 = 24;
+const static dsf2flac_int32 nCoefs_minphase_352 = 64;
+const static dsf2flac_float64 coefs_minphase_352[64] = {
+	+1.038807113909440461e-07,+7.459592369701630285e-07,+3.273483457426120783e-06,+1.107285210962551533e-05,+3.152226471669622302e-05,+7.900471468085116568e-05,+1.790861369723891730e-04,+3.736955994854549356e-04,
+	+7.267461145224147828e-04,+1.329151650152722661e-03,+2.301726125780159758e-03,+3.794134116538395041e-03,+5.978059921699823212e-03,+9.033207842567836376e-03,+1.312570718517462598e-02,+1.837992164376670706e-02,
+	+2.484636684899829001e-02,+3.247010510063470801e-02,+4.106521512916881667e-02,+5.030132935748955758e-02,+5.970749790198465190e-02,+6.869668180251323197e-02,+7.661116652624792855e-02,+8.278556029002247241e-02,
+	+8.662045202508766861e-02,+8.765699346747139742e-02,+8.564131084029515117e-02,+8.056818272532131897e-02,+7.269592235033642269e-02,+6.252854655482974200e-02,+5.076640472531886855e-02,+3.823154793691781184e-02,
+	+2.577826673888022196e-02,+1.420160881918558320e-02,+4.156843828217716974e-03,-3.899241060145519112e-03,-9.738218842274689105e-03,-1.335898415650410218e-02,-1.495867720355265225e-02,-1.488255803152308161e-02,
+	-1.356237727108948639e-02,-1.145346328156969865e-02,-8.979602756731066421e-03,-6.492250511489036646e-03,-4.247310345135344584e-03,-2.399395346177070430e-03,-1.010724713637751277e-03,-7.005828783584619414e-05,
+	+4.835420514551119265e-04,+7.369085186762385550e-04,+7.825332143274589623e-04,+7.039826184829380646e-04,+5.675209640639002854e-04,+4.192873383857917847e-04,+2.866165808981664372e-04,+1.818234864268452385e-04,
+	+1.068989999608551051e-04,+5.795060718947460881e-05,+2.869919812321107520e-05,+1.279031082717348480e-05,+5.006426505088714788e-06,+1.650389711227759702e-06,+4.216669846713284640e-07,+6.697515209765796022e-08,
+};
+
+// first stage of the cascade for ratios of 64 and above, 1 bit DSD -> DSD/8.
+// Protects the bands which alias onto 0 to 0.4535*fout (20kHz at 44.1kHz) in later stages.
+const static dsf2flac_int32 tzero_cascade_first = 24;
+const static dsf2flac_int32 nCoefs_cascade_first = 48;
+const static dsf2flac_float64 coefs_cascade_first[48] = {
+	+2.537081179491006114e-05,+7.377455731715979034e-04,+1.201435691313344507e-03,+1.460081080627014839e-03,+1.537115062666271834e-03,+1.376513671777681441e-03,+1.039243833546193898e-03,+6.104701395215553347e-04,
+	-8.253310222393057775e-04,-5.684867946447511207e-03,-9.299962141254551617e-03,-1.167033954887661609e-02,-1.269653282154077981e-02,-1.185705369466765260e-02,-9.164260333724704582e-03,-4.745332599141663908e-03,
+	+5.861527991767110334e-03,+2.550809367483311899e-02,+4.495416294430929632e-02,+6.402567529756662823e-02,+8.234402217302677629e-02,+9.862491730816233537e-02,+1.125640480190576859e-01,+1.240732568347513026e-01,
+	+1.240732568347513026e-01,+1.125640480190576859e-01,+9.862491730816233537e-02,+8.234402217302677629e-02,+6.402567529756662823e-02,+4.495416294430929632e-02,+2.550809367483311899e-02,+5.861527991767110334e-03,
+	-4.745332599141663908e-03,-9.164260333724704582e-03,-1.185705369466765260e-02,-1.269653282154077981e-02,-1.167033954887661609e-02,-9.299962141254551617e-03,-5.684867946447511207e-03,-8.253310222393057775e-04,
+	+6.104701395215553347e-04,+1.039243833546193898e-03,+1.376513671777681441e-03,+1.537115062666271834e-03,+1.460081080627014839e-03,+1.201435691313344507e-03,+7.377455731715979034e-04,+2.537081179491006114e-05,
+};
+
+// half-band stages of the cascade, impulse responses at each stage's input rate, every
+// other tap is zero and the middle one is 0.5. Passband 0.4535*fout, over 130dB down
+// in the bands aliasing onto it.
+// the last stage, 2*fout -> fout
+const static dsf2flac_int32 nCoefs_halfband_last = 179;
+const static dsf2flac_float64 coefs_halfband_last[179] = {
+	+3.415264115860542801e-07,+0.000000000000000000e+00,-7.601428289727028490e-07,+0.000000000000000000e+00,+1.573933054569674047e-06,+0.000000000000000000e+00,-2.938743296975117730e-06,+0.000000000000000000e+00,
+	+5.121676043182892247e-06,+0.000000000000000000e+00,-8.443777897697571572e-06,+0.000000000000000000e+00,+1.336453389782321538e-05,+0.000000000000000000e+00,-2.043255336540721105e-05,+0.000000000000000000e+00,
+	+3.034271051043731151e-05,+0.000000000000000000e+00,-4.396920704885843071e-05,+0.000000000000000000e+00,+6.233233817221626224e-05,+0.000000000000000000e+00,-8.669439705637942747e-05,+0.000000000000000000e+00,
+	+1.185257920208807048e-04,+0.000000000000000000e+00,-1.595410373655345177e-04,+0.000000000000000000e+00,+2.117580843219892114e-04,+0.000000000000000000e+00,-2.774513736468349999e-04,+0.000000000000000000e+00,
+	+3.592427996426082737e-04,+0.000000000000000000e+00,-4.600876464221413751e-04,+0.000000000000000000e+00,+5.832851494947839666e-04,+0.000000000000000000e+00,-7.325602758044462773e-04,+0.000000000000000000e+00,
+	+9.120206906836569004e-04,+0.000000000000000000e+00,-1.126250273922289012e-03,+0.000000000000000000e+00,+1.380345259765910874e-03,+0.000000000000000000e+00,-1.679943363832168100e-03,+0.000000000000000000e+00,
+	+2.031383662255123457e-03,+0.000000000000000000e+00,-2.441765852310725723e-03,+0.000000000000000000e+00,+2.919167335030439445e-03,+0.000000000000000000e+00,-3.472912507419143036e-03,+0.000000000000000000e+00,
+	+4.113883843139883034e-03,+0.000000000000000000e+00,-4.855123881579222200e-03,+0.000000000000000000e+00,+5.712548868409508818e-03,+0.000000000000000000e+00,-6.706097076588202199e-03,+0.000000000000000000e+00,
+	+7.861471443574193085e-03,+0.000000000000000000e+00,-9.212693064803968712e-03,+0.000000000000000000e+00,+1.080631584702385073e-02,+0.000000000000000000e+00,-1.270817792728655415e-02,+0.000000000000000000e+00,
+	+1.501498904006549895e-02,+0.000000000000000000e+00,-1.787528200298799108e-02,+0.000000000000000000e+00,+2.152953082804151541e-02,+0.000000000000000000e+00,-2.639423941126861628e-02,+0.000000000000000000e+00,
+	+3.325798471890276109e-02,+0.000000000000000000e+00,-4.381348607377702487e-02,+0.000000000000000000e+00,+6.246674364090010201e-02,+0.000000000000000000e+00,-1.053821288342279283e-01,+0.000000000000000000e+00,
+	+3.180688191142348464e-01,+5.000000000000000000e-01,+3.180688191142348464e-01,+0.000000000000000000e+00,-1.053821288342279283e-01,+0.000000000000000000e+00,+6.246674364090010201e-02,+0.000000000000000000e+00,
+	-4.381348607377702487e-02,+0.000000000000000000e+00,+3.325798471890276109e-02,+0.000000000000000000e+00,-2.639423941126861628e-02,+0.000000000000000000e+00,+2.152953082804151541e-02,+0.000000000000000000e+00,
+	-1.787528200298799108e-02,+0.000000000000000000e+00,+1.501498904006549895e-02,+0.000000000000000000e+00,-1.270817792728655415e-02,+0.000000000000000000e+00,+1.080631584702385073e-02,+0.000000000000000000e+00,
+	-9.212693064803968712e-03,+0.000000000000000000e+00,+7.861471443574193085e-03,+0.000000000000000000e+00,-6.706097076588202199e-03,+0.000000000000000000e+00,+5.712548868409508818e-03,+0.000000000000000000e+00,
+	-4.855123881579222200e-03,+0.000000000000000000e+00,+4.113883843139883034e-03,+0.000000000000000000e+00,-3.472912507419143036e-03,+0.000000000000000000e+00,+2.919167335030439445e-03,+0.000000000000000000e+00,
+	-2.441765852310725723e-03,+0.000000000000000000e+00,+2.031383662255123457e-03,+0.000000000000000000e+00,-1.679943363832168100e-03,+0.000000000000000000e+00,+1.380345259765910874e-03,+0.000000000000000000e+00,
+	-1.126250273922289012e-03,+0.000000000000000000e+00,+9.120206906836569004e-04,+0.000000000000000000e+00,-7.325602758044462773e-04,+0.000000000000000000e+00,+5.832851494947839666e-04,+0.000000000000000000e+00,
+	-4.600876464221413751e-04,+0.000000000000000000e+00,+3.592427996426082737e-04,+0.000000000000000000e+00,-2.774513736468349999e-04,+0.000000000000000000e+00,+2.117580843219892114e-04,+0.000000000000000000e+00,
+	-1.595410373655345177e-04,+0.000000000000000000e+00,+1.185257920208807048e-04,+0.000000000000000000e+00,-8.669439705637942747e-05,+0.000000000000000000e+00,+6.233233817221626224e-05,+0.000000000000000000e+00,
+	-4.396920704885843071e-05,+0.000000000000000000e+00,+3.034271051043731151e-05,+0.000000000000000000e+00,-2.043255336540721105e-05,+0.000000000000000000e+00,+1.336453389782321538e-05,+0.000000000000000000e+00,
+	-8.443777897697571572e-06,+0.000000000000000000e+00,+5.121676043182892247e-06,+0.000000000000000000e+00,-2.938743296975117730e-06,+0.000000000000000000e+00,+1.573933054569674047e-06,+0.000000000000000000e+00,
+	-7.601428289727028490e-07,+0.000000000000000000e+00,+3.415264115860542801e-07,
+};
+
+// 4*fout -> 2*fout
+const static dsf2flac_int32 nCoefs_halfband_second = 27;
+const static dsf2flac_float64 coefs_halfband_second[27] = {
+	+7.473811122216526847e-05,+0.000000000000000000e+00,-6.912374136481439857e-04,+0.000000000000000000e+00,+3.381848833358114086e-03,+0.000000000000000000e+00,-1.164920069888894863e-02,+0.000000000000000000e+00,
+	+3.239001840904558172e-02,+0.000000000000000000e+00,-8.353862333870651358e-02,+0.000000000000000000e+00,+3.100325574389850014e-01,+5.000000000000000000e-01,+3.100325574389850014e-01,+0.000000000000000000e+00,
+	-8.353862333870651358e-02,+0.000000000000000000e+00,+3.239001840904558172e-02,+0.000000000000000000e+00,-1.164920069888894863e-02,+0.000000000000000000e+00,+3.381848833358114086e-03,+0.000000000000000000e+00,
+	-6.912374136481439857e-04,+0.000000000000000000e+00,+7.473811122216526847e-05,
+};
+
+// 8*fout -> 4*fout
+const static dsf2flac_int32 nCoefs_halfband_third = 19;
+const static dsf2flac_float64 coefs_halfband_third[19] = {
+	+3.557847332318650295e-04,+0.000000000000000000e+00,-3.671112068318138719e-03,+0.000000000000000000e+00,+1.888531015769587262e-02,+0.000000000000000000e+00,-6.943666714354337910e-02,+0.000000000000000000e+00,
+	+3.038666884983780014e-01,+5.000000000000000000e-01,+3.038666884983780014e-01,+0.000000000000000000e+00,-6.943666714354337910e-02,+0.000000000000000000e+00,+1.888531015769587262e-02,+0.000000000000000000e+00,
+	-3.671112068318138719e-03,+0.000000000000000000e+00,+3.557847332318650295e-04,
+};
+
+// every earlier stage
+const static dsf2flac_int32 nCoefs_halfband_early = 11;
+const static dsf2flac_float64 coefs_halfband_early[11] = {
+	+6.088307791130110475e-03,+0.000000000000000000e+00,-4.950508393696152754e-02,+0.000000000000000000e+00,+2.934168309620108772e-01,+5.000000000000000000e-01,+2.934168309620108772e-01,+0.000000000000000000e+00,
+	-4.950508393696152754e-02,+0.000000000000000000e+00,+6.088307791130110475e-03,
+};
@@ -0,0 +1,176 @@
+/*
+ * dsf2flac - http://code.google.com/p/dsf2flac/
+ *
+ * A file conversion tool for translating dsf dsd audio files into
+ * flac pcm audio files.
+ *
+ * Copyright (c) 2013 by respective authors.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *
+ * Acknowledgments
+ *
+ * Many thanks to the following authors and projects whose work has greatly
+ * helped the development of this tool.
+ *
+ *
+ * Sebastian Gesemann - dsd2pcm (http://code.google.com/p/dsd2pcm/)
+ * SACD Ripper (http://code.google.com/p/sacd-ripper/)
+ * Maxim V.Anisiutkin - foo_input_sacd (http://sourceforge.net/projects/sacddecoder/files/)
+ * Vladislav Goncharov - foo_input_sacd_hq (http://vladgsound.wordpress.com)
+ * Jesus R - www.sonore.us
+ *
+ */
+
+#include "fir_filter.h"
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <zlib.h>
+
+static std::mutex filtersMutex;
+static std::map<dsf2flac_uint32, std::shared_ptr<FirFilter> > filters;
+static bool cacheDirSet = false;
+static std::string cacheDir;
+
+FirFilter::FirFilter(const std::string& path)
+{
+	ratio = 0;
+	tzero = -1;
+	hash = 0;
+	valid = false;
+	errorMsg = "";
+
+	std::ifstream file(path.c_str());
+	if (!file) {
+		errorMsg = "can't open the filter file " + path;
+		return;
+	}
+	// the key value lines, up to the coefficients
+	dsf2flac_int32 nTaps = -1;
+	bool symmetric = false;
+	bool inCoefs = false;
+	std::string line;
+	while (std::getline(file, line)) {
+		std::string::size_type comment = line.find('#');
+		if (comment != std::string::npos)
+			line.erase(comment);
+		std::istringstream ss(line);
+		if (inCoefs) {
+			dsf2flac_float64 c;
+			while (ss >> c)
+				coefs.push_back(c);
+			if (!ss.eof()) {
+				errorMsg = "not a number in the coefficients of " + path;
+				return;
+			}
+			continue;
+		}
+		std::string key, value;
+		if (!(ss >> key))
+			continue;
+		if (key == "coefficients") {
+			inCoefs = true;
+			continue;
+		}
+		if (!(ss >> value)) {
+			errorMsg = "no value for " + key + " in " + path;
+			return;
+		}
+		if (key == "ratio")
+			ratio = atoi(value.c_str());
+		else if (key == "taps")
+			nTaps = atoi(value.c_str());
+		else if (key == "tzero")
+			tzero = atoi(value.c_str());
+		else if (key == "symmetric")
+			symmetric = value == "yes" || value == "1" || value == "true";
+		else {
+			errorMsg = "unknown key " + key + " in " + path;
+			return;
+		}
+	}
+	if (ratio < 8 || ratio % 8) {
+		errorMsg = "the ratio must be a multiple of 8 in " + path;
+		return;
+	}
+	if (symmetric) {
+		if (nTaps < 1 || (dsf2flac_int32) coefs.size() != (nTaps+1)/2) {
+			errorMsg = "a symmetric filter needs taps and the first (taps+1)/2 coefficients in " + path;
+			return;
+		}
+		for (dsf2flac_int32 k=coefs.size(); k<nTaps; k++)
+			coefs.push_back(coefs[nTaps-1-k]);
+	}
+	if (coefs.empty() || (nTaps >= 0 && (dsf2flac_int32) coefs.size() != nTaps)) {
+		errorMsg = "the number of coefficients does not match taps in " + path;
+		return;
+	}
+	if (tzero < 0)
+		tzero = (coefs.size()+7)/16*8;
+	if (tzero % 8) {
+		errorMsg = "tzero must be a multiple of 8 in " + path;
+		return;
+	}
+	hash = crc32(0, (const Bytef*) &coefs[0], coefs.size()*sizeof(dsf2flac_float64));
+	valid = true;
+}
+
+FirFilter::~FirFilter()
+{
+}
+
+std::string FirFilter::getTablePath(bool msbFirst)
+{
+	std::lock_guard<std::mutex> lock(filtersMutex);
+	if (!cacheDirSet) {
+		const char* xdg = getenv("XDG_CACHE_HOME");
+		const char* home = getenv("HOME");
+		if (xdg && *xdg)
+			cacheDir = std::string(xdg) + "/dsf2flac";
+		else if (home && *home)
+			cacheDir = std::string(home) + "/.cache/dsf2flac";
+		cacheDirSet = true;
+	}
+	if (cacheDir.empty())
+		return "";
+	char name[64];
+	snprintf(name, sizeof(name), "/lut-%08x-%d-%s.bin", hash, getNumCoefs(), msbFirst ? "msb" : "lsb");
+	return cacheDir + name;
+}
+
+void FirFilter::add(std::shared_ptr<FirFilter> filter)
+{
+	std::lock_guard<std::mutex> lock(filtersMutex);
+	filters[filter->getRatio()] = filter;
+}
+
+std::shared_ptr<FirFilter> FirFilter::find(dsf2flac_uint32 ratio)
+{
+	std::lock_guard<std::mutex> lock(filtersMutex);
+	std::map<dsf2flac_uint32, std::shared_ptr<FirFilter> >::iterator it = filters.find(ratio);
+	return it == filters.end() ? std::shared_ptr<FirFilter>() : it->second;
+}
+
+void FirFilter::setCacheDir(const std::string& dir)
+{
+	std::lock_guard<std::mutex> lock(filtersMutex);
+	cacheDir = dir;
+	cacheDirSet = true;
+}
@@ -0,0 +1,104 @@
+/*
+ * dsf2flac - http://code.google.com/p/dsf2flac/
+ *
+ * A file conversion tool for translating dsf dsd audio files into
+ * flac pcm audio files.
+ *
+ * Copyright (c) 2013 by respective authors.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *
+ * Acknowledgments
+ *
+ * Many thanks to the following authors and projects whose work has greatly
+ * helped the development of this tool.
+ *
+ *
+ * Sebastian Gesemann - dsd2pcm (http://code.google.com/p/dsd2pcm/)
+ * SACD Ripper (http://code.google.com/p/sacd-ripper/)
+ * Maxim V.Anisiutkin - foo_input_sacd (http://sourceforge.net/projects/sacddecoder/files/)
+ * Vladislav Goncharov - foo_input_sacd_hq (http://vladgsound.wordpress.com)
+ * Jesus R - www.sonore.us
+ *
+ */
+
+#ifndef FIRFILTER_H
+#define FIRFILTER_H
+
+#include "dsf2flac_types.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * A decimation filter loaded from a file at runtime (dsf2flac --filter), which the DsdDecimator
+ * uses instead of its built-in filter for the same ratio.
+ *
+ * A filter file is text. Blank lines and everything after a # are ignored. It starts with
+ * "key value" lines:
+ *
+ * ratio N       the decimation ratio, DSD rate / PCM rate (before any 48kHz resampling), a multiple of 8
+ * taps N        the length of the impulse response, needed if symmetric
+ * tzero N       the filter t=0 position in DSD samples, a multiple of 8 (by default the middle tap rounded to 8)
+ * symmetric B   yes if only the first (taps+1)/2 coefficients are given, the rest mirror them
+ *
+ * followed by a line holding "coefficients" and then the impulse response at the DSD rate,
+ * separated by spaces or new lines.
+ *
+ * Building the lookup tables of a long filter takes a while, so they are saved in the cache
+ * folder, named after a crc32 of the coefficients, and mapped into memory on later runs.
+ */
+class FirFilter
+{
+public:
+	/// Class constructor, loads the filter file at path.
+	FirFilter(const std::string& path);
+	virtual ~FirFilter();
+
+	/// Return false if the file could not be loaded.
+	bool isValid() { return valid; };
+	/// Returns a message explaining why the file could not be loaded.
+	std::string getErrorMsg() { return errorMsg; };
+
+	/// Return the decimation ratio the filter is for.
+	dsf2flac_uint32 getRatio() { return ratio; };
+	/// Return the number of coefficients.
+	dsf2flac_int32 getNumCoefs() { return coefs.size(); };
+	/// Return the impulse response at the DSD rate.
+	const dsf2flac_float64* getCoefs() { return &coefs[0]; };
+	/// Return the filter t=0 position in DSD samples.
+	dsf2flac_int32 getTzero() { return tzero; };
+	/// Return a crc32 of the coefficients, identifying the filter.
+	dsf2flac_uint32 getHash() { return hash; };
+	/// Return the file the lookup table for the bit order is cached in, empty if there is no cache folder.
+	std::string getTablePath(bool msbFirst);
+
+	/// Makes the DsdDecimators created from now on with the filter's ratio use it.
+	static void add(std::shared_ptr<FirFilter> filter);
+	/// Return the filter added for ratio, or NULL to use the built-in one.
+	static std::shared_ptr<FirFilter> find(dsf2flac_uint32 ratio);
+	/// Sets the folder the lookup tables are cached in, empty for none. It is $XDG_CACHE_HOME/dsf2flac or ~/.cache/dsf2flac by default.
+	static void setCacheDir(const std::string& dir);
+private:
+	dsf2flac_uint32 ratio;
+	std::vector<dsf2flac_float64> coefs;
+	dsf2flac_int32 tzero;
+	dsf2flac_uint32 hash;
+	bool valid;
+	std::string errorMsg;
+};
+
+#endif // FIRFILTER_H
@@ -46,24 +46,121 @@
   */
 
 #include "fstream_plus.h"
+#include <algorithm>
+#include <string.h>
+#include <sys/stat.h>
+
+const stream_size fstreamPlus::streamHistory;
 
 fstreamPlus::fstreamPlus() : std::fstream()
 {
+	forwardOnly = false;
+	streamPos = 0;
+	streamEnd = 0;
 }
 
 fstreamPlus::~fstreamPlus()
 {
 }
 
+void fstreamPlus::open(const char* path, ios_base::openmode mode)
+{
+	if (!strcmp(path,"-"))
+		path = "/dev/stdin";
+	// stdin redirected from a file is still seekable
+	struct stat st;
+	forwardOnly = !stat(path,&st) && !S_ISREG(st.st_mode);
+	streamPos = 0;
+	streamEnd = 0;
+	if (forwardOnly)
+		history.resize(streamHistory);
+	std::fstream::open(path,mode);
+}
+
 /** Overload seekg methods to return true on fail **/
 bool fstreamPlus::seekg(std::streampos pos)
 {
-	std::fstream::seekg(pos);
-	return !good();
+	if (!forwardOnly) {
+		std::fstream::seekg(pos);
+		return !good();
+	}
+	// like std::istream::seekg, the end of the stream may have been reached but nothing else
+	clear(rdstate() & ~std::ios_base::eofbit);
+	if (fail())
+		return true;
+	dsf2flac_int64 p = (std::streamoff) pos;
+	if (p > (dsf2flac_int64) streamEnd)
+		return skipTo(p);
+	if (p < 0 || p + streamHistory < streamEnd) {
+		setstate(std::ios_base::failbit);
+		return true;
+	}
+	streamPos = p;
+	return false;
 }
 bool fstreamPlus::seekg(std::streamoff pos, ios_base::seekdir way)
 {
-	std::fstream::seekg(pos,way);
+	if (!forwardOnly) {
+		std::fstream::seekg(pos,way);
+		return !good();
+	}
+	// the end of a stream isn't known until it has been read
+	if (way == std::ios_base::end) {
+		setstate(std::ios_base::failbit);
+		return true;
+	}
+	if (way == std::ios_base::cur)
+		pos += streamPos;
+	return seekg(std::streampos(pos));
+}
+
+std::streampos fstreamPlus::tellg()
+{
+	if (!forwardOnly)
+		return std::fstream::tellg();
+	if (fail())
+		return std::streampos(-1);
+	return std::streampos(streamPos);
+}
+
+void fstreamPlus::readChars(char* b, stream_size n)
+{
+	if (!forwardOnly) {
+		read(b,n);
+		return;
+	}
+	// replay anything we have seeked back over
+	while (n > 0 && streamPos < streamEnd) {
+		stream_size i = streamPos % streamHistory;
+		stream_size m = std::min(std::min(n, streamEnd - streamPos), streamHistory - i);
+		memcpy(b, &history[i], m);
+		b += m;
+		n -= m;
+		streamPos += m;
+	}
+	if (n == 0)
+		return;
+	read(b,n);
+	// keep the last streamHistory bytes for seeking back to
+	stream_size got = gcount();
+	stream_size k = got > streamHistory ? got - streamHistory : 0;
+	while (k < got) {
+		stream_size i = (streamEnd + k) % streamHistory;
+		stream_size m = std::min(got - k, streamHistory - i);
+		memcpy(&history[i], b + k, m);
+		k += m;
+	}
+	streamPos += got;
+	streamEnd += got;
+}
+
+bool fstreamPlus::skipTo(stream_size pos)
+{
+	// read up to pos and throw it away
+	char scratch[4096];
+	streamPos = streamEnd;
+	while (streamPos < pos && good())
+		readChars(scratch, std::min<stream_size>(pos - streamPos, sizeof(scratch)));
 	return !good();
 }
 
@@ -82,11 +179,11 @@ bool fstreamPlus::read_uint64_rev	(dsf2flac_uint64* b,stream_size n) {return rea
 
 /** templates for the readers **/
 template<typename rType> bool fstreamPlus::read_helper(rType* b, stream_size n) {
-	read( reinterpret_cast<char*>(b), sizeof(rType)*n);
+	readChars( reinterpret_cast<char*>(b), sizeof(rType)*n);
 	return bad();
 }
 template<typename rType> bool fstreamPlus::read_helper_rev(rType* b, stream_size n) {
-	read( reinterpret_cast<char*>(b), sizeof(rType)*n);
+	readChars( reinterpret_cast<char*>(b), sizeof(rType)*n);
 	reverseByteOrder(b,n);
 	return bad();
 }
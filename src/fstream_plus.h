@@ -49,6 +49,7 @@
 #define FILEPLUS_H
 
 #include <fstream>
+#include <vector>
 #include "dsf2flac_types.h"
 
 typedef dsf2flac_uint64 stream_size;
@@ -59,9 +60,19 @@ public:
 	fstreamPlus();
 	virtual ~fstreamPlus();
 	
+	/**
+	 * Overload open so that "-" reads stdin. Anything which is not a regular file (stdin,
+	 * a pipe or a FIFO) is read forward only: it is never seeked, seeking forward skips
+	 * the bytes and only the last streamHistory bytes read can be seeked back to.
+	 **/
+	void open(const char* path, ios_base::openmode mode);
+	bool isForwardOnly() { return forwardOnly; }
+	
 	/** Overload seekg methods to return true on fail **/
 	bool seekg(std::streampos pos);
 	bool seekg(std::streamoff pos, ios_base::seekdir way);
+	/** Overload tellg, which can't ask a forward only stream **/
+	std::streampos tellg();
 	
 	/** Additional read methods - native bit order **/
 	// All return true on error. All read "n" numbers (not n chars/bytes!)
@@ -88,8 +99,20 @@ public:
 	
 	char* getFilePath();
 	
+	/// how far back a forward only stream can be seeked, enough to reread the headers and first block.
+	static const stream_size streamHistory = 1<<20;
+	
 private:
 
+	bool forwardOnly;
+	stream_size streamPos;	// the position of the next byte to be read
+	stream_size streamEnd;	// the number of bytes taken from the stream
+	std::vector<char> history;	// the last bytes taken from the stream, a ring indexed by position
+	
+	/** reads n chars, from the history first if we have seeked back in a forward only stream **/
+	void readChars(char* b, stream_size n);
+	bool skipTo(stream_size pos);
+	
 	/** templates for the readers **/
 	template<typename rType> bool read_helper(rType* b, stream_size n);
 	template<typename rType> bool read_helper_rev(rType* b, stream_size n);
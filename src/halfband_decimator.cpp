@@ -0,0 +1,66 @@
+/*
+ * dsf2flac - http://code.google.com/p/dsf2flac/
+ *
+ * A file conversion tool for translating dsf dsd audio files into
+ * flac pcm audio files.
+ *
+ * Copyright (c) 2013 by respective authors.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *
+ * Acknowledgments
+ *
+ * Many thanks to the following authors and projects whose work has greatly
+ * helped the development of this tool.
+ *
+ *
+ * Sebastian Gesemann - dsd2pcm (http://code.google.com/p/dsd2pcm/)
+ * SACD Ripper (http://code.google.com/p/sacd-ripper/)
+ * Maxim V.Anisiutkin - foo_input_sacd (http://sourceforge.net/projects/sacddecoder/files/)
+ * Vladislav Goncharov - foo_input_sacd_hq (http://vladgsound.wordpress.com)
+ * Jesus R - www.sonore.us
+ *
+ */
+
+#include "halfband_decimator.h"
+
+HalfbandDecimator::HalfbandDecimator(const dsf2flac_int32 n, const dsf2flac_float64* coefs)
+{
+	nCoefs = n;
+	// the even taps, padded to a multiple of 4
+	dsf2flac_uint32 nEven = (nCoefs+1)/2;
+	nTaps = (nEven+3)/4*4;
+	taps.assign(nTaps,0);
+	for (dsf2flac_uint32 k=0; k<nEven; k++)
+		taps[k] = coefs[2*k];
+	// the middle tap is the (nCoefs+1)/4 th odd one back
+	middle.resize((nCoefs+1)/4);
+	inputs.resize(2*nTaps);
+	reset();
+}
+
+HalfbandDecimator::~HalfbandDecimator()
+{
+}
+
+void HalfbandDecimator::reset()
+{
+	inputs.assign(inputs.size(),0);
+	middle.assign(middle.size(),0);
+	inputPos = 0;
+	middlePos = 0;
+	onOutput = true;
+}
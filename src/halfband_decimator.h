@@ -0,0 +1,106 @@
+/*
+ * dsf2flac - http://code.google.com/p/dsf2flac/
+ *
+ * A file conversion tool for translating dsf dsd audio files into
+ * flac pcm audio files.
+ *
+ * Copyright (c) 2013 by respective authors.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *
+ * Acknowledgments
+ *
+ * Many thanks to the following authors and projects whose work has greatly
+ * helped the development of this tool.
+ *
+ *
+ * Sebastian Gesemann - dsd2pcm (http://code.google.com/p/dsd2pcm/)
+ * SACD Ripper (http://code.google.com/p/sacd-ripper/)
+ * Maxim V.Anisiutkin - foo_input_sacd (http://sourceforge.net/projects/sacddecoder/files/)
+ * Vladislav Goncharov - foo_input_sacd_hq (http://vladgsound.wordpress.com)
+ * Jesus R - www.sonore.us
+ *
+ */
+
+#ifndef HALFBANDDECIMATOR_H
+#define HALFBANDDECIMATOR_H
+
+#include "dsf2flac_types.h"
+#include <vector>
+
+/**
+ * One half-band stage of the DsdDecimator cascade for one channel: a FIR filter which halves
+ * the sample rate.
+ *
+ * Every other tap of a half-band filter is zero and the middle one is 0.5, so each output only
+ * needs the taps of one polyphase branch (a dot product over contiguous inputs, written so that
+ * the compiler can vectorise it) plus one input from the other branch.
+ */
+class HalfbandDecimator
+{
+public:
+	/**
+	 * Class constructor.
+	 * coefs is the impulse response at the input rate, nCoefs long which must be 4k+3.
+	 */
+	HalfbandDecimator(const dsf2flac_int32 nCoefs, const dsf2flac_float64* coefs);
+	virtual ~HalfbandDecimator();
+
+	/// Clears the history, the next input is on an output.
+	void reset();
+	/// Return the delay through the filter in input samples.
+	dsf2flac_uint32 getDelay() { return nCoefs/2; };
+	/// Takes the next input, every second one (starting with the first after reset()) gives an output in out.
+	inline bool push(dsf2flac_float64 in, dsf2flac_float64& out);
+private:
+	dsf2flac_uint32 nCoefs;
+	std::vector<dsf2flac_float64> taps; // the non zero taps beside the middle, padded with zeros to a multiple of 4
+	dsf2flac_uint32 nTaps;
+	std::vector<dsf2flac_float64> inputs; // the inputs the taps apply to, newest first, stored twice so that nTaps are always contiguous
+	dsf2flac_uint32 inputPos;
+	std::vector<dsf2flac_float64> middle; // the other inputs, a ring waiting to reach the middle tap
+	dsf2flac_uint32 middlePos;
+	bool onOutput;
+};
+
+bool HalfbandDecimator::push(dsf2flac_float64 in, dsf2flac_float64& out)
+{
+	if (!onOutput) {
+		middle[middlePos] = in;
+		if (++middlePos == middle.size())
+			middlePos = 0;
+		onOutput = true;
+		return false;
+	}
+	inputPos = inputPos ? inputPos-1 : nTaps-1;
+	inputs[inputPos] = inputs[inputPos+nTaps] = in;
+	// four sums so that they can run side by side
+	const dsf2flac_float64* x = &inputs[inputPos];
+	const dsf2flac_float64* h = &taps[0];
+	dsf2flac_float64 s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+	for (dsf2flac_uint32 k=0; k<nTaps; k+=4) {
+		s0 += h[k]*x[k];
+		s1 += h[k+1]*x[k+1];
+		s2 += h[k+2]*x[k+2];
+		s3 += h[k+3]*x[k+3];
+	}
+	// the oldest of the other inputs is the one at the middle tap
+	out = (s0 + s1) + (s2 + s3) + 0.5*middle[middlePos];
+	onOutput = false;
+	return true;
+}
+
+#endif // HALFBANDDECIMATOR_H
@@ -41,62 +41,90 @@
 
 #include <boost/timer/timer.hpp>
 #include <boost/filesystem.hpp>
-#include <dsd_decimator.h>
 #include <dsf_file_reader.h>
 #include <dsdiff_file_reader.h>
-#include <tagConversion.h>
-#include <FLAC++/metadata.h>
-#include <FLAC++/encoder.h>
+#include <dsd_tee_reader.h>
+#include <conversion_sink.h>
+#include <dsf_file_writer.h>
+#include <dsdiff_file_writer.h>
+#include <batch_scheduler.h>
+#include <conversion_cache.h>
+#include <conversion_server.h>
+#include <realtime_streamer.h>
+#include <progress_metrics.h>
+#include <stage_timer.h>
+#include <fir_filter.h>
 #include <math.h>
 #include <cmdline.h>
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <list>
+#include <signal.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include <sstream>
-#include <dop_packer.h>
-#include <AudioFile.h>
+#include <thread>
+#include <vector>
 
-typedef struct {
-    uint8_t Bits1;
-    uint8_t Bits2;
-    uint8_t Marker;
-} DopSample;
+static ProgressMetrics metrics; // how the run is going, reported by --metrics-fd and --metrics-file
+static ConversionCache* cache = NULL; // set by --cache
+static ConversionServer* server = NULL; // set by --serve
+static std::atomic<bool> statsRequested(false); // set by SIGUSR1 when --stats is given
+static std::atomic<bool> cacheKeeperStop(false); // ends keep_cache at the end of the run
+static std::string filterSettings = "builtin"; // the --quality preset and the --filter filters, by ratio and crc32
 
-template class AudioFile<DopSample>;
+/// Reports how far a conversion has got, in percent.
+typedef std::function<void (dsf2flac_float64 percent)> ProgressFunction;
 
-#define flacBlockLen 1024
-#define waveBlockLen 1024
+/// What became of one input (or track) in a batch.
+enum JobResult { JOB_FAILED, JOB_DONE, JOB_SKIPPED };
 
-using boost::timer::cpu_timer;
-using boost::timer::cpu_times;
-using boost::timer::nanosecond_type;
-
-static nanosecond_type reportInterval(100000000LL);
-static cpu_timer timer;
-static dsf2flac_float64 lastPos;
+/**
+ * void request_stats(int sig)
+ *
+ * SIGUSR1 handler, asks for the stage timings so far to be printed.
+ */
+void request_stats(int sig) {
+    statsRequested = true;
+}
 
 /**
- * void setupTimer(dsf2flac_float64 currPos)
+ * void check_stats_request()
  *
- * called by main to setup the boost timer for reporting progress to the user
+ * called regularly during conversions, prints the stage timings of every thread if SIGUSR1 was received.
  */
-void setupTimer(dsf2flac_float64 currPos) {
-    timer = cpu_timer();
-    lastPos = currPos;
+void check_stats_request() {
+    if (!statsRequested.exchange(false))
+        return;
+    StageTotals totals[NUM_STAGES];
+    StageTimer::getTotals(totals);
+    std::string line = "{\"snapshot\":true,\"stages\":" + StageTimer::toJson(totals) + "}\n";
+    fputs(line.c_str(), stderr);
 }
 
 /**
- * void checkTimer(dsf2flac_float64 currPos, dsf2flac_float64 percent)
+ * void keep_cache
  *
- * called to report progress to the user.
+ * runs in its own thread while --cache is in use and writes the manifest as conversions finish,
+ * so they are remembered even if the process is killed. In --batch SIGINT and SIGTERM are blocked
+ * in every other thread and taken here: the manifest is saved, then the signal ends the process.
  */
-void checkTimer(dsf2flac_float64 currPos, dsf2flac_float64 percent) {
-    cpu_times const elapsed_times(timer.elapsed());
-    nanosecond_type const elapsed(elapsed_times.system + elapsed_times.user);
-    if (elapsed >= reportInterval) {
-        fprintf(stderr, "\33[2K\r");
-        fprintf(stderr, "Rate: %4.1fx\t", (currPos - lastPos) / elapsed * 1000000000);
-        fprintf(stderr, "Progress: %3.0f%%", percent);
-        fflush(stderr);
-        lastPos = currPos;
-        timer = cpu_timer();
+void keep_cache(sigset_t stopSignals) {
+    struct timespec second = {1, 0};
+    while (!cacheKeeperStop) {
+        int sig = sigtimedwait(&stopSignals, NULL, &second);
+        if (sig > 0) {
+            fprintf(stderr, "\nInterrupted, saving the cache\n");
+            if (!cache->save())
+                fprintf(stderr, "WARNING: %s\n", cache->getErrorMsg().c_str());
+            signal(sig, SIG_DFL);
+            pthread_sigmask(SIG_UNBLOCK, &stopSignals, NULL);
+            raise(sig);
+        } else if (!cache->saveIfDue()) {
+            fprintf(stderr, "WARNING: %s\n", cache->getErrorMsg().c_str());
+        }
     }
 }
 
@@ -115,459 +143,912 @@ boost::filesystem::path muti_track_name_helper(boost::filesystem::path outpath,
 }
 
 /**
- * int track_helper()
- *
- * converts a track at a time to PCM FLAC
+ * int do_conversion
  *
+ * converts each track in the reader (or just track, if it is not -1) with every sink.
+ * The sinks may share one input through a DsdTeeReader, so the input is read (and decoded)
+ * once for all of them. The files written successfully are added to written, if given,
+ * and progress (if set) is told how far through the input the conversion is.
  */
-int pcm_track_helper(
-        boost::filesystem::path outpath,
-        DsdDecimator* dec,
-        int bits,
-        dsf2flac_float64 scale,
-        dsf2flac_float64 tpdfDitherPeakAmplitude,
-        dsf2flac_float64 clipAmplitude,
-        dsf2flac_float64 startPos,
-        dsf2flac_float64 endPos,
-        ID3_Tag id3tag) {
+int do_conversion(
+        DsdSampleReader* dsr,
+        std::vector<ConversionSink*>& sinks,
+        std::vector<boost::filesystem::path>& outpaths,
+        bool verbose,
+        dsf2flac_int32 track,
+        std::vector<boost::filesystem::path>* written,
+        const ProgressFunction& progress
+        ) {
+    bool ok = true;
 
-    if (startPos > dec->getLength() - 1)
-        startPos = dec->getLength() - 1;
+    // the audio converted is added to the metrics as the outputs move on through the input
+    dsf2flac_int64 endPos = track < 0 ? dsr->getLength() : std::min<dsf2flac_int64>(dsr->getTrackEnd(track), dsr->getLength());
+    dsf2flac_int64 reportedPos = track < 0 ? 0 : dsr->getTrackStart(track);
+    for (dsf2flac_uint32 i = 0; i < sinks.size(); i++)
+        sinks[i]->setVerbose(verbose);
 
-    if (endPos > dec->getLength())
-        endPos = dec->getLength();
+    // convert each track in the file in turn
+    dsf2flac_uint32 firstTrack = track < 0 ? 0 : track;
+    dsf2flac_uint32 endTrack = track < 0 ? dsr->getNumTracks() : track + 1;
+    for (dsf2flac_uint32 n = firstTrack; n < endTrack; n++) {
+
+        // start the track in every sink
+        std::vector<bool> opened(sinks.size(), false);
+        std::vector<boost::filesystem::path> trackOutPaths(sinks.size());
+        for (dsf2flac_uint32 i = 0; i < sinks.size(); i++) {
+            // construct an appropriate filename for multi track files.
+            boost::filesystem::path& trackOutPath = trackOutPaths[i];
+            if (dsr->getNumTracks() > 1) {
+                trackOutPath = muti_track_name_helper(outpaths[i], n);
+            } else {
+                trackOutPath = outpaths[i];
+            }
 
-    // flac vars
-    bool ok = true;
-    FLAC::Encoder::File encoder;
-    FLAC__StreamEncoderInitStatus init_status;
-    FLAC__StreamMetadata * metadata[2];
+            if (verbose)
+                fprintf(stderr, "Output file\n\t%s\n", trackOutPath.c_str());
+            opened[i] = sinks[i]->openTrack(n, trackOutPath);
+            if (!opened[i]) {
+                fprintf(stderr, "ERROR: %s: %s\n", trackOutPath.c_str(), sinks[i]->getErrorMsg().c_str());
+                ok = false;
+            }
+        }
 
-    // setup the encoder
-    if (!encoder) {
-        fprintf(stderr, "ERROR: allocating encoder\n");
-        return 0;
-    }
-    ok &= encoder.set_verify(true);
-    ok &= encoder.set_compression_level(5);
-    ok &= encoder.set_channels(dec->getNumChannels());
-    ok &= encoder.set_bits_per_sample(bits);
-    ok &= encoder.set_sample_rate(dec->getOutputSampleRate());
-    ok &= encoder.set_total_samples_estimate(endPos - startPos);
-
-    // add tags and a padding block
-    if (ok) {
-        metadata[0] = id3v2_to_flac(id3tag);
-        metadata[1] = FLAC__metadata_object_new(FLAC__METADATA_TYPE_PADDING);
-        metadata[1]->length = 2048; /* set the padding length */
-        ok = encoder.set_metadata(metadata, 2);
-    }
-
-    // initialize encoder
-    if (ok) {
-        if (!strcmp(outpath.c_str(), "-"))
-            init_status = encoder.init((FILE *) stdout);
-        else // outpath.c_str());
-            init_status = encoder.init(outpath.c_str());
-        if (init_status != FLAC__STREAM_ENCODER_INIT_STATUS_OK) {
-            fprintf(stderr, "ERROR: initializing encoder: %s\n", FLAC__StreamEncoderInitStatusString[init_status]);
-            ok = false;
+        // MAIN CONVERSION LOOP //
+        // always advance the sink that is furthest behind, so that the sinks stay in step
+        // and the shared input can be released as soon as possible.
+        std::vector<bool> running(opened);
+        while (true) {
+            dsf2flac_int32 next = -1;
+            for (dsf2flac_uint32 i = 0; i < sinks.size(); i++) {
+                if (!running[i] || sinks[i]->trackDone())
+                    continue;
+                if (next < 0 || sinks[i]->getPosition() < sinks[next]->getPosition())
+                    next = i;
+            }
+            if (next < 0)
+                break;
+            if (!sinks[next]->process()) {
+                running[next] = false; // give up on this output
+                ok = false;
+            }
+            dsf2flac_int64 pos = std::min(sinks[next]->getPosition(), endPos);
+            if (pos > reportedPos) {
+                metrics.addAudioDone((dsf2flac_float64) (pos - reportedPos) / dsr->getSamplingFreq());
+                reportedPos = pos;
+            }
+            if (verbose)
+                metrics.printProgress();
+            if (progress)
+                progress(100.0 * sinks[next]->getPosition() / dsr->getLength());
+            check_stats_request();
         }
-    }
 
-    // return if there is a problem with any of the flac stuff.
-    if (!ok)
-        return ok;
-
-    // creep up to the start point.
-    while (dec->getPosition() < startPos) {
-        dec->step();
-    }
-    // create a FLAC__int32 buffer to hold the samples as they are converted
-    unsigned int bufferLen = dec->getNumChannels() * flacBlockLen;
-    FLAC__int32* buffer = new FLAC__int32[bufferLen];
-    // MAIN CONVERSION LOOP //
-    while (dec->getPosition() <= endPos - flacBlockLen) {
-        dec->getSamples(buffer, bufferLen, scale, tpdfDitherPeakAmplitude, clipAmplitude);
-        if (!(ok = encoder.process_interleaved(buffer, flacBlockLen)))
-            fprintf(stderr, "   state: %s\n", encoder.get_state().resolved_as_cstring(encoder));
-        checkTimer(dec->getPositionInSeconds(), dec->getPositionAsPercent());
-    }
-    // delete the old buffer and make a new one with a single sample per chan
-    delete[] buffer;
-    buffer = new FLAC__int32[dec->getNumChannels()];
-    // creep up to the end
-    while (dec->getPosition() <= endPos) {
-        dec->getSamples(buffer, dec->getNumChannels(), scale, tpdfDitherPeakAmplitude, clipAmplitude);
-        if (!(ok = encoder.process_interleaved(buffer, 1)))
-            fprintf(stderr, "   state: %s\n", encoder.get_state().resolved_as_cstring(encoder));
-        checkTimer(dec->getPositionInSeconds(), dec->getPositionAsPercent());
-    }
-    delete[] buffer;
-    // close the flac file
-    ok &= encoder.finish();
-    // report back to the user
-    fprintf(stderr, "\33[2K\r");
-    fprintf(stderr, "%3.1f%%\t", dec->getPositionAsPercent());
-    if (ok) {
-        fprintf(stderr, "Conversion completed sucessfully.\n");
-    } else {
-        fprintf(stderr, "\nError during conversion.\n");
-        fprintf(stderr, "encoding: %s\n", ok ? "succeeded" : "FAILED");
-        fprintf(stderr, "   state: %s\n", encoder.get_state().resolved_as_cstring(encoder));
+        // finish the track and report back to the user
+        for (dsf2flac_uint32 i = 0; i < sinks.size(); i++) {
+            if (!opened[i])
+                continue;
+            bool trackOk = sinks[i]->closeTrack() && running[i];
+            ok &= trackOk;
+            if (trackOk && written)
+                written->push_back(trackOutPaths[i]);
+            if (!verbose && trackOk)
+                continue;
+            fprintf(stderr, "\33[2K\r");
+            fprintf(stderr, "%3.1f%%\t", 100.0 * sinks[i]->getPosition() / dsr->getLength());
+            if (trackOk) {
+                fprintf(stderr, "Conversion completed sucessfully.\n");
+            } else {
+                fprintf(stderr, "\nError during conversion.\n");
+                fprintf(stderr, "encoding: %s\n", trackOk ? "succeeded" : "FAILED");
+                fprintf(stderr, "   state: %s\n", sinks[i]->getErrorMsg().c_str());
+            }
+        }
     }
-    // free things
-    FLAC__metadata_object_delete(metadata[0]);
-    FLAC__metadata_object_delete(metadata[1]);
 
+    // the outputs stop a little short of the end (the filter's last samples), count them too
+    if (ok && endPos > reportedPos)
+        metrics.addAudioDone((dsf2flac_float64) (endPos - reportedPos) / dsr->getSamplingFreq());
     return ok;
 }
 
-/*
- * do_pcm_conversion
+/**
+ * ConversionSink* make_sink
  *
- * this function uses a dsdDecimator to do the conversion into PCM.
+ * creates a sink from one entry of the --outputs list:
+ * flac[:RATE[:BITS]][=FILE], dop[=FILE], dopwav[=FILE], dsf[=FILE] or dff[=FILE]
+ * missing values are taken from the other options.
  */
-int do_pcm_conversion(
+ConversionSink* make_sink(
+        std::string spec,
         DsdSampleReader* dsr,
         int fs,
         int bits,
         bool dither,
         dsf2flac_float64 userScale,
-        boost::filesystem::path inpath,
-        boost::filesystem::path outpath
+        boost::filesystem::path defaultOutpath,
+        boost::filesystem::path& outpath
         ) {
+    // split off the file name
+    std::string kind = spec;
+    std::string file;
+    size_t eq = spec.find('=');
+    if (eq != std::string::npos) {
+        kind = spec.substr(0, eq);
+        file = spec.substr(eq + 1);
+    }
+    // and the parameters
+    std::vector<std::string> params;
+    std::istringstream ss(kind);
+    std::string param;
+    while (std::getline(ss, param, ':'))
+        params.push_back(param);
+    if (params.empty())
+        return NULL;
+
+    // outputs without a file name are named after the default output.
+    std::string suffix;
+    ConversionSink* sink = NULL;
+    if (params[0] == "flac" && params.size() <= 3) {
+        if (params.size() > 1)
+            fs = atoi(params[1].c_str());
+        if (params.size() > 2)
+            bits = atoi(params[2].c_str());
+        if (bits != 16 && bits != 20 && bits != 24)
+            return NULL;
+        std::ostringstream s;
+        s << "_" << fs << ".flac";
+        suffix = s.str();
+        sink = new PcmFlacSink(dsr, fs, bits, dither, userScale);
+    } else if (params[0] == "dop" && params.size() == 1) {
+        suffix = "_dop.flac";
+        sink = new DopFlacSink(dsr);
+    } else if (params[0] == "dopwav" && params.size() == 1) {
+        suffix = "_dop.wav";
+        sink = new DopWaveSink(dsr);
+    } else if (params[0] == "dsf" && params.size() == 1) {
+        suffix = ".dsf";
+        sink = new DsdFileSink(dsr, new DsfFileWriter(dsr));
+    } else if (params[0] == "dff" && params.size() == 1) {
+        suffix = ".dff";
+        sink = new DsdFileSink(dsr, new DsdiffFileWriter(dsr));
+    } else {
+        return NULL;
+    }
 
-    bool ok = true;
+    if (!file.empty()) {
+        outpath = file;
+    } else {
+        outpath = defaultOutpath;
+        outpath.replace_extension();
+        outpath += suffix;
+    }
+    return sink;
+}
 
-    // create decimator
-    DsdDecimator dec(dsr, fs);
-    if (!dec.isValid()) {
-        fprintf(stderr, "%s\n", dec.getErrorMsg().c_str());
-        return 0;
+/**
+ * boost::filesystem::path default_outpath
+ *
+ * the output path used when none is given: the input path with the extension changed to suit the output.
+ */
+boost::filesystem::path default_outpath(const gengetopt_args_info& args_info, boost::filesystem::path inpath) {
+    // a pipeline carries on through stdout
+    if (inpath == "-")
+        return inpath;
+    boost::filesystem::path outpath = inpath;
+    if (args_info.passthrough_given) {
+        outpath.replace_extension(std::string(".") + args_info.passthrough_arg);
+    } else if (args_info.realtime_flag) {
+        outpath.replace_extension(".raw");
+    } else if (args_info.wav_flag && args_info.dop_flag) {
+        outpath.replace_extension(".wav");
+    } else {
+        outpath.replace_extension(".flac");
     }
+    return outpath;
+}
 
-    // calc real scale and dither amplitude
-    dsf2flac_float64 scale = userScale * pow(2.0, bits - 1); // increase scale by factor of 2^23 (24bit).
-    dsf2flac_float64 tpdfDitherPeakAmplitude;
-    if (dither)
-        tpdfDitherPeakAmplitude = 1.0;
-    else
-        tpdfDitherPeakAmplitude = 0.0;
-    dsf2flac_float64 clipAmplitude = pow(2.0, bits - 1) - 1; // clip at max range.
+/**
+ * bool is_stream
+ *
+ * true if inpath is stdin or a pipe, which can only be read once from start to end.
+ */
+bool is_stream(boost::filesystem::path inpath) {
+    boost::system::error_code ec;
+    return inpath == "-" || (boost::filesystem::exists(inpath, ec) && !boost::filesystem::is_regular_file(inpath, ec));
+}
 
-    setupTimer(dsr->getPositionInSeconds());
+/**
+ * DsdSampleReader* open_reader
+ *
+ * opens a reader of the right type for inpath, returns NULL (after telling the user why) on failure.
+ * The type is given by --input-format, otherwise by the extension.
+ */
+DsdSampleReader* open_reader(const gengetopt_args_info& args_info, const boost::filesystem::path& inpath) {
+    // pointer to the dsdSampleReader (could be any valid type).
+    DsdSampleReader* dsr;
+    std::string format = args_info.input_format_given ? std::string(".") + args_info.input_format_arg : inpath.extension().string();
 
-    // convert each track in the file in turn
-    for (dsf2flac_uint32 n = 0; n < dsr->getNumTracks(); n++) {
-
-        // get and check the start and end samples
-        dsf2flac_float64 trackStart = (dsf2flac_float64) dsr->getTrackStart(n) / dec.getDecimationRatio();
-        dsf2flac_float64 trackEnd = (dsf2flac_float64) dsr->getTrackEnd(n) / dec.getDecimationRatio();
-        if (trackStart < dec.getFirstValidSample())
-            trackStart = dec.getFirstValidSample();
-        if (trackStart >= dec.getLastValidSample())
-            trackStart = dec.getLastValidSample() - 1;
-        if (trackEnd <= dec.getFirstValidSample())
-            trackEnd = dec.getFirstValidSample() + 1;
-        if (trackEnd > dec.getLastValidSample())
-            trackEnd = dec.getLastValidSample();
-
-        // construct an appropriate filename for multi track files.
-        boost::filesystem::path trackOutPath;
-        if (dsr->getNumTracks() > 1) {
-            trackOutPath = muti_track_name_helper(outpath, n);
-        } else {
-            trackOutPath = outpath;
-        }
+    // create either a reader for dsf or dsd
+    if (format == ".dsf" || format == ".DSF")
+        dsr = new DsfFileReader((char*) inpath.c_str());
+    else if (format == ".dff" || format == ".DFF")
+        dsr = new DsdiffFileReader((char*) inpath.c_str());
+    else {
+        fprintf(stderr, "Sorry, only .dsf or .dff input files are supported, use --input-format for other names\n");
+        return NULL;
+    }
 
-        fprintf(stderr, "Output file\n\t%s\n", trackOutPath.c_str());
-        // use the pcm_track_helper
-        ok &= pcm_track_helper(trackOutPath, &dec, bits, scale, tpdfDitherPeakAmplitude, clipAmplitude, trackStart, trackEnd, dsr->getID3Tag(n));
+    // check reader is valid.
+    if (!dsr->isValid()) {
+        fprintf(stderr, "Error opening DSDFF file!\n");
+        fprintf(stderr, "%s: %s\n", inpath.c_str(), dsr->getErrorMsg().c_str());
+        delete dsr;
+        return NULL;
     }
+    return dsr;
+}
 
-    return ok;
+/**
+ * std::string conversion_settings
+ *
+ * describes everything on the command line that changes the outputs, so the cache can tell
+ * whether an earlier conversion was done the same way. fixedPoint is whether the fixed point
+ * engine made the PCM, which --fixed-point alone doesn't say as it only covers some rates.
+ */
+std::string conversion_settings(const gengetopt_args_info& args_info, bool fixedPoint) {
+    std::ostringstream s;
+    // a new version may change the filters or the output format
+    s << CMDLINE_PARSER_PACKAGE_NAME << " " << CMDLINE_PARSER_VERSION;
+    if (args_info.outputs_given)
+        s << " outputs=" << args_info.outputs_arg;
+    else if (args_info.passthrough_given)
+        s << " passthrough=" << args_info.passthrough_arg;
+    else if (!args_info.dop_flag)
+        s << " pcm";
+    else if (args_info.wav_flag)
+        s << " dopwav";
+    else
+        s << " dop";
+    s << " rate=" << args_info.samplerate_arg;
+    s << " bits=" << args_info.bits_arg;
+    s << " scale=" << args_info.scale_arg;
+    // the dither generator is seeded the same way for every decimator
+    s << " dither=" << (args_info.nodither_flag ? "off" : "tpdf");
+    s << " filter=" << filterSettings;
+    if (fixedPoint)
+        s << " fixed";
+    return s.str();
 }
 
 /**
- *	dop_track_helper
+ * bool make_sinks
+ *
+ * creates the sinks for the outputs chosen on the command line, and the path each one writes.
+ * Several outputs share the input through tee, which is created here and left NULL for one.
+ * Returns false if an entry of --outputs can't be understood.
  */
-int dop_track_helper(
-        boost::filesystem::path outpath,
+bool make_sinks(
+        const gengetopt_args_info& args_info,
         DsdSampleReader* dsr,
-        dsf2flac_int64 startPos,
-        dsf2flac_int64 endPos,
-        ID3_Tag id3tag) {
+        boost::filesystem::path outpath,
+        std::vector<ConversionSink*>& sinks,
+        std::vector<boost::filesystem::path>& outpaths,
+        DsdTeeReader*& tee
+        ) {
+    // collect the options
+    int fs = args_info.samplerate_arg;
+    int bits = args_info.bits_arg;
+    bool dither = !args_info.nodither_flag;
+    bool dop = args_info.dop_flag;
+    dsf2flac_float64 userScaleDB = (dsf2flac_float64) args_info.scale_arg;
+    dsf2flac_float64 userScale = pow(10.0, userScaleDB / 20);
 
-    // double check the start and end positions!
-    if (startPos > dsr->getLength() - 1)
-        startPos = dsr->getLength() - 1;
-    if (endPos > dsr->getLength())
-        endPos = dsr->getLength();
+    tee = NULL;
+    if (args_info.outputs_given) {
+        std::vector<std::string> specs;
+        std::istringstream ss(args_info.outputs_arg);
+        std::string spec;
+        while (std::getline(ss, spec, ','))
+            specs.push_back(spec);
+        if (specs.size() > 1)
+            tee = new DsdTeeReader(dsr);
+        for (dsf2flac_uint32 i = 0; i < specs.size(); i++) {
+            boost::filesystem::path p;
+            ConversionSink* sink = make_sink(specs[i], tee ? tee->newBranch() : dsr, fs, bits, dither, userScale, outpath, p);
+            if (!sink) {
+                fprintf(stderr, "Sorry, can't understand the output \"%s\"\n", specs[i].c_str());
+                return false;
+            }
+            sinks.push_back(sink);
+            outpaths.push_back(p);
+        }
+    } else if (args_info.passthrough_given) {
+        if (!strcmp(args_info.passthrough_arg, "dsf"))
+            sinks.push_back(new DsdFileSink(dsr, new DsfFileWriter(dsr)));
+        else
+            sinks.push_back(new DsdFileSink(dsr, new DsdiffFileWriter(dsr)));
+        outpaths.push_back(outpath);
+    } else if (!dop) {
+        sinks.push_back(new PcmFlacSink(dsr, fs, bits, dither, userScale));
+        outpaths.push_back(outpath);
+    } else if (args_info.wav_flag) {
+        sinks.push_back(new DopWaveSink(dsr));
+        outpaths.push_back(outpath);
+    } else {
+        sinks.push_back(new DopFlacSink(dsr));
+        outpaths.push_back(outpath);
+    }
+    return true;
+}
 
-    // create a dop packer object.
-    DopPacker dopp = DopPacker(dsr);
+/**
+ * bool uses_fixed_point
+ *
+ * true if converting inpath into outpath would make its PCM with the fixed point engine.
+ */
+bool uses_fixed_point(const gengetopt_args_info& args_info, boost::filesystem::path inpath, boost::filesystem::path outpath) {
+    DsdSampleReader* dsr = open_reader(args_info, inpath);
+    if (!dsr)
+        return false;
+    std::vector<ConversionSink*> sinks;
+    std::vector<boost::filesystem::path> outpaths;
+    DsdTeeReader* tee;
+    bool fixed = false;
+    if (make_sinks(args_info, dsr, outpath, sinks, outpaths, tee))
+        for (dsf2flac_uint32 i = 0; i < sinks.size(); i++)
+            if (sinks[i]->isValid() && sinks[i]->isFixedPoint())
+                fixed = true;
+    for (dsf2flac_uint32 i = 0; i < sinks.size(); i++)
+        delete sinks[i];
+    if (tee)
+        delete tee;
+    delete dsr;
+    return fixed;
+}
 
-    // flac vars
-    bool ok = true;
-    FLAC::Encoder::File encoder;
-    FLAC__StreamEncoderInitStatus init_status;
-    FLAC__StreamMetadata * metadata[2];
+/**
+ * bool is_up_to_date
+ *
+ * true if the cache says inpath has already been converted into outpath with these options.
+ * A conversion is only recorded as fixed point if the fixed point engine made it, so with
+ * --fixed-point one recorded without it is up to date if the engine can't be used for it now either.
+ */
+bool is_up_to_date(const gengetopt_args_info& args_info, boost::filesystem::path inpath, boost::filesystem::path outpath) {
+    if (cache->isUpToDate(inpath, outpath, conversion_settings(args_info, args_info.fixed_point_flag)))
+        return true;
+    return args_info.fixed_point_flag && cache->isUpToDate(inpath, outpath, conversion_settings(args_info, false))
+            && !uses_fixed_point(args_info, inpath, outpath);
+}
 
-    // setup the encoder
-    if (!encoder) {
-        fprintf(stderr, "ERROR: allocating encoder\n");
-        return 0;
+/**
+ * bool convert_file
+ *
+ * converts one input file into the outputs chosen on the command line.
+ * verbose shows the file and format details and the progress, batch mode turns this off.
+ * If track is not -1 only that track is converted, starting the reader at the track rather
+ * than reading through the file up to it.
+ * If dsdSeconds is given it is set to the length of the audio converted in seconds.
+ * The files written successfully are added to written, if given.
+ * fixedPoint (if given) is set if the fixed point engine made the PCM of any output.
+ * progress (if set) is called as the conversion goes along.
+ */
+bool convert_file(
+        const gengetopt_args_info& args_info,
+        boost::filesystem::path inpath,
+        boost::filesystem::path outpath,
+        bool verbose,
+        dsf2flac_float64* dsdSeconds,
+        dsf2flac_int32 track,
+        std::vector<boost::filesystem::path>* written,
+        bool* fixedPoint,
+        const ProgressFunction& progress
+        ) {
+    // everything for this file happens on this thread, so its totals give the file's timings
+    StageTotals stagesBefore[NUM_STAGES];
+    StageTimer::getThreadTotals(stagesBefore);
+    boost::timer::cpu_timer wallTimer;
+
+    metrics.jobStarted();
+    DsdSampleReader* dsr = open_reader(args_info, inpath);
+    if (!dsr) {
+        metrics.jobFinished(false);
+        return false;
     }
-    ok &= encoder.set_verify(true);
-    ok &= encoder.set_compression_level(5);
-    ok &= encoder.set_channels(dsr->getNumChannels());
-    ok &= encoder.set_bits_per_sample(24);
-
-    if (dsr->getSamplingFreq() == 2822400) {
-        ok &= encoder.set_sample_rate(176400);
-    } else if (dsr->getSamplingFreq() == 5644800) {
-        ok &= encoder.set_sample_rate(352800);
-    } else {
-        fprintf(stderr, "ERROR: DOP sample rate > 352800 not supported by FLAC\n");
-        return 0;
+    dsf2flac_float64 seconds;
+    if (track < 0)
+        seconds = (dsf2flac_float64) dsr->getLength() / dsr->getSamplingFreq();
+    else
+        seconds = (dsf2flac_float64) (std::min<dsf2flac_int64>(dsr->getTrackEnd(track), dsr->getLength()) - dsr->getTrackStart(track)) / dsr->getSamplingFreq();
+    if (dsdSeconds)
+        *dsdSeconds = seconds;
+    metrics.addAudioTotal(seconds);
+
+    if (verbose) {
+        fprintf(stderr, "Input file\n\t%s\n", inpath.c_str());
+        dsr->dispFileInfo();
     }
-    ok &= encoder.set_total_samples_estimate((endPos - startPos) / 16);
 
-    // add tags and a padding block
-    if (ok) {
-        metadata[0] = id3v2_to_flac(id3tag);
-        metadata[1] = FLAC__metadata_object_new(FLAC__METADATA_TYPE_PADDING);
-        metadata[1]->length = 2048; /* set the padding length */
-        ok = encoder.set_metadata(metadata, 2);
-    }
+    // create the sinks, several outputs share the input through a tee.
+    std::vector<ConversionSink*> sinks;
+    std::vector<boost::filesystem::path> outpaths;
+    DsdTeeReader* tee;
+    bool ok = make_sinks(args_info, dsr, outpath, sinks, outpaths, tee);
 
-    // initialize encoder
-    if (ok) {
-        if (!strcmp(outpath.c_str(), "-"))
-            init_status = encoder.init((FILE *) stdout);
-        else // outpath.c_str());
-            init_status = encoder.init(outpath.c_str());
-        if (init_status != FLAC__STREAM_ENCODER_INIT_STATUS_OK) {
-            fprintf(stderr, "ERROR: initializing encoder: %s\n", FLAC__StreamEncoderInitStatusString[init_status]);
+    // feedback some info to the user
+    for (dsf2flac_uint32 i = 0; ok && i < sinks.size(); i++) {
+        if (!sinks[i]->isValid()) {
+            fprintf(stderr, "%s: %s\n", inpath.c_str(), sinks[i]->getErrorMsg().c_str());
             ok = false;
+        } else if (verbose) {
+            sinks[i]->dispFormatInfo();
         }
     }
 
-    // return if there is a problem with any of the flac stuff.
-    if (!ok)
-        return ok;
-
-    // creep up to the start point.
-    while (dsr->getPosition() < startPos) {
-        dsr->step();
-    }
-    // create a FLAC__int32 buffer to hold the samples as they are converted
-    unsigned int bufferLen = dsr->getNumChannels() * flacBlockLen;
-    FLAC__int32* buffer = new FLAC__int32[bufferLen];
-    // MAIN CONVERSION LOOP //
-    while (dsr->getPosition() <= endPos - flacBlockLen * 16) {
-        dopp.pack_buffer(buffer, bufferLen);
-        if (!(ok = encoder.process_interleaved(buffer, flacBlockLen)))
-            fprintf(stderr, "   state: %s\n", encoder.get_state().resolved_as_cstring(encoder));
-        checkTimer(dsr->getPositionInSeconds(), dsr->getPositionAsPercent());
-    }
-    // delete the old buffer and make a new one with a single sample per chan
-    delete[] buffer;
-    buffer = new FLAC__int32[dsr->getNumChannels()];
-    // creep up to the end
-    while (dsr->getPosition() <= endPos) {
-        dopp.pack_buffer(buffer, dsr->getNumChannels());
-        if (!(ok = encoder.process_interleaved(buffer, 1)))
-            fprintf(stderr, "   state: %s\n", encoder.get_state().resolved_as_cstring(encoder));
-        checkTimer(dsr->getPositionInSeconds(), dsr->getPositionAsPercent());
-    }
-    delete[] buffer;
-    // close the flac file
-    ok &= encoder.finish();
-    // report back to the user
-    fprintf(stderr, "\33[2K\r");
-    fprintf(stderr, "%3.1f%%\t", dsr->getPositionAsPercent());
-    if (ok) {
-        fprintf(stderr, "Conversion completed sucessfully.\n");
-    } else {
-        fprintf(stderr, "\nError during conversion.\n");
-        fprintf(stderr, "encoding: %s\n", ok ? "succeeded" : "FAILED");
-        fprintf(stderr, "   state: %s\n", encoder.get_state().resolved_as_cstring(encoder));
+    // --fixed-point only covers the single filter rates, at scales whose tables fit in int32,
+    // the tracks of one input are told about it once
+    for (dsf2flac_uint32 i = 0; ok && i < sinks.size(); i++) {
+        if (sinks[i]->isFixedPoint()) {
+            if (fixedPoint)
+                *fixedPoint = true;
+        } else if (args_info.fixed_point_flag && sinks[i]->makesPcm() && track <= 0) {
+            fprintf(stderr, "WARNING: %s: --fixed-point can't be used for this rate and scale, the PCM is computed in floating point\n",
+                    inpath.c_str());
+        }
     }
-    // free things
-    FLAC__metadata_object_delete(metadata[0]);
-    FLAC__metadata_object_delete(metadata[1]);
 
+    // a single track is read from its start, seek() refills the reader history which covers the filter pre-roll.
+    if (ok && track >= 0) {
+        if (tee)
+            tee->seek(dsr->getTrackStart(track));
+        else
+            dsr->seek(dsr->getTrackStart(track));
+    }
+
+    // do the conversion into PCM and/or DoP
+    if (ok)
+        ok = do_conversion(dsr, sinks, outpaths, verbose, track, written, progress);
+
+    for (dsf2flac_uint32 i = 0; i < sinks.size(); i++)
+        delete sinks[i];
+    if (tee)
+        delete tee;
+    delete dsr;
+    metrics.jobFinished(ok);
+
+    if (StageTimer::isEnabled()) {
+        StageTotals stagesAfter[NUM_STAGES], stages[NUM_STAGES];
+        StageTimer::getThreadTotals(stagesAfter);
+        StageTimer::subtract(stagesAfter, stagesBefore, stages);
+        std::ostringstream line;
+        line << "{\"file\":" << StageTimer::jsonString(inpath.string());
+        if (track >= 0)
+            line << ",\"track\":" << track + 1;
+        line << ",\"ok\":" << (ok ? "true" : "false");
+        line << ",\"wall_ms\":" << wallTimer.elapsed().wall / 1e6;
+        line << ",\"stages\":" << StageTimer::toJson(stages) << "}\n";
+        fputs(line.str().c_str(), stderr);
+    }
     return ok;
 }
 
 /**
- *	dop_track_helper_wave
+ * bool run_jobs
+ *
+ * runs the jobs in scheduler with convert, showing the progress and then the overall throughput.
+ * convert sets its second argument to the length of the audio it converted in seconds.
  */
-int dop_track_helper_wave(
-        boost::filesystem::path outpath,
-        DsdSampleReader* dsr,
-        dsf2flac_int64 startPos,
-        dsf2flac_int64 endPos,
-        ID3_Tag id3tag) {
-
-    // double check the start and end positions!
-    if (startPos > dsr->getLength() - 1)
-        startPos = dsr->getLength() - 1;
-    if (endPos > dsr->getLength())
-        endPos = dsr->getLength();
-
-    // create a dop packer object.
-    DopPacker dopp = DopPacker(dsr);
-
-    // flac vars
-    bool ok = true;
-
-
-    AudioFile<DopSample> File;
-
-
-    File.setSampleRate(dsr->getSamplingFreq() / 16);
-    File.setBitDepth(24);
-    File.setNumChannels(dsr->getNumChannels());
-    File.setNumSamples(endPos / 16);
-    File.printSummary();
-
-    std::ofstream* out = NULL;
+bool run_jobs(
+        BatchScheduler& scheduler,
+        const char* what,
+        std::function<JobResult (const BatchJob&, dsf2flac_float64&)> convert
+        ) {
+    std::mutex totalLock;
+    dsf2flac_float64 totalSeconds = 0;
+    dsf2flac_uint32 nSkipped = 0;
+    boost::timer::cpu_timer wallTimer;
+
+    metrics.setJobsQueued(scheduler.getNumJobs());
+    scheduler.run(
+        [&](const BatchJob& job) {
+            dsf2flac_float64 seconds = 0;
+            JobResult r = convert(job, seconds);
+            const char* result = r == JOB_DONE ? "done" : r == JOB_SKIPPED ? "skipped" : "FAILED";
+            std::lock_guard<std::mutex> l(totalLock);
+            if (r == JOB_DONE)
+                totalSeconds += seconds;
+            if (r == JOB_SKIPPED) {
+                nSkipped++;
+                metrics.jobSkipped();
+            }
+            if (job.track < 0)
+                fprintf(stderr, "\33[2K\r%s\t%s\n", result, job.path.c_str());
+            else
+                fprintf(stderr, "\33[2K\r%s\ttrack %d\n", result, job.track + 1);
+            return r != JOB_FAILED;
+        },
+        [&]() {
+            metrics.setJobsQueued(scheduler.getNumJobs() - scheduler.getNumDone() - scheduler.getNumRunning());
+            dsf2flac_float64 elapsed = wallTimer.elapsed().wall / 1e9;
+            fprintf(stderr, "\33[2K\r%s: %u/%u\tRate: %.1fMB/s", what, scheduler.getNumDone(), scheduler.getNumJobs(),
+                    scheduler.getBytesDone() / 1e6 / elapsed);
+            fflush(stderr);
+        });
+
+    metrics.setJobsQueued(0);
+
+    // report the throughput of the whole run
+    dsf2flac_float64 elapsed = wallTimer.elapsed().wall / 1e9;
+    fprintf(stderr, "\33[2K\r");
+    fprintf(stderr, "%s finished: %u converted, %u up to date, %u failed\n",
+            what, scheduler.getNumDone() - scheduler.getNumFailed() - nSkipped, nSkipped, scheduler.getNumFailed());
+    fprintf(stderr, "\t%.1fs of audio in %.1fs (%.1fx realtime), %.1fMB/s\n",
+            totalSeconds, elapsed, totalSeconds / elapsed, scheduler.getBytesDone() / 1e6 / elapsed);
+    return scheduler.getNumFailed() == 0;
+}
 
-    if (outpath != "-") {
-        out = new ofstream(outpath.c_str(), std::ios::binary);
-        if (out == NULL) {
-            return false;
-        }
-        if (!out->is_open()) {
-            delete out;
-            return false;
-        }
+/**
+ * int run_batch
+ *
+ * converts every file found by --batch, several at once, and reports the overall throughput.
+ */
+int run_batch(const gengetopt_args_info& args_info) {
+    if (args_info.outfile_given) {
+        fprintf(stderr, "Sorry, --outfile can't be used with --batch, use --outdir instead\n");
+        return 0;
+    }
+    if (args_info.outputs_given && strchr(args_info.outputs_arg, '=')) {
+        fprintf(stderr, "Sorry, output file names can't be given in --outputs with --batch, use --outdir instead\n");
+        return 0;
+    }
+    if (args_info.jobs_arg < 0) {
+        fprintf(stderr, "Sorry, --jobs must be 0 or more\n");
+        return 0;
     }
 
-    std::vector<uint8_t> headerData;
+    BatchScheduler scheduler(args_info.jobs_arg);
+    if (!scheduler.addPath(args_info.batch_arg)) {
+        fprintf(stderr, "Sorry, can't read %s\n", args_info.batch_arg);
+        return 0;
+    }
+    if (scheduler.getNumJobs() == 0) {
+        fprintf(stderr, "No DSF or DFF files found in %s\n", args_info.batch_arg);
+        return 0;
+    }
+    fprintf(stderr, "Converting %u files (%.1fMB) using %u threads\n",
+            scheduler.getNumJobs(), scheduler.getTotalBytes() / 1e6, scheduler.getNumWorkers());
+
+    return run_jobs(scheduler, "Files", [&](const BatchJob& job, dsf2flac_float64& seconds) {
+        boost::filesystem::path outpath = job.path;
+        if (args_info.outdir_given)
+            outpath = boost::filesystem::path(args_info.outdir_arg) / job.relPath;
+        outpath = default_outpath(args_info, outpath);
+        if (cache && !args_info.force_flag && is_up_to_date(args_info, job.path, outpath))
+            return JOB_SKIPPED;
+        if (args_info.outdir_given) {
+            boost::system::error_code ec;
+            boost::filesystem::create_directories(outpath.parent_path(), ec);
+        }
+        std::vector<boost::filesystem::path> written;
+        bool fixedPoint = false;
+        bool ok = convert_file(args_info, job.path, outpath, false, &seconds, -1, &written, &fixedPoint, ProgressFunction());
+        if (cache && ok)
+            cache->record(job.path, outpath, conversion_settings(args_info, fixedPoint), written);
+        else if (cache)
+            cache->forget(job.path, outpath);
+        return ok ? JOB_DONE : JOB_FAILED;
+    });
+}
 
-    File.getHeaderData(headerData);
+/**
+ * int convert_tracks
+ *
+ * converts the tracks of a multi track input side by side, each worker has its own reader
+ * which starts at its track, and writes its own output files (which are added to written).
+ * fixedPoint is set if the fixed point engine made the PCM of any track.
+ */
+int convert_tracks(
+        const gengetopt_args_info& args_info,
+        boost::filesystem::path inpath,
+        boost::filesystem::path outpath,
+        DsdSampleReader* dsr,
+        std::vector<boost::filesystem::path>* written,
+        bool* fixedPoint
+        ) {
+    BatchScheduler scheduler(args_info.jobs_arg);
+    dsf2flac_uint64 bytesPerSample = dsr->getNumChannels();
+    for (dsf2flac_uint32 n = 0; n < dsr->getNumTracks(); n++)
+        scheduler.addTrack(inpath, n, (dsr->getTrackEnd(n) - dsr->getTrackStart(n)) * bytesPerSample / 8);
+    fprintf(stderr, "Converting %u tracks using %u threads\n",
+            scheduler.getNumJobs(), std::min(scheduler.getNumWorkers(), scheduler.getNumJobs()));
+
+    std::mutex writtenLock;
+    return run_jobs(scheduler, "Tracks", [&](const BatchJob& job, dsf2flac_float64& seconds) {
+        std::vector<boost::filesystem::path> trackWritten;
+        bool trackFixedPoint = false;
+        bool ok = convert_file(args_info, job.path, outpath, false, &seconds, job.track, &trackWritten, &trackFixedPoint, ProgressFunction());
+        std::lock_guard<std::mutex> l(writtenLock);
+        written->insert(written->end(), trackWritten.begin(), trackWritten.end());
+        if (trackFixedPoint)
+            *fixedPoint = true;
+        return ok ? JOB_DONE : JOB_FAILED;
+    });
+}
 
-    if (out != NULL) {
-        out->write((char*) headerData.data(), headerData.size());
-    } else {
-        std::cout.write((char*) headerData.data(), headerData.size());
+/**
+ * int convert_input
+ *
+ * converts the single input given with --infile, unless the cache says it is up to date.
+ * The tracks of a multi track input are converted at the same time, unless they all go to stdout.
+ */
+int convert_input(const gengetopt_args_info& args_info, boost::filesystem::path inpath, boost::filesystem::path outpath) {
+    bool toStdout = !strcmp(outpath.c_str(), "-");
+    // a stream can't be checked against the cache, or opened once per track
+    bool fromStream = is_stream(inpath);
+    if (cache && !toStdout && !fromStream && !args_info.force_flag && is_up_to_date(args_info, inpath, outpath)) {
+        fprintf(stderr, "%s is up to date, use --force to convert it anyway\n", inpath.c_str());
+        metrics.jobSkipped();
+        return 1;
     }
 
-    // creep up to the start point.
-    while (dsr->getPosition() < startPos) {
-        dsr->step();
+    std::vector<boost::filesystem::path> written;
+    bool fixedPoint = false;
+    int ok = -1;
+    if (BatchScheduler(args_info.jobs_arg).getNumWorkers() > 1 && !toStdout && !fromStream) {
+        DsdSampleReader* dsr = open_reader(args_info, inpath);
+        if (!dsr)
+            return 0;
+        if (dsr->getNumTracks() > 1) {
+            fprintf(stderr, "Input file\n\t%s\n", inpath.c_str());
+            dsr->dispFileInfo();
+            ok = convert_tracks(args_info, inpath, outpath, dsr, &written, &fixedPoint);
+        }
+        delete dsr;
     }
-    // create a FLAC__int32 buffer to hold the samples as they are converted
-    size_t bufferLen = dsr->getNumChannels() * waveBlockLen;
-    FLAC__int32* buffer = new FLAC__int32[bufferLen];
-    size_t NumChannels = dsr->getNumChannels();
+    if (ok < 0)
+        ok = convert_file(args_info, inpath, outpath, true, NULL, -1, &written, &fixedPoint, ProgressFunction());
+
+    if (cache && !toStdout && !fromStream && ok)
+        cache->record(inpath, outpath, conversion_settings(args_info, fixedPoint), written);
+    else if (cache && !fromStream)
+        cache->forget(inpath, outpath);
+    return ok;
+}
 
-    std::vector<DopSample> samplesData(waveBlockLen * NumChannels);
+/**
+ * bool parse_number
+ *
+ * reads the whole of text as a number, false if it isn't one.
+ */
+bool parse_number(const std::string& text, dsf2flac_float64& value) {
+    char* end;
+    value = strtod(text.c_str(), &end);
+    return !text.empty() && *end == '\0';
+}
 
-    // MAIN CONVERSION LOOP //
-    while (dsr->getPosition() <= endPos - waveBlockLen) {
-        samplesData.clear();
-        dopp.pack_buffer(buffer, bufferLen);
-        for (size_t s = 0; s < waveBlockLen; s++) {
-            for (size_t c = 0; c < NumChannels; c++) {
-                samplesData.push_back(*((DopSample*) & buffer[s * NumChannels + c]));
-            }
+/**
+ * std::string serve_request
+ *
+ * runs one request sent to the server. Each field is the long name of an option, with
+ * =VALUE for the options which take one; anything not given is taken from defaults.
+ * The reply is "done" followed by the files written, "skipped" if the cache says the
+ * input is up to date, or "error" and the reason.
+ */
+std::string serve_request(const gengetopt_args_info& defaults, const std::vector<std::string>& fields, const ProgressFunction& progress) {
+    // the strings in args point into defaults or into values.
+    gengetopt_args_info args = defaults;
+    bool force = args.force_flag;
+    std::list<std::string> values;
+    for (dsf2flac_uint32 i = 0; i < fields.size(); i++) {
+        std::string name = fields[i];
+        std::string value;
+        size_t eq = name.find('=');
+        bool hasValue = eq != std::string::npos;
+        if (hasValue) {
+            value = name.substr(eq + 1);
+            name = name.substr(0, eq);
         }
-        if (out != NULL) {
-            out->write((char*) samplesData.data(), samplesData.size() * sizeof (DopSample));
+        values.push_back(value);
+        char* v = (char*) values.back().c_str();
+        dsf2flac_float64 x;
+
+        if (name == "infile" && hasValue) {
+            args.infile_arg = v;
+            args.infile_given = 1;
+        } else if (name == "outfile" && hasValue) {
+            args.outfile_arg = v;
+            args.outfile_given = 1;
+        } else if (name == "samplerate" && hasValue && parse_number(value, x) && (x == 44100 || x == 88200 || x == 176400 || x == 352800
+                || x == 48000 || x == 96000 || x == 192000 || x == 384000)) {
+            args.samplerate_arg = x;
+        } else if (name == "bits" && hasValue && parse_number(value, x) && (x == 16 || x == 20 || x == 24)) {
+            args.bits_arg = x;
+        } else if (name == "scale" && hasValue && parse_number(value, x)) {
+            args.scale_arg = x;
+        } else if (name == "nodither" && !hasValue) {
+            args.nodither_flag = 1;
+        } else if (name == "dop" && !hasValue) {
+            args.dop_flag = 1;
+        } else if (name == "wav" && !hasValue) {
+            args.wav_flag = 1;
+        } else if (name == "outputs" && hasValue) {
+            args.outputs_arg = v;
+            args.outputs_given = 1;
+        } else if (name == "passthrough" && hasValue && (value == "dsf" || value == "dff")) {
+            args.passthrough_arg = v;
+            args.passthrough_given = 1;
+        } else if (name == "force" && !hasValue) {
+            force = true;
         } else {
-            std::cout.write((char*) samplesData.data(), samplesData.size() * sizeof (DopSample));
-        }
-        checkTimer(dsr->getPositionInSeconds(), dsr->getPositionAsPercent());
-    }
-    // delete the old buffer and make a new one with a single sample per chan
-    delete[] buffer;
-    bufferLen = dsr->getNumChannels();
-    buffer = new FLAC__int32[bufferLen];
-    // creep up to the end
-
-    while (dsr->getPosition() <= endPos) {
-        dopp.pack_buffer(buffer, bufferLen);
-        for (size_t c = 0; c < NumChannels; c++) {
-            if (out != NULL) {
-                out->write((char*) (buffer + c), sizeof (DopSample));
-            } else {
-                std::cout.write((char*) (buffer + c), sizeof (DopSample));
-            }
+            metrics.addError();
+            return "error\tcan't understand \"" + fields[i] + "\"";
         }
-        checkTimer(dsr->getPositionInSeconds(), dsr->getPositionAsPercent());
     }
-    delete[] buffer;
-
-    if (out != NULL) {
-        out->close();
-        delete out;
+    if (!args.infile_given) {
+        metrics.addError();
+        return "error\tinfile is required";
     }
 
-    // report back to the user
-    fprintf(stderr, "\33[2K\r");
-    fprintf(stderr, "%3.1f%%\t\n", dsr->getPositionAsPercent());
+    boost::filesystem::path inpath(args.infile_arg);
+    boost::filesystem::path outpath;
+    if (args.outfile_given)
+        outpath = args.outfile_arg;
+    else
+        outpath = default_outpath(args, inpath);
+    if (!strcmp(outpath.c_str(), "-")) {
+        metrics.addError();
+        return "error\tthe server can't write to stdout";
+    }
 
-    if (ok) {
-        fprintf(stderr, "Conversion completed sucessfully.\n");
-    } else {
-        fprintf(stderr, "\nError during conversion.\n");
-        fprintf(stderr, "encoding: %s\n", ok ? "succeeded" : "FAILED");
-        fprintf(stderr, "   state: ERROR\n");
+    if (cache && !force && is_up_to_date(args, inpath, outpath)) {
+        fprintf(stderr, "skipped\t%s\n", inpath.c_str());
+        metrics.jobSkipped();
+        return "skipped";
     }
 
-    return ok;
+    std::vector<boost::filesystem::path> written;
+    bool fixedPoint = false;
+    bool ok = convert_file(args, inpath, outpath, false, NULL, -1, &written, &fixedPoint, progress);
+    if (cache && ok)
+        cache->record(inpath, outpath, conversion_settings(args, fixedPoint), written);
+    else if (cache)
+        cache->forget(inpath, outpath);
+    fprintf(stderr, "%s\t%s\n", ok ? "done" : "FAILED", inpath.c_str());
+    if (!ok)
+        return "error\tconversion failed, see the server log";
+
+    std::string reply = "done";
+    for (dsf2flac_uint32 i = 0; i < written.size(); i++)
+        reply += "\t" + written[i].string();
+    return reply;
 }
 
 /**
- * int do_dop_conversion
- *
- * this function handles conversion into DoP encoded flac
+ * void stop_server
  *
+ * signal handler which shuts the server down cleanly.
  */
-int do_dop_conversion(
-        DsdSampleReader* dsr,
-        boost::filesystem::path inpath,
-        boost::filesystem::path outpath,
-        bool wave
-        ) {
-    bool ok = true;
-
-    setupTimer(dsr->getPositionInSeconds());
+void stop_server(int sig) {
+    if (server)
+        server->stop();
+}
 
-    // convert each track in the file in turn
-    for (dsf2flac_uint32 n = 0; n < dsr->getNumTracks(); n++) {
+/**
+ * int run_server
+ *
+ * serves conversion requests on the socket given with --serve until interrupted.
+ * The decimation filters and the worker threads are set up once and kept for every request.
+ */
+int run_server(const gengetopt_args_info& args_info) {
+    if (args_info.infile_given || args_info.outfile_given || args_info.batch_given || args_info.outdir_given) {
+        fprintf(stderr, "Sorry, the files to convert are sent to the server, --serve can't be used with --infile, --outfile, --batch or --outdir\n");
+        return 0;
+    }
 
-        // get and check the start and end samples
-        dsf2flac_uint64 trackStart = dsr->getTrackStart(n);
-        dsf2flac_uint64 trackEnd = dsr->getTrackEnd(n);
+    server = new ConversionServer(args_info.serve_arg, args_info.jobs_arg);
+    if (!server->listen()) {
+        fprintf(stderr, "Sorry, %s\n", server->getErrorMsg().c_str());
+        delete server;
+        server = NULL;
+        return 0;
+    }
 
-        // construct an appropriate filename for multi track files.
-        boost::filesystem::path trackOutPath;
-        if (dsr->getNumTracks() > 1) {
-            trackOutPath = muti_track_name_helper(outpath, n);
-        } else {
-            trackOutPath = outpath;
-        }
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = stop_server;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    fprintf(stderr, "Serving on %s with %u workers\n", server->getSocketPath().c_str(), server->getNumWorkers());
+    server->run([&](const std::vector<std::string>& fields, const ConversionServer::ProgressFunction& progress) {
+        return serve_request(args_info, fields, progress);
+    });
+    fprintf(stderr, "Server stopped\n");
+
+    delete server;
+    server = NULL;
+    return 1;
+}
 
+/**
+ * int run_realtime
+ *
+ * streams the input as raw PCM (or DoP) with low latency, normally to stdout for a player,
+ * and then reports the latency measured.
+ */
+int run_realtime(const gengetopt_args_info& args_info, boost::filesystem::path inpath, boost::filesystem::path outpath) {
+    if (args_info.outputs_given || args_info.passthrough_given || args_info.cache_given) {
+        fprintf(stderr, "Sorry, --realtime has a single raw output, it can't be used with --outputs, --passthrough or --cache\n");
+        return 0;
+    }
+    if (args_info.period_arg < 1 || args_info.periods_arg < 2) {
+        fprintf(stderr, "Sorry, --period must be at least 1 and --periods at least 2\n");
+        return 0;
+    }
 
-        fprintf(stderr, "Output file\n\t%s\n", trackOutPath.c_str());
-        fprintf(stderr, "\tTrack number: %u\n", n);
-        fprintf(stderr, "\tTrack start: %llu\n", dsr->getTrackStart(n)*1ULL);
-        fprintf(stderr, "\tTrack end: %llu\n", dsr->getTrackEnd(n)*1ULL);
+    DsdSampleReader* dsr = open_reader(args_info, inpath);
+    if (!dsr)
+        return 0;
+    fprintf(stderr, "Input file\n\t%s\n", inpath.c_str());
+    dsr->dispFileInfo();
 
-        // use the pcm_track_helper
-        if (wave) {
-            ok &= dop_track_helper_wave(trackOutPath, dsr, trackStart, trackEnd, dsr->getID3Tag(n));
-        } else {
-            ok &= dop_track_helper(trackOutPath, dsr, trackStart, trackEnd, dsr->getID3Tag(n));
+    RealtimeStreamer streamer(dsr, args_info.period_arg, args_info.periods_arg);
+    if (args_info.dop_flag)
+        streamer.setDopOutput();
+    else
+        streamer.setPcmOutput(args_info.samplerate_arg, args_info.bits_arg, !args_info.nodither_flag, pow(10.0, (dsf2flac_float64) args_info.scale_arg / 20));
+    if (!streamer.isValid()) {
+        fprintf(stderr, "Sorry, %s\n", streamer.getErrorMsg().c_str());
+        delete dsr;
+        return 0;
+    }
+    streamer.dispFormatInfo();
+
+    int fd = 1;
+    if (strcmp(outpath.c_str(), "-")) {
+        fd = open(outpath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+        if (fd < 0) {
+            fprintf(stderr, "Sorry, can't write %s\n", outpath.c_str());
+            delete dsr;
+            return 0;
         }
+        fprintf(stderr, "Output file\n\t%s\n", outpath.c_str());
     }
 
+    // the streamer's threads are sampled for the metrics
+    dsf2flac_float64 reportedSeconds = 0;
+    ProgressMetrics::SampleFunction sample = [&](ProgressMetrics& m) {
+        dsf2flac_float64 seconds = (dsf2flac_float64) streamer.getFramesWritten() / streamer.getFrameRate();
+        m.addAudioDone(seconds - reportedSeconds);
+        reportedSeconds = seconds;
+        m.setPeriodsReady(streamer.getNumPeriodsReady());
+    };
+    metrics.jobStarted();
+    metrics.addAudioTotal((dsf2flac_float64) dsr->getLength() / dsr->getSamplingFreq());
+    metrics.setSampler(sample);
+
+    bool ok = streamer.stream(fd);
+    if (fd != 1)
+        close(fd);
+    metrics.setSampler(ProgressMetrics::SampleFunction());
+    sample(metrics);
+    metrics.jobFinished(ok);
+    if (!ok)
+        fprintf(stderr, "ERROR: %s\n", streamer.getErrorMsg().c_str());
+
+    fprintf(stderr, "Latency\n\tFirst output after: %.1fms\n", streamer.getStartupLatency());
+    fprintf(stderr, "\tDecode to output: %.1fms average, %.1fms worst\n", streamer.getMeanLatency(), streamer.getMaxLatency());
+    fprintf(stderr, "\tTimes the output waited for the decoder: %u\n", streamer.getNumDecoderWaits());
+    if (!streamer.hasRealtimePriority())
+        fprintf(stderr, "\tThe decoder ran at normal priority, real time scheduling was not allowed\n");
+    if (StageTimer::isEnabled()) {
+        // the decoding and the writing happen on threads of their own
+        StageTotals totals[NUM_STAGES];
+        StageTimer::getTotals(totals);
+        std::string line = "{\"file\":" + StageTimer::jsonString(inpath.string()) + ",\"ok\":" + (ok ? "true" : "false")
+                + ",\"stages\":" + StageTimer::toJson(totals) + "}\n";
+        fputs(line.c_str(), stderr);
+    }
+    delete dsr;
     return ok;
 }
 
@@ -586,63 +1067,122 @@ int main(int argc, char **argv) {
     if (args_info.help_given || args_info.version_given)
         exit(1);
 
-    // collect the options
-    int fs = args_info.samplerate_arg;
-    int bits = args_info.bits_arg;
-    bool dither = !args_info.nodither_flag;
-    bool dop = args_info.dop_flag;
-    dsf2flac_float64 userScaleDB = (dsf2flac_float64) args_info.scale_arg;
-    dsf2flac_float64 userScale = pow(10.0, userScaleDB / 20);
-    boost::filesystem::path inpath(args_info.infile_arg);
-    boost::filesystem::path outpath;
-    if (args_info.outfile_given)
-        outpath = args_info.outfile_arg;
-    else {
-        outpath = inpath;
-        if (args_info.wav_flag && args_info.dop_flag) {
-            outpath.replace_extension(".wav");
-        } else {
-            outpath.replace_extension(".flac");
-        }
+    if (!args_info.infile_given && !args_info.batch_given && !args_info.serve_given) {
+        fprintf(stderr, "%s: '--infile' ('-i'), '--batch' or '--serve' option required\n", argv[0]);
+        exit(1);
     }
 
     fprintf(stderr, "%s ", CMDLINE_PARSER_PACKAGE_NAME);
     fprintf(stderr, "%s\n\n", CMDLINE_PARSER_VERSION);
 
-    // pointer to the dsdSampleReader (could be any valid type).
-    DsdSampleReader* dsr;
-
-    // create either a reader for dsf or dsd
-    if (inpath.extension() == ".dsf" || inpath.extension() == ".DSF")
-        dsr = new DsfFileReader((char*) inpath.c_str());
-    else if (inpath.extension() == ".dff" || inpath.extension() == ".DFF")
-        dsr = new DsdiffFileReader((char*) inpath.c_str());
-    else {
-        fprintf(stderr, "Sorry, only .dff or .dff input files are supported\n");
+    if (args_info.jobs_arg < 0) {
+        fprintf(stderr, "Sorry, --jobs must be 0 or more\n");
         return 0;
     }
 
-    // check reader is valid.
-    if (!dsr->isValid()) {
-        fprintf(stderr, "Error opening DSDFF file!\n");
-        fprintf(stderr, "%s\n", dsr->getErrorMsg().c_str());
-        return 0;
+    // load the record of earlier conversions
+    if (args_info.cache_given) {
+        cache = new ConversionCache(args_info.cache_arg, args_info.hash_flag);
+        if (!cache->load()) {
+            fprintf(stderr, "Sorry, %s\n", cache->getErrorMsg().c_str());
+            return 0;
+        }
     }
 
-    fprintf(stderr, "Input file\n\t%s\n", inpath.c_str());
-    dsr->dispFileInfo();
+    // the built-in filter set
+    if (!strcmp(args_info.quality_arg, "fast")) {
+        DsdDecimator::setDefaultQuality(DSD_FILTER_FAST);
+        filterSettings = "fast";
+    } else if (!strcmp(args_info.quality_arg, "minphase")) {
+        DsdDecimator::setDefaultQuality(DSD_FILTER_MINIMUM_PHASE);
+        filterSettings = "minphase";
+    }
+
+    DsdDecimator::setDefaultFixedPoint(args_info.fixed_point_flag);
+
+    // load the filters which replace the built-in ones
+    if (args_info.filter_cache_given)
+        FirFilter::setCacheDir(args_info.filter_cache_arg);
+    if (args_info.filter_given) {
+        std::ostringstream s;
+        std::istringstream ss(args_info.filter_arg);
+        std::string path;
+        while (std::getline(ss, path, ',')) {
+            std::shared_ptr<FirFilter> filter(new FirFilter(path));
+            if (!filter->isValid()) {
+                fprintf(stderr, "Sorry, %s\n", filter->getErrorMsg().c_str());
+                return 0;
+            }
+            FirFilter::add(filter);
+            char hash[32];
+            snprintf(hash, sizeof(hash), "%u:%08x", filter->getRatio(), filter->getHash());
+            s << "," << hash;
+        }
+        filterSettings += s.str();
+    }
+
+    // time the stages of the conversion, SIGUSR1 asks for the totals so far
+    if (args_info.stats_flag) {
+        StageTimer::setEnabled(true);
+        struct sigaction sa;
+        memset(&sa, 0, sizeof(sa));
+        sa.sa_handler = request_stats;
+        sa.sa_flags = SA_RESTART; // the signal must not interrupt file reads
+        sigaction(SIGUSR1, &sa, NULL);
+    }
 
-    // do the conversion into PCM or DoP
-    if (!dop) {
-        // feedback some info to the user
-        fprintf(stderr, "Output format\n\tSampleRate: %dHz\n\tDepth: %dbit\n\tDither: %s\n\tScale: %1.1fdB\n", fs, bits, (dither) ? "true" : "false", userScaleDB);
-        //printf("\tIdleSample: 0x%02x\n",dsr->getIdleSample());
+    // report the progress to other programs
+    if (args_info.metrics_fd_given) {
+        if (fcntl(args_info.metrics_fd_arg, F_GETFD) < 0) {
+            fprintf(stderr, "Sorry, --metrics-fd %d is not an open file descriptor\n", args_info.metrics_fd_arg);
+            return 0;
+        }
+        metrics.setJsonFd(args_info.metrics_fd_arg);
+    }
+    if (args_info.metrics_file_given)
+        metrics.setTextfile(args_info.metrics_file_arg);
+    // keep the cache manifest up to date as the run goes, in --batch it is also saved when the run is interrupted.
+    // This is before any other thread is started, so that they all block the signals.
+    std::thread cacheKeeper;
+    if (cache) {
+        sigset_t stopSignals;
+        sigemptyset(&stopSignals);
+        if (args_info.batch_given) {
+            sigaddset(&stopSignals, SIGINT);
+            sigaddset(&stopSignals, SIGTERM);
+            pthread_sigmask(SIG_BLOCK, &stopSignals, NULL);
+        }
+        cacheKeeper = std::thread(keep_cache, stopSignals);
+    }
 
-        return do_pcm_conversion(dsr, fs, bits, dither, userScale, inpath, outpath);
+    metrics.start(args_info.metrics_interval_arg);
+
+    int ok;
+    if (args_info.serve_given) {
+        ok = run_server(args_info);
+    } else if (args_info.batch_given) {
+        ok = run_batch(args_info);
     } else {
-        // feedback some info to the user
-        fprintf(stderr, "Output format\n\tDSD samples packed as DoP\n");
+        boost::filesystem::path inpath(args_info.infile_arg);
+        boost::filesystem::path outpath;
+        if (args_info.outfile_given)
+            outpath = args_info.outfile_arg;
+        else
+            outpath = default_outpath(args_info, inpath);
+        if (args_info.realtime_flag)
+            ok = run_realtime(args_info, inpath, outpath);
+        else
+            ok = convert_input(args_info, inpath, outpath);
+    }
 
-        return do_dop_conversion(dsr, inpath, outpath, args_info.wav_flag);
+    metrics.stop();
+
+    if (cache) {
+        cacheKeeperStop = true;
+        cacheKeeper.join();
+        if (!cache->save())
+            fprintf(stderr, "WARNING: %s\n", cache->getErrorMsg().c_str());
+        delete cache;
     }
+    return ok;
 }
@@ -0,0 +1,88 @@
+/*
+ * dsf2flac - http://code.google.com/p/dsf2flac/
+ *
+ * A file conversion tool for translating dsf dsd audio files into
+ * flac pcm audio files.
+ *
+ * Copyright (c) 2013 by respective authors.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *
+ * Acknowledgments
+ *
+ * Many thanks to the following authors and projects whose work has greatly
+ * helped the development of this tool.
+ *
+ *
+ * Sebastian Gesemann - dsd2pcm (http://code.google.com/p/dsd2pcm/)
+ * SACD Ripper (http://code.google.com/p/sacd-ripper/)
+ * Maxim V.Anisiutkin - foo_input_sacd (http://sourceforge.net/projects/sacddecoder/files/)
+ * Vladislav Goncharov - foo_input_sacd_hq (http://vladgsound.wordpress.com)
+ * Jesus R - www.sonore.us
+ *
+ */
+
+#include <period_ring.h>
+
+PeriodRing::PeriodRing(dsf2flac_uint32 nPeriods, dsf2flac_uint32 periodBytes)
+{
+	if (nPeriods < 1)
+		nPeriods = 1;
+	periods.resize(nPeriods);
+	for (dsf2flac_uint32 i=0; i<nPeriods; i++) {
+		periods[i].data.resize(periodBytes);
+		periods[i].length = 0;
+	}
+	writeIdx = 0;
+	readIdx = 0;
+}
+
+PeriodRing::~PeriodRing()
+{
+}
+
+Period* PeriodRing::writePeriod()
+{
+	dsf2flac_uint64 w = writeIdx.load(std::memory_order_relaxed);
+	// acquire: the consumer has finished with the period before it is reused
+	if (w - readIdx.load(std::memory_order_acquire) >= periods.size())
+		return NULL;
+	return &periods[w % periods.size()];
+}
+
+void PeriodRing::commitWrite()
+{
+	// release: the period's contents are visible before the consumer sees the new index
+	writeIdx.store(writeIdx.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+Period* PeriodRing::readPeriod()
+{
+	dsf2flac_uint64 r = readIdx.load(std::memory_order_relaxed);
+	if (r == writeIdx.load(std::memory_order_acquire))
+		return NULL;
+	return &periods[r % periods.size()];
+}
+
+void PeriodRing::releaseRead()
+{
+	readIdx.store(readIdx.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+dsf2flac_uint32 PeriodRing::getNumFilled()
+{
+	return writeIdx.load(std::memory_order_acquire) - readIdx.load(std::memory_order_acquire);
+}
@@ -0,0 +1,90 @@
+/*
+ * dsf2flac - http://code.google.com/p/dsf2flac/
+ *
+ * A file conversion tool for translating dsf dsd audio files into
+ * flac pcm audio files.
+ *
+ * Copyright (c) 2013 by respective authors.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *
+ * Acknowledgments
+ *
+ * Many thanks to the following authors and projects whose work has greatly
+ * helped the development of this tool.
+ *
+ *
+ * Sebastian Gesemann - dsd2pcm (http://code.google.com/p/dsd2pcm/)
+ * SACD Ripper (http://code.google.com/p/sacd-ripper/)
+ * Maxim V.Anisiutkin - foo_input_sacd (http://sourceforge.net/projects/sacddecoder/files/)
+ * Vladislav Goncharov - foo_input_sacd_hq (http://vladgsound.wordpress.com)
+ * Jesus R - www.sonore.us
+ *
+ */
+
+#ifndef PERIODRING_H
+#define PERIODRING_H
+
+#include "dsf2flac_types.h"
+#include <atomic>
+#include <chrono>
+#include <vector>
+
+/// One period of output in a PeriodRing.
+typedef struct {
+	std::vector<dsf2flac_uint8> data;	// capacity is the period size in bytes
+	dsf2flac_uint32 length;				// bytes in use
+	std::chrono::steady_clock::time_point started;	// when the producer started on this period
+} Period;
+
+/**
+ * A lock free ring of fixed size periods passing output from one producer thread to one
+ * consumer thread.
+ *
+ * The producer fills the period returned by writePeriod() and hands it over with commitWrite(),
+ * the consumer takes it with readPeriod() and gives it back with releaseRead(). Neither side
+ * ever blocks or takes a lock, so a slow consumer can never stall the producer part way through
+ * a period (and the other way round); each side decides for itself how to wait.
+ */
+class PeriodRing
+{
+public:
+	/// Class constructor. nPeriods periods of periodBytes bytes each.
+	PeriodRing(dsf2flac_uint32 nPeriods, dsf2flac_uint32 periodBytes);
+	/// Class destructor.
+	virtual ~PeriodRing();
+
+	/// The next period for the producer to fill, NULL if the ring is full.
+	Period* writePeriod();
+	/// Pass the period returned by writePeriod() to the consumer.
+	void commitWrite();
+	/// The next period for the consumer, NULL if the ring is empty.
+	Period* readPeriod();
+	/// Give the period returned by readPeriod() back to the producer.
+	void releaseRead();
+
+	/// The number of periods in the ring.
+	dsf2flac_uint32 getNumPeriods() { return periods.size(); };
+	/// The number of periods waiting for the consumer.
+	dsf2flac_uint32 getNumFilled();
+private:
+	std::vector<Period> periods;
+	// each index is only written by one side; they count periods and wrap at 2^64.
+	std::atomic<dsf2flac_uint64> writeIdx;
+	std::atomic<dsf2flac_uint64> readIdx;
+};
+
+#endif // PERIODRING_H
@@ -0,0 +1,120 @@
+/*
+ * dsf2flac - http://code.google.com/p/dsf2flac/
+ *
+ * A file conversion tool for translating dsf dsd audio files into
+ * flac pcm audio files.
+ *
+ * Copyright (c) 2013 by respective authors.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *
+ * Acknowledgments
+ *
+ * Many thanks to the following authors and projects whose work has greatly
+ * helped the development of this tool.
+ *
+ *
+ * Sebastian Gesemann - dsd2pcm (http://code.google.com/p/dsd2pcm/)
+ * SACD Ripper (http://code.google.com/p/sacd-ripper/)
+ * Maxim V.Anisiutkin - foo_input_sacd (http://sourceforge.net/projects/sacddecoder/files/)
+ * Vladislav Goncharov - foo_input_sacd_hq (http://vladgsound.wordpress.com)
+ * Jesus R - www.sonore.us
+ *
+ */
+
+#include "polyphase_resampler.h"
+#include <math.h>
+#include <map>
+#include <mutex>
+
+// taps per phase and Kaiser window shape, together these give 135dB of rejection
+static const dsf2flac_uint32 resamplerTaps = 192;
+static const dsf2flac_float64 resamplerBeta = 14.0;
+// the pass band ends and the stop band starts at these fractions of the lower rate
+static const dsf2flac_float64 resamplerPass = 0.4535;
+static const dsf2flac_float64 resamplerStop = 0.5;
+
+/// The zeroth order modified Bessel function of the first kind, for the Kaiser window.
+static dsf2flac_float64 besselI0(dsf2flac_float64 x)
+{
+	dsf2flac_float64 sum = 1.0;
+	dsf2flac_float64 term = 1.0;
+	for (int k=1; term > 1e-20*sum; k++) {
+		term *= (x/(2*k))*(x/(2*k));
+		sum += term;
+	}
+	return sum;
+}
+
+PolyphaseResampler::PolyphaseResampler(const dsf2flac_uint32 u, const dsf2flac_uint32 d)
+{
+	up = u;
+	down = d;
+	nTaps = resamplerTaps;
+	phases = sharedPhases(up,down,nTaps);
+	inputs.resize(2*nTaps);
+	reset();
+}
+
+PolyphaseResampler::~PolyphaseResampler()
+{
+}
+
+void PolyphaseResampler::reset()
+{
+	inputs.assign(inputs.size(),0);
+	inputPos = 0;
+	next = 0;
+}
+
+std::shared_ptr<const std::vector<dsf2flac_float64> > PolyphaseResampler::sharedPhases(
+		const dsf2flac_uint32 up,
+		const dsf2flac_uint32 down,
+		const dsf2flac_uint32 nTaps)
+{
+	static std::mutex cacheMutex;
+	static std::map<std::pair<dsf2flac_uint32,dsf2flac_uint32>, std::shared_ptr<const std::vector<dsf2flac_float64> > > cache;
+	std::lock_guard<std::mutex> lock(cacheMutex);
+	std::shared_ptr<const std::vector<dsf2flac_float64> >& cached = cache[std::make_pair(up,down)];
+	if (!cached) {
+		std::vector<dsf2flac_float64>* p = new std::vector<dsf2flac_float64>(up*nTaps,0);
+		// the filter is up*nTaps-1 long so that it is centred on a tap
+		dsf2flac_int32 nCoefs = up*nTaps - 1;
+		dsf2flac_float64 centre = (nCoefs-1)/2;
+		// the cutoff in cycles per sample at the upsampled rate
+		dsf2flac_float64 lower = down > up ? (dsf2flac_float64)up/down : 1.0;
+		dsf2flac_float64 fc = (resamplerPass + resamplerStop) / 2 * lower / up;
+		for (dsf2flac_uint32 ph=0; ph<up; ph++) {
+			dsf2flac_float64 sum = 0;
+			for (dsf2flac_uint32 k=0; k<nTaps; k++) {
+				dsf2flac_int32 n = ph + k*up;
+				if (n >= nCoefs)
+					continue;
+				dsf2flac_float64 t = n - centre;
+				dsf2flac_float64 sinc = t == 0 ? 2*fc : sin(2*M_PI*fc*t) / (M_PI*t);
+				dsf2flac_float64 w = t / centre;
+				dsf2flac_float64 h = sinc * besselI0(resamplerBeta*sqrt(1 - w*w)) / besselI0(resamplerBeta);
+				(*p)[ph*nTaps+k] = h;
+				sum += h;
+			}
+			// each phase on its own passes dc at unity gain
+			for (dsf2flac_uint32 k=0; k<nTaps; k++)
+				(*p)[ph*nTaps+k] /= sum;
+		}
+		cached.reset(p);
+	}
+	return cached;
+}
@@ -0,0 +1,117 @@
+/*
+ * dsf2flac - http://code.google.com/p/dsf2flac/
+ *
+ * A file conversion tool for translating dsf dsd audio files into
+ * flac pcm audio files.
+ *
+ * Copyright (c) 2013 by respective authors.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *
+ * Acknowledgments
+ *
+ * Many thanks to the following authors and projects whose work has greatly
+ * helped the development of this tool.
+ *
+ *
+ * Sebastian Gesemann - dsd2pcm (http://code.google.com/p/dsd2pcm/)
+ * SACD Ripper (http://code.google.com/p/sacd-ripper/)
+ * Maxim V.Anisiutkin - foo_input_sacd (http://sourceforge.net/projects/sacddecoder/files/)
+ * Vladislav Goncharov - foo_input_sacd_hq (http://vladgsound.wordpress.com)
+ * Jesus R - www.sonore.us
+ *
+ */
+
+#ifndef POLYPHASERESAMPLER_H
+#define POLYPHASERESAMPLER_H
+
+#include "dsf2flac_types.h"
+#include <memory>
+#include <vector>
+
+/**
+ * A rational resampler for one channel of the DsdDecimator, which makes up outputs for every
+ * down inputs (160/147 takes 44.1kHz to 48kHz).
+ *
+ * The filter is a Kaiser windowed sinc at up times the input rate, flat to 0.4535 and cutting
+ * off by 0.5 of the lower of the two rates. It is split into up phases, each output only needs
+ * the taps of one phase (a dot product over contiguous inputs, written so that the compiler can
+ * vectorise it). The phase tables are worked out once and shared by every resampler.
+ */
+class PolyphaseResampler
+{
+public:
+	/**
+	 * Class constructor.
+	 * The output rate is up/down times the input rate, the fraction must be in its lowest terms.
+	 */
+	PolyphaseResampler(const dsf2flac_uint32 up, const dsf2flac_uint32 down);
+	virtual ~PolyphaseResampler();
+
+	/// Clears the history.
+	void reset();
+	/// Return the delay through the filter in 1/up ths of an input sample.
+	dsf2flac_uint32 getDelay() { return nTaps*up/2 - 1; };
+	/// Return the number of inputs each output depends on.
+	dsf2flac_uint32 getNumTaps() { return nTaps; };
+	/**
+	 * Sets when the next output is made: next/up th of an input sample after the next input is
+	 * taken, less getDelay(). Each input takes up from next, each output adds down to it.
+	 */
+	void setNext(dsf2flac_int32 n) { next = n; };
+	/// Returns true if another input has to be taken before the next output.
+	bool needsInput() { return next >= 0; };
+	/// Takes the next input.
+	inline void push(dsf2flac_float64 in);
+	/// Returns the next output, needsInput() must be false.
+	inline dsf2flac_float64 pull();
+private:
+	/// Returns the phase tables for up and down, building them on first use. Thread safe.
+	static std::shared_ptr<const std::vector<dsf2flac_float64> > sharedPhases(
+			const dsf2flac_uint32 up,
+			const dsf2flac_uint32 down,
+			const dsf2flac_uint32 nTaps);
+	dsf2flac_uint32 up;
+	dsf2flac_uint32 down;
+	dsf2flac_uint32 nTaps; // taps per phase, a multiple of 8
+	std::shared_ptr<const std::vector<dsf2flac_float64> > phases; // the taps of phase p from p*nTaps, newest input first
+	std::vector<dsf2flac_float64> inputs; // newest first, stored twice so that nTaps are always contiguous
+	dsf2flac_uint32 inputPos;
+	dsf2flac_int32 next; // see setNext()
+};
+
+void PolyphaseResampler::push(dsf2flac_float64 in)
+{
+	inputPos = inputPos ? inputPos-1 : nTaps-1;
+	inputs[inputPos] = inputs[inputPos+nTaps] = in;
+	next -= up;
+}
+
+dsf2flac_float64 PolyphaseResampler::pull()
+{
+	// the newest input is the one the phase's first tap applies to
+	const dsf2flac_float64* x = &inputs[inputPos];
+	const dsf2flac_float64* h = &(*phases)[(next+up)*nTaps];
+	// eight sums side by side, which the compiler turns into packed multiplies and adds
+	dsf2flac_float64 s[8] = { 0, 0, 0, 0, 0, 0, 0, 0 };
+	for (dsf2flac_uint32 k=0; k<nTaps; k+=8, h+=8, x+=8)
+		for (dsf2flac_uint32 j=0; j<8; j++)
+			s[j] += h[j]*x[j];
+	next += down;
+	return ((s[0] + s[1]) + (s[2] + s[3])) + ((s[4] + s[5]) + (s[6] + s[7]));
+}
+
+#endif // POLYPHASERESAMPLER_H
@@ -0,0 +1,269 @@
+/*
+ * dsf2flac - http://code.google.com/p/dsf2flac/
+ *
+ * A file conversion tool for translating dsf dsd audio files into
+ * flac pcm audio files.
+ *
+ * Copyright (c) 2013 by respective authors.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *
+ * Acknowledgments
+ *
+ * Many thanks to the following authors and projects whose work has greatly
+ * helped the development of this tool.
+ *
+ *
+ * Sebastian Gesemann - dsd2pcm (http://code.google.com/p/dsd2pcm/)
+ * SACD Ripper (http://code.google.com/p/sacd-ripper/)
+ * Maxim V.Anisiutkin - foo_input_sacd (http://sourceforge.net/projects/sacddecoder/files/)
+ * Vladislav Goncharov - foo_input_sacd_hq (http://vladgsound.wordpress.com)
+ * Jesus R - www.sonore.us
+ *
+ */
+
+#include <progress_metrics.h>
+#include <stage_timer.h>
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sstream>
+
+ProgressMetrics::ProgressMetrics()
+{
+	created = std::chrono::steady_clock::now();
+	audioTotal = 0;
+	audioDone = 0;
+	jobsQueued = 0;
+	jobsRunning = 0;
+	jobsDone = 0;
+	jobsFailed = 0;
+	jobsSkipped = 0;
+	periodsReady = 0;
+	errors = 0;
+	jsonFd = -1;
+	stopping = false;
+	lastElapsed = 0;
+	lastAudioDone = 0;
+	lineElapsed = 0;
+	lineAudioDone = 0;
+}
+
+ProgressMetrics::~ProgressMetrics()
+{
+	stop();
+}
+
+void ProgressMetrics::start(dsf2flac_uint32 intervalMs)
+{
+	if ((jsonFd < 0 && textfile.empty()) || reporter.joinable())
+		return;
+	if (intervalMs < 1)
+		intervalMs = 1;
+	stopping = false;
+	reporter = std::thread(&ProgressMetrics::reportLoop, this, intervalMs);
+}
+
+void ProgressMetrics::stop()
+{
+	if (!reporter.joinable())
+		return;
+	{
+		std::lock_guard<std::mutex> l(lock);
+		stopping = true;
+	}
+	stopCond.notify_all();
+	reporter.join();
+}
+
+void ProgressMetrics::setSampler(SampleFunction f)
+{
+	std::lock_guard<std::mutex> l(lock);
+	sampler = f;
+}
+
+void ProgressMetrics::add(std::atomic<dsf2flac_float64>& a, dsf2flac_float64 v)
+{
+	dsf2flac_float64 old = a;
+	while (!a.compare_exchange_weak(old, old + v))
+		;
+}
+
+void ProgressMetrics::jobFinished(bool ok)
+{
+	jobsRunning--;
+	if (ok) {
+		jobsDone++;
+	} else {
+		jobsFailed++;
+		errors++;
+	}
+}
+
+dsf2flac_float64 ProgressMetrics::getElapsed()
+{
+	return std::chrono::duration<dsf2flac_float64>(std::chrono::steady_clock::now() - created).count();
+}
+
+void ProgressMetrics::printProgress()
+{
+	dsf2flac_float64 elapsed = getElapsed();
+	if (elapsed - lineElapsed < 0.1)
+		return;
+	dsf2flac_float64 done = getAudioDone();
+	dsf2flac_float64 total = getAudioTotal();
+	fprintf(stderr, "\33[2K\r");
+	fprintf(stderr, "Rate: %4.1fx\t", (done - lineAudioDone) / (elapsed - lineElapsed));
+	fprintf(stderr, "Progress: %3.0f%%", total > 0 ? 100 * done / total : 0.0);
+	fflush(stderr);
+	lineElapsed = elapsed;
+	lineAudioDone = done;
+}
+
+std::string ProgressMetrics::toJson(dsf2flac_float64 rate, bool final)
+{
+	StageTotals stages[NUM_STAGES];
+	StageTimer::getTotals(stages);
+	dsf2flac_float64 elapsed = getElapsed();
+	dsf2flac_float64 done = getAudioDone();
+	dsf2flac_float64 total = getAudioTotal();
+	std::ostringstream s;
+	s.precision(3);
+	s << std::fixed;
+	s << "{\"time\":" << std::chrono::duration<dsf2flac_float64>(std::chrono::system_clock::now().time_since_epoch()).count();
+	s << ",\"elapsed_s\":" << elapsed;
+	s << ",\"audio_done_s\":" << done;
+	s << ",\"audio_total_s\":" << total;
+	s << ",\"progress\":" << (total > 0 ? 100 * done / total : 0.0);
+	s << ",\"realtime_factor\":" << rate;
+	s << ",\"realtime_factor_avg\":" << (elapsed > 0 ? done / elapsed : 0.0);
+	s << ",\"jobs_queued\":" << jobsQueued;
+	s << ",\"jobs_running\":" << jobsRunning;
+	s << ",\"jobs_done\":" << jobsDone;
+	s << ",\"jobs_failed\":" << jobsFailed;
+	s << ",\"jobs_skipped\":" << jobsSkipped;
+	s << ",\"periods_ready\":" << periodsReady;
+	s << ",\"bytes_in\":" << stages[STAGE_READ].bytes;
+	s << ",\"bytes_out\":" << stages[STAGE_WRITE].bytes;
+	s << ",\"errors\":" << errors;
+	s << ",\"final\":" << (final ? "true" : "false") << "}";
+	return s.str();
+}
+
+/// One metric in the Prometheus text format.
+static void promMetric(std::ostringstream& s, const char* name, const char* type, const char* help, dsf2flac_float64 value)
+{
+	s << "# HELP dsf2flac_" << name << " " << help << "\n";
+	s << "# TYPE dsf2flac_" << name << " " << type << "\n";
+	s << "dsf2flac_" << name << " " << value << "\n";
+}
+
+std::string ProgressMetrics::toPrometheus(dsf2flac_float64 rate)
+{
+	StageTotals stages[NUM_STAGES];
+	StageTimer::getTotals(stages);
+	std::ostringstream s;
+	s.precision(15);
+	promMetric(s, "audio_converted_seconds_total", "counter", "Seconds of audio converted.", getAudioDone());
+	promMetric(s, "audio_seconds", "gauge", "Seconds of audio to convert, so far as it is known.", getAudioTotal());
+	promMetric(s, "realtime_factor", "gauge", "Seconds of audio converted per second recently.", rate);
+	promMetric(s, "jobs_queued", "gauge", "Files or tracks waiting to be converted.", jobsQueued);
+	promMetric(s, "jobs_running", "gauge", "Files or tracks being converted.", jobsRunning);
+	s << "# HELP dsf2flac_jobs_total Files or tracks finished, by result.\n";
+	s << "# TYPE dsf2flac_jobs_total counter\n";
+	s << "dsf2flac_jobs_total{result=\"done\"} " << jobsDone << "\n";
+	s << "dsf2flac_jobs_total{result=\"failed\"} " << jobsFailed << "\n";
+	s << "dsf2flac_jobs_total{result=\"skipped\"} " << jobsSkipped << "\n";
+	promMetric(s, "periods_ready", "gauge", "Decoded periods waiting to be written in real time mode.", periodsReady);
+	promMetric(s, "input_bytes_total", "counter", "Bytes of DSD read from the inputs.", stages[STAGE_READ].bytes);
+	promMetric(s, "output_bytes_total", "counter", "Bytes written to the outputs.", stages[STAGE_WRITE].bytes);
+	promMetric(s, "errors_total", "counter", "Failed conversions and other errors.", errors);
+	promMetric(s, "last_update_timestamp_seconds", "gauge", "When these metrics were written.",
+			std::chrono::duration<dsf2flac_float64>(std::chrono::system_clock::now().time_since_epoch()).count());
+	return s.str();
+}
+
+void ProgressMetrics::reportLoop(dsf2flac_uint32 intervalMs)
+{
+	// a reader of the JSON going away must not kill the conversion, write() returns EPIPE instead
+	sigset_t pipeSet;
+	sigemptyset(&pipeSet);
+	sigaddset(&pipeSet, SIGPIPE);
+	pthread_sigmask(SIG_BLOCK, &pipeSet, NULL);
+
+	std::unique_lock<std::mutex> l(lock);
+	while (!stopping) {
+		if (stopCond.wait_for(l, std::chrono::milliseconds(intervalMs), [this]() { return stopping; }))
+			break;
+		report(false);
+	}
+	report(true);
+}
+
+void ProgressMetrics::report(bool final)
+{
+	// called with lock held
+	if (sampler)
+		sampler(*this);
+	dsf2flac_float64 elapsed = getElapsed();
+	dsf2flac_float64 done = getAudioDone();
+	dsf2flac_float64 rate = elapsed > lastElapsed ? (done - lastAudioDone) / (elapsed - lastElapsed) : 0;
+	lastElapsed = elapsed;
+	lastAudioDone = done;
+	if (jsonFd >= 0)
+		writeJson(toJson(rate, final) + "\n");
+	if (!textfile.empty())
+		writeTextfile(toPrometheus(rate));
+}
+
+void ProgressMetrics::writeJson(const std::string& s)
+{
+	const char* data = s.c_str();
+	size_t len = s.size();
+	while (len > 0) {
+		ssize_t n = ::write(jsonFd, data, len);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0) {
+			fprintf(stderr, "WARNING: could not write the metrics, stopping them: %s\n", strerror(errno));
+			jsonFd = -1;
+			return;
+		}
+		data += n;
+		len -= n;
+	}
+}
+
+void ProgressMetrics::writeTextfile(const std::string& s)
+{
+	// write a new file and move it into place, so the collector never sees half of one
+	std::string tmp = textfile + ".tmp";
+	FILE* f = fopen(tmp.c_str(), "w");
+	bool ok = f != NULL;
+	if (ok) {
+		ok = fwrite(s.c_str(), 1, s.size(), f) == s.size();
+		ok &= fclose(f) == 0;
+	}
+	if (ok)
+		ok = rename(tmp.c_str(), textfile.c_str()) == 0;
+	if (!ok) {
+		fprintf(stderr, "WARNING: could not write the metrics to %s, stopping them: %s\n", textfile.c_str(), strerror(errno));
+		textfile.clear();
+	}
+}
@@ -0,0 +1,150 @@
+/*
+ * dsf2flac - http://code.google.com/p/dsf2flac/
+ *
+ * A file conversion tool for translating dsf dsd audio files into
+ * flac pcm audio files.
+ *
+ * Copyright (c) 2013 by respective authors.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *
+ * Acknowledgments
+ *
+ * Many thanks to the following authors and projects whose work has greatly
+ * helped the development of this tool.
+ *
+ *
+ * Sebastian Gesemann - dsd2pcm (http://code.google.com/p/dsd2pcm/)
+ * SACD Ripper (http://code.google.com/p/sacd-ripper/)
+ * Maxim V.Anisiutkin - foo_input_sacd (http://sourceforge.net/projects/sacddecoder/files/)
+ * Vladislav Goncharov - foo_input_sacd_hq (http://vladgsound.wordpress.com)
+ * Jesus R - www.sonore.us
+ *
+ */
+
+#ifndef PROGRESSMETRICS_H
+#define PROGRESSMETRICS_H
+
+#include "dsf2flac_types.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+/**
+ * Keeps the numbers describing how a run is going (audio converted, jobs finished, queue depths,
+ * bytes read and written and errors) and reports them to other programs.
+ *
+ * The conversions update the counters from any thread, which is cheap enough to do as they go.
+ * Once start() is called a thread reports the counters every interval, as a line of JSON on a file
+ * descriptor and/or by rewriting a Prometheus textfile (the format of node_exporter's textfile
+ * collector). The bytes are the read and write counts kept by StageTimer.
+ *
+ * The progress line shown on a terminal is made from the same numbers by printProgress().
+ */
+class ProgressMetrics
+{
+public:
+	/// Called before each report, to update gauges from something which does not push them (e.g. a queue).
+	typedef std::function<void (ProgressMetrics& metrics)> SampleFunction;
+
+	/// Class constructor.
+	ProgressMetrics();
+	/// Class destructor, stops the reporting.
+	virtual ~ProgressMetrics();
+
+	/// Write a line of JSON to fd at every report.
+	void setJsonFd(int fd) { jsonFd = fd; };
+	/// Rewrite the Prometheus textfile at path at every report.
+	void setTextfile(std::string path) { textfile = path; };
+	/// Start reporting every intervalMs, if an output has been set.
+	void start(dsf2flac_uint32 intervalMs);
+	/// Make a final report and stop reporting.
+	void stop();
+	/// Set (or clear, with an empty function) the function called before each report.
+	void setSampler(SampleFunction f);
+
+	/// Add seconds of audio to what is to be converted.
+	void addAudioTotal(dsf2flac_float64 seconds) { add(audioTotal, seconds); };
+	/// Add seconds of audio to what has been converted.
+	void addAudioDone(dsf2flac_float64 seconds) { add(audioDone, seconds); };
+	/// A file (or track) has started converting.
+	void jobStarted() { jobsRunning++; };
+	/// A file (or track) has finished converting, a failure counts as an error.
+	void jobFinished(bool ok);
+	/// A file was not converted because it was up to date.
+	void jobSkipped() { jobsSkipped++; };
+	/// Count an error which is not a failed job (e.g. a bad request).
+	void addError() { errors++; };
+	/// Set the number of jobs waiting to start.
+	void setJobsQueued(dsf2flac_uint32 n) { jobsQueued = n; };
+	/// Set the number of decoded periods waiting to be written (real time mode).
+	void setPeriodsReady(dsf2flac_uint32 n) { periodsReady = n; };
+
+	/// Seconds since the metrics were created.
+	dsf2flac_float64 getElapsed();
+	/// Seconds of audio converted.
+	dsf2flac_float64 getAudioDone() { return audioDone; };
+	/// Seconds of audio to convert, so far as it is known.
+	dsf2flac_float64 getAudioTotal() { return audioTotal; };
+
+	/// Show the progress on stderr, no more than every 0.1s. Call it from one thread only.
+	void printProgress();
+	/// The counters as a line of JSON (without the newline). rate is the recent realtime factor.
+	std::string toJson(dsf2flac_float64 rate, bool final);
+	/// The counters in the Prometheus text format. rate is the recent realtime factor.
+	std::string toPrometheus(dsf2flac_float64 rate);
+private:
+	/// Add v to a, atomically.
+	static void add(std::atomic<dsf2flac_float64>& a, dsf2flac_float64 v);
+	/// The loop run by the reporting thread.
+	void reportLoop(dsf2flac_uint32 intervalMs);
+	/// Write out one report.
+	void report(bool final);
+	/// Write s to the JSON fd, giving up on it if that fails.
+	void writeJson(const std::string& s);
+	/// Replace the textfile with s.
+	void writeTextfile(const std::string& s);
+private:
+	std::chrono::steady_clock::time_point created;
+	std::atomic<dsf2flac_float64> audioTotal;	// seconds
+	std::atomic<dsf2flac_float64> audioDone;
+	std::atomic<dsf2flac_uint32> jobsQueued;
+	std::atomic<dsf2flac_uint32> jobsRunning;
+	std::atomic<dsf2flac_uint32> jobsDone;
+	std::atomic<dsf2flac_uint32> jobsFailed;
+	std::atomic<dsf2flac_uint32> jobsSkipped;
+	std::atomic<dsf2flac_uint32> periodsReady;
+	std::atomic<dsf2flac_uint32> errors;
+
+	int jsonFd;
+	std::string textfile;
+	std::thread reporter;
+	std::mutex lock;				// guards sampler and stopping
+	std::condition_variable stopCond;
+	bool stopping;
+	SampleFunction sampler;
+	dsf2flac_float64 lastElapsed;	// at the previous report
+	dsf2flac_float64 lastAudioDone;
+
+	dsf2flac_float64 lineElapsed;	// at the previous progress line
+	dsf2flac_float64 lineAudioDone;
+};
+
+#endif // PROGRESSMETRICS_H
@@ -0,0 +1,283 @@
+/*
+ * dsf2flac - http://code.google.com/p/dsf2flac/
+ *
+ * A file conversion tool for translating dsf dsd audio files into
+ * flac pcm audio files.
+ *
+ * Copyright (c) 2013 by respective authors.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *
+ * Acknowledgments
+ *
+ * Many thanks to the following authors and projects whose work has greatly
+ * helped the development of this tool.
+ *
+ *
+ * Sebastian Gesemann - dsd2pcm (http://code.google.com/p/dsd2pcm/)
+ * SACD Ripper (http://code.google.com/p/sacd-ripper/)
+ * Maxim V.Anisiutkin - foo_input_sacd (http://sourceforge.net/projects/sacddecoder/files/)
+ * Vladislav Goncharov - foo_input_sacd_hq (http://vladgsound.wordpress.com)
+ * Jesus R - www.sonore.us
+ *
+ */
+
+#include <realtime_streamer.h>
+#include <stage_timer.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+#include <thread>
+#include <unistd.h>
+
+/// How long the writer sleeps when it has caught up with the decoder.
+static const std::chrono::microseconds writerPollInterval(100);
+
+/// Milliseconds between two time points.
+static dsf2flac_float64 elapsedMs(std::chrono::steady_clock::time_point from, std::chrono::steady_clock::time_point to)
+{
+	return std::chrono::duration<dsf2flac_float64, std::milli>(to - from).count();
+}
+
+RealtimeStreamer::RealtimeStreamer(DsdSampleReader *r, dsf2flac_uint32 pf, dsf2flac_uint32 np)
+{
+	reader = r;
+	dec = NULL;
+	packer = NULL;
+	periodFrames = pf < 1 ? 1 : pf;
+	nPeriods = np < 2 ? 2 : np;
+	frameRate = 0;
+	frameLength = 0;
+	bits = 0;
+	bytesPerSample = 0;
+	scale = 1;
+	tpdfDitherPeakAmplitude = 0;
+	clipAmplitude = 0;
+	ring = NULL;
+	nFrames = 0;
+	framesWritten = 0;
+	periodsReady = 0;
+	produced = false;
+	cancelled = false;
+	realtimePriority = false;
+	startupLatency = 0;
+	latencySum = 0;
+	maxLatency = 0;
+	nPeriodsWritten = 0;
+	nDecoderWaits = 0;
+	valid = false;
+	errorMsg = "no output format chosen";
+}
+
+RealtimeStreamer::~RealtimeStreamer()
+{
+	delete dec;
+	delete packer;
+	delete ring;
+}
+
+bool RealtimeStreamer::setPcmOutput(dsf2flac_uint32 sampleRate, dsf2flac_uint32 b, bool dither, dsf2flac_float64 userScale)
+{
+	valid = false;
+	if (b != 16 && b != 20 && b != 24) {
+		errorMsg = "the raw output must be 16, 20 or 24 bits";
+		return false;
+	}
+	dec = new DsdDecimator(reader, sampleRate);
+	if (!dec->isValid()) {
+		errorMsg = dec->getErrorMsg();
+		return false;
+	}
+	bits = b;
+	bytesPerSample = bits == 16 ? 2 : 3;
+	frameRate = sampleRate;
+	// the same scale, dither and clipping as the flac output
+	scale = userScale * pow(2.0, bits - 1);
+	tpdfDitherPeakAmplitude = dither ? 1.0 : 0.0;
+	clipAmplitude = pow(2.0, bits - 1) - 1;
+	valid = true;
+	return true;
+}
+
+bool RealtimeStreamer::setDopOutput()
+{
+	valid = false;
+	if (reader->getSamplingFreq() % 16) {
+		errorMsg = "the DSD sample rate can't be packed into DoP";
+		return false;
+	}
+	packer = new DopPacker(reader);
+	bits = 24;
+	bytesPerSample = 3;
+	frameLength = 16;
+	frameRate = reader->getSamplingFreq() / frameLength;
+	valid = true;
+	return true;
+}
+
+const char* RealtimeStreamer::getFormatName()
+{
+	if (bits == 16)
+		return "S16_LE";
+	else if (bits == 20)
+		return "S20_3LE";
+	return "S24_3LE";
+}
+
+void RealtimeStreamer::dispFormatInfo()
+{
+	fprintf(stderr, "Output format\n\tRaw %s%s, %u channels at %uHz\n",
+			packer ? "DoP " : "", getFormatName(), reader->getNumChannels(), frameRate);
+	fprintf(stderr, "\tPeriod: %u frames (%.1fms), %u periods\n",
+			periodFrames, 1000.0 * periodFrames / frameRate, nPeriods);
+}
+
+bool RealtimeStreamer::stream(int fd)
+{
+	if (!valid)
+		return false;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	// start at frame 0, so that only the filter history is read before the first period.
+	// The reader position is that of the newest char, the one before the char seek() leaves next.
+	dsf2flac_int64 readerPos = 8;
+	if (dec)
+		readerPos += dec->getFilterDelay();
+	reader->seek(readerPos);
+	nFrames = dec ? dec->getLength() : reader->getLength() / frameLength;
+
+	delete ring;
+	ring = new PeriodRing(nPeriods, periodFrames * reader->getNumChannels() * bytesPerSample);
+	samples.resize(periodFrames * reader->getNumChannels());
+	framesWritten = 0;
+	periodsReady = 0;
+	produced = false;
+	cancelled = false;
+#ifdef F_SETPIPE_SZ
+	// a pipe holds 64KiB by default, which is longer than the whole ring at most rates
+	fcntl(fd, F_SETPIPE_SZ, periodFrames * reader->getNumChannels() * bytesPerSample);
+#endif
+	std::thread producer(&RealtimeStreamer::produce, this);
+
+	// write the periods out as they arrive
+	bool ok = true;
+	bool waiting = false;
+	while (true) {
+		Period* p = ring->readPeriod();
+		if (!p) {
+			// the decoder commits its last period before it says it has finished
+			if (produced && !(p = ring->readPeriod()))
+				break;
+			if (!p) {
+				if (nPeriodsWritten && !waiting)
+					nDecoderWaits++;
+				waiting = true;
+				std::this_thread::sleep_for(writerPollInterval);
+				continue;
+			}
+		}
+		waiting = false;
+
+		dsf2flac_uint32 sent = 0;
+		StageScope scope(STAGE_WRITE); // includes blocking on the device
+		StageTimer::count(STAGE_WRITE, p->length, 0);
+		while (sent < p->length) {
+			ssize_t n = write(fd, &p->data[sent], p->length - sent);
+			if (n < 0 && errno == EINTR)
+				continue;
+			if (n <= 0) {
+				errorMsg = std::string("writing the output: ") + strerror(errno);
+				ok = false;
+				break;
+			}
+			sent += n;
+		}
+		if (!ok)
+			break;
+
+		std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+		if (!nPeriodsWritten)
+			startupLatency = elapsedMs(start, now);
+		dsf2flac_float64 latency = elapsedMs(p->started, now);
+		latencySum += latency;
+		if (latency > maxLatency)
+			maxLatency = latency;
+		nPeriodsWritten++;
+		framesWritten += p->length / (reader->getNumChannels() * bytesPerSample);
+		ring->releaseRead();
+		periodsReady = ring->getNumFilled();
+	}
+
+	cancelled = true;
+	producer.join();
+	return ok;
+}
+
+void RealtimeStreamer::produce()
+{
+	realtimePriority = raisePriority();
+	// while the ring is full, wait for about a quarter of a period to be played
+	std::chrono::microseconds fullWait((dsf2flac_int64) 250000 * periodFrames / frameRate + 1);
+
+	dsf2flac_int64 done = 0;
+	while (done < nFrames && !cancelled) {
+		Period* p = ring->writePeriod();
+		if (!p) {
+			std::this_thread::sleep_for(fullWait);
+			continue;
+		}
+		dsf2flac_uint32 frames = periodFrames;
+		if (frames > nFrames - done)
+			frames = nFrames - done;
+		p->started = std::chrono::steady_clock::now();
+		fillPeriod(p, frames);
+		ring->commitWrite();
+		done += frames;
+	}
+	produced = true;
+}
+
+void RealtimeStreamer::fillPeriod(Period* p, dsf2flac_uint32 frames)
+{
+	dsf2flac_uint32 n = frames * reader->getNumChannels();
+	p->length = n * bytesPerSample;
+	if (packer) {
+		packer->pack_buffer_24(&p->data[0], frames);
+		return;
+	}
+	dec->getSamples(&samples[0], n, scale, tpdfDitherPeakAmplitude, clipAmplitude);
+	// little endian, the low bytes of each sample
+	dsf2flac_uint8* out = &p->data[0];
+	for (dsf2flac_uint32 i=0; i<n; i++) {
+		dsf2flac_int32 s = samples[i];
+		out[0] = (dsf2flac_uint8) s;
+		out[1] = (dsf2flac_uint8) (s >> 8);
+		if (bytesPerSample == 3)
+			out[2] = (dsf2flac_uint8) (s >> 16);
+		out += bytesPerSample;
+	}
+}
+
+bool RealtimeStreamer::raisePriority()
+{
+	// half way up the real time range leaves room for the audio server and the driver
+	struct sched_param sp;
+	sp.sched_priority = (sched_get_priority_min(SCHED_FIFO) + sched_get_priority_max(SCHED_FIFO)) / 2;
+	return pthread_setschedparam(pthread_self(), SCHED_FIFO, &sp) == 0;
+}
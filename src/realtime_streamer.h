@@ -0,0 +1,141 @@
+/*
+ * dsf2flac - http://code.google.com/p/dsf2flac/
+ *
+ * A file conversion tool for translating dsf dsd audio files into
+ * flac pcm audio files.
+ *
+ * Copyright (c) 2013 by respective authors.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *
+ * Acknowledgments
+ *
+ * Many thanks to the following authors and projects whose work has greatly
+ * helped the development of this tool.
+ *
+ *
+ * Sebastian Gesemann - dsd2pcm (http://code.google.com/p/dsd2pcm/)
+ * SACD Ripper (http://code.google.com/p/sacd-ripper/)
+ * Maxim V.Anisiutkin - foo_input_sacd (http://sourceforge.net/projects/sacddecoder/files/)
+ * Vladislav Goncharov - foo_input_sacd_hq (http://vladgsound.wordpress.com)
+ * Jesus R - www.sonore.us
+ *
+ */
+
+#ifndef REALTIMESTREAMER_H
+#define REALTIMESTREAMER_H
+
+#include "dsd_sample_reader.h"
+#include "dsd_decimator.h"
+#include "dop_packer.h"
+#include "period_ring.h"
+#include <atomic>
+
+/**
+ * Streams raw PCM or DoP from a reader to a file descriptor (normally stdout into a player)
+ * with as little delay and jitter as possible.
+ *
+ * The output is headerless little endian samples written a period at a time with write(),
+ * no encoder and no stdio buffering. A pipe is shrunk to its smallest size, so that the
+ * kernel does not hold much more audio than the ring does. The decoding runs on its own thread, at real time
+ * priority where the system allows it, and passes whole periods to the writing thread
+ * through a lock free PeriodRing. Playback starts from a seek, so before the first period
+ * only the filter history is read.
+ *
+ * The time from starting to decode a period to it having been written is measured for every
+ * period, as is the time to the first output, and can be read back once stream() returns.
+ */
+class RealtimeStreamer
+{
+public:
+	/// Class constructor. Output is written in periods of periodFrames frames, with up to nPeriods waiting.
+	RealtimeStreamer(DsdSampleReader *reader, dsf2flac_uint32 periodFrames, dsf2flac_uint32 nPeriods);
+	/// Class destructor.
+	virtual ~RealtimeStreamer();
+
+	/// Decode to PCM at sampleRate with bits bits (16, 20 or 24), see PcmFlacSink for the scale and dither.
+	bool setPcmOutput(dsf2flac_uint32 sampleRate, dsf2flac_uint32 bits, bool dither, dsf2flac_float64 userScale);
+	/// Pack the DSD samples into 24 bit DoP.
+	bool setDopOutput();
+
+	/// Stream the whole reader to fd. Returns false if writing fails.
+	bool stream(int fd);
+
+	/// Return false if the output can't be made.
+	bool isValid() { return valid; };
+	/// Returns a message explaining why.
+	std::string getErrorMsg() { return errorMsg; };
+	/// Can be called to display the output format to stderr.
+	void dispFormatInfo();
+
+	/// The output frame rate in Hz.
+	dsf2flac_uint32 getFrameRate() { return frameRate; };
+	/// The ALSA name of the sample format written, e.g. S24_3LE.
+	const char* getFormatName();
+	/// True if the decoding thread got real time scheduling.
+	bool hasRealtimePriority() { return realtimePriority; };
+	/// The time from calling stream() to the first period having been written, in ms.
+	dsf2flac_float64 getStartupLatency() { return startupLatency; };
+	/// The average time from starting to decode a period to it having been written, in ms.
+	dsf2flac_float64 getMeanLatency() { return nPeriodsWritten ? latencySum / nPeriodsWritten : 0; };
+	/// The longest time from starting to decode a period to it having been written, in ms.
+	dsf2flac_float64 getMaxLatency() { return maxLatency; };
+	/// The number of times the writer found no period ready after the first one.
+	dsf2flac_uint32 getNumDecoderWaits() { return nDecoderWaits; };
+	/// The frames written so far, can be called from another thread while streaming.
+	dsf2flac_int64 getFramesWritten() { return framesWritten; };
+	/// The frames in the whole stream, known once stream() has started.
+	dsf2flac_int64 getNumFrames() { return nFrames; };
+	/// The periods decoded and waiting to be written, can be called from another thread while streaming.
+	dsf2flac_uint32 getNumPeriodsReady() { return periodsReady; };
+private:
+	/// The loop run by the decoding thread.
+	void produce();
+	/// Fill p with the next frames frames of output.
+	void fillPeriod(Period* p, dsf2flac_uint32 frames);
+	/// Try to raise the calling thread to real time priority.
+	bool raisePriority();
+private:
+	DsdSampleReader *reader;
+	DsdDecimator *dec;		// set for PCM output
+	DopPacker *packer;		// set for DoP output
+	dsf2flac_uint32 periodFrames;
+	dsf2flac_uint32 nPeriods;
+	dsf2flac_uint32 frameRate;
+	dsf2flac_uint32 frameLength;		// DSD samples per DoP frame
+	dsf2flac_uint32 bits;
+	dsf2flac_uint32 bytesPerSample;
+	dsf2flac_float64 scale;
+	dsf2flac_float64 tpdfDitherPeakAmplitude;
+	dsf2flac_float64 clipAmplitude;
+	std::vector<dsf2flac_int32> samples;	// one period of PCM before packing
+	PeriodRing* ring;
+	std::atomic<dsf2flac_int64> nFrames;		// frames in the whole stream
+	std::atomic<dsf2flac_int64> framesWritten;
+	std::atomic<dsf2flac_uint32> periodsReady;	// a copy of the ring's fill, for other threads
+	std::atomic<bool> produced;			// the decoding thread has committed its last period
+	std::atomic<bool> cancelled;		// the writer has given up
+	bool realtimePriority;
+	dsf2flac_float64 startupLatency;
+	dsf2flac_float64 latencySum;
+	dsf2flac_float64 maxLatency;
+	dsf2flac_uint32 nPeriodsWritten;
+	dsf2flac_uint32 nDecoderWaits;
+	bool valid;
+	std::string errorMsg;
+};
+
+#endif // REALTIMESTREAMER_H
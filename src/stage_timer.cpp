@@ -0,0 +1,217 @@
+/*
+ * dsf2flac - http://code.google.com/p/dsf2flac/
+ *
+ * A file conversion tool for translating dsf dsd audio files into
+ * flac pcm audio files.
+ *
+ * Copyright (c) 2013 by respective authors.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *
+ * Acknowledgments
+ *
+ * Many thanks to the following authors and projects whose work has greatly
+ * helped the development of this tool.
+ *
+ *
+ * Sebastian Gesemann - dsd2pcm (http://code.google.com/p/dsd2pcm/)
+ * SACD Ripper (http://code.google.com/p/sacd-ripper/)
+ * Maxim V.Anisiutkin - foo_input_sacd (http://sourceforge.net/projects/sacddecoder/files/)
+ * Vladislav Goncharov - foo_input_sacd_hq (http://vladgsound.wordpress.com)
+ * Jesus R - www.sonore.us
+ *
+ */
+
+#include <stage_timer.h>
+#include <atomic>
+#include <mutex>
+#include <set>
+#include <stdio.h>
+#include <time.h>
+#include <vector>
+
+bool StageTimer::enabled = false;
+
+static const char* stageNames[NUM_STAGES] = { "read", "dst_decode", "decimate", "quantize", "encode", "write" };
+
+/// Nanoseconds on clock.
+static dsf2flac_uint64 clockNs(clockid_t clock)
+{
+	struct timespec ts;
+	clock_gettime(clock, &ts);
+	return (dsf2flac_uint64) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/**
+ * The totals of one thread. Only the thread itself adds to them, the atomics just let
+ * getTotals() read them from another thread while they change.
+ */
+struct ThreadStages {
+	std::atomic<dsf2flac_uint64> values[NUM_STAGES][4];	// wallNs, cpuNs, bytes, samples
+	std::vector<PipelineStage> stack;	// the stages entered, innermost last
+	dsf2flac_uint64 lastWall;
+	dsf2flac_uint64 lastCpu;
+
+	ThreadStages();
+	~ThreadStages();
+	void add(PipelineStage s, int field, dsf2flac_uint64 v) {
+		values[s][field].store(values[s][field].load(std::memory_order_relaxed) + v, std::memory_order_relaxed);
+	};
+	void get(StageTotals totals[NUM_STAGES]);
+	/// Charge the time since the last change to the innermost stage.
+	void charge();
+};
+
+// every live thread's totals, and what finished threads left behind
+static std::mutex registryLock;
+static std::set<ThreadStages*> registry;
+static StageTotals retired[NUM_STAGES];
+static thread_local ThreadStages threadStages;
+
+ThreadStages::ThreadStages()
+{
+	for (int s=0; s<NUM_STAGES; s++)
+		for (int f=0; f<4; f++)
+			values[s][f] = 0;
+	lastWall = 0;
+	lastCpu = 0;
+	std::lock_guard<std::mutex> lock(registryLock);
+	registry.insert(this);
+}
+
+ThreadStages::~ThreadStages()
+{
+	std::lock_guard<std::mutex> lock(registryLock);
+	StageTotals mine[NUM_STAGES];
+	get(mine);
+	for (int s=0; s<NUM_STAGES; s++) {
+		retired[s].wallNs += mine[s].wallNs;
+		retired[s].cpuNs += mine[s].cpuNs;
+		retired[s].bytes += mine[s].bytes;
+		retired[s].samples += mine[s].samples;
+	}
+	registry.erase(this);
+}
+
+void ThreadStages::get(StageTotals totals[NUM_STAGES])
+{
+	for (int s=0; s<NUM_STAGES; s++) {
+		totals[s].wallNs = values[s][0].load(std::memory_order_relaxed);
+		totals[s].cpuNs = values[s][1].load(std::memory_order_relaxed);
+		totals[s].bytes = values[s][2].load(std::memory_order_relaxed);
+		totals[s].samples = values[s][3].load(std::memory_order_relaxed);
+	}
+}
+
+void ThreadStages::charge()
+{
+	dsf2flac_uint64 wall = clockNs(CLOCK_MONOTONIC);
+	dsf2flac_uint64 cpu = clockNs(CLOCK_THREAD_CPUTIME_ID);
+	if (!stack.empty()) {
+		add(stack.back(), 0, wall - lastWall);
+		add(stack.back(), 1, cpu - lastCpu);
+	}
+	lastWall = wall;
+	lastCpu = cpu;
+}
+
+void StageTimer::enter(PipelineStage s)
+{
+	threadStages.charge();
+	threadStages.stack.push_back(s);
+}
+
+void StageTimer::leave()
+{
+	threadStages.charge();
+	if (!threadStages.stack.empty())
+		threadStages.stack.pop_back();
+}
+
+void StageTimer::count(PipelineStage s, dsf2flac_uint64 bytes, dsf2flac_uint64 samples)
+{
+	threadStages.add(s, 2, bytes);
+	threadStages.add(s, 3, samples);
+}
+
+void StageTimer::getThreadTotals(StageTotals totals[NUM_STAGES])
+{
+	threadStages.get(totals);
+}
+
+void StageTimer::getTotals(StageTotals totals[NUM_STAGES])
+{
+	std::lock_guard<std::mutex> lock(registryLock);
+	for (int s=0; s<NUM_STAGES; s++)
+		totals[s] = retired[s];
+	for (std::set<ThreadStages*>::iterator it = registry.begin(); it != registry.end(); ++it) {
+		StageTotals t[NUM_STAGES];
+		(*it)->get(t);
+		for (int s=0; s<NUM_STAGES; s++) {
+			totals[s].wallNs += t[s].wallNs;
+			totals[s].cpuNs += t[s].cpuNs;
+			totals[s].bytes += t[s].bytes;
+			totals[s].samples += t[s].samples;
+		}
+	}
+}
+
+void StageTimer::subtract(const StageTotals after[NUM_STAGES], const StageTotals before[NUM_STAGES], StageTotals diff[NUM_STAGES])
+{
+	for (int s=0; s<NUM_STAGES; s++) {
+		diff[s].wallNs = after[s].wallNs - before[s].wallNs;
+		diff[s].cpuNs = after[s].cpuNs - before[s].cpuNs;
+		diff[s].bytes = after[s].bytes - before[s].bytes;
+		diff[s].samples = after[s].samples - before[s].samples;
+	}
+}
+
+const char* StageTimer::getStageName(PipelineStage s)
+{
+	return (s >= 0 && s < NUM_STAGES) ? stageNames[s] : "unknown";
+}
+
+std::string StageTimer::toJson(const StageTotals totals[NUM_STAGES])
+{
+	std::string json = "{";
+	char buf[256];
+	for (int s=0; s<NUM_STAGES; s++) {
+		snprintf(buf, sizeof(buf), "%s\"%s\":{\"wall_ms\":%.3f,\"cpu_ms\":%.3f,\"bytes\":%llu,\"samples\":%llu}",
+				s ? "," : "", stageNames[s], totals[s].wallNs / 1e6, totals[s].cpuNs / 1e6,
+				(unsigned long long) totals[s].bytes, (unsigned long long) totals[s].samples);
+		json += buf;
+	}
+	return json + "}";
+}
+
+std::string StageTimer::jsonString(const std::string& s)
+{
+	std::string out = "\"";
+	for (size_t i=0; i<s.size(); i++) {
+		unsigned char c = s[i];
+		if (c == '"' || c == '\\') {
+			out += '\\';
+			out += c;
+		} else if (c < 0x20) {
+			char buf[8];
+			snprintf(buf, sizeof(buf), "\\u%04x", c);
+			out += buf;
+		} else {
+			out += c;
+		}
+	}
+	return out + "\"";
+}
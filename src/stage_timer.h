@@ -0,0 +1,117 @@
+/*
+ * dsf2flac - http://code.google.com/p/dsf2flac/
+ *
+ * A file conversion tool for translating dsf dsd audio files into
+ * flac pcm audio files.
+ *
+ * Copyright (c) 2013 by respective authors.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *
+ * Acknowledgments
+ *
+ * Many thanks to the following authors and projects whose work has greatly
+ * helped the development of this tool.
+ *
+ *
+ * Sebastian Gesemann - dsd2pcm (http://code.google.com/p/dsd2pcm/)
+ * SACD Ripper (http://code.google.com/p/sacd-ripper/)
+ * Maxim V.Anisiutkin - foo_input_sacd (http://sourceforge.net/projects/sacddecoder/files/)
+ * Vladislav Goncharov - foo_input_sacd_hq (http://vladgsound.wordpress.com)
+ * Jesus R - www.sonore.us
+ *
+ */
+
+#ifndef STAGETIMER_H
+#define STAGETIMER_H
+
+#include "dsf2flac_types.h"
+#include <string>
+
+/// The stages of a conversion which are timed.
+enum PipelineStage {
+	STAGE_READ = 0,		// reading DSD data from the input file
+	STAGE_DST_DECODE,	// decompressing DST frames
+	STAGE_DECIMATE,		// filtering DSD down to PCM
+	STAGE_QUANTIZE,		// scaling, dithering and rounding the PCM
+	STAGE_ENCODE,		// FLAC encoding (libFLAC writes its own output, so this includes that)
+	STAGE_WRITE,		// writing the output files
+	NUM_STAGES
+};
+
+/// What has been spent in one stage.
+typedef struct {
+	dsf2flac_uint64 wallNs;		// wall clock time
+	dsf2flac_uint64 cpuNs;		// cpu time of the thread
+	dsf2flac_uint64 bytes;		// bytes read, decoded or written
+	dsf2flac_uint64 samples;	// samples (of all channels) produced
+} StageTotals;
+
+/**
+ * Accumulates the wall and cpu time spent in each stage of the conversion, plus the bytes and
+ * samples each one handles, so the bottleneck can be found.
+ *
+ * Code marks a stage with a StageScope. Stages nest, the time is always charged to the innermost
+ * one only (the file reads made while the decimator steps the reader count as reading, not as
+ * decimation). Every thread keeps its own totals, so timing needs no locks; they can be read for
+ * the calling thread alone (e.g. for one file) or summed over every thread.
+ *
+ * Timing is off until setEnabled(true) is called, a StageScope then costs a single test.
+ * The bytes and samples are always counted, they are cheap and the progress metrics use them.
+ */
+class StageTimer
+{
+public:
+	/// Turn timing on or off, before any worker threads are started.
+	static void setEnabled(bool e) { enabled = e; };
+	/// True if timing is on.
+	static bool isEnabled() { return enabled; };
+
+	/// Start charging time to stage s, until the matching leave(). Use StageScope rather than calling this.
+	static void enter(PipelineStage s);
+	/// Stop charging time to the stage entered last.
+	static void leave();
+	/// Add bytes and samples handled by stage s (counted even when timing is off).
+	static void count(PipelineStage s, dsf2flac_uint64 bytes, dsf2flac_uint64 samples);
+
+	/// The totals of the calling thread since it started.
+	static void getThreadTotals(StageTotals totals[NUM_STAGES]);
+	/// The totals of every thread since the program started.
+	static void getTotals(StageTotals totals[NUM_STAGES]);
+	/// Sets diff to the totals in after which were not yet in before.
+	static void subtract(const StageTotals after[NUM_STAGES], const StageTotals before[NUM_STAGES], StageTotals diff[NUM_STAGES]);
+
+	/// The name of a stage as used in the JSON, e.g. "dst_decode".
+	static const char* getStageName(PipelineStage s);
+	/// The totals as a JSON object with one member per stage.
+	static std::string toJson(const StageTotals totals[NUM_STAGES]);
+	/// s as a quoted JSON string.
+	static std::string jsonString(const std::string& s);
+private:
+	static bool enabled;
+};
+
+/// Charges the time until it goes out of scope to a stage (when timing is on).
+class StageScope
+{
+public:
+	StageScope(PipelineStage s) { active = StageTimer::isEnabled(); if (active) StageTimer::enter(s); };
+	~StageScope() { if (active) StageTimer::leave(); };
+private:
+	bool active;
+};
+
+#endif // STAGETIMER_H
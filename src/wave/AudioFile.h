@@ -41,6 +41,13 @@ public:
     //=============================================================
     typedef std::vector<std::vector<T> > AudioBuffer;
 
+    /** The layout of the header written by getHeaderData() */
+    enum class HeaderFormat {
+        Riff, // plain 44 byte RIFF header, data must be smaller than 4 GiB
+        Rf64, // RF64 header with a ds64 chunk holding the 64 bit sizes
+        RiffSizeUnknown // RIFF header with all sizes set to 0xFFFFFFFF, for streams of unknown length
+    };
+
     //=============================================================
 
     /** Constructor */
@@ -80,7 +87,7 @@ public:
     }
 
     /** @Returns the number of samples per channel */
-    size_t getNumSamplesPerChannel() const {
+    uint64_t getNumSamplesPerChannel() const {
         return numSamples;
     }
 
@@ -106,7 +113,7 @@ public:
     /** Sets the number of samples per channel in the audio buffer. This will try to preserve
      * the existing audio, adding zeros to new samples in a given channel if the number of samples is increased.
      */
-    void setNumSamples(uint32_t aNumSamples) {
+    void setNumSamples(uint64_t aNumSamples) {
         numSamples = aNumSamples;
     }
 
@@ -126,24 +133,61 @@ public:
     }
 
 
+    /** @Returns the size of the data chunk in bytes */
+    uint64_t getDataChunkSize() const {
+        return (uint64_t) getNumSamplesPerChannel() * getNumChannels() * getBitDepth() / 8;
+    }
+
+    /** @Returns true if the data is too big for a plain RIFF header */
+    bool needsRF64() const {
+        return getDataChunkSize() + 44 - 8 > 0xFFFFFFFFULL;
+    }
+
+    /** @Returns the size in bytes of the header written for the given format */
+    static size_t getHeaderSize(HeaderFormat format) {
+        return format == HeaderFormat::Rf64 ? 80 : 44;
+    }
+
     //=============================================================
 
+    /** Writes a RIFF header, or an RF64 one if the data is too big for RIFF */
     void getHeaderData(std::vector<uint8_t>& fileData) {
+        getHeaderData(fileData, needsRF64() ? HeaderFormat::Rf64 : HeaderFormat::Riff);
+    }
+
+    void getHeaderData(std::vector<uint8_t>& fileData, HeaderFormat format) {
         fileData.clear();
 
 
-        size_t dataChunkSize = getNumSamplesPerChannel() * getNumChannels() * getBitDepth() / 8;
+        uint64_t dataChunkSize = getDataChunkSize();
+        uint64_t fileSizeInBytes = dataChunkSize + getHeaderSize(format) - 8;
 
         // -----------------------------------------------------------
         // HEADER CHUNK
-        addStringToFileData(fileData, "RIFF");
-
-
-        size_t fileSizeInBytes = dataChunkSize + 44 - 8;
-        addInt32ToFileData(fileData, fileSizeInBytes);
+        if (format == HeaderFormat::Rf64) {
+            addStringToFileData(fileData, "RF64");
+            addInt32ToFileData(fileData, -1); // real size is in the ds64 chunk
+        } else {
+            addStringToFileData(fileData, "RIFF");
+            if (format == HeaderFormat::RiffSizeUnknown)
+                addInt32ToFileData(fileData, -1);
+            else
+                addInt32ToFileData(fileData, fileSizeInBytes);
+        }
 
         addStringToFileData(fileData, "WAVE");
 
+        // -----------------------------------------------------------
+        // DS64 CHUNK (RF64 only)
+        if (format == HeaderFormat::Rf64) {
+            addStringToFileData(fileData, "ds64");
+            addInt32ToFileData(fileData, 28); // ds64 chunk size, no table
+            addInt64ToFileData(fileData, fileSizeInBytes);
+            addInt64ToFileData(fileData, dataChunkSize);
+            addInt64ToFileData(fileData, getNumSamplesPerChannel());
+            addInt32ToFileData(fileData, 0); // table length
+        }
+
         // -----------------------------------------------------------
         // FORMAT CHUNK
         addStringToFileData(fileData, "fmt ");
@@ -165,7 +209,10 @@ public:
         // -----------------------------------------------------------
         // DATA CHUNK
         addStringToFileData(fileData, "data");
-        addInt32ToFileData(fileData, dataChunkSize);
+        if (format == HeaderFormat::Riff)
+            addInt32ToFileData(fileData, dataChunkSize);
+        else
+            addInt32ToFileData(fileData, -1);
 
 
     }
@@ -175,7 +222,7 @@ public:
         std::ofstream* out = NULL;
 
         if (filePath != "-") {
-            out = new ofstream(filePath, std::ios::binary);
+            out = new std::ofstream(filePath, std::ios::binary);
             if (out == NULL) {
                 return false;
             }
@@ -202,7 +249,7 @@ public:
             std::cout.write((char*) fileData.data(), fileData.size());
         }
 
-        for (uint32_t i = 0; i < getNumSamplesPerChannel(); i++) {
+        for (uint64_t i = 0; i < getNumSamplesPerChannel(); i++) {
             for (uint16_t channel = 0; channel < getNumChannels(); channel++) {
 
                 if (out != NULL) {
@@ -299,6 +346,12 @@ private:
             fileData.push_back(bytes[i]);
     }
 
+    void addInt64ToFileData(std::vector<uint8_t>& fileData, uint64_t i) {
+        // RF64 sizes are always little endian
+        for (int b = 0; b < 8; b++)
+            fileData.push_back((i >> (8 * b)) & 0xFF);
+    }
+
     void addInt16ToFileData(std::vector<uint8_t>& fileData, int16_t i, Endianness endianness = Endianness::LittleEndian) {
         uint8_t bytes[2];
 
@@ -318,7 +371,7 @@ private:
     //=============================================================
     uint32_t sampleRate;
     uint16_t bitDepth;
-    size_t numSamples;
+    uint64_t numSamples;
     uint16_t numChannels;
 };
 